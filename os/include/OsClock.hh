@@ -0,0 +1,171 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- c++ -*-
+
+#ifndef OCPIOSCLOCK_H__
+#define OCPIOSCLOCK_H__
+
+/**
+ * \file
+ * \brief A high resolution clock for timestamping in hot paths.
+ *
+ * OCPI::OS::Clock::now() returns nanoseconds on the CLOCK_MONOTONIC_RAW timeline.
+ * When the CPU has an invariant time stamp counter and the fasttimed daemon is
+ * publishing a calibration of it in shared memory, the time is computed from the
+ * counter without a system call, and all processes on the system share the same
+ * calibration.  Otherwise, or if the daemon stops updating the calibration, it is
+ * read from CLOCK_MONOTONIC_RAW.  Setting the OCPI_CLOCK environment variable to
+ * "system" forces the latter.
+ */
+
+#include <cstdint>
+#include <time.h>
+
+namespace OCPI {
+  namespace OS {
+    namespace Clock {
+
+      /**
+       * The calibration of the cycle counter published in shared memory.  It is a line
+       * through (cycleBase, nsBase) with slope mult / 2^c_shift nanoseconds per cycle.
+       * Each update starts the new line where the old one was at that moment, so time
+       * never jumps; the slope is adjusted to absorb the measured error by the next update.
+       * Readers use "sequence" as a sequence lock: it is odd while being written.
+       */
+      struct Calibration {
+	uint32_t magic;
+	volatile uint32_t sequence;
+	uint64_t cycleBase;
+	uint64_t nsBase;
+	uint64_t mult;
+	uint64_t hz;          // measured cycle frequency
+	int64_t  errorNs;     // difference from CLOCK_MONOTONIC_RAW at the last update
+	uint64_t intervalNs;  // time between the last two updates
+	uint64_t updates;
+      };
+      const uint32_t c_magic = 0x4f434c4b; // "OCLK"
+      const unsigned c_shift = 32;
+      extern const char c_shmName[];
+
+      // CLOCK_MONOTONIC_RAW in nanoseconds
+      inline uint64_t system() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+      }
+
+      // The raw cycle counter, or the system clock on CPUs where we don't read one
+      inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return system();
+#endif
+      }
+
+      // The low 64 bits of (a * b) >> c_shift, from 32 bit halves so it works where
+      // there is no 128 bit type
+      inline uint64_t mulShift(uint64_t a, uint64_t b) {
+	uint64_t
+	  aLo = a & 0xffffffff, aHi = a >> 32,
+	  bLo = b & 0xffffffff, bHi = b >> 32;
+	return ((aHi * bHi) << 32) + aHi * bLo + aLo * bHi + ((aLo * bLo) >> 32);
+      }
+
+      // Where a cycle count falls on a calibration's line.  A count before cycleBase
+      // wraps to a value 2^64 too large, which adds (mult << c_shift) to the product.
+      inline uint64_t convert(const volatile Calibration &c, uint64_t a_cycles) {
+	uint64_t delta = a_cycles - c.cycleBase, mult = c.mult;
+	uint64_t ns = mulShift(delta, mult);
+	if ((int64_t)delta < 0)
+	  ns -= mult << c_shift;
+	return c.nsBase + ns;
+      }
+
+      namespace Internal {
+	extern const volatile Calibration *g_calibration; // NULL when not using the counter
+	extern volatile bool g_initialized;
+	extern uint64_t g_staleNs; // the calibration is abandoned when not updated this long
+	void initialize();
+	void stale();
+	// Read a consistent pair of cycle count and conversion
+	inline uint64_t read(const volatile Calibration &c, uint64_t *a_cycles = NULL) {
+	  uint32_t seq;
+	  uint64_t cyc, ns;
+	  do {
+	    seq = __atomic_load_n(&c.sequence, __ATOMIC_ACQUIRE);
+	    cyc = cycles();
+	    ns = convert(c, cyc);
+	    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+	  } while ((seq & 1) || seq != c.sequence);
+	  if (a_cycles)
+	    *a_cycles = cyc;
+	  return ns;
+	}
+      }
+
+      // Nanoseconds on the CLOCK_MONOTONIC_RAW timeline
+      inline uint64_t now() {
+	if (!Internal::g_initialized)
+	  Internal::initialize();
+	const volatile Calibration *c = Internal::g_calibration;
+	if (!c)
+	  return system();
+	uint64_t ns = Internal::read(*c);
+	if ((int64_t)(ns - c->nsBase) < (int64_t)Internal::g_staleNs)
+	  return ns;
+	Internal::stale();
+	return system();
+      }
+
+      // Convert a value previously returned by cycles() to now()'s timeline.
+      // Return false if now() is not based on the cycle counter.
+      bool cyclesToNs(uint64_t a_cycles, uint64_t &ns);
+
+      // Wall clock nanoseconds since the epoch, as now() plus the offset between the
+      // clocks, measured again each second.  Suitable for log stamps, not for keeping time.
+      uint64_t realtime();
+
+      // "tsc" or "monotonic_raw"
+      const char *source();
+
+      /**
+       * The calibrating side, used by the fasttimed daemon.  The constructor creates
+       * the shared memory segment and makes an initial short measurement, and update()
+       * should be called periodically after that.
+       */
+      class Publisher {
+	Calibration *m_calibration;
+	uint64_t m_firstCycles, m_firstNs, m_lastNs;
+	void sample(uint64_t &a_cycles, uint64_t &ns);
+	void publish(uint64_t a_cycles, uint64_t ns, uint64_t mult, int64_t error);
+      public:
+	// Throws a std::string if the counter is not usable or the segment can't be created
+	Publisher();
+	~Publisher();
+	void update();
+	const Calibration &calibration() const { return *m_calibration; }
+      };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#include "OsPosixError.hh"
+#include "OsClock.hh"
+
+namespace OCPI {
+  namespace OS {
+    namespace Clock {
+
+const char c_shmName[] = "/ocpi-clock";
+// A calibration not updated for this long (or 4 update intervals if longer) is ignored
+static const uint64_t c_staleNs = 60ull * 1000000000ull;
+// How often the offset between now() and the wall clock is measured again
+static const uint64_t c_anchorNs = 1000000000ull;
+// Limits on how quickly the published slope is slewed, and when we step instead
+static const int64_t c_maxPpm = 500, c_stepNs = 10 * 1000000;
+
+// (num << c_shift) / den, one bit at a time since there may be no 128 bit type
+static uint64_t
+divShift(uint64_t num, uint64_t den) {
+  uint64_t q = num / den, r = num % den;
+  for (unsigned n = 0; n < c_shift; n++) {
+    bool carry = (r >> 63) != 0;
+    q <<= 1;
+    r <<= 1;
+    if (carry || r >= den) {
+      r -= den;
+      q |= 1;
+    }
+  }
+  return q;
+}
+
+// Does the CPU say that its time stamp counter runs at a constant rate in all states?
+static bool
+invariantCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned a, b, c, d;
+  return __get_cpuid(0x80000000, &a, &b, &c, &d) && a >= 0x80000007 &&
+    __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1u << 8));
+#else
+  return false;
+#endif
+}
+
+namespace Internal {
+  const volatile Calibration *g_calibration;
+  volatile bool g_initialized;
+  uint64_t g_staleNs = c_staleNs;
+  static volatile int64_t s_realtimeOffset;
+  static volatile uint64_t s_anchor; // now() when s_realtimeOffset was measured
+  static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+
+  // Measure the offset from now() to the wall clock, which is slewed or stepped
+  // by time synchronization while now() is not.
+  static void
+  anchor() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const volatile Calibration *c = g_calibration;
+    uint64_t mono = c ? read(*c) : system();
+    __atomic_store_n(&s_realtimeOffset,
+		     (int64_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec - mono),
+		     __ATOMIC_RELAXED);
+    __atomic_store_n(&s_anchor, mono, __ATOMIC_RELAXED);
+  }
+
+  // Decide whether to use the published calibration.  This must not log since
+  // the logging code uses the clock.
+  static void
+  doInitialize() {
+    const char *env = getenv("OCPI_CLOCK");
+    int fd;
+    if ((!env || strcasecmp(env, "system")) && invariantCounter() &&
+	(fd = shm_open(c_shmName, O_RDONLY, 0)) >= 0) {
+      struct stat st;
+      void *p;
+      if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Calibration) &&
+	  (p = mmap(NULL, sizeof(Calibration), PROT_READ, MAP_SHARED, fd, 0)) != MAP_FAILED) {
+	const volatile Calibration &c = *(const volatile Calibration *)p;
+	uint64_t sys = system(), ns = read(c);
+	int64_t diff = (int64_t)(ns - sys);
+	uint64_t stale = c.intervalNs * 4 > c_staleNs ? c.intervalNs * 4 : c_staleNs;
+	if (c.magic == c_magic && c.updates && sys - c.nsBase < stale &&
+	    diff < c_stepNs && diff > -c_stepNs) {
+	  g_staleNs = stale;
+	  g_calibration = &c;
+	} else
+	  munmap(p, sizeof(Calibration));
+      }
+      close(fd);
+    }
+    anchor();
+    __atomic_store_n(&g_initialized, true, __ATOMIC_RELEASE);
+  }
+
+  // The publisher has stopped updating the calibration (e.g. the daemon exited), so
+  // the line is no longer being corrected: use the system clock from now on.
+  void
+  stale() {
+    __atomic_store_n(&g_calibration, (const volatile Calibration *)NULL, __ATOMIC_RELEASE);
+  }
+
+  void
+  initialize() {
+    pthread_once(&s_once, doInitialize);
+  }
+}
+
+bool
+cyclesToNs(uint64_t a_cycles, uint64_t &ns) {
+  if (!Internal::g_initialized)
+    Internal::initialize();
+  const volatile Calibration *c = Internal::g_calibration;
+  if (!c)
+    return false;
+  uint32_t seq;
+  do {
+    seq = __atomic_load_n(&c->sequence, __ATOMIC_ACQUIRE);
+    ns = convert(*c, a_cycles);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || seq != c->sequence);
+  return true;
+}
+
+uint64_t
+realtime() {
+  uint64_t mono = now(); // initializes
+  if (mono - __atomic_load_n(&Internal::s_anchor, __ATOMIC_RELAXED) >= c_anchorNs) {
+    Internal::anchor();
+    mono = now();
+  }
+  return mono + (uint64_t)__atomic_load_n(&Internal::s_realtimeOffset, __ATOMIC_RELAXED);
+}
+
+const char *
+source() {
+  if (!Internal::g_initialized)
+    Internal::initialize();
+  return Internal::g_calibration ? "tsc" : "monotonic_raw";
+}
+
+Publisher::
+Publisher()
+  : m_calibration(NULL) {
+  if (!invariantCounter())
+    throw std::string("the CPU's cycle counter is not invariant");
+  int fd = shm_open(c_shmName, O_CREAT | O_RDWR, 0644);
+  if (fd < 0)
+    throw OCPI::OS::Posix::getErrorMessage(errno);
+  void *p;
+  if (ftruncate(fd, sizeof(Calibration)) != 0 ||
+      (p = mmap(NULL, sizeof(Calibration), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) ==
+      MAP_FAILED) {
+    int err = errno;
+    close(fd);
+    shm_unlink(c_shmName);
+    throw OCPI::OS::Posix::getErrorMessage(err);
+  }
+  close(fd);
+  m_calibration = (Calibration *)p;
+  memset(m_calibration, 0, sizeof(Calibration));
+  // An initial estimate from a short baseline, refined by update()
+  uint64_t cyc = 0, ns = 0;
+  sample(m_firstCycles, m_firstNs);
+  struct timespec ts = { 0, 50 * 1000000 };
+  nanosleep(&ts, NULL);
+  sample(cyc, ns);
+  m_lastNs = ns;
+  m_calibration->intervalNs = ns - m_firstNs;
+  publish(cyc, ns, divShift(ns - m_firstNs, cyc - m_firstCycles), 0);
+  __atomic_store_n(&m_calibration->magic, c_magic, __ATOMIC_RELEASE);
+}
+
+Publisher::
+~Publisher() {
+  if (m_calibration) {
+    munmap(m_calibration, sizeof(Calibration));
+    shm_unlink(c_shmName);
+  }
+}
+
+// Take the pair of readings least disturbed by preemption or interrupts,
+// attributing the system time to the middle of the counter readings around it.
+void Publisher::
+sample(uint64_t &a_cycles, uint64_t &ns) {
+  uint64_t best = UINT64_MAX;
+  for (unsigned n = 0; n < 16; n++) {
+    uint64_t before = cycles(), sys = system(), after = cycles();
+    if (after - before < best) {
+      best = after - before;
+      a_cycles = before + (after - before) / 2;
+      ns = sys;
+    }
+  }
+}
+
+void Publisher::
+publish(uint64_t a_cycles, uint64_t ns, uint64_t mult, int64_t error) {
+  Calibration &c = *m_calibration;
+  __atomic_store_n(&c.sequence, c.sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  c.cycleBase = a_cycles;
+  c.nsBase = ns;
+  c.mult = mult;
+  c.hz = divShift(1000000000ull, mult);
+  c.errorNs = error;
+  c.updates++;
+  __atomic_store_n(&c.sequence, c.sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Measure the rate over the whole time we have been running, start the new line where
+// the old one is now, and tilt it so that the current error is gone by the next update,
+// assuming that is as far away as the last one was.
+void Publisher::
+update() {
+  uint64_t cyc = 0, ns = 0;
+  sample(cyc, ns);
+  Calibration &c = *m_calibration;
+  uint64_t
+    interval = ns - m_lastNs,
+    rate = divShift(ns - m_firstNs, cyc - m_firstCycles),
+    old = convert(c, cyc);
+  int64_t error = (int64_t)(old - ns);
+  m_lastNs = ns;
+  c.intervalNs = interval;
+  if (error >= c_stepNs || error <= -c_stepNs || !interval) {
+    publish(cyc, ns, rate, error); // too far off to slew, so step
+    return;
+  }
+  // |error| < c_stepNs, so rate * error fits in 64 bits for any counter faster than
+  // about 5MHz: rate is 2^c_shift times the nanoseconds per cycle
+  int64_t
+    adjust = ((int64_t)rate * error) / (int64_t)interval,
+    limit = ((int64_t)rate * c_maxPpm) / 1000000;
+  if (adjust > limit)
+    adjust = limit;
+  else if (adjust < -limit)
+    adjust = -limit;
+  publish(cyc, old, (uint64_t)((int64_t)rate - adjust), error);
+}
+    }
+  }
+}
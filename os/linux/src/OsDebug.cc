@@ -20,16 +20,22 @@
 
 #include <signal.h>
 #include <unistd.h>
-#include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
 #include <execinfo.h>
 #include <stdarg.h>
 #include <cstdlib>
+#include <cstddef>
+#include <string>
 #include <iostream>
 #include <cstdio>
 #include <climits>
 #include <cstring>
 #include "OsDebug.hh"
 #include "OsMutex.hh"
+#include "OsClock.hh"
 
 namespace OCPI {
   namespace OS {
@@ -102,14 +108,481 @@ namespace OCPI {
       }
       return n <= logLevel;
     }
+    // Format the start of a log line in the traditional format, given a time from
+    // OCPI::OS::Clock::realtime(), which is cheaper than gettimeofday
+    static void
+    formatPrefix(char *buf, size_t size, unsigned n, uint64_t ns) {
+      snprintf(buf, size, "OCPI(%2d:%3u.%04u): ", n, (unsigned)((ns/1000000000)%1000),
+	       (unsigned)((ns%1000000000 + 500000)/1000000));
+    }
+    static void
+    logPrefix(std::string &out, unsigned n, uint64_t ns) {
+      char buf[40];
+      formatPrefix(buf, sizeof(buf), n, ns);
+      out += buf;
+    }
+
+    // Asynchronous logging, enabled by the OCPI_LOG_ASYNC environment variable.
+    // Callers copy the format and capture the argument values into a per-thread,
+    // single-producer/single-consumer ring buffer without locking or formatting.
+    // The format is copied since it may be a temporary or in a module that is unloaded.
+    // A background thread merges the rings in time order, formats the records and writes
+    // them to stderr.  When a ring is full the message is dropped and counted.
+    namespace {
+      const size_t
+	ASYNC_DEFAULT_KB = 64,   // default per-thread ring size
+	ASYNC_MIN_SIZE = 16*1024,
+	ASYNC_MAX_RECORD = 4096, // larger messages are truncated
+	ASYNC_IDLE_NS = 2000000; // consumer polling interval when idle
+      const uint32_t ASYNC_PAD = UINT32_MAX; // level of a padding record at the end of a ring
+
+      struct AsyncRecord {
+	uint32_t size;      // total size of the record, a multiple of 8
+	uint32_t level;     // or ASYNC_PAD
+	uint64_t ns;        // OCPI::OS::Clock::realtime()
+	uint32_t fmtSize;   // the format and its null follow, zero when preformatted
+	uint32_t unused;
+	// argument values follow the format, or the preformatted string
+      };
+      struct ThreadLog {
+	ThreadLog *next;    // on the list of all rings, which are never freed
+	bool inUse;         // owned by a live thread
+	uint64_t head, tail; // consumer and producer positions, never wrapped
+	size_t size;        // power of two
+	uint8_t *ring;
+      };
+
+      enum ArgType { AT_INT, AT_LONG, AT_LONGLONG, AT_SIZE, AT_INTMAX, AT_PTRDIFF,
+		     AT_DOUBLE, AT_LONGDOUBLE, AT_POINTER, AT_STRING, AT_NONE };
+      // Parse one conversion specification starting just after the %.
+      // Return false for those we do not handle asynchronously (positional, %n, wide).
+      struct ConvSpec {
+	const char *end;     // after the conversion character
+	bool widthStar, precStar;
+	int precision;       // literal precision, or -1
+	ArgType type;
+      };
+      bool
+      parseSpec(const char *cp, ConvSpec &cs) {
+	cs.widthStar = cs.precStar = false;
+	cs.precision = -1;
+	if (*cp == '%') {
+	  cs.end = cp + 1;
+	  cs.type = AT_NONE;
+	  return true;
+	}
+	cp += strspn(cp, "-+ #0'");
+	if (*cp == '*') {
+	  cs.widthStar = true;
+	  cp++;
+	} else
+	  while (*cp >= '0' && *cp <= '9')
+	    cp++;
+	if (*cp == '$')
+	  return false;
+	if (*cp == '.') {
+	  if (*++cp == '*') {
+	    cs.precStar = true;
+	    cp++;
+	  } else
+	    for (cs.precision = 0; *cp >= '0' && *cp <= '9'; cp++)
+	      cs.precision = cs.precision * 10 + (*cp - '0');
+	}
+	ArgType integer = AT_INT;
+	bool isLong = false, isLongDouble = false;
+	switch (*cp) {
+	case 'h': cp += cp[1] == 'h' ? 2 : 1; break;
+	case 'l':
+	  if (cp[1] == 'l') {
+	    integer = AT_LONGLONG;
+	    cp += 2;
+	  } else {
+	    integer = AT_LONG;
+	    isLong = true;
+	    cp++;
+	  }
+	  break;
+	case 'q': integer = AT_LONGLONG; cp++; break;
+	case 'L': integer = AT_LONGLONG; isLongDouble = true; cp++; break;
+	case 'z': integer = AT_SIZE; cp++; break;
+	case 'j': integer = AT_INTMAX; cp++; break;
+	case 't': integer = AT_PTRDIFF; cp++; break;
+	default:;
+	}
+	switch (*cp) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+	  cs.type = integer; break;
+	case 'c':
+	  if (isLong)
+	    return false;
+	  cs.type = AT_INT; break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+	  cs.type = isLongDouble ? AT_LONGDOUBLE : AT_DOUBLE; break;
+	case 'p':
+	  cs.type = AT_POINTER; break;
+	case 's':
+	  if (isLong)
+	    return false;
+	  cs.type = AT_STRING; break;
+	default:
+	  return false;
+	}
+	cs.end = cp + 1;
+	return true;
+      }
+      inline bool
+      put(uint8_t *&p, uint8_t *end, const void *v, size_t n) {
+	if (p + n > end)
+	  return false;
+	memcpy(p, v, n);
+	p += n;
+	return true;
+      }
+      // Capture the argument values, returning false if the message must be preformatted
+      bool
+      capture(const char *fmt, va_list ap, uint8_t *&p, uint8_t *end) {
+	ConvSpec cs;
+	for (const char *cp = fmt; (cp = strchr(cp, '%')); cp = cs.end) {
+	  if (!parseSpec(cp + 1, cs))
+	    return false;
+	  int star;
+	  if (cs.widthStar && (star = va_arg(ap, int), !put(p, end, &star, sizeof(star))))
+	    return false;
+	  if (cs.precStar && (cs.precision = star = va_arg(ap, int),
+			      !put(p, end, &star, sizeof(star))))
+	    return false;
+	  union {
+	    int i; long l; long long ll; size_t z; intmax_t j; ptrdiff_t t;
+	    double d; long double ld; void *ptr;
+	  } u;
+	  size_t n;
+	  switch (cs.type) {
+	  case AT_INT: u.i = va_arg(ap, int); n = sizeof(int); break;
+	  case AT_LONG: u.l = va_arg(ap, long); n = sizeof(long); break;
+	  case AT_LONGLONG: u.ll = va_arg(ap, long long); n = sizeof(long long); break;
+	  case AT_SIZE: u.z = va_arg(ap, size_t); n = sizeof(size_t); break;
+	  case AT_INTMAX: u.j = va_arg(ap, intmax_t); n = sizeof(intmax_t); break;
+	  case AT_PTRDIFF: u.t = va_arg(ap, ptrdiff_t); n = sizeof(ptrdiff_t); break;
+	  case AT_DOUBLE: u.d = va_arg(ap, double); n = sizeof(double); break;
+	  case AT_LONGDOUBLE: u.ld = va_arg(ap, long double); n = sizeof(long double); break;
+	  case AT_POINTER: u.ptr = va_arg(ap, void *); n = sizeof(void *); break;
+	  case AT_STRING: {
+	    // With a precision, the string need not be null terminated
+	    const char *str = va_arg(ap, const char *);
+	    uint32_t len = !str ? UINT32_MAX :
+	      (uint32_t)(cs.precision >= 0 ? strnlen(str, (size_t)cs.precision) : strlen(str));
+	    if (!put(p, end, &len, sizeof(len)) || (str && !put(p, end, str, len)))
+	      return false;
+	    continue;
+	  }
+	  default:
+	    continue;
+	  }
+	  if (!put(p, end, &u, n))
+	    return false;
+	}
+	return true;
+      }
+      inline void
+      get(const uint8_t *&p, void *v, size_t n) {
+	memcpy(v, p, n);
+	p += n;
+      }
+      // Format a captured record, reparsing the format to find the argument types.
+      // Each conversion is formatted with its * width and precision made literal.
+      void
+      format(std::string &out, const AsyncRecord &r) {
+	const uint8_t *p = (const uint8_t *)(&r + 1);
+	if (!r.fmtSize) {
+	  uint32_t len;
+	  get(p, &len, sizeof(len));
+	  out.append((const char *)p, len);
+	  return;
+	}
+	const char *fmt = (const char *)p;
+	p += r.fmtSize;
+	ConvSpec cs;
+	std::string spec;
+	char buf[512];
+	for (const char *cp = fmt; (cp = strchr(fmt, '%')); fmt = cs.end) {
+	  out.append(fmt, (size_t)(cp - fmt));
+	  parseSpec(cp + 1, cs); // this succeeded during capture
+	  if (cs.type == AT_NONE) {
+	    out += '%';
+	    continue;
+	  }
+	  spec.assign(cp, (size_t)(cs.end - cp));
+	  int star;
+	  if (cs.widthStar) {
+	    get(p, &star, sizeof(star));
+	    snprintf(buf, sizeof(buf), "%d", star);
+	    spec.replace(spec.find('*'), 1, buf);
+	  }
+	  if (cs.precStar) {
+	    get(p, &star, sizeof(star));
+	    snprintf(buf, sizeof(buf), "%d", star);
+	    spec.replace(spec.find('*'), 1, buf);
+	  }
+	  const char *sp = spec.c_str();
+	  int n = 0;
+	  std::string str;
+	  switch (cs.type) {
+	  case AT_INT: { int v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_LONG: { long v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_LONGLONG: { long long v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_SIZE: { size_t v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_INTMAX: { intmax_t v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_PTRDIFF: { ptrdiff_t v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_DOUBLE: { double v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_LONGDOUBLE: { long double v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_POINTER: { void *v; get(p, &v, sizeof(v)); n = snprintf(buf, sizeof(buf), sp, v); break; }
+	  case AT_STRING: {
+	    uint32_t len;
+	    get(p, &len, sizeof(len));
+	    const char *v = NULL;
+	    if (len != UINT32_MAX) {
+	      str.assign((const char *)p, len);
+	      p += len;
+	      v = str.c_str();
+	    }
+	    // Strings may be longer than the local buffer
+	    n = snprintf(NULL, 0, sp, v);
+	    if (n > 0) {
+	      size_t start = out.size();
+	      out.resize(start + (size_t)n + 1);
+	      snprintf(&out[start], (size_t)n + 1, sp, v);
+	      out.resize(start + (size_t)n);
+	    }
+	    continue;
+	  }
+	  default:;
+	  }
+	  if (n > 0)
+	    out.append(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+	}
+	out += fmt;
+      }
+
+      pthread_once_t s_asyncOnce = PTHREAD_ONCE_INIT;
+      pthread_key_t s_asyncKey;
+      pthread_t s_asyncThread;
+      size_t s_asyncSize;          // per-thread ring size, zero when not asynchronous
+      bool s_asyncRunning, s_asyncStop;
+      unsigned s_asyncProducers;   // threads between checking s_asyncRunning and enqueuing
+      ThreadLog *s_threadLogs;     // list of all rings
+      uint64_t s_asyncDropped;
+      __thread ThreadLog *t_log;
+
+      // Write everything available, in time order across the threads.
+      // Return whether anything was written.
+      bool
+      asyncDrain() {
+	std::string out;
+	bool any = false;
+	while (true) {
+	  ThreadLog *oldest = NULL;
+	  AsyncRecord *oldestRec = NULL;
+	  for (ThreadLog *tl = __atomic_load_n(&s_threadLogs, __ATOMIC_ACQUIRE); tl; tl = tl->next)
+	    while (tl->head != __atomic_load_n(&tl->tail, __ATOMIC_ACQUIRE)) {
+	      AsyncRecord *r = (AsyncRecord *)(tl->ring + (tl->head & (tl->size - 1)));
+	      if (r->level == ASYNC_PAD) {
+		__atomic_store_n(&tl->head, tl->head + r->size, __ATOMIC_RELEASE);
+		continue;
+	      }
+	      if (!oldestRec || r->ns < oldestRec->ns) {
+		oldest = tl;
+		oldestRec = r;
+	      }
+	      break;
+	    }
+	  if (!oldest)
+	    break;
+	  logPrefix(out, oldestRec->level, oldestRec->ns);
+	  format(out, *oldestRec);
+	  if (out.empty() || out[out.size() - 1] != '\n')
+	    out += '\n';
+	  __atomic_store_n(&oldest->head, oldest->head + oldestRec->size, __ATOMIC_RELEASE);
+	  any = true;
+	  if (out.size() > 64*1024) {
+	    fwrite(out.data(), 1, out.size(), stderr);
+	    out.clear();
+	  }
+	}
+	static uint64_t reported;
+	uint64_t dropped = __atomic_load_n(&s_asyncDropped, __ATOMIC_RELAXED);
+	if (dropped != reported) {
+	  logPrefix(out, OCPI_LOG_BAD, OCPI::OS::Clock::realtime());
+	  char buf[100];
+	  snprintf(buf, sizeof(buf), "%llu log messages dropped (total %llu): OCPI_LOG_ASYNC buffer full\n",
+		   (unsigned long long)(dropped - reported), (unsigned long long)dropped);
+	  out += buf;
+	  reported = dropped;
+	}
+	if (out.size()) {
+	  fwrite(out.data(), 1, out.size(), stderr);
+	  fflush(stderr);
+	}
+	return any;
+      }
+      void *
+      asyncThread(void *) {
+	while (true) {
+	  bool stop = __atomic_load_n(&s_asyncStop, __ATOMIC_ACQUIRE);
+	  if (!asyncDrain()) {
+	    if (stop)
+	      break;
+	    struct timespec ts = { 0, ASYNC_IDLE_NS };
+	    nanosleep(&ts, NULL);
+	  }
+	}
+	return NULL;
+      }
+      void
+      asyncStop() {
+	if (s_asyncRunning) {
+	  __atomic_store_n(&s_asyncStop, true, __ATOMIC_RELEASE);
+	  pthread_join(s_asyncThread, NULL);
+	  // Later logging (e.g. from static destructors) is synchronous, but threads that
+	  // already decided to enqueue must finish before the last drain.
+	  __atomic_store_n(&s_asyncRunning, false, __ATOMIC_SEQ_CST);
+	  while (__atomic_load_n(&s_asyncProducers, __ATOMIC_SEQ_CST))
+	    sched_yield();
+	  asyncDrain();
+	}
+      }
+      // The child of a fork has no drain thread, so it logs synchronously.
+      // Records in the rings when the process forked are written by the parent.
+      void
+      asyncForkChild() {
+	s_asyncRunning = false;
+	s_asyncProducers = 0;
+      }
+      // A thread exiting makes its ring available to a new thread, after it is drained
+      void
+      asyncThreadExit(void *arg) {
+	__atomic_store_n(&((ThreadLog *)arg)->inUse, false, __ATOMIC_RELEASE);
+      }
+      void
+      asyncInit() {
+	const char *e = getenv("OCPI_LOG_ASYNC");
+	if (!e || !*e)
+	  return;
+	unsigned long kb = strtoul(e, NULL, 0);
+	if (!kb)
+	  return;
+	size_t size = (kb == 1 ? ASYNC_DEFAULT_KB : kb) * 1024;
+	for (s_asyncSize = ASYNC_MIN_SIZE; s_asyncSize < size; s_asyncSize <<= 1)
+	  ;
+	if (pthread_key_create(&s_asyncKey, asyncThreadExit) ||
+	    pthread_create(&s_asyncThread, NULL, asyncThread, NULL)) {
+	  s_asyncSize = 0;
+	  return;
+	}
+	s_asyncRunning = true;
+	atexit(asyncStop);
+	pthread_atfork(NULL, NULL, asyncForkChild);
+      }
+      ThreadLog *
+      asyncThreadLog() {
+	ThreadLog *tl;
+	for (tl = __atomic_load_n(&s_threadLogs, __ATOMIC_ACQUIRE); tl; tl = tl->next)
+	  if (!__atomic_load_n(&tl->inUse, __ATOMIC_ACQUIRE) &&
+	      __sync_bool_compare_and_swap(&tl->inUse, false, true))
+	    break;
+	if (!tl) {
+	  if (!(tl = (ThreadLog *)malloc(sizeof(ThreadLog))) ||
+	      !(tl->ring = (uint8_t *)malloc(s_asyncSize))) {
+	    free(tl);
+	    return NULL;
+	  }
+	  tl->inUse = true;
+	  tl->head = tl->tail = 0;
+	  tl->size = s_asyncSize;
+	  do
+	    tl->next = __atomic_load_n(&s_threadLogs, __ATOMIC_ACQUIRE);
+	  while (!__sync_bool_compare_and_swap(&s_threadLogs, tl->next, tl));
+	}
+	pthread_setspecific(s_asyncKey, tl);
+	return t_log = tl;
+      }
+      // Enqueue a record, returning false if logging should be done synchronously
+      bool
+      asyncEnqueue(unsigned n, const char *fmt, va_list ap) {
+	ThreadLog *tl = t_log ? t_log : asyncThreadLog();
+	if (!tl)
+	  return false;
+	uint64_t rec[ASYNC_MAX_RECORD/sizeof(uint64_t)];
+	AsyncRecord &r = *(AsyncRecord *)rec;
+	uint8_t
+	  *p = (uint8_t *)(&r + 1),
+	  *end = (uint8_t *)rec + sizeof(rec);
+	size_t fmtSize = strlen(fmt) + 1;
+	bool captured = false;
+	if (put(p, end, fmt, fmtSize)) {
+	  va_list aq;
+	  va_copy(aq, ap);
+	  captured = capture(fmt, aq, p, end);
+	  va_end(aq);
+	}
+	r.fmtSize = (uint32_t)fmtSize;
+	r.unused = 0;
+	if (!captured) {
+	  // Preformat messages we can't capture, with truncation
+	  p = (uint8_t *)(&r + 1);
+	  size_t room = (size_t)(end - p) - sizeof(uint32_t);
+	  int len = vsnprintf((char *)p + sizeof(uint32_t), room, fmt, ap);
+	  uint32_t ulen = len < 0 ? 0 : (size_t)len >= room ? (uint32_t)(room - 1) : (uint32_t)len;
+	  memcpy(p, &ulen, sizeof(ulen));
+	  p += sizeof(ulen) + ulen;
+	  r.fmtSize = 0;
+	}
+	r.size = (uint32_t)(((size_t)(p - (uint8_t *)rec) + 7) & ~(size_t)7);
+	r.level = n;
+	r.ns = OCPI::OS::Clock::realtime();
+	// Reserve space in the ring, with padding to keep records contiguous
+	uint64_t
+	  tail = tl->tail,
+	  head = __atomic_load_n(&tl->head, __ATOMIC_ACQUIRE);
+	size_t
+	  offset = tail & (tl->size - 1),
+	  toEnd = tl->size - offset,
+	  pad = toEnd < r.size ? toEnd : 0;
+	if (tl->size - (tail - head) < pad + r.size) {
+	  __atomic_fetch_add(&s_asyncDropped, 1, __ATOMIC_RELAXED);
+	  return true;
+	}
+	if (pad) {
+	  AsyncRecord *padRec = (AsyncRecord *)(tl->ring + offset);
+	  padRec->size = (uint32_t)pad;
+	  padRec->level = ASYNC_PAD;
+	  offset = 0;
+	}
+	memcpy(tl->ring + offset, rec, r.size);
+	__atomic_store_n(&tl->tail, tail + pad + r.size, __ATOMIC_RELEASE);
+	return true;
+      }
+      bool
+      asyncLog(unsigned n, const char *fmt, va_list ap) {
+	pthread_once(&s_asyncOnce, asyncInit);
+	if (!s_asyncSize)
+	  return false;
+	__atomic_fetch_add(&s_asyncProducers, 1, __ATOMIC_SEQ_CST);
+	bool queued =
+	  __atomic_load_n(&s_asyncRunning, __ATOMIC_SEQ_CST) && asyncEnqueue(n, fmt, ap);
+	__atomic_fetch_sub(&s_asyncProducers, 1, __ATOMIC_RELEASE);
+	return queued;
+      }
+    }
+
     void
     logPrintV(unsigned n, const char *fmt, va_list ap){
       if (logWillLog(n)) {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
+	if (asyncLog(n, fmt, ap))
+	  return;
+	char prefix[40];
+	formatPrefix(prefix, sizeof(prefix), n, OCPI::OS::Clock::realtime());
 	pthread_mutex_lock (&mine);
-	fprintf(stderr, "OCPI(%2d:%3u.%04u): ", n, (unsigned)(tv.tv_sec%1000),
-		(unsigned)((tv.tv_usec+500)/1000));
+	fputs(prefix, stderr);
 	vfprintf(stderr, fmt, ap);
 	if (fmt[strlen(fmt)-1] != '\n')
 	  fprintf(stderr, "\n");
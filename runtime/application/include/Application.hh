@@ -185,6 +185,7 @@ namespace OCPI {
       bool m_dump;
       std::string m_dumpFile;
       bool m_dumpPlatforms;
+      bool m_dumpStatistics;
       Application &m_apiApplication;
 
       void clear();
@@ -285,6 +286,9 @@ namespace OCPI {
 		       OCPI::API::AccessList &list = OCPI::API::emptyList);
       void dumpDeployment(const char *appFile, const std::string &file);
       void dumpProperties(bool printParameters, bool printCached, const char *context) const;
+      void getStatistics(OCPI::Container::Worker::Statistics &stats) const;
+      bool getStatistic(unsigned ordinal, std::string &name, std::string &value) const;
+      void dumpStatistics() const;
       void genScaPrf(const char *outDir) const;
       void genScaScd(const char *outDir) const;
       void genScaSpd(const char *outDir, const char *pkg) const;
@@ -104,6 +104,11 @@ namespace OCPI {
       void dumpDeployment(const char *appFile, const std::string &file);
       void dumpProperties(bool printParameters = true, bool printCached = true,
 			  const char *context = NULL) const;
+      // Runtime statistics of workers and their ports, such as message counts and run
+      // times, named <instance>.<statistic> or <instance>.<port>.<statistic>.
+      // Returns false when ordinal is past the end.
+      bool getStatistic(unsigned ordinal, std::string &name, std::string &value) const;
+      void dumpStatistics() const;
       // setter template without implementation.  we only implement the ones for our types
       template <typename T> void
       setPropertyValue(const char *w, const char *p, const T value,
@@ -1177,12 +1177,14 @@ it is really per actual worker config...
         m_verbose = false;
         m_dump = false;
         m_dumpPlatforms = false;
+        m_dumpStatistics = false;
         OB::findBool(params, "verbose", m_verbose);
         OB::findBool(params, "dump", m_dump);
         const char *dumpFile;
         if (OB::findString(params, "dumpFile", dumpFile))
           m_dumpFile = dumpFile;
         OB::findBool(params, "dumpPlatforms", m_dumpPlatforms);
+        OB::findBool(params, "dumpStatistics", m_dumpStatistics);
         OB::findBool(params, "hex", m_hex);
         OB::findBool(params, "hidden", m_hidden);
         OB::findBool(params, "uncached", m_uncached);
@@ -1704,6 +1706,59 @@ it is really per actual worker config...
           fprintf(stderr, "%s\n", out.c_str());
         }
     }
+    // The prefix of the statistics of a worker member, with members of crews named
+    // <instance>[<member>].
+    static void
+    statisticPrefix(const OC::Launcher::Member &m, std::string &prefix) {
+      prefix = m.m_name;
+      if (m.m_crew && m.m_crew->m_size > 1)
+        OU::formatAdd(prefix, "[%zu]", m.m_member);
+      prefix += ".";
+    }
+    // Collect the statistics of all worker members in this process
+    void ApplicationI::
+    getStatistics(OC::Worker::Statistics &stats) const {
+      std::string prefix;
+      for (unsigned n = 0; n < m_launchMembers.size(); n++) {
+        const OC::Launcher::Member &m = m_launchMembers[n];
+        if (!m.m_worker)
+          continue;
+        statisticPrefix(m, prefix);
+        size_t first = stats.size();
+        m.m_worker->getStatistics(stats);
+        for (size_t i = first; i < stats.size(); i++)
+          stats[i].first.insert(0, prefix);
+      }
+    }
+    // Only the statistics of members up to the one with this ordinal are collected
+    bool ApplicationI::
+    getStatistic(unsigned ordinal, std::string &name, std::string &value) const {
+      OC::Worker::Statistics stats;
+      for (unsigned n = 0; n < m_launchMembers.size(); n++) {
+        const OC::Launcher::Member &m = m_launchMembers[n];
+        if (!m.m_worker)
+          continue;
+        stats.clear();
+        m.m_worker->getStatistics(stats);
+        if (ordinal < stats.size()) {
+          statisticPrefix(m, name);
+          name += stats[ordinal].first;
+          value = stats[ordinal].second;
+          return true;
+        }
+        ordinal -= OCPI_UTRUNCATE(unsigned, stats.size());
+      }
+      return false;
+    }
+    void ApplicationI::
+    dumpStatistics() const {
+      OC::Worker::Statistics stats;
+      getStatistics(stats);
+      fprintf(stderr, "Dump of all runtime statistics:\n");
+      for (unsigned n = 0; n < stats.size(); n++)
+        fprintf(stderr, "Statistic %3u: %s = \"%s\"\n", n, stats[n].first.c_str(),
+                stats[n].second.c_str());
+    }
     void ApplicationI::
     startMasterSlave(bool isMaster, bool isSlave, bool isSource) {
       for (unsigned n = 0; n < m_nContainers; n++)
@@ -1858,6 +1913,8 @@ it is really per actual worker config...
         }
       if (m_dump)
         dumpProperties(false, false, "final");
+      if (m_dumpStatistics)
+        dumpStatistics();
       if (m_dumpPlatforms)
         for (unsigned n = 0; n < m_nContainers; n++)
           m_containers[n]->dump(false, m_hex);
@@ -2236,6 +2293,14 @@ it is really per actual worker config...
     dumpProperties(bool printParameters, bool printCached, const char *context) const {
       return m_application.dumpProperties(printParameters, printCached, context);
     }
+    bool Application::
+    getStatistic(unsigned ordinal, std::string &name, std::string &value) const {
+      return m_application.getStatistic(ordinal, name, value);
+    }
+    void Application::
+    dumpStatistics() const {
+      m_application.dumpStatistics();
+    }
     // Type-specific scalar property value setters.
     #define OCPI_DATA_TYPE(sca,corba,letter,bits,run,pretty,store)         \
     template <> void Application::                                         \
@@ -57,10 +57,14 @@
 %ignore OCPI::API::PVUChar;
 %ignore OCPI::API::Connection;
 %ignore OCPI::API::PropertyAccess;
+%ignore OCPI::API::PropertyBatch;
 %apply std::string& OUTPUT {std::string& value};
 %ignore put();
 %ignore getBuffer(uint8_t *&data, size_t &length);
 %ignore getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &endOfData);
+%ignore getBuffer(uint8_t *&data, size_t &length, unsigned long timeout_us);
+%ignore getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &endOfData,
+		  unsigned long timeout_us);
 %ignore getProperty(const std::string &a_name, std::string &value, AccessList &list = emptyList,
 		    PropertyOptionList &options = noPropertyOptions,
 		    PropertyAttributes *attributes = NULL) const;
@@ -348,6 +352,190 @@
   }
 %}
 
+// Batched external port I/O, to move many messages per call between ports and
+// NumPy arrays (or anything supporting the buffer protocol) without holding the GIL.
+%{
+#include <cstring>
+  // Get a C-contiguous buffer, checking its item size when nonzero.  Return true on error.
+  static bool getPyBuffer(PyObject *obj, Py_buffer &view, bool writable, size_t itemSize,
+			  const char *what) {
+    if (PyObject_GetBuffer(obj, &view,
+			   PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0)))
+      return true;
+    if (itemSize && (size_t)view.itemsize != itemSize) {
+      PyErr_Format(PyExc_TypeError, "%s must have %zu byte elements", what, itemSize);
+      PyBuffer_Release(&view);
+      return true;
+    }
+    return false;
+  }
+  // Read up to maxMessages messages into data, which must hold at least one buffer.
+  // No Python calls here since the GIL is released.
+  static size_t readMessages(OA::ExternalPort &port, uint8_t *data, size_t size,
+			     uint64_t *offsets, uint8_t *opCodes, size_t maxMessages,
+			     unsigned long timeout_us, bool &eof) {
+    size_t n = 0, offset = 0, bufferSize = port.bufferSize();
+    offsets[0] = 0;
+    eof = false;
+    for (; n < maxMessages && size - offset >= bufferSize && !eof; n++) {
+      uint8_t *mData, opCode;
+      size_t length;
+      // Only the first message waits: after that take what is ready
+      OA::ExternalBuffer *b = n ?
+	port.getBuffer(mData, length, opCode, eof) :
+	port.getBuffer(mData, length, opCode, eof, timeout_us);
+      if (!b)
+	break;
+      if (!mData) { // end of data with no message
+	b->release();
+	break;
+      }
+      memcpy(data + offset, mData, length);
+      b->release();
+      offset += length;
+      offsets[n + 1] = offset;
+      if (opCodes)
+	opCodes[n] = opCode;
+    }
+    return n;
+  }
+  // Write messages from data, with message n being from offsets[n] to offsets[n+1].
+  // The caller has checked that each message fits in a buffer, so every buffer taken
+  // is put, and none is left held by the port when this returns.
+  static size_t writeMessages(OA::ExternalPort &port, const uint8_t *data,
+			      const uint64_t *offsets, const uint8_t *opCodes,
+			      size_t nMessages, unsigned long timeout_us) {
+    size_t n;
+    for (n = 0; n < nMessages; n++) {
+      uint8_t *mData;
+      size_t length, mLength = offsets[n + 1] - offsets[n];
+      if (!port.getBuffer(mData, length, timeout_us))
+	break;
+      memcpy(mData, data + offsets[n], mLength);
+      port.put(mLength, opCodes ? opCodes[n] : 0, false);
+    }
+    return n;
+  }
+%}
+
+%extend OCPI::API::ExternalPort {
+  // Read up to len(offsets)-1 messages into the writable buffer "data".  Message n is
+  // placed at data[offsets[n]:offsets[n+1]], with its opcode in opCodes[n] if opCodes
+  // is not None.  Waits up to timeout_us for the first message (0 is forever).
+  // Returns (number of messages, end of data seen).
+  PyObject *readMessages(PyObject *data, PyObject *offsets, PyObject *opCodes = Py_None,
+			 unsigned long timeout_us = 0) {
+    Py_buffer dView, oView, cView;
+    if (getPyBuffer(data, dView, true, 0, "data"))
+      return NULL;
+    if (getPyBuffer(offsets, oView, true, sizeof(uint64_t), "offsets")) {
+      PyBuffer_Release(&dView);
+      return NULL;
+    }
+    size_t max = (size_t)(oView.len / (Py_ssize_t)sizeof(uint64_t));
+    bool haveCodes = opCodes != Py_None;
+    if (haveCodes && getPyBuffer(opCodes, cView, true, 1, "opCodes")) {
+      PyBuffer_Release(&dView);
+      PyBuffer_Release(&oView);
+      return NULL;
+    }
+    PyObject *result = NULL;
+    if (max < 2 || (haveCodes && (size_t)cView.len < max - 1))
+      PyErr_SetString(PyExc_ValueError,
+		      "offsets must have at least 2 elements, and opCodes one less");
+    else if ((size_t)dView.len < $self->bufferSize())
+      PyErr_Format(PyExc_ValueError, "data must hold at least %zu bytes",
+		   $self->bufferSize());
+    else {
+      size_t n = 0;
+      bool eof = false;
+      std::string error;
+      Py_BEGIN_ALLOW_THREADS
+      try {
+	n = ::readMessages(*$self, (uint8_t *)dView.buf, (size_t)dView.len,
+			   (uint64_t *)oView.buf, haveCodes ? (uint8_t *)cView.buf : NULL,
+			   max - 1, timeout_us, eof);
+      } catch (std::string &e) {
+	error = e.empty() ? "Unknown Exception" : e;
+      } catch (...) {
+	error = "Unknown Exception";
+      }
+      Py_END_ALLOW_THREADS
+      if (error.size())
+	PyErr_SetString(PyExc_RuntimeError, error.c_str());
+      else
+	result = Py_BuildValue("(nO)", (Py_ssize_t)n, eof ? Py_True : Py_False);
+    }
+    if (haveCodes)
+      PyBuffer_Release(&cView);
+    PyBuffer_Release(&oView);
+    PyBuffer_Release(&dView);
+    return result;
+  }
+  // Write len(offsets)-1 messages from the buffer "data", where message n is
+  // data[offsets[n]:offsets[n+1]], with opcode opCodes[n], or 0 if opCodes is None.
+  // Waits up to timeout_us for each buffer (0 is forever).
+  // Returns the number of messages written, which is less than requested on timeout,
+  // or when a message is larger than the port's buffer size: then none from that
+  // message on are written.
+  PyObject *writeMessages(PyObject *data, PyObject *offsets, PyObject *opCodes = Py_None,
+			  unsigned long timeout_us = 0) {
+    Py_buffer dView, oView, cView;
+    if (getPyBuffer(data, dView, false, 0, "data"))
+      return NULL;
+    if (getPyBuffer(offsets, oView, false, sizeof(uint64_t), "offsets")) {
+      PyBuffer_Release(&dView);
+      return NULL;
+    }
+    size_t nOffsets = (size_t)(oView.len / (Py_ssize_t)sizeof(uint64_t));
+    bool haveCodes = opCodes != Py_None;
+    if (haveCodes && getPyBuffer(opCodes, cView, false, 1, "opCodes")) {
+      PyBuffer_Release(&dView);
+      PyBuffer_Release(&oView);
+      return NULL;
+    }
+    PyObject *result = NULL;
+    const uint64_t *offs = (const uint64_t *)oView.buf;
+    bool ok = nOffsets >= 1 && (!haveCodes || (size_t)cView.len >= nOffsets - 1);
+    for (size_t i = 0; ok && i + 1 < nOffsets; i++)
+      ok = offs[i] <= offs[i + 1] && offs[i + 1] <= (uint64_t)dView.len;
+    // Check all lengths before any buffer is taken: only the messages before the first
+    // one that does not fit in a buffer are written.
+    size_t nMessages = 0, bufferSize = $self->bufferSize();
+    if (ok)
+      for (; nMessages + 1 < nOffsets && offs[nMessages + 1] - offs[nMessages] <= bufferSize;
+	   nMessages++)
+	;
+    if (!ok)
+      PyErr_SetString(PyExc_ValueError,
+		      "offsets must be ascending within data, and opCodes one shorter");
+    else {
+      size_t n = 0;
+      std::string error;
+      Py_BEGIN_ALLOW_THREADS
+      try {
+	n = ::writeMessages(*$self, (const uint8_t *)dView.buf, offs,
+			    haveCodes ? (const uint8_t *)cView.buf : NULL, nMessages,
+			    timeout_us);
+      } catch (std::string &e) {
+	error = e.empty() ? "Unknown Exception" : e;
+      } catch (...) {
+	error = "Unknown Exception";
+      }
+      Py_END_ALLOW_THREADS
+      if (error.size())
+	PyErr_SetString(PyExc_RuntimeError, error.c_str());
+      else
+	result = PyInt_FromSize_t(n);
+    }
+    if (haveCodes)
+      PyBuffer_Release(&cView);
+    PyBuffer_Release(&oView);
+    PyBuffer_Release(&dView);
+    return result;
+  }
+}
+
 %exception {
     try {
         $action
@@ -111,6 +111,7 @@
 	                               "not an application XML file") \
   CMD_OPTION(seconds,     , Long,   0, "<seconds> -- legacy, use \"duration\" now") \
   CMD_OPTION(version,     , Bool,   0, "print the OpenCPI release version") \
+  CMD_OPTION(stats,       , Bool,   0, "dump worker and port runtime statistics after execution") \
   /**/
 
 //  CMD_OPTION_S(simulator, H,String, 0, "Create a container with this HDL simulator")
@@ -316,6 +317,8 @@ static int mymain(const char **ap) {
     params.addString("dumpFile", options.dump_file());
   if (options.dump_platforms())
     params.addBool("dumpPlatforms", true);
+  if (options.stats())
+    params.addBool("dumpStatistics", true);
   if (options.sim_dir())
     params.addString("simDir", options.sim_dir());
   if (options.sim_ticks())
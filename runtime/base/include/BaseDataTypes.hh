@@ -207,6 +207,8 @@ namespace OCPI {
     // and an offset within a group (calculated with OMG CDR rules as extended according to 
     // section 7.3 of the CDK doc.)
     class Member : public ValueType {
+      struct Compiled;               // expressions compiled for repeated finalization
+      Compiled *m_compiled;
     public:
       std::string m_name, m_abbrev, m_pretty, m_description;
       size_t m_offset;               // within group
@@ -235,6 +237,8 @@ namespace OCPI {
       const char
         *finalize(const IdentResolver &resolv, const char *tag, bool isFixed),
 	*parseDefault(const char *value, const char *tag, const IdentResolver *resolv = NULL),
+	// Reevaluate the default value expression into a value of this type
+	*parseDefaultExpr(Value &v, const IdentResolver &resolv, bool *isVariable = NULL),
 	*parse(ezxml_t x, bool isFixed, bool hasName, const char *hasDefault, const char *tag,
 	       unsigned ordinal, const IdentResolver *resolv = NULL),
 	*descend(const OCPI::API::AccessList &list, const Member *&member, const Value **valuep,
@@ -99,6 +99,33 @@ namespace OCPI {
       virtual ~IdentResolver();
       virtual const char *getValue(const char *sym, ExprValue &val) const = 0;
     };
+    // An expression that is lexed once, with its constants converted and its identifiers
+    // assigned to slots, so that it can be evaluated repeatedly and cheaply when the values
+    // of the identifiers are different.  Evaluation results and errors are the same as
+    // with evalExpression.
+    class ExprCompiled {
+    public:
+      struct Program;
+    private:
+      Program *m_program;
+      const char *evaluate(ExprValue &val, const IdentResolver *resolver,
+			   const ExprValue *values) const;
+    public:
+      ExprCompiled();
+      ExprCompiled(const ExprCompiled &);
+      ExprCompiled &operator=(const ExprCompiled &);
+      ~ExprCompiled();
+      const char *compile(const char *string, const char *end = NULL);
+      bool isCompiled() const { return m_program != NULL; }
+      const std::string &source() const;
+      // The identifiers in the expression, indexed by slot
+      size_t nSymbols() const;
+      const char *symbol(size_t n) const;
+      // Evaluate using the resolver for the identifiers
+      const char *evaluate(ExprValue &val, const IdentResolver *resolver = NULL) const;
+      // Evaluate using values for the identifiers, indexed by slot
+      const char *evaluate(ExprValue &val, const ExprValue *values, size_t nValues) const;
+    };
 
     const char
       // The core function that evaluates expressions
@@ -113,6 +140,8 @@ namespace OCPI {
 		       const IdentResolver *resolver),
       *parseExprBool(const char *a, bool &b, std::string *expr,
 		     const IdentResolver *resolver),
+      // Reevaluate a compiled expression as a number
+      *parseExprNumber(const ExprCompiled &expr, size_t &np, const IdentResolver *resolver),
       *getExprNumber(ezxml_t x, const char *attr, size_t &np, bool *found, std::string &expr,
 		     const IdentResolver *resolver),
       *parseConditionals(ezxml_t parent, const IdentResolver &r),
@@ -123,6 +123,9 @@ namespace OCPI {
 #undef OCPI_DATA_TYPE
 	  const char *parse(const char *unparsed, const char *stop = NULL, bool add = false,
 			    const IdentResolver *resolv = NULL, bool *isVariable = NULL);
+	  // Parse a single scalar (not string) value from a compiled expression
+	  const char *parse(const ExprCompiled &expr, const IdentResolver *resolv = NULL,
+			    bool *isVariable = NULL);
       const char *allocate(bool add = false);
       char &nextStringChar() {
 	assert(m_stringNext && (size_t)(m_stringNext - m_stringSpace) < m_stringSpaceLength);
@@ -169,11 +172,13 @@ namespace OCPI {
 #endif
     private:
       const char
-	*parseExpressionValue(const char *start, const char *end, size_t nSeq, size_t nArray),
+	*parseExpressionValue(const char *start, const char *end, size_t nSeq, size_t nArray,
+			      const ExprCompiled *compiled = NULL),
 	*parseValue(const char *unparsed, const char *stop, size_t nSeq, size_t nArray),
 	*parseElement(const char *start, const char *end, size_t nSeq),
 	*parseDimension(const char *unparsed, const char *stop,
 			size_t nseq, size_t dim, size_t offset, size_t nItems);
+      bool parseLiteral(const char *start, const char *end, size_t nSeq, size_t nArray);
       void clear();
       void clearStruct();
     };
@@ -109,14 +109,33 @@ namespace OCPI {
       return true;
     }
 
+    // The expressions that finalize reevaluates, compiled on first use so that they are not
+    // lexed again for each set of parameter values.
+    struct Member::Compiled {
+      std::vector<ExprCompiled> arrayDimensions;
+      ExprCompiled sequenceLength, stringLength, defaultValue;
+      // Get the compiled form of the expression, recompiling it if it has changed
+      static const char *get(ExprCompiled &compiled, const std::string &expr) {
+	return compiled.isCompiled() && compiled.source() == expr ? NULL :
+	  compiled.compile(expr.c_str(), expr.c_str() + expr.length());
+      }
+      static const char *number(ExprCompiled &compiled, const std::string &expr, size_t &np,
+				const IdentResolver &resolver) {
+	const char *err = get(compiled, expr);
+	return err ? err : parseExprNumber(compiled, np, &resolver);
+      }
+    };
+
     Member::
-    Member() : m_offset(0), m_isIn(false), m_isOut(false), m_isKey(false), m_default(NULL), m_ordinal(0)
+    Member() : m_compiled(NULL), m_offset(0), m_isIn(false), m_isOut(false), m_isKey(false),
+	       m_default(NULL), m_ordinal(0)
     {
     }
 
     Member::
     Member(const Member &other)
-      : ValueType(other), m_name(other.m_name), m_abbrev(other.m_abbrev), m_pretty(other.m_pretty),
+      : ValueType(other), m_compiled(NULL), m_name(other.m_name), m_abbrev(other.m_abbrev),
+	m_pretty(other.m_pretty),
 	m_description(other.m_description), m_offset(other.m_offset), m_isIn(other.m_isIn),
 	m_isOut(other.m_isOut), m_isKey(other.m_isKey), m_default(NULL),
         m_defaultExpr(other.m_defaultExpr), m_ordinal(other.m_ordinal) {
@@ -128,7 +147,8 @@ namespace OCPI {
     Member::
     Member(const char *name, const char *abbrev, const char *description, OA::BaseType type,
 	   bool a_isSequence, const char *defaultValue)
-      : ValueType(type, a_isSequence), m_name(name), m_abbrev(abbrev ? abbrev : ""),
+      : ValueType(type, a_isSequence), m_compiled(NULL), m_name(name),
+	m_abbrev(abbrev ? abbrev : ""),
 	m_description(description ? description : ""),
 	m_offset(0), m_isIn(false), m_isOut(false), m_isKey(false), m_default(NULL) {
       if (defaultValue) {
@@ -146,6 +166,7 @@ namespace OCPI {
     void swap(Member& f, Member& s){
       using std::swap;
       swap<ValueType>(f, s);
+      swap(f.m_compiled, s.m_compiled);
       swap(f.m_name, s.m_name);
       swap(f.m_abbrev, s.m_abbrev);
       swap(f.m_pretty, s.m_pretty);
@@ -162,6 +183,7 @@ namespace OCPI {
     Member::~Member() {
       if (m_default)
 	delete m_default;
+      delete m_compiled;
     }
 
     // Return a type object that is a sequence of this type
@@ -387,12 +409,15 @@ namespace OCPI {
       if (m_baseType == OA::OCPI_Struct)
 	for (unsigned n = 0; n < m_nMembers; n++)
 	  m_members[n].finalize(resolver, "member", a_isFixed);
+      if (!m_compiled)
+	m_compiled = new Compiled;
       if (m_arrayRank) {
 	m_nItems = 1;
+	m_compiled->arrayDimensions.resize(m_arrayRank);
 	for (unsigned i = 0; i < m_arrayRank; i++) {
 	  if (m_arrayDimensionsExprs[i].length() &&
-	      (err = parseExprNumber(m_arrayDimensionsExprs[i].c_str(), m_arrayDimensions[i],
-				     NULL,  &resolver)))
+	      (err = Compiled::number(m_compiled->arrayDimensions[i], m_arrayDimensionsExprs[i],
+				      m_arrayDimensions[i], resolver)))
 	    return err;
 	  // FIXME: this is redundant with the code in parse() - share it
 	  if (m_arrayDimensions[i] == 0)
@@ -402,20 +427,41 @@ namespace OCPI {
       }
       if (m_isSequence) {
 	if (m_sequenceLengthExpr.length() &&
-	    (err = parseExprNumber(m_sequenceLengthExpr.c_str(), m_sequenceLength, NULL,
-				   &resolver)))
+	    (err = Compiled::number(m_compiled->sequenceLength, m_sequenceLengthExpr,
+				    m_sequenceLength, resolver)))
 	  return err;
 	if (a_isFixed && m_sequenceLength == 0)
 	  return "Sequence must have a bounded size";
       }
       if (m_baseType == OA::OCPI_String) {
 	if (m_stringLengthExpr.length() &&
-	    (err = parseExprNumber(m_stringLengthExpr.c_str(), m_stringLength, NULL, &resolver)))
+	    (err = Compiled::number(m_compiled->stringLength, m_stringLengthExpr, m_stringLength,
+				    resolver)))
 	  return err;
 	if (a_isFixed && m_stringLength == 0)
 	  return "StringLength cannot be zero";
       }
-      return m_defaultExpr.length() ? parseDefault(m_defaultExpr.c_str(), tag, &resolver) : NULL;
+      if (m_defaultExpr.empty())
+	return NULL;
+      delete m_default;
+      m_default = new Value(*this);
+      return (err = parseDefaultExpr(*m_default, resolver)) ?
+	OU::esprintf("for %s %s: %s", tag, m_name.c_str(), err) : NULL;
+    }
+
+    // Only single scalar values are single expressions that can be compiled.
+    // Strings and chars need a prefix to be expressions, so they are not compiled either.
+    const char *Member::
+    parseDefaultExpr(Value &v, const IdentResolver &resolver, bool *isVariable) {
+      assert(m_defaultExpr.length());
+      if (m_isSequence || m_arrayRank || m_baseType == OA::OCPI_Struct ||
+	  m_baseType == OA::OCPI_Type || m_baseType == OA::OCPI_String ||
+	  m_baseType == OA::OCPI_Char)
+	return v.parse(m_defaultExpr.c_str(), NULL, false, &resolver, isVariable);
+      if (!m_compiled)
+	m_compiled = new Compiled;
+      const char *err = Compiled::get(m_compiled->defaultValue, m_defaultExpr);
+      return err ? err : v.parse(m_compiled->defaultValue, &resolver, isVariable);
     }
 
     void Member::
@@ -26,7 +26,9 @@
 #include <limits>
 #include <cfloat>
 #include <cerrno>
+#include <vector>
 #include <gmpxx.h>
+#include "OcpiDebugApi.hh"
 #include "UtilMisc.hh"
 #include "UtilEzxml.hh"
 #include "BaseValue.hh"
@@ -338,13 +340,15 @@ public:
   }
   const char
   *reduce(ExprToken *start, ExprToken *&end, bool parens = false),
-    *parse(const char *buf, const char *end, ExprToken *&tokens, const IdentResolver *resolve);
+    *parse(const ExprCompiled::Program &program, ExprToken *tokens, const IdentResolver *resolve,
+	   const ExprValue *values);
 };
 
 struct ExprToken {
   OpCode op;
   const char *start, *end; 
   ExprValue::Internal value;
+  size_t slot; // for identifiers in compiled expressions, the index of the symbol
   void string2Number() {
     if (op == OpConstant && value.m_isString) {
       value.m_number = value.m_string.size() ? 1 : 0;
@@ -514,58 +518,91 @@ reduce(ExprToken *start, ExprToken *&end, bool parens) {
   return NULL;
 }
 
+// The result of lexing an expression once, with constants converted and identifiers
+// assigned to slots, so that it can be evaluated repeatedly without lexing.
+struct ExprCompiled::Program {
+  std::string m_source;
+  std::vector<ExprToken> m_tokens;      // all tokens including the OpEnd
+  std::vector<std::string> m_symbols;   // the unique identifiers in order of appearance
+  const char *compile(const char *buf, const char *end) {
+    OpCode op;
+    const char *err;
+    m_source.assign(buf, OCPI_SIZE_T_DIFF(end, buf));
+    buf = m_source.c_str();
+    end = buf + m_source.length();
+    pthread_once(&once, init);
+    for (const char *cp = buf;;) {
+      m_tokens.resize(m_tokens.size() + 1);
+      ExprToken &t = m_tokens.back();
+      if ((err = t.value.lex(cp, end, t.start, t.end, op)))
+	return err;
+      t.op = op;
+      t.slot = 0;
+      if (op == OpIdent) {
+	std::string sym(t.start, OCPI_SIZE_T_DIFF(t.end, t.start));
+	if (!strcasecmp(sym.c_str(), "false") || !strcasecmp(sym.c_str(), "true")) {
+	  t.op = OpConstant;
+	  t.value.m_isString = false;
+	  t.value.m_number = tolower(sym[0]) == 't' ? 1 : 0;
+	} else {
+	  for (; t.slot < m_symbols.size(); t.slot++)
+	    if (m_symbols[t.slot] == sym)
+	      break;
+	  if (t.slot == m_symbols.size())
+	    m_symbols.push_back(sym);
+	}
+      }
+      t.start = t.end = NULL; // not valid when copied
+      if (op == OpEnd)
+	return NULL;
+    }
+  }
+};
+
+// Evaluate a compiled program, using "tokens" as the working space that is reduced as
+// evaluation proceeds.  Identifiers are resolved as they are reached, either from the
+// slot-indexed values or from the resolver.
 const char *ExprValue::Internal::
-parse(const char *buf, const char *end, ExprToken *&tokens, const IdentResolver *resolver) {
+parse(const ExprCompiled::Program &program, ExprToken *tokens, const IdentResolver *resolver,
+      const ExprValue *values) {
   OpCode op = OpEnd;
-  unsigned nTokens = 0, nParens = 0;
-  const char *cp, *dummy;
+  unsigned nParens = 0;
   const char *err;
-  Internal dumval;
-
-  pthread_once(&once, init);
-  for (cp = buf; !(err = dumval.lex(cp, end, dummy, dummy, op)) && op != OpEnd; nTokens++)    ;
-  if (err)
-    return err;
   bool usesVariable = false;
-  ExprToken *lpar = 0, *t = tokens = new ExprToken[++nTokens];
-  cp = buf;
+  ExprToken *lpar = 0, *t = tokens;
+  const ExprToken *pt = &program.m_tokens[0];
   do {
-    t->value.lex(cp, end, t->start, t->end, t->op); // can ignore errors in second pass
+    *t = *pt++;
     if (op == OpCond2 && t->op == OpEnd)
       return "illegal trailing colon operator"; // check this odd case
     switch ((op = t->op)) {
     case OpConstant:
-      // These values are set in lex()
+      // These values are set when compiled
       break;
     case OpIdent:
       {
-	std::string sym(t->start, OCPI_SIZE_T_DIFF(t->end, t->start));
-	if (!strcasecmp(sym.c_str(), "false")) {
-	  t->op = OpConstant;
-	  t->value.m_isString = false;
-	  t->value.m_number = 0;
-	} else if (!strcasecmp(sym.c_str(), "true")) {
-	  t->op = OpConstant;
-	  t->value.m_isString = false;
-	  t->value.m_number = 1;
-	} else if (!resolver)
+	const std::string &sym = program.m_symbols[t->slot];
+	ExprValue v;
+	const ExprValue *vp = &v;
+	if (values)
+	  vp = &values[t->slot];
+	else if (!resolver)
 	  return "no symbols are available for this expression";
-	else {
-	  ExprValue v;
-	  if ((err = resolver->getValue(sym.c_str(), v)))
-	    return err;
-	  if (!v.m_internal || v.m_internal->m_isString)
-	    ocpiLog(20, "Retrieved value for %s: string \"%s\"\n",
-		      sym.c_str(), v.m_internal ? v.m_internal->m_string.c_str() : "");
-	  else
-	    ocpiLog(20, "Retrieved value for %s: num %u %" PRIi64 "\n",
-		      sym.c_str(), v.m_numberSet, v.getNumber());
-	  t->value = *v.m_internal;
-	  t->op = OpConstant;
-	  usesVariable = true;
-	  //std::string s;
-	  //ocpiDebug("Expression variable %s has value %s", sym.c_str(), t->value.getString(s));
-	}
+	else if ((err = resolver->getValue(sym.c_str(), v)))
+	  return err;
+	if (!OCPI::OS::logWillLog(20))
+	  ;
+	else if (!vp->m_internal || vp->m_internal->m_isString)
+	  ocpiLog(20, "Retrieved value for %s: string \"%s\"\n",
+		  sym.c_str(), vp->m_internal ? vp->m_internal->m_string.c_str() : "");
+	else
+	  ocpiLog(20, "Retrieved value for %s: num %u %" PRIi64 "\n",
+		  sym.c_str(), vp->m_numberSet, vp->getNumber());
+	if (!vp->m_internal)
+	  return OU::esprintf("no value for identifier \"%s\"", sym.c_str());
+	t->value = *vp->m_internal;
+	t->op = OpConstant;
+	usesVariable = true;
       }
       // convert to string value or number value
       break;
@@ -619,21 +656,88 @@ parse(const char *buf, const char *end, ExprToken *&tokens, const IdentResolver
   return NULL;
 }
 
-const char *evalExpression(const char *start, ExprValue &val, const IdentResolver *resolver,
-			   const char *end) {
+ExprCompiled::ExprCompiled() : m_program(NULL) {}
+ExprCompiled::ExprCompiled(const ExprCompiled &other)
+  : m_program(other.m_program ? new Program(*other.m_program) : NULL) {
+}
+ExprCompiled &ExprCompiled::operator=(const ExprCompiled &other) {
+  if (this != &other) {
+    delete m_program;
+    m_program = other.m_program ? new Program(*other.m_program) : NULL;
+  }
+  return *this;
+}
+ExprCompiled::~ExprCompiled() { delete m_program; }
+
+const char *ExprCompiled::
+compile(const char *start, const char *end) {
   if (!end)
     end = start + strlen(start);
+  delete m_program;
+  m_program = new Program;
+  const char *err = m_program->compile(start, end);
+  if (err) {
+    delete m_program;
+    m_program = NULL;
+    return OU::esprintf("when parsing expression \"%.*s\": %s", (int)(end-start), start, err);
+  }
+  return NULL;
+}
+
+const std::string &ExprCompiled::source() const {
+  static const std::string empty;
+  return m_program ? m_program->m_source : empty;
+}
+size_t ExprCompiled::nSymbols() const {
+  return m_program ? m_program->m_symbols.size() : 0;
+}
+const char *ExprCompiled::symbol(size_t n) const {
+  assert(m_program && n < m_program->m_symbols.size());
+  return m_program->m_symbols[n].c_str();
+}
+
+const char *ExprCompiled::
+evaluate(ExprValue &val, const IdentResolver *resolver, const ExprValue *values) const {
+  assert(m_program);
   ExprValue::Internal *v = new ExprValue::Internal();
-  ExprToken *tokens = 0;
-  const char *err = v->parse(start, end, tokens, resolver);
+  ExprToken *tokens = new ExprToken[m_program->m_tokens.size()];
+  const char *err = v->parse(*m_program, tokens, resolver, values);
   delete [] tokens;
   v->setInternal(val);
-  std::string s;
-  ocpiLog(20, "Evaluating expression: %.*s err: \"%s\" value: \"%s\"",
-  	    (int)(end - start), start, err ? err : "", val.getString(s));
+  const std::string &s = m_program->m_source;
+  if (OCPI::OS::logWillLog(20)) { // avoid formatting the value when not logging
+    std::string vs;
+    ocpiLog(20, "Evaluating expression: %s err: \"%s\" value: \"%s\"",
+	    s.c_str(), err ? err : "", val.getString(vs));
+  }
   return
-    err ? OU::esprintf("when parsing expression \"%.*s\": %s", (int)(end-start), start, err) :
-    NULL;
+    err ? OU::esprintf("when parsing expression \"%s\": %s", s.c_str(), err) : NULL;
+}
+
+const char *ExprCompiled::
+evaluate(ExprValue &val, const IdentResolver *resolver) const {
+  return evaluate(val, resolver, NULL);
+}
+
+const char *ExprCompiled::
+evaluate(ExprValue &val, const ExprValue *values, size_t nValues) const {
+  assert(m_program);
+  if (nValues < m_program->m_symbols.size())
+    return OU::esprintf("when parsing expression \"%s\": %zu values supplied for %zu identifiers",
+			m_program->m_source.c_str(), nValues, m_program->m_symbols.size());
+  return evaluate(val, NULL, values);
+}
+
+const char *evalExpression(const char *start, ExprValue &val, const IdentResolver *resolver,
+			   const char *end) {
+  ExprCompiled compiled;
+  const char *err = compiled.compile(start, end);
+  if (err) {
+    // Leave the (zero) value set as when an evaluation fails
+    (new ExprValue::Internal())->setInternal(val);
+    return err;
+  }
+  return compiled.evaluate(val, resolver);
 }
 
 IdentResolver::~IdentResolver() {}
@@ -663,6 +767,20 @@ parseExprNumber(const char *a, size_t &np, std::string *expr, const IdentResolve
   return err;
 }
 
+const char *
+parseExprNumber(const ExprCompiled &expr, size_t &np, const IdentResolver *resolver) {
+  ExprValue v;
+  const char *err = expr.evaluate(v, resolver);
+  if (!err) {
+    if (!v.isNumber())
+      err = OU::esprintf("the expression \"%s\" does not evaluate to a number",
+			 expr.source().c_str());
+    else
+      np = OCPI_UTRUNCATE(size_t, v.getNumber());
+  }
+  return err;
+}
+
 // Evaluate the expression, using the resolver, and if the expression was variable,
 // save the expression so it can be reevaluated again later when the values of
 // variables are different.  Check the expression as a boolean, which means if a string,
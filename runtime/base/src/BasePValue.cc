@@ -85,6 +85,9 @@ namespace OCPI {
       PVBool("polled"),
       PVULong("bufferCount"),
       PVULong("bufferSize"),
+      PVBool("shareBroadcast"),
+      PVULong("broadcastLag"),
+      PVString("hashFunction"),
       PVString("portBufferCount"), // internal usage since bufferCount/Size are overloaded for two types
       PVString("portBufferSize"),
       PVUChar("index"),
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <cfloat>
+#include <math.h>
 #include <string.h>
 #include <pthread.h>
 #include "OsAssert.hh"
@@ -617,6 +618,20 @@ namespace OCPI {
       return NULL;
     }
     const char *Value::
+    parse(const ExprCompiled &expr, const IdentResolver *resolver, bool *isVariable) {
+      assert(!m_vt->m_isSequence && !m_vt->m_arrayRank &&
+	     m_vt->m_baseType != OA::OCPI_Struct && m_vt->m_baseType != OA::OCPI_Type &&
+	     m_vt->m_baseType != OA::OCPI_String);
+      Resolver r(resolver, isVariable);
+      const char *err;
+      clear();
+      m_nTotal = m_vt->m_nItems;
+      if ((err = allocate()) || (err = parseExpressionValue(NULL, NULL, 0, 0, &expr)))
+	return err;
+      m_parsed = true;
+      return NULL;
+    }
+    const char *Value::
     parseDimension(const char *unparsed, const char *stop,
 		   size_t nseq, size_t dim, size_t offset, size_t nItems) {
       size_t
@@ -662,7 +677,8 @@ namespace OCPI {
 	parseValue(start, end, nSeq, 0);
     }
     const char *Value::
-    parseExpressionValue(const char *start, const char *end, size_t nSeq, size_t nArray) {
+    parseExpressionValue(const char *start, const char *end, size_t nSeq, size_t nArray,
+			 const ExprCompiled *compiled) {
       Resolver *r = getResolver();
       struct Intercept : public IdentResolver {
 	Value &value;
@@ -685,13 +701,162 @@ namespace OCPI {
       } mine(*this, r);
       const char *err;
       ExprValue ev;
-      if (!(err = evalExpression(start, ev, &mine, end)) &&
+      if (!(err = compiled ? compiled->evaluate(ev, &mine) :
+	    evalExpression(start, ev, &mine, end)) &&
 	  !(err = ev.getTypedValue(*this, nSeq * m_vt->m_nItems + nArray)) &&
 	  r->isVariable)
 	*r->isVariable = mine.usedVariable; // use mine, not ev.isVariable() since it might be enum tag
       return err;
     }
 
+    // Fast path for plain numeric and boolean literals, avoiding the expression parser,
+    // which is dominated by GMP setup and lexing even for simple constants.
+    // Only literals whose value is certain to be identical to what the expression parser
+    // would produce are accepted here.  Anything else, including anything erroneous,
+    // returns false so the expression parser handles it with the usual error messages.
+    bool Value::
+    parseLiteral(const char *cp, const char *end, size_t nSeq, size_t nArray) {
+      while (cp < end && isspace(*cp))
+	cp++;
+      while (end > cp && isspace(end[-1]))
+	end--;
+      if (cp == end)
+	return false;
+      bool items = m_vt->m_isSequence || m_vt->m_arrayRank;
+      size_t index = nSeq * m_vt->m_nItems + nArray, len = OCPI_SIZE_T_DIFF(end, cp);
+      Resolver *r = getResolver();
+      switch (m_vt->m_baseType) {
+      case OA::OCPI_Bool:
+	{
+	  bool b;
+	  if (len == 4 && !strncasecmp(cp, "true", 4))
+	    b = true;
+	  else if (len == 5 && !strncasecmp(cp, "false", 5))
+	    b = false;
+	  else if (len == 1 && (*cp == '0' || *cp == '1'))
+	    b = *cp == '1';
+	  else
+	    return false;
+	  (items ? m_pBool[index] : m_Bool) = b;
+	}
+	break;
+      case OA::OCPI_Float:
+      case OA::OCPI_Double:
+	{
+	  // Decimal literals that the expression parser converts with strtod, or integers
+	  // that are exact in a double.  No octal (leading zero), hex, suffixes or '@'.
+	  const char *p = *cp == '-' ? cp + 1 : cp;
+	  if (p == end || (*p == '0' && p + 1 < end && isdigit(p[1])))
+	    return false;
+	  bool dot = false;
+	  size_t nDigits = 0;
+	  for (; p < end && (isdigit(*p) || *p == '.'); p++)
+	    if (*p != '.')
+	      nDigits++;
+	    else if (dot)
+	      return false;
+	    else
+	      dot = true;
+	  if (!nDigits || (!dot && (p != end || nDigits > 15)))
+	    return false;
+	  if (p < end) {
+	    if (*p != 'e' && *p != 'E')
+	      return false;
+	    if (++p < end && (*p == '-' || *p == '+'))
+	      p++;
+	    // the expression parser treats a leading zero after the first as octal
+	    if (p == end || (*p == '0' && p + 1 < end))
+	      return false;
+	    while (p < end && isdigit(*p))
+	      p++;
+	    if (p != end)
+	      return false;
+	  }
+	  char buf[64], *ep;
+	  if (len >= sizeof(buf))
+	    return false;
+	  memcpy(buf, cp, len);
+	  buf[len] = '\0';
+	  errno = 0;
+	  double d = strtod(buf, &ep);
+	  if (errno || *ep)
+	    return false;
+	  if (fpclassify(d) == FP_ZERO) // the expression parser never produces negative zero
+	    d = 0;
+	  if (m_vt->m_baseType == OA::OCPI_Double)
+	    (items ? m_pDouble[index] : m_Double) = d;
+	  else if (d < -FLT_MAX || d > FLT_MAX)
+	    return false;
+	  else
+	    (items ? m_pFloat[index] : m_Float) = (float)d;
+	}
+	break;
+      case OA::OCPI_UChar: case OA::OCPI_Short: case OA::OCPI_UShort: case OA::OCPI_Long:
+      case OA::OCPI_ULong: case OA::OCPI_LongLong: case OA::OCPI_ULongLong:
+	{
+	  // Decimal, 0x hex or 0[digit] octal, with no suffixes or exponents
+	  bool neg = *cp == '-';
+	  const char *p = neg ? cp + 1 : cp;
+	  unsigned base = 10;
+	  if (p + 1 < end && *p == '0') {
+	    if (p[1] == 'x' || p[1] == 'X')
+	      base = 16, p += 2;
+	    else if (isdigit(p[1]))
+	      base = 8, p++;
+	    else
+	      return false;
+	  }
+	  if (p == end)
+	    return false;
+	  uint64_t u = 0;
+	  for (; p < end; p++) {
+	    unsigned d =
+	      isdigit(*p) ? (unsigned)(*p - '0') :
+	      *p >= 'a' && *p <= 'f' ? (unsigned)(*p - 'a' + 10) :
+	      *p >= 'A' && *p <= 'F' ? (unsigned)(*p - 'A' + 10) : 16;
+	    if (d >= base || u > (UINT64_MAX - d) / base)
+	      return false;
+	    u = u * base + d;
+	  }
+	  uint64_t max = 0;
+	  bool isSigned = false;
+	  switch (m_vt->m_baseType) {
+	  case OA::OCPI_UChar: max = UINT8_MAX; break;
+	  case OA::OCPI_Short: max = INT16_MAX; isSigned = true; break;
+	  case OA::OCPI_UShort: max = UINT16_MAX; break;
+	  case OA::OCPI_Long: max = INT32_MAX; isSigned = true; break;
+	  case OA::OCPI_ULong: max = UINT32_MAX; break;
+	  case OA::OCPI_LongLong: max = INT64_MAX; isSigned = true; break;
+	  default: max = UINT64_MAX;
+	  }
+	  if (neg ? (isSigned ? u > max + 1 : u != 0) : u > max)
+	    return false;
+	  uint64_t val = neg ? ~u + 1 : u;
+	  switch (m_vt->m_baseType) {
+#define DO_INT(pretty)							\
+	  case OA::OCPI_##pretty:					\
+	    (items ? m_p##pretty[index] : m_##pretty) = (OA::pretty)val;	\
+	    break
+	    DO_INT(UChar);
+	    DO_INT(Short);
+	    DO_INT(UShort);
+	    DO_INT(Long);
+	    DO_INT(ULong);
+	    DO_INT(LongLong);
+	    DO_INT(ULongLong);
+#undef DO_INT
+	  default:;
+	  }
+	}
+	break;
+      default:
+	return false;
+      }
+      if (r && r->isVariable)
+	*r->isVariable = false;
+      return true;
+    }
+
     // A single value - not sequence or array
     const char *Value::
     parseValue(const char *start, const char *end, size_t nSeq, size_t nArray) {
@@ -711,7 +876,9 @@ namespace OCPI {
 	  break;
 	start += EXPR_PREFIX_LEN;
 	// falls thru
-      default:;
+      default:
+	if (parseLiteral(start, end, nSeq, nArray))
+	  return NULL;
 	return parseExpressionValue(start, end, nSeq, nArray);
       }	  
       // Parse a value, not an expresion
@@ -832,6 +999,10 @@ unparse(std::string &s, const Unparser *up, bool append, bool hex, char comma) c
     up = this;
   if (!append)
     s.clear();
+  // Avoid repeated reallocation when unparsing large sequences or arrays of scalars
+  if (m_nTotal > 1 && m_vt->m_baseType != OA::OCPI_Struct && m_vt->m_baseType != OA::OCPI_String &&
+      m_vt->m_baseType != OA::OCPI_Type)
+    s.reserve(s.length() + m_nTotal * (m_vt->m_nBits / 3 + 3));
   return m_vt->m_isSequence ?
     up->sequenceUnparse(*this, s, hex, comma) :
     up->elementUnparse(*this, s, 0, hex, comma, false, *up);
@@ -923,22 +1094,39 @@ unparseChar(std::string &s, char argVal, bool hex) const {
   }
   return argVal == 0;
 }
+// Append a floating point value using the shortest exponent form
 static void
 doFloat(std::string &s, double val, unsigned digits) {
-  char *cp;
-  ocpiCheck(asprintf(&cp, "%.*g", digits, val) > 0);
-  for (char *p = cp; *p; p++)
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%.*g", digits, val);
+  ocpiCheck(n > 0 && (size_t)n < sizeof(buf));
+  for (char *p = buf; *p; p++)
     if (*p == 'e' || *p == 'E') {
-      while (p > cp && p[-1] == '0') {
-	strcpy(p - 1, p); // FIXME valgrind overlap
+      while (p > buf && p[-1] == '0') {
+	memmove(p - 1, p, strlen(p) + 1);
 	p--;
       }
       if (p[1] && p[1] == '0' && !p[2])
 	*p = '\0';
       break;
     }
-  s += cp;
-  free(cp);
+  s += buf;
+}
+// Append an unsigned integer in decimal or 0x-prefixed hex without using printf
+static void
+doInteger(std::string &s, uint64_t val, bool hex) {
+  char buf[24], *cp = buf + sizeof(buf);
+  if (hex) {
+    do
+      *--cp = "0123456789abcdef"[val & 0xf];
+    while (val >>= 4);
+    *--cp = 'x';
+    *--cp = '0';
+  } else
+    do
+      *--cp = (char)('0' + val % 10);
+    while (val /= 10);
+  s.append(cp, OCPI_SIZE_T_DIFF(buf + sizeof(buf), cp));
 }
 bool Unparser::
 unparseDouble(std::string &s, double val, bool) const {
@@ -958,7 +1146,7 @@ unparseShort(std::string &s, int16_t val, bool hex) const {
     s += '-';
   } else
     u = (uint16_t)val;
-  doFormat(s, hex ? "0x%" PRIx16 : "%" PRIu16, u);
+  doInteger(s, u, hex);
   return val == 0;
 }
 bool Unparser::
@@ -969,22 +1157,22 @@ unparseLong(std::string &s, int32_t val, bool hex) const {
     s += '-';
   } else
     u = (uint32_t)val;
-  doFormat(s, hex ? "0x%" PRIx32 : "%" PRIu32, u);
+  doInteger(s, u, hex);
   return val == 0;
 }
 bool Unparser::
 unparseUChar(std::string &s, uint8_t val, bool hex) const {
-  doFormat(s, hex ? "0x%x" : "%u", val);
+  doInteger(s, val, hex);
   return val == 0;
 }
 bool Unparser::
 unparseULong(std::string &s, uint32_t val, bool hex) const {
-  doFormat(s, hex ? "0x%lx" : "%lu", (unsigned long)val);
+  doInteger(s, val, hex);
   return val == 0;
 }
 bool Unparser::
 unparseUShort(std::string &s, uint16_t val, bool hex) const {
-  doFormat(s, hex ? "0x%lx" : "%lu", (unsigned long)val);
+  doInteger(s, val, hex);
   return val == 0;
 }
 bool Unparser::
@@ -995,12 +1183,12 @@ unparseLongLong(std::string &s, int64_t val, bool hex) const {
     s += '-';
   } else
     u = (uint64_t)val;
-  doFormat(s, hex ? "0x%" PRIx64 : "%" PRIu64, u);
+  doInteger(s, u, hex);
   return val == 0;
 }
 bool Unparser::
 unparseULongLong(std::string &s, uint64_t val, bool hex) const {
-  doFormat(s, hex ? "0x%" PRIx64 : "%" PRIu64, val);
+  doInteger(s, val, hex);
   return val == 0;
 }
 size_t Value::
@@ -0,0 +1,193 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmark for parsing and unparsing large sequence values.
+// The "old" parse forces every element through the expression parser by making each one
+// a trivial expression (adding zero), and the "old" unparse uses printf-style formatting
+// for every element.
+// Both must produce results identical to the literal fast paths.
+// Usage: valueBench [nElements [nIterations]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include "UtilMisc.hh"
+#include "BaseDataTypes.hh"
+#include "BaseValue.hh"
+
+namespace OA = OCPI::API;
+namespace OU = OCPI::Util;
+namespace OB = OCPI::Base;
+
+// The unparsing as it was done with printf formatting
+// yes, we really do want to compare floats with zero here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+struct OldUnparser : public OB::Unparser {
+  static void doFloat(std::string &s, double val, unsigned digits) {
+    char *cp;
+    if (asprintf(&cp, "%.*g", digits, val) <= 0)
+      abort();
+    for (char *p = cp; *p; p++)
+      if (*p == 'e' || *p == 'E') {
+	while (p > cp && p[-1] == '0') {
+	  memmove(p - 1, p, strlen(p) + 1);
+	  p--;
+	}
+	if (p[1] && p[1] == '0' && !p[2])
+	  *p = '\0';
+	break;
+      }
+    s += cp;
+    free(cp);
+  }
+  bool unparseDouble(std::string &s, double val, bool) const {
+    doFloat(s, val, 17);
+    return val == 0;
+  }
+  bool unparseFloat(std::string &s, float val, bool) const {
+    doFloat(s, val, 9);
+    return val == 0;
+  }
+  bool unparseShort(std::string &s, int16_t val, bool hex) const {
+    if (val < 0)
+      s += '-';
+    OU::formatAdd(s, hex ? "0x%x" : "%u", (unsigned)(val < 0 ? -(int)val : val));
+    return val == 0;
+  }
+  bool unparseULong(std::string &s, uint32_t val, bool hex) const {
+    OU::formatAdd(s, hex ? "0x%lx" : "%lu", (unsigned long)val);
+    return val == 0;
+  }
+  bool unparseLongLong(std::string &s, int64_t val, bool hex) const {
+    uint64_t u = val < 0 ? (uint64_t)~val + 1 : (uint64_t)val;
+    if (val < 0)
+      s += '-';
+    OU::formatAdd(s, hex ? "0x%" PRIx64 : "%" PRIu64, u);
+    return val == 0;
+  }
+};
+// re-allow the -Wfloat-equal warning
+#pragma GCC diagnostic pop
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static const char *typeName(OA::BaseType bt) {
+  switch (bt) {
+  case OA::OCPI_Double: return "double";
+  case OA::OCPI_Float: return "float";
+  case OA::OCPI_Short: return "short";
+  case OA::OCPI_ULong: return "ulong";
+  case OA::OCPI_LongLong: return "longlong";
+  default: return "?";
+  }
+}
+
+// Generate a sequence value string of representative values for the type
+static void generate(OA::BaseType bt, size_t n, std::string &s, std::string &wrapped) {
+  s.clear();
+  wrapped.clear();
+  for (size_t i = 0; i < n; i++) {
+    if (i) {
+      s += ',';
+      wrapped += ',';
+    }
+    std::string e;
+    long r = random();
+    switch (bt) {
+    case OA::OCPI_Double:
+      OldUnparser::doFloat(e, (double)(r - RAND_MAX/2) / 12345.678, 17); break;
+    case OA::OCPI_Float:
+      OldUnparser::doFloat(e, (float)((double)(r - RAND_MAX/2) * 1e-7), 9); break;
+    case OA::OCPI_Short:
+      OU::format(e, "%d", (int)(int16_t)r); break;
+    case OA::OCPI_ULong:
+      OU::format(e, i & 1 ? "0x%lx" : "%lu", (unsigned long)(uint32_t)r); break;
+    case OA::OCPI_LongLong:
+      OU::format(e, "%lld", (long long)(r - RAND_MAX/2) * 65537); break;
+    default:;
+    }
+    s += e;
+    wrapped += e;
+    wrapped += "+0";
+  }
+}
+
+static bool bench(OA::BaseType bt, size_t nElements, unsigned nIter) {
+  OB::ValueType vt(bt, true);
+  std::string s, wrapped, oldOut, newOut;
+  generate(bt, nElements, s, wrapped);
+  OB::Value oldV(vt), newV(vt);
+  OldUnparser oldUp;
+  const char *err;
+  double t0 = now();
+  for (unsigned i = 0; i < nIter; i++)
+    if ((err = oldV.parse(wrapped.c_str()))) {
+      fprintf(stderr, "Old parse of %s failed: %s\n", typeName(bt), err);
+      return true;
+    }
+  double t1 = now();
+  for (unsigned i = 0; i < nIter; i++)
+    if ((err = newV.parse(s.c_str()))) {
+      fprintf(stderr, "New parse of %s failed: %s\n", typeName(bt), err);
+      return true;
+    }
+  double t2 = now();
+  for (unsigned i = 0; i < nIter; i++)
+    oldV.unparse(oldOut, &oldUp);
+  double t3 = now();
+  for (unsigned i = 0; i < nIter; i++)
+    newV.unparse(newOut);
+  double t4 = now();
+  std::string check;
+  newV.unparse(check, &oldUp);
+  if (oldOut != newOut || check != newOut) {
+    fprintf(stderr, "Results differ for type %s\n", typeName(bt));
+    return true;
+  }
+  printf("%-9s parse: old %9.3f ms new %9.3f ms (%5.1fx)  "
+	 "unparse: old %9.3f ms new %9.3f ms (%5.1fx)\n", typeName(bt),
+	 (t1 - t0) * 1e3 / nIter, (t2 - t1) * 1e3 / nIter, (t1 - t0) / (t2 - t1),
+	 (t3 - t2) * 1e3 / nIter, (t4 - t3) * 1e3 / nIter, (t3 - t2) / (t4 - t3));
+  return false;
+}
+
+int main(int argc, char **argv) {
+  size_t nElements = argc > 1 ? strtoul(argv[1], NULL, 0) : 65536;
+  unsigned nIter = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 5;
+  if (!nElements || !nIter) {
+    fprintf(stderr, "Usage is: valueBench [nElements [nIterations]]\n");
+    return 1;
+  }
+  printf("Sequences of %zu elements, average of %u iterations\n", nElements, nIter);
+  static const OA::BaseType types[] = {
+    OA::OCPI_Double, OA::OCPI_Float, OA::OCPI_Short, OA::OCPI_ULong, OA::OCPI_LongLong
+  };
+  bool bad = false;
+  for (unsigned n = 0; n < sizeof(types)/sizeof(types[0]); n++)
+    bad = bench(types[n], nElements, nIter) || bad;
+  return bad ? 1 : 0;
+}
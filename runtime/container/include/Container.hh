@@ -160,6 +160,9 @@ namespace OCPI {
     protected:
       void shutdown();
       virtual Application *firstApplication() const = 0; // Allow base class to see if there are apps
+      // When dispatch has returned Spin, a container that knows when it will next have work
+      // can wait for it here, returning false if it can't
+      virtual bool idleWait() { return false; }
     };
   }
 }
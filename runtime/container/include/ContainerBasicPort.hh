@@ -28,6 +28,7 @@
 #include "OcpiContainerApi.hh"
 
 #include "UtilSelfMutex.hh"
+#include "UtilSharedRelease.hh"
 #include "BasePValue.hh"
 #include "BaseParentChild.hh"
 #include "MetadataPort.hh"
@@ -108,6 +109,10 @@ namespace OCPI {
 typedef int pthread_spinlock_t;
 # endif
       pthread_spinlock_t m_zcLock;          // use until lockless...
+      // These are for zero-copy broadcast.  A buffer that is shared is referenced by
+      // "proxy" buffers, one per reader, that are put on the readers' zc queues.
+      ExternalBuffer *m_shared;             // when a proxy, the buffer being shared
+      OCPI::Util::ShareCount m_shares;      // when shared, how many proxies are outstanding
       // This is specific to the "transport" mode, with a buffer from the transport system
       OCPI::Transport::BufferUserFacet *m_dtBuffer;
       uint8_t *m_dtData;
@@ -125,6 +130,7 @@ typedef int pthread_spinlock_t;
       size_t offset();
       size_t position() { return m_position; }
       ExternalBuffer *next() { return m_next; }
+      OCPI::Util::ShareCount &shares() { return m_shares; }
       void
 	release(),
 	take(),
@@ -137,6 +143,13 @@ typedef int pthread_spinlock_t;
 	    size_t direct = 0);
     };
 
+    // Always-on counters kept by each port, as seen by the user of the port
+    struct PortStatistics {
+      uint64_t m_messages, m_bytes;
+      uint64_t m_stalls; // times a buffer was wanted but none was ready
+      PortStatistics() : m_messages(0), m_bytes(0), m_stalls(0) {}
+    };
+
     // This class has behavior common to worker, external, bridge, shim ports.
     class BasicPort : public PortData, public OCPI::API::ExternalPort,
 		      virtual protected OCPI::Util::SelfMutex {
@@ -160,6 +173,19 @@ typedef int pthread_spinlock_t;
       ExternalBuffer  *m_next2write, *m_next2put, *m_next2read, *m_next2release;
       BasicPort *m_allocator;
       // end shim mode
+      // Readiness notification for external ports, on the port holding the buffers
+      int m_readyFd;                  // eventfd, or -1 when nobody is waiting
+      volatile bool m_readySignaled;  // to only write it once between waits
+      // Readiness notification for the worker of this port: a bit atomically set in its mask
+      volatile uint32_t *m_readyMask; // NULL when nobody wants it
+      uint32_t m_readyBit;
+      PortStatistics m_stats;
+      bool m_stalled;                 // to count each stall once, not each retry
+      inline void countStall(bool stalled) {
+	if (stalled && !m_stalled)
+	  m_stats.m_stalls++;
+	m_stalled = stalled;
+      }
     protected:
       BasicPort *m_forward;  // if set, forward worker-side to this other port
       BasicPort *m_backward; // if set, other is forwarded to here
@@ -189,6 +215,19 @@ typedef int pthread_spinlock_t;
       virtual uint8_t *allocateBuffers(size_t len);
       virtual void freeBuffers(uint8_t *allocation);
       unsigned fullCount(), emptyCount();
+      // Note that buffers have been put or released here, for any external waiter,
+      // and for the workers of this port and of the port forwarded to it.
+      inline void notifyReady() {
+	if (m_readyMask)
+	  __sync_fetch_and_or(m_readyMask, m_readyBit);
+	if (m_backward && m_backward->m_readyMask)
+	  __sync_fetch_and_or(m_backward->m_readyMask, m_backward->m_readyBit);
+	if (m_readyFd >= 0)
+	  signalReady();
+      }
+    private:
+      void signalReady(), clearReady();
+      bool waitReady(uint64_t deadline, unsigned &backoff);
     public:
       Container &container() const { return m_container; }
       inline const OCPI::Metadata::Port &metaPort() const { return m_metaPort; }
@@ -198,6 +237,7 @@ typedef int pthread_spinlock_t;
       // FIXME: Horrible hack to allow retrieving special memory handles
       virtual intptr_t clBuffers() { return 0; }
       size_t bufferSize() { return m_bufferSize; }
+      const PortStatistics &statistics() const { return m_stats; }
       size_t bufferStride() {
 	size_t s = m_forward ? m_forward->m_bufferStride : m_bufferStride;
 	assert(s);
@@ -232,7 +272,11 @@ typedef int pthread_spinlock_t;
 				     OCPI::Transport::PortRole &pRole, unsigned &pOptions);
       OCPI::API::ExternalBuffer
         *getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &end),
-	*getBuffer(uint8_t *&data, size_t &length);
+	*getBuffer(uint8_t *&data, size_t &length),
+        *getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &end,
+		   unsigned long timeout_us),
+	*getBuffer(uint8_t *&data, size_t &length, unsigned long timeout_us);
+      int readyFd();
       // Internal methods.
       bool peekOpCode(uint8_t &op);
       ExternalBuffer *getFullBuffer(), *getEmptyBuffer();
@@ -64,7 +64,7 @@ namespace OCPI {
 	                // input:  ditto
 	AsAvailable,    // input: receive from set as available, rotating the look
 	All,            // output: send to all in the specified set
-	Balanced,       // output: if least busy is in specified set, send, else discard
+	Balanced,       // output: send to the least busy in the specified set
 	Directed,       // output: take input member from API
 	Hashed,         // output: compute input member based on hash of m_hashField
 	Discard,        // output: discard messages
@@ -83,6 +83,9 @@ namespace OCPI {
 	  m_last,   // last opposite member to deal with
 	  m_next;   // next opposite member to deal with
 	const OCPI::Base::Member *m_hashField;
+	uint64_t (*m_hash)(const char *, size_t); // hash function for m_hashField
+	std::string m_lastKey;  // hash field of the last hashed message
+	size_t m_lastNext;      // member it was routed to
 	BridgeMode m_mode;
 	BridgeOp();
       } *m_bridgeOp;
@@ -106,6 +109,10 @@ namespace OCPI {
       unsigned                       m_firstBridge;         // first one for current local buf
       unsigned                       m_currentBridge;       // current bridge for local buf
       unsigned                       m_nextBridge;          // next one to use for any op
+      // State for zero-copy broadcast of local buffers to in-process bridge ports
+      bool                           m_shareBroadcast;      // readers don't modify buffers
+      std::vector<ExternalBuffer*>   m_proxies;             // per local buffer, per bridge
+      OCPI::Util::SharedRelease<ExternalBuffer> m_sharedRelease; // local buffers to release
     protected:
       LocalPort(Container &container, const OCPI::Metadata::Port &mPort, bool isProvider,
 		const OCPI::Base::PValue *params);
@@ -120,9 +127,17 @@ namespace OCPI {
       // "other" being NULL means the other port is remote in another process
       virtual bool isInProcess(LocalPort *other) const = 0;
       bool getLocalBuffer();
+      bool leastBusy(const BridgeOp &bo, size_t &next);
+      bool sendAll(BridgeOp &bo);
+      static void send2Bridge(ExternalBuffer &local, ExternalBuffer &bridge, BridgePort &bp);
       void setupBridging(Launcher::Connection &c);
       void determineBridgeOp(Launcher::Connection &c, const OCPI::Metadata::Port &output,
 			     const OCPI::Metadata::Port &input, unsigned op, BridgeOp &bo);
+    public:
+      // Ask for a bit to be set in a mask whenever buffers become available or are released
+      // on this port.  Return false if that can't be done because buffers move by other
+      // means (transports or bridges), in which case the caller must poll.
+      bool notifyReadyTo(volatile uint32_t *mask, uint32_t bit);
     protected:
       bool initialConnect(Launcher::Connection &c);
       bool finalConnect(Launcher::Connection &c);
@@ -132,6 +147,8 @@ namespace OCPI {
       void runBridge(); // flow data between this port and its bridge ports
     public:
       size_t nOthers() const { return m_bridgePorts.size(); }
+      // The counters of bridge port n, or NULL if it was never connected
+      const PortStatistics *bridgeStatistics(size_t n) const;
 #if 0
       void applyConnectParams(const OCPI::Transport::Descriptors *other,
 			      const OCPI::Base::PValue *params);
@@ -65,6 +65,7 @@ namespace OCPI {
 
     class Application;
     class Port;
+    struct PortStatistics;
     class Artifact;
     // This is the base class for all workers
     // It supports the API, and is a child of the Worker template class inherited by
@@ -202,6 +203,12 @@ namespace OCPI {
 		       OCPI::API::PropertyAttributes *a_attributes = NULL) const;
       // Level 5 of 5: The actual local work that involves caching etc.
       void setProperty(unsigned ordinal, const OCPI::Base::Value &v) const; // for launcher
+      // Raw access to whole property values, bypassing all levels above.
+      // Overridable by containers that can batch better than one access per property
+      virtual void getRawProperties(const OCPI::API::PropertyInfo *const *infos,
+				    uint8_t *const *data, size_t nProps, bool uncached) const;
+      virtual void setRawProperties(const OCPI::API::PropertyInfo *const *infos,
+				    const uint8_t *const *data, size_t nProps) const;
     private:
       void setProperty(const OCPI::API::PropertyInfo &info, const OCPI::Base::Value &v,
 		       const OCPI::Base::Member &m, size_t offset) const;
@@ -261,6 +268,15 @@ namespace OCPI {
 #undef CONTROL_OP
       virtual bool wait(OCPI::OS::Timer *t = NULL);
       bool isDone();
+      // Runtime statistics as name/value pairs, where port statistics are <port>.<name>,
+      // and those of a port's bridge to another member are <port>.bridge[<n>].<name>
+      typedef std::vector<std::pair<std::string, std::string> > Statistics;
+      virtual void getStatistics(Statistics &stats);
+    protected:
+      static void addStatistic(Statistics &stats, const std::string &name, uint64_t value);
+      static void addPortStatistics(Statistics &stats, const std::string &name,
+				    const PortStatistics &ps);
+    public:
 
     private:
       const OCPI::API::PropertyInfo &checkInfo(unsigned ordinal) const;
@@ -24,6 +24,7 @@
 #define OCPI_CONTAINER_API_H
 #include <stdarg.h>
 #include <string>
+#include <vector>
 #include <initializer_list>
 #include <cassert>
 #include "OcpiPValueApi.hh"
@@ -70,6 +71,21 @@ namespace OCPI {
         getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &endOfData) = 0;
       // Return zero when no buffers are available.
       virtual ExternalBuffer *getBuffer(uint8_t *&data, size_t &length) = 0;
+      // These variants wait up to timeout_us microseconds for a buffer (0 means forever),
+      // and return zero on timeout.
+      virtual ExternalBuffer *
+        getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &endOfData,
+		  unsigned long timeout_us) = 0;
+      virtual ExternalBuffer *
+	getBuffer(uint8_t *&data, size_t &length, unsigned long timeout_us) = 0;
+      // Return a file descriptor that becomes readable when getBuffer may succeed,
+      // for use with poll/select/epoll along with other ports and files.
+      // Calling getBuffer clears it, so call getBuffer until it returns zero after waking.
+      // Return -1 if this port cannot signal readiness (e.g. its buffers are remote),
+      // in which case the timeout variants of getBuffer must be used.
+      virtual int readyFd() = 0;
+      // The size of this port's buffers, which is the largest message it can carry.
+      virtual size_t bufferSize() = 0;
       inline ExternalBuffer *
       getInputBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &eof) {
         return getBuffer(data, length, opCode, eof);
@@ -107,6 +123,7 @@ namespace OCPI {
 			   const PValue *otherParams = NULL) = 0;
     };
     class Property;
+    class PropertyBatch;
     class PropertyInfo;
     class PropertyAccess {
     public:
@@ -154,6 +171,7 @@ namespace OCPI {
     };
     class Worker : virtual public PropertyAccess {
       friend class Property;
+      friend class PropertyBatch;
       friend class OCPI::RCC::RCCUserSlave;
       virtual PropertyInfo &setupProperty(const char *name,
 					  volatile uint8_t *&m_writeVaddr,
@@ -161,6 +179,12 @@ namespace OCPI {
       virtual PropertyInfo &setupProperty(unsigned n,
 					  volatile uint8_t *&m_writeVaddr,
 					  const volatile uint8_t *&m_readVaddr) const = 0;
+      // Raw access to whole property values in their native binary layout, for a batch of
+      // properties on this worker.  Used by Property and PropertyBatch raw value methods.
+      virtual void getRawProperties(const PropertyInfo *const *infos, uint8_t *const *data,
+				    size_t nProps, bool uncached) const = 0;
+      virtual void setRawProperties(const PropertyInfo *const *infos,
+				    const uint8_t *const *data, size_t nProps) const = 0;
       virtual bool beforeStart() const = 0;
     protected:
       virtual ~Worker();
@@ -339,6 +363,7 @@ namespace OCPI {
     // on their stack so that access to members (in inline methods) has no indirection.
     class Property {
       friend class OCPI::Container::Worker;
+      friend class PropertyBatch;
       // First, the reference memebers to maximize code sharing among constructors
     protected:
       const Worker &m_worker;               // which worker do I belong to
@@ -514,7 +539,27 @@ namespace OCPI {
       // ==========================================================================================
       // End of access list interfaces
       // ==========================================================================================
-
+      // Raw access to the whole value of the property in its native binary layout, with no
+      // string conversion or navigation.  The buffer length must be rawLength().
+      size_t rawLength() const;
+      void getRawValue(void *buf, size_t length, bool uncached = false) const;
+      void setRawValue(const void *buf, size_t length) const;
+    };
+    // A batch of property handles, possibly on different workers, whose raw values are
+    // read or written together.  Handles on the same worker are accessed in one call
+    // to that worker, which for remote workers is a single round trip.
+    // The handles must outlive the batch.
+    class PropertyBatch {
+      std::vector<const Property *> m_properties;
+      void access(const void *const values[], bool get, bool uncached) const;
+    public:
+      PropertyBatch() {}
+      PropertyBatch(std::initializer_list<const Property *> props) : m_properties(props) {}
+      void add(const Property &p) { m_properties.push_back(&p); }
+      size_t size() const { return m_properties.size(); }
+      // Each value buffer must be the rawLength() of its corresponding property
+      void getRawValues(void *const values[], bool uncached = false) const;
+      void setRawValues(const void *const values[]) const;
     };
     // ACI functions for using servers
     void useServers(const char *server = NULL, const PValue *params = NULL,
@@ -127,12 +127,16 @@ public: // Should these be protected with friends reading?
   void initMasks(OcpiPortMask first, va_list ap);
   void setMasks(OcpiPortMask first, va_list ap);
   void activate(OCPI::OS::Timer &tmr, unsigned nPorts) const;
+  // For containers that keep the timeout themselves rather than in an OS::Timer
+  void activate(unsigned nPorts) const;
   // Return true if should run based on non-port info
   // Set timedout if we are running due to timeout.
   // Set hasRun
   // Set bail if should NOT run based on non-port info
  protected:
   bool shouldRun(OCPI::OS::Timer &tmr, bool &timedout, bool &bail) const;
+  // Same, but with the timeout's expiration determined by the caller
+  bool shouldRun(bool expired, bool &timedout, bool &bail) const;
 };
 }} // OCPI::API::
 #endif // __cplusplus
@@ -220,7 +220,8 @@ namespace OCPI {
 	    em->waitForEvent(usecs) == XF::EventTimeout && m_verbose)
 	  ocpiBad("Timeout after %u usecs waiting for event", usecs);
 	// if there is no application on this container, use less CPU
-	OCPI::OS::sleep(firstApplication() || m_bridgedPorts.size() ? 0 : 100);
+	if (m_bridgedPorts.size() || !idleWait())
+	  OCPI::OS::sleep(firstApplication() || m_bridgedPorts.size() ? 0 : 100);
       }
       return true;
     }
@@ -19,7 +19,16 @@
  */
 
 #include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
 #include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 // This is obviously temporary
 #ifdef __APPLE__
 #include "../../../foreign/pwq/src/platform.c"
@@ -90,8 +99,8 @@ namespace OCPI {
     ExternalBuffer::
     ExternalBuffer(BasicPort &a_port, ExternalBuffer *a_next, unsigned n)
       : m_port(a_port), m_full(false), m_busy(false), m_position(n), m_next(a_next),
-	m_zcHead(NULL), m_zcTail(NULL), m_zcNext(NULL), m_zcHost(NULL), m_dtBuffer(NULL),
-	m_dtData(NULL) {
+	m_zcHead(NULL), m_zcTail(NULL), m_zcNext(NULL), m_zcHost(NULL), m_shared(NULL),
+	m_dtBuffer(NULL), m_dtData(NULL) {
       memset(&m_hdr, 0, sizeof(m_hdr));
       pthread_spin_init(&m_zcLock, PTHREAD_PROCESS_PRIVATE);
     }
@@ -125,7 +134,7 @@ namespace OCPI {
       : PortData(mPort, a_isProvider, NULL), m_lastInBuffer(NULL), m_lastOutBuffer(NULL),
 	m_dtLastBuffer(NULL), m_dtPort(NULL), m_allocation(NULL), m_bufferStride(0),
 	m_next2write(NULL), m_next2put(NULL), m_next2read(NULL), m_next2release(NULL),
-	m_forward(NULL), m_backward(NULL), m_nRead(0), m_nWritten(0),
+	m_readyFd(-1), m_readySignaled(false), m_readyMask(NULL), m_readyBit(0), m_stalled(false), m_forward(NULL), m_backward(NULL), m_nRead(0), m_nWritten(0),
 	myDesc(getData().data.desc), m_metaPort(mPort), m_container(c) {
       applyPortParams(params);
     }
@@ -152,6 +161,8 @@ namespace OCPI {
       if (m_allocation && m_allocator == this)
 	freeBuffers(m_allocation);
       delete m_dtLastBuffer;
+      if (m_readyFd >= 0)
+	close(m_readyFd);
     }
 
     void BasicPort::
@@ -620,12 +631,14 @@ namespace OCPI {
       if ((m_forward ? m_forward : this)->m_lastOutBuffer)
 	throw OU::Error("getBuffer called on output port \"%s\" without putting previous buffer",
 			name().c_str());
+      clearReady();
       ExternalBuffer *b = getEmptyBuffer();
       if (b) {
 	data = b->data();
 	length = b->m_hdr.m_length;
 	(m_forward ? m_forward : this)->m_lastOutBuffer = b;
       }
+      countStall(!b);
       return b;
     }
 
@@ -648,6 +661,10 @@ namespace OCPI {
       if (!m_lastOutBuffer)
 	throw OU::Error("put called on output port %s without a previous buffer",
 			name().c_str());
+      // Count it on the output port even when the buffer belongs to the input shim
+      BasicPort &counted = isProvider() && m_backward ? *m_backward : *this;
+      counted.m_stats.m_messages++;
+      counted.m_stats.m_bytes += length;
       m_lastOutBuffer->send(length, opCode, end, direct);
       ocpiDebug("Putting (internal) on %p(f %p) buffer %p length %zu", this, m_forward,
 		m_lastOutBuffer, length);
@@ -707,6 +724,7 @@ namespace OCPI {
 	m_port.m_nWritten++;
 	assert(this == m_port.m_next2put);
 	m_port.m_next2put = m_next;
+	m_port.notifyReady();
       } else if (m_port.m_dtPort) {
 	ocpiAssert(m_dtBuffer);
 	m_port.m_dtPort->sendOutputBuffer(m_dtBuffer, m_hdr.m_length, m_hdr.m_opCode, m_hdr.m_eof);
@@ -736,6 +754,7 @@ namespace OCPI {
 	  b->m_hdr.m_data = 0; // standalone EOF
 	  b->m_full = true;
 	  m_nWritten++;
+	  b->m_port.notifyReady();
 	}
 	return true;
       }
@@ -757,6 +776,10 @@ namespace OCPI {
     put(OA::ExternalBuffer &buf) {
       ExternalBuffer &b = static_cast<ExternalBuffer&>(buf);
       ocpiDebug("port.put(buf %p) on %p forward %p", &buf, this, m_forward);
+      if (!isProvider()) { // not when forwarded to an input shim
+	m_stats.m_messages++;
+	m_stats.m_bytes += b.m_hdr.m_length;
+      }
       if (m_forward)
 	m_forward->put(buf);
       else if (&b.m_port == this)
@@ -776,6 +799,7 @@ namespace OCPI {
 	  m_next2write->m_zcHead = &b;
 	m_next2write->m_zcTail = &b;
 	pthread_spin_unlock(&m_next2write->m_zcLock);
+	notifyReady();
       } else if (m_dtPort && b.m_dtBuffer)
 	m_dtPort->sendZcopyInputBuffer(*b.m_dtBuffer,
 				       b.m_hdr.m_length, b.m_hdr.m_opCode, b.m_hdr.m_eof);
@@ -795,6 +819,107 @@ namespace OCPI {
 	(m_forward ? m_forward->m_nWritten - m_forward->m_nRead : m_nWritten - m_nRead) != 0;
     }
 
+    // Readiness for external ports is signaled by an eventfd on the port that holds the
+    // shim buffers, which is written at most once between clearings.
+    // Ports using the transport (DT) mode have nothing to signal them so callers poll.
+    int BasicPort::
+    readyFd() {
+      BasicPort &p = m_forward ? *m_forward : *this;
+#ifdef __linux__
+      if (p.m_readyFd < 0 && p.m_allocation &&
+	  (p.m_readyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+	throw OU::Error("Can't create readiness event for port \"%s\": %s", cname(),
+			strerror(errno));
+#endif
+      return p.m_readyFd;
+    }
+
+    void BasicPort::
+    signalReady() {
+      if (!m_readySignaled && __sync_bool_compare_and_swap(&m_readySignaled, false, true)) {
+	uint64_t one = 1;
+	ssize_t n = write(m_readyFd, &one, sizeof(one));
+	(void)n; // it is non-blocking and can only fail when it is already readable
+      }
+    }
+
+    // Clear before looking for buffers, so that anything that happens after will signal
+    void BasicPort::
+    clearReady() {
+      BasicPort &p = m_forward ? *m_forward : *this;
+      if (p.m_readyFd >= 0 && p.m_readySignaled) {
+	p.m_readySignaled = false;
+	uint64_t value;
+	ssize_t n = read(p.m_readyFd, &value, sizeof(value));
+	(void)n;
+      }
+    }
+
+    static uint64_t now() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+
+    // Wait until the port might be ready, or the deadline passes (0 is never).
+    // Return false on timeout.  Without a readiness fd, poll with backoff.
+    bool BasicPort::
+    waitReady(uint64_t deadline, unsigned &backoff) {
+      uint64_t wait = UINT64_MAX, t = now();
+      if (deadline) {
+	if (t >= deadline)
+	  return false;
+	wait = deadline - t;
+      }
+#ifdef __linux__
+      BasicPort &p = m_forward ? *m_forward : *this;
+      if (p.m_readyFd >= 0) {
+	struct pollfd pfd = { p.m_readyFd, POLLIN, 0 };
+	struct timespec ts, *tsp = NULL;
+	if (deadline) {
+	  ts.tv_sec = (time_t)(wait / 1000000000ull);
+	  ts.tv_nsec = (long)(wait % 1000000000ull);
+	  tsp = &ts;
+	}
+	if (ppoll(&pfd, 1, tsp, NULL) < 0 && errno != EINTR)
+	  throw OU::Error("Error waiting for port \"%s\": %s", cname(), strerror(errno));
+      } else
+#endif
+      {
+	// The transport needs no help from us, so just back off from 1us to 1ms
+	backoff = backoff ? std::min(backoff * 2, 1000u) : 1;
+	struct timespec ts;
+	uint64_t ns = std::min(wait, (uint64_t)backoff * 1000);
+	ts.tv_sec = 0;
+	ts.tv_nsec = (long)ns;
+	nanosleep(&ts, NULL);
+      }
+      return true;
+    }
+
+    OA::ExternalBuffer *BasicPort::
+    getBuffer(uint8_t *&data, size_t &length, unsigned long timeout_us) {
+      uint64_t deadline = timeout_us ? now() + timeout_us * 1000ull : 0;
+      unsigned backoff = 0;
+      readyFd(); // make sure it exists before the first look
+      OA::ExternalBuffer *b;
+      while (!(b = getBuffer(data, length)) && waitReady(deadline, backoff))
+	;
+      return b;
+    }
+
+    OA::ExternalBuffer *BasicPort::
+    getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &end,
+	      unsigned long timeout_us) {
+      uint64_t deadline = timeout_us ? now() + timeout_us * 1000ull : 0;
+      unsigned backoff = 0;
+      readyFd(); // make sure it exists before the first look
+      OA::ExternalBuffer *b;
+      while (!(b = getBuffer(data, length, opCode, end)) && waitReady(deadline, backoff))
+	;
+      return b;
+    }
+
     // Step 3: high level
     OA::ExternalBuffer *BasicPort::
     getBuffer(uint8_t *&data, size_t &length, uint8_t &opCode, bool &end) {
@@ -805,7 +930,9 @@ namespace OCPI {
 	throw
 	  OU::Error("getBuffer called on input port \"%s\" of worker \"%s\" without releasing "
 		    "previous buffer", name().c_str(), metaPort().metaWorker().cname());
+      clearReady();
       ExternalBuffer *b = getFullBuffer();
+      countStall(!b);
       if (b) {
 	data = b->data();
 	length = b->m_hdr.m_length;
@@ -813,35 +940,36 @@ namespace OCPI {
 	end = b->m_hdr.m_eof;
 	assert(!m_forward);
 	m_lastInBuffer = b;
+	if (data) {
+	  m_stats.m_messages++;
+	  m_stats.m_bytes += length;
+	}
 	//	(m_forward ? m_forward : this)->m_lastInBuffer = b;
       }
       return b;
     }
 
+    // A peek, which does not remove the buffer from the queue, so that peekOpCode
+    // does not lose it.
     ExternalBuffer *
     ExternalBuffer::zcPeek() {
-      // A peek
-      ocpiDebug("zcpeek buf %p head %p tail %p next %p", this, m_zcHead, m_zcTail, m_zcHead->m_zcNext);
-      ExternalBuffer *l_next = NULL;
-      if (m_zcHead) {
-        pthread_spin_lock(&m_zcLock);
-	if ((l_next = m_zcHead)) {
-	  m_zcHead = l_next->m_zcNext;
-	  if (l_next == m_zcTail)
-	    m_zcTail = NULL;
-	}
-	pthread_spin_unlock(&m_zcLock);
-      }
-      return l_next;
+      ocpiDebug("zcpeek buf %p head %p tail %p", this, m_zcHead, m_zcTail);
+      return m_zcHead;
     }
 
-    // This buffer is the head->next, we are the single reader
+    // This buffer is the head of its host's queue, we are the single reader
     void ExternalBuffer::
     zcPop() {
       ocpiDebug("zcPop on %p host %p head %p headnext %p early next %p", this, m_zcHost,
 		m_zcHost->m_zcHead,
 		m_zcHost->m_zcHead ? m_zcHost->m_zcHead->m_zcNext : NULL, m_zcNext);
-      //      m_zcHost->m_zcHead->m_zcNext = m_zcNext;
+      ExternalBuffer &host = *m_zcHost;
+      assert(host.m_zcHead == this);
+      pthread_spin_lock(&host.m_zcLock);
+      host.m_zcHead = m_zcNext;
+      if (host.m_zcTail == this)
+	host.m_zcTail = NULL;
+      pthread_spin_unlock(&host.m_zcLock);
       m_zcHost = NULL;
     }
 
@@ -959,7 +1087,12 @@ namespace OCPI {
     void BasicPort::
     releaseBuffer(ExternalBuffer &b) {
       assert(!m_forward);
-      if (&b.m_port != this)               // buffer is zc queued buffer
+      if (b.m_shared) {                    // buffer is a proxy for a broadcast buffer
+	ExternalBuffer &shared = *b.m_shared;
+	b.m_full = b.m_busy = false;
+	b.m_zcNext = b.m_zcHost = b.m_shared = NULL;
+	shared.m_shares.remove(); // the proxy may be reused after this
+      } else if (&b.m_port != this)        // buffer is zc queued buffer
 	b.m_port.releaseBuffer(b);         // release from its true port
       else if (m_next2release) {
 	assert(&b.m_port == this);
@@ -971,6 +1104,7 @@ namespace OCPI {
 	m_next2release = b.m_next;
 	ocpiDebug("Release on %p of %p head %p tail %p next %p", this, &b, b.m_zcHead, b.m_zcTail, b.m_zcNext);
 	b.m_zcHead = b.m_zcTail = b.m_zcNext = b.m_zcHost = NULL;
+	notifyReady();
       } else if (m_dtPort) {
 	assert(&b.m_port == this);
 	assert(b.m_dtBuffer);
@@ -1231,6 +1365,8 @@ namespace OCPI {
     unsigned BasicPort::emptyCount() {
       if (m_forward)
 	return m_forward->emptyCount();
+      if (!m_next2write) // not shim mode
+	return m_dtPort ? m_dtPort->emptyOutputBufferCount() : 0;
       if (!m_next2write->m_full) {
 	unsigned w = m_next2write->m_position, r = m_next2release->m_position;
 	return r + (r > w ? 0 : OCPI_UTRUNCATE(unsigned, m_nBuffers)) - w;
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include "farmhash.h"
+#include "UtilHash.hh"
 #include "OsAssert.hh"
 #include "UtilCDR.hh"
 #include "Container.hh"
@@ -27,6 +28,7 @@
 
 namespace OCPI {
   namespace Container {
+    namespace OA = OCPI::API;
     namespace OM = OCPI::Metadata;
     namespace OU = OCPI::Util;
     namespace OB = OCPI::Base;
@@ -39,7 +41,7 @@ namespace OCPI {
 	 m_scale(0), m_external(NULL), m_connectedBridgePorts(0), m_localBridgePort(NULL),
 	 m_bridgeContainer(NULL), m_localBuffer(NULL),
 	 m_localDistribution(OM::Port::DistributionLimit), m_firstBridge(0), m_currentBridge(0),
-	 m_nextBridge(0) {
+	 m_nextBridge(0), m_shareBroadcast(false) {
     }
 
     LocalPort::
@@ -52,6 +54,8 @@ namespace OCPI {
 	  delete m_bridgePorts[n];
       if (m_localBridgePort != this)
 	delete m_localBridgePort;
+      for (unsigned n = 0; n < m_proxies.size(); n++)
+	delete m_proxies[n];
     }
 
     // This is called soon after construction, but not in the constructor.
@@ -109,6 +113,7 @@ namespace OCPI {
 	  unsigned /*op*/, LocalPort::BridgeOp &bo) {
       bo.m_mode = partialRange(c.m_out.m_scale, c.m_out.m_index, c.m_in.m_scale,
 			       bo.m_first, bo.m_last) ? Discard : Balanced;
+      bo.m_next = bo.m_first;
     }
 
     // Send balanced to all
@@ -254,7 +259,9 @@ namespace OCPI {
       /* Hashed */   {{bad,bad},     {bad,bad},         {bad,bad},          {bad,bad},      {bad,bad}, {bad,bad},      {bad,bad}},
     };
 
-    LocalPort::BridgeOp::BridgeOp() : m_first(0), m_last(0), m_next(0), m_hashField(NULL), m_mode(Cyclic) {}
+    LocalPort::BridgeOp::BridgeOp()
+      : m_first(0), m_last(0), m_next(0), m_hashField(NULL), m_hash(OU::Hash64),
+	m_lastNext(SIZE_MAX), m_mode(Cyclic) {}
 
     // Figure out the three parameters for bridge port processing for the given op
     // at this port: the mode, the starting bridge port, and the ending bridge port.
@@ -280,6 +287,28 @@ namespace OCPI {
       m_defaultBridgeOp.m_last = m_bridgePorts.size() - 1;
       for (unsigned n = 0; n < nOps; n++)
 	determineBridgeOp(c, output, input, n, m_bridgeOps[n]);
+      // Readers may modify their input buffers in place, so sharing broadcast buffers with
+      // them instead of copying must be asked for, on the output side.
+      bool share;
+      if (OB::findBool(c.m_out.m_params, "shareBroadcast", share))
+	m_shareBroadcast = share;
+      OA::ULong lag;
+      if (OB::findULong((isProvider() ? c.m_in : c.m_out).m_params, "broadcastLag", lag))
+	m_sharedRelease.setLimit(lag);
+      // All output members must agree on the hash, so it comes from the output side
+      const char *hash;
+      if (OB::findString(c.m_out.m_params, "hashFunction", hash)) {
+	uint64_t (*func)(const char *, size_t);
+	if (!strcasecmp(hash, "farmhash"))
+	  func = OU::Hash64;
+	else if (!strcasecmp(hash, "fingerprint")) // stable across releases and platforms
+	  func = OU::Fingerprint64;
+	else
+	  throw OU::Error("Invalid hashFunction value \"%s\": must be farmhash or fingerprint",
+			  hash);
+	for (unsigned n = 0; n < nOps; n++)
+	  m_bridgeOps[n].m_hash = func;
+      }
       if (isInProcess(NULL)) {
 	ocpiInfo("Bridging is in-process");
 	becomeShim(NULL);    // skinny set of buffers and flags between codec and worker
@@ -382,6 +411,23 @@ namespace OCPI {
       }
     }
 
+    // Only direct in-process connections between two worker (or external) ports, with
+    // shim buffers on one side, have every put and release of buffers pass through
+    // notifyReady() on the port holding the buffers.
+    bool LocalPort::
+    notifyReadyTo(volatile uint32_t *mask, uint32_t bit) {
+      BasicPort *other = m_forward ? m_forward : m_backward;
+      LocalPort *lp = other ? dynamic_cast<LocalPort *>(other) : NULL;
+      if (!lp || !m_bridgePorts.empty() || !lp->m_bridgePorts.empty() ||
+	  !(m_forward ? m_forward : this)->m_allocation) {
+	m_readyMask = NULL;
+	return false;
+      }
+      m_readyBit = bit;
+      m_readyMask = mask;
+      return true;
+    }
+
     // Make sure a local buffer is available and return true of there is one ready to go.
     // Also, for each new local buffer, initialize m_bridgeOp (and m_currentBuffer)
     // If m_localBuffer is set but m_bridgeOp is NOT set, it means we can't yet do anything,
@@ -433,11 +479,81 @@ namespace OCPI {
       return true;
     }
 
-    static inline void
-    send2Bridge(ExternalBuffer &local, ExternalBuffer &bridge) {
+    inline void LocalPort::
+    send2Bridge(ExternalBuffer &local, ExternalBuffer &bridge, BridgePort &bp) {
       assert(bridge.length() >= local.length());
       memcpy(bridge.data(), local.data(), local.length());
       bridge.send(local.length(), local.opCode(), local.end());
+      bp.countStall(false);
+      bp.m_stats.m_messages++;
+      bp.m_stats.m_bytes += local.length();
+    }
+
+    const PortStatistics *LocalPort::
+    bridgeStatistics(size_t n) const {
+      return m_bridgePorts[n] ? &m_bridgePorts[n]->statistics() : NULL;
+    }
+
+    // Choose the bridge port in the range with the most empty buffers.
+    // The search starts at bo.m_next so that ties are broken round-robin.
+    // Return false if none of them has an empty buffer.
+    inline bool LocalPort::
+    leastBusy(const BridgeOp &bo, size_t &next) {
+      unsigned most = 0;
+      for (size_t n = bo.m_next, count = bo.m_last - bo.m_first + 1; count; count--) {
+	unsigned empty = m_bridgePorts[n]->emptyCount();
+	if (empty > most) {
+	  most = empty;
+	  next = n;
+	}
+	n = n == bo.m_last ? bo.m_first : n + 1;
+      }
+      return most != 0;
+    }
+
+    // Send the current local buffer to all bridge ports in the range, starting at bo.m_next.
+    // With shareBroadcast, bridge ports with buffers in this process share the local buffer
+    // without copying, using a proxy buffer per bridge port that is put on its zero-copy
+    // queue.  Others get a copy.  Return false if we must wait for a bridge port or for
+    // shared buffers to be released.
+    bool LocalPort::
+    sendAll(BridgeOp &bo) {
+      ExternalBuffer &lb = *m_localBuffer;
+      // only buffers from shim mode can be shared
+      bool canShare = m_shareBroadcast && lb.m_next != NULL;
+      if (canShare && bo.m_next == bo.m_first && m_sharedRelease.full())
+	return false; // the slowest reader is too far behind
+      size_t nBridges = m_bridgePorts.size();
+      for (;;) {
+	BridgePort &bp = *m_bridgePorts[bo.m_next];
+	BasicPort &target = bp.m_forward ? *bp.m_forward : bp;
+	if (canShare && target.m_next2write) {
+	  size_t n = lb.m_position * nBridges + bo.m_next;
+	  if (n >= m_proxies.size())
+	    m_proxies.resize(n + 1, NULL);
+	  ExternalBuffer *&proxy = m_proxies[n];
+	  if (!proxy)
+	    proxy = new ExternalBuffer(lb.m_port, NULL, 0);
+	  assert(!proxy->m_shared);
+	  proxy->m_hdr = lb.m_hdr;
+	  proxy->m_dtData = lb.m_hdr.m_data ? lb.data() : NULL;
+	  proxy->m_shared = &lb;
+	  lb.m_shares.add();
+	  bp.put(*proxy); // counted by bp, and forwarded to target
+	} else {
+	  ExternalBuffer *b = bp.getEmptyBuffer();
+	  if (!b) {
+	    bp.countStall(true);
+	    return false;
+	  }
+	  send2Bridge(lb, *b, bp);
+	}
+	if (bo.m_next == bo.m_last)
+	  break;
+	bo.m_next++;
+      }
+      bo.m_next = bo.m_first;
+      return true;
     }
 
     // The callback to do bridge port processing on a local port.
@@ -447,6 +563,8 @@ namespace OCPI {
       // Wait for all bridge connections to be made to this local port.
       if (m_connectedBridgePorts != m_bridgePorts.size())
 	return;
+      // Release local buffers in order, but only after all readers of shared ones are done.
+      m_sharedRelease.poll();
       // Keep going while there are local buffers we can process
       // If this returns true, we have both m_currentBuffer and m_bridgeOp
       while (getLocalBuffer()) {
@@ -463,6 +581,8 @@ namespace OCPI {
 	  assert(m_localBuffer->data());
 	  memcpy(m_localBuffer->data(), b->data(), b->length());
 	  m_localBuffer->send(b->length(), b->opCode(), b->end());
+	  bp.m_stats.m_messages++;
+	  bp.m_stats.m_bytes += b->length();
 	  bp.releaseBuffer(*b);
 	  m_localBuffer = NULL;
 	  // Cycle nextBridge globally among all bridge ports.
@@ -485,7 +605,8 @@ namespace OCPI {
 	      m_localBuffer = NULL;
 	    break;
 	  case Balanced:
-	    // For now, left be cyclic
+	    if (!leastBusy(bo, next))
+	      return; // all members are busy: wait until one has room
 	    break;
 	  case Directed:
 	    next = m_localBuffer->direct();
@@ -494,9 +615,20 @@ namespace OCPI {
 	  case Hashed:
 	    {
 	      size_t length;
-	      const uint8_t *data = bo.m_hashField->getField(m_localBuffer->data(), length);
+	      const char *data =
+		(const char *)bo.m_hashField->getField(m_localBuffer->data(), length);
 	      assert(data);
-	      next = OU::Hash((const char*)data, length) % m_bridgePorts.size();
+	      // Runs of messages with the same key, and retries of a message whose member
+	      // had no room, reuse the last routing rather than hashing again.
+	      if (bo.m_lastNext != SIZE_MAX && length == bo.m_lastKey.length() &&
+		  !memcmp(data, bo.m_lastKey.data(), length))
+		next = bo.m_lastNext;
+	      else {
+		// Jump hashing means adding members only moves 1/n of the keys
+		next = OU::Misc::jumpHash(bo.m_hash(data, length), m_bridgePorts.size());
+		bo.m_lastKey.assign(data, length);
+		bo.m_lastNext = next;
+	      }
 	      if (next < bo.m_first || next > bo.m_last)
 		m_localBuffer = NULL;
 	    }
@@ -504,15 +636,22 @@ namespace OCPI {
 	  case Discard:
 	    m_localBuffer = NULL;
 	    break;
+	  case All:
+	    if (!sendAll(bo))
+	      return;
+	    m_localBuffer = NULL;
+	    break;
 	  default:;
 	  }
 	  if (m_localBuffer) { // have a full output from local port
 	    // Phase 2: see if the identified bridge port has a buffer after all and ship it.
 	    BridgePort *bp = m_bridgePorts[next];
 	    ExternalBuffer *b = bp->getEmptyBuffer();
-	    if (!b)
+	    if (!b) {
+	      bp->countStall(true);
 	      return;
-	    send2Bridge(*m_localBuffer, *b);
+	    }
+	    send2Bridge(*m_localBuffer, *b, *bp);
 	    // Phase 3: do post processing, to compute bo.m_next, etc. "all" is special case
 	    switch (bo.m_mode) { // break to process buffer if b != NULL
 	    case Cyclic:
@@ -526,17 +665,7 @@ namespace OCPI {
 	      bo.m_next += m_scale;
 	      bo.m_next %= m_bridgePorts.size();
 	      break;
-	    case All:
-	      // A special case where we loop and replicate the output
-	      while (bo.m_next != bo.m_last) {
-		bo.m_next++;
-		bp = m_bridgePorts[bo.m_next];
-		if (!(b = bp->getEmptyBuffer()))
-		  return;
-		send2Bridge(*m_localBuffer, *b);
-	      }
-	      break;
-	    case Balanced: // do cyclic for now.
+	    case Balanced: // start the next search after this choice
 	      bo.m_next = next == bo.m_last ? bo.m_first : ++next;
 	      break;
 	    case Directed:
@@ -545,7 +674,7 @@ namespace OCPI {
 	    }
 	    m_localBuffer = NULL;
 	  }
-	  lb->release();
+	  m_sharedRelease.release(*lb);
 	} // end of output processing
       } // end of loop through local buffers
     }  // end of method
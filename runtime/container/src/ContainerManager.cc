@@ -45,6 +45,7 @@ extern "C" {
 #include "OcpiContainerRunConditionApi.hh"
 #include "XferAccess.hh"
 #include "XferManager.hh"
+#include "TimeEmit.hh"
 
 #include "ContainerManager.hh"
 #include "ContainerLauncher.hh"
@@ -71,6 +72,13 @@ namespace OCPI {
       // Delete my children before the transportGlobals they depend on.
       delete LocalLauncher::singleton();
       deleteChildren();
+      // Time::Emit is shut down here, after all containers and workers are gone, so that
+      // streams and dumps are finished whichever containers were used.
+      // Ignore any errors since it is not critical.
+      try {
+	OCPI::Time::Emit::shutdown();
+      } catch (...) {
+      }
       if ( m_tpg_no_events ) delete m_tpg_no_events;
       if ( m_tpg_events ) delete m_tpg_events;
       delete [] s_containers;
@@ -125,6 +125,53 @@ namespace OCPI {
     void Property::throwError(const char *err) const {
       throw OU::Error("Access error for property \"%s\":  %s", m_info.cname(), err);
     }
+    size_t Property::rawLength() const {
+      return m_info.m_nBytes;
+    }
+    void Property::getRawValue(void *buf, size_t length, bool uncached) const {
+      if (length != m_info.m_nBytes)
+	throwError("buffer length for raw value does not match the property's raw length");
+      const PropertyInfo *info = &m_info;
+      uint8_t *data = static_cast<uint8_t *>(buf);
+      m_worker.getRawProperties(&info, &data, 1, uncached);
+    }
+    void Property::setRawValue(const void *buf, size_t length) const {
+      if (length != m_info.m_nBytes)
+	throwError("buffer length for raw value does not match the property's raw length");
+      const PropertyInfo *info = &m_info;
+      const uint8_t *data = static_cast<const uint8_t *>(buf);
+      m_worker.setRawProperties(&info, &data, 1);
+    }
+    // Group the properties in the batch by worker, and access each worker once
+    void PropertyBatch::
+    access(const void *const values[], bool get, bool uncached) const {
+      std::vector<bool> done(m_properties.size(), false);
+      std::vector<const PropertyInfo *> infos;
+      std::vector<const uint8_t *> data;
+      for (size_t n = 0; n < m_properties.size(); ++n)
+	if (!done[n]) {
+	  const Worker &w = m_properties[n]->m_worker;
+	  infos.clear();
+	  data.clear();
+	  for (size_t i = n; i < m_properties.size(); ++i)
+	    if (!done[i] && &m_properties[i]->m_worker == &w) {
+	      infos.push_back(&m_properties[i]->m_info);
+	      data.push_back(static_cast<const uint8_t *>(values[i]));
+	      done[i] = true;
+	    }
+	  if (get)
+	    w.getRawProperties(&infos[0], const_cast<uint8_t *const *>(&data[0]), infos.size(),
+			       uncached);
+	  else
+	    w.setRawProperties(&infos[0], &data[0], infos.size());
+	}
+    }
+    void PropertyBatch::getRawValues(void *const values[], bool uncached) const {
+      access(const_cast<const void *const *>(values), true, uncached);
+    }
+    void PropertyBatch::setRawValues(const void *const values[]) const {
+      access(values, false, false);
+    }
 
 // yes, we really do want to compare floats with zero here
 #pragma GCC diagnostic push
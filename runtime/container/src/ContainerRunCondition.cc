@@ -152,6 +152,10 @@ void RunCondition::
 activate(OCPI::OS::Timer &tmr, unsigned nPorts) const {
   if (m_timeout)
     tmr.reset(m_usecs / 1000000, (m_usecs % 1000000) * 1000);
+  activate(nPorts);
+}
+void RunCondition::
+activate(unsigned nPorts) const {
   // fix up default run condition when there are no ports at all
   if (!nPorts && m_portMasks && m_portMasks[0] == OCPI_ALL_PORTS) {
     if (m_timeout)
@@ -164,11 +168,18 @@ activate(OCPI::OS::Timer &tmr, unsigned nPorts) const {
 }
 bool RunCondition::
 shouldRun(OCPI::OS::Timer &timer, bool &timedOut, bool &bail) const {
-  if (!m_portMasks) // no port mask array means run all the time
-    return true;
-  if (m_timeout && timer.expired()) {
+  if (m_portMasks && m_timeout && timer.expired()) {
     ocpiInfo("WORKER TIMED OUT, elapsed time = %u,%u",
              timer.getElapsed().seconds(), timer.getElapsed().nanoseconds());
+    return shouldRun(true, timedOut, bail);
+  }
+  return shouldRun(false, timedOut, bail);
+}
+bool RunCondition::
+shouldRun(bool expired, bool &timedOut, bool &bail) const {
+  if (!m_portMasks) // no port mask array means run all the time
+    return true;
+  if (m_timeout && expired) {
     timedOut = true;
     return true;
   }
@@ -19,6 +19,7 @@
  */
 
 #include <climits> // CHAR_BIT
+#include <cinttypes>
 #include "OsMisc.hh"
 #include "BaseValue.hh"
 #include "BaseValueReader.hh"
@@ -659,6 +660,61 @@ namespace OCPI {
       }
     }
 
+    // Raw property access: the whole property value in its native binary layout,
+    // with the same caching and checking as the value-based methods above.
+    // Scalars use the sized accessors so that they are atomic where the hardware allows.
+    static inline bool isRawScalar(const OA::PropertyInfo &info) {
+      return !info.m_isSequence && !info.m_arrayRank && info.m_baseType != OA::OCPI_String &&
+	info.m_baseType != OA::OCPI_Struct;
+    }
+    void Worker::
+    getRawProperties(const OA::PropertyInfo *const *infos, uint8_t *const *data, size_t nProps,
+		     bool uncached) const {
+      OA::PropertyOptionList options({ uncached ? OA::UNCACHED : OA::NONE });
+      for (size_t n = 0; n < nProps; ++n) {
+	const OA::PropertyInfo &info = *infos[n];
+	if (info.m_baseType == OA::OCPI_Type)
+	  throw OU::Error("Typedef properties are not supported yet");
+	if (info.m_isDebug && !isDebug())
+	  throw OU::Error("For getting debug property \"%s\": worker is not in debug mode",
+			  info.cname());
+	bool scalar = isRawScalar(info);
+	uint8_t *p = data[n];
+	if (info.m_isParameter) {
+	  if (!scalar)
+	    throw OU::Error("Raw access to the non-scalar \"%s\" parameter is not supported",
+			    info.cname());
+	  memcpy(p, &info.m_default->m_UChar, info.m_nBytes);
+	  continue;
+	}
+	bool dirty;
+	Cache *cache = getCache(info, 0, info, &dirty, options);
+	getData(info, cache, dirty, 0, p, scalar ? 0 : info.m_nBytes, scalar ? info.m_nBits : 0);
+      }
+    }
+
+    void Worker::
+    setRawProperties(const OA::PropertyInfo *const *infos, const uint8_t *const *data,
+		     size_t nProps) const {
+      for (size_t n = 0; n < nProps; ++n) {
+	const OA::PropertyInfo &info = *infos[n];
+	if (!info.m_isWritable)
+	  throw OU::Error("The '%s' property of worker '%s' is not writable",
+			  info.cname(), name().c_str());
+	if (info.m_isInitial && !beforeStart())
+	  throw OU::Error("The '%s' property of worker '%s' is initial, and cannot be written "
+			  "after start", info.cname(), name().c_str());
+	if (info.m_baseType == OA::OCPI_Type)
+	  throw OU::Error("Typedef properties are not settable yet");
+	if (info.m_isDebug && !isDebug())
+	  throw OU::Error("For setting debug property \"%s\": worker is not in debug mode",
+			  info.cname());
+	bool scalar = isRawScalar(info);
+	setData(info, getCache(info, 0, info), 0, data[n], scalar ? 0 : info.m_nBytes,
+		scalar ? info.m_nBits : 0);
+      }
+    }
+
     bool Worker::
     getProperty(unsigned ordinal, std::string &a_name, std::string &value, bool *unreadablep,
 		bool hex, bool *cachedp, bool uncached, bool *hiddenp) {
@@ -1058,6 +1114,39 @@ namespace OCPI {
       ocpiAssert("This method is not expected to ever be called" == 0);
     }
 
+    void Worker::
+    addStatistic(Statistics &stats, const std::string &name, uint64_t value) {
+      std::string s;
+      OU::format(s, "%" PRIu64, value);
+      stats.push_back(std::make_pair(name, s));
+    }
+
+    void Worker::
+    addPortStatistics(Statistics &stats, const std::string &name, const PortStatistics &ps) {
+      addStatistic(stats, name + ".messages", ps.m_messages);
+      addStatistic(stats, name + ".bytes", ps.m_bytes);
+      addStatistic(stats, name + ".stalls", ps.m_stalls);
+    }
+
+    // The statistics common to all workers are those of their ports in this process,
+    // each followed by those of its bridge ports to other members.
+    void Worker::
+    getStatistics(Statistics &stats) {
+      for (unsigned n = 0; n < nPorts(); n++) {
+	const char *pname = metaPort(n).cname();
+	Port *p = findPort(pname);
+	if (!p)
+	  continue;
+	addPortStatistics(stats, pname, p->statistics());
+	for (size_t b = 0; b < p->nOthers(); b++) {
+	  const PortStatistics *bs = p->bridgeStatistics(b);
+	  std::string name;
+	  if (bs)
+	    addPortStatistics(stats, OU::format(name, "%s.bridge[%zu]", pname, b), *bs);
+	}
+      }
+    }
+
     WorkerControl::~WorkerControl(){}
   }
   namespace API {
@@ -0,0 +1,610 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Transport benchmark: repeatable throughput and latency measurements.
+ *
+ * Two layers are measured, each over a matrix of message sizes, buffer counts and fan-out:
+ *
+ * - "xfer": each loaded transfer driver, between local endpoints in this process, using the
+ *   same data-then-flag transfer requests that the transport layer builds.
+ * - "aci": one external port broadcasting to a crew of pass-through (bias) workers, whose
+ *   output comes back through another external port, which exercises the transport and
+ *   circuit layers and the crew's bridge ports.  With --server, the crew runs in a container
+ *   of an ocpiserve, so the data plane uses sockets.
+ *
+ * Named scenarios (--scenario) select a layer and driver rather than running the whole matrix:
+ * "pio", "socket" and "datagram-loopback" (xfer over shared memory, TCP or UDP on loopback),
+ * "fanout" (the crew in this process) and "local-ocpiserve" (the crew in an ocpiserve that
+ * is started on loopback for the purpose).
+ *
+ * Latency is measured with one message in flight (one-way for "xfer", round trip for "aci");
+ * throughput is measured with all buffers in flight.  Each case is reported as one JSON
+ * object per line, so that results can be compared across builds.
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "OcpiApi.hh"
+#include "OsAssert.hh"
+#include "UtilMisc.hh"
+#include "UtilException.hh"
+#include "BasePValue.hh"
+#include "XferEndPoint.hh"
+#include "XferServices.hh"
+#include "XferFactory.hh"
+#include "XferManager.hh"
+
+#define OCPI_OPTIONS_HELP \
+  "Usage syntax is: transport_bench [options]\n" \
+  "Measures throughput and latency of transfer drivers and, optionally, of applications\n" \
+  "using them, writing one JSON object per line for each case measured.\n"
+#define OCPI_OPTIONS \
+  CMD_OPTION_S(transport, T, String, 0, "transfer driver to measure, e.g. ocpi-smb-pio\n" \
+	       "default is all loaded drivers") \
+  CMD_OPTION_S(size,      s, ULong,  0, "message size in bytes, default is 16, 1024 and 65536") \
+  CMD_OPTION_S(buffers,   b, ULong,  0, "buffers per connection, default is 2 and 8") \
+  CMD_OPTION_S(fanout,    f, ULong,  0, "consumers per producer, default is 1 and 4") \
+  CMD_OPTION(broadcast,   B, Bool,   0, "xfer: send each message to all consumers, not round-robin") \
+  CMD_OPTION(pings,       p, ULong,  "1000", "messages used to measure latency") \
+  CMD_OPTION(messages,    m, ULong,  "20000", "messages used to measure throughput") \
+  CMD_OPTION(timeout,     t, ULong,  "5", "seconds to wait for any one message") \
+  CMD_OPTION(aci,         a, Bool,   0, "also measure a crew of bias workers") \
+  CMD_OPTION(server,      S, String, 0, "ocpiserve address (host:port) to run application\n" \
+	     "workers on, rather than in this process") \
+  CMD_OPTION(share,       z, Bool,   0, "share each message among the crew rather than\n" \
+	     "copying it to each member (the shareBroadcast connection parameter)") \
+  CMD_OPTION_S(scenario,  n, String, 0, "named scenario to run instead of the matrix:\n" \
+	       "pio, socket, datagram-loopback, fanout or local-ocpiserve") \
+  CMD_OPTION(ocpiserve,   x, String, "ocpiserve", "program run for local-ocpiserve") \
+  CMD_OPTION(output,      o, String, 0, "file to write results to, default is standard output") \
+  CMD_OPTION(verbose,     v, Bool,   0, "describe progress on standard error") \
+
+#include "BaseOption.hh"
+
+namespace OA = OCPI::API;
+namespace OU = OCPI::Util;
+namespace OB = OCPI::Base;
+namespace XF = OCPI::Xfer;
+
+namespace {
+  typedef std::vector<uint64_t> Samples;
+
+  inline uint64_t
+  now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  struct Case {
+    const char *scenario, *layer;
+    std::string transport;
+    size_t size, nBuffers, fanout;
+    bool broadcast;
+  };
+
+  struct Result {
+    uint64_t messages, bytes, elapsedNs;
+    Samples latency;
+    std::string error;
+    Result() : messages(0), bytes(0), elapsedNs(0) {}
+  };
+
+  uint64_t
+  percentile(const Samples &sorted, double p) {
+    if (sorted.empty())
+      return 0;
+    size_t n = (size_t)(p * (double)sorted.size());
+    return sorted[std::min(n, sorted.size() - 1)];
+  }
+
+  void
+  report(FILE *f, const Case &c, Result &r) {
+    std::sort(r.latency.begin(), r.latency.end());
+    double seconds = (double)r.elapsedNs / 1e9;
+    std::string s;
+    OU::format(s,
+	       "{\"scenario\":\"%s\",\"layer\":\"%s\",\"transport\":\"%s\",\"size\":%zu,"
+	       "\"buffers\":%zu,\"fanout\":%zu,\"broadcast\":%s", c.scenario, c.layer,
+	       c.transport.c_str(), c.size, c.nBuffers, c.fanout, c.broadcast ? "true" : "false");
+    if (r.error.empty())
+      OU::formatAdd(s,
+		    ",\"messages\":%" PRIu64 ",\"seconds\":%.6f,\"msgs_per_sec\":%.1f,"
+		    "\"mbytes_per_sec\":%.3f,\"pings\":%zu,\"lat_min_ns\":%" PRIu64
+		    ",\"lat_p50_ns\":%" PRIu64 ",\"lat_p90_ns\":%" PRIu64 ",\"lat_p99_ns\":%"
+		    PRIu64 ",\"lat_p999_ns\":%" PRIu64 ",\"lat_max_ns\":%" PRIu64 "}",
+		    r.messages, seconds, seconds > 0. ? (double)r.messages / seconds : 0.,
+		    seconds > 0. ? (double)r.bytes / seconds / 1e6 : 0., r.latency.size(),
+		    percentile(r.latency, 0), percentile(r.latency, .5),
+		    percentile(r.latency, .9), percentile(r.latency, .99),
+		    percentile(r.latency, .999), r.latency.empty() ? 0 : r.latency.back());
+    else {
+      // Errors are strings from anywhere: keep the JSON valid
+      std::string e;
+      for (const char *cp = r.error.c_str(); *cp; cp++)
+	if (*cp == '"' || *cp == '\\')
+	  (e += '\\') += *cp;
+	else if ((unsigned char)*cp >= ' ')
+	  e += *cp;
+      OU::formatAdd(s, ",\"error\":\"%s\"}", e.c_str());
+    }
+    fprintf(f, "%s\n", s.c_str());
+    fflush(f);
+  }
+
+  // Driver-level case: one source endpoint posting to "fanout" target endpoints, with
+  // a transfer request for each target buffer that moves the data and then the flag
+  // that indicates its arrival, like the transport layer does.
+  class XferBench {
+    const Case &m_case;
+    uint64_t m_timeoutNs;
+    XF::XferFactory &m_factory;
+    size_t m_flagOffset, m_slotSize, m_nSlots;
+    XF::EndPoint *m_source;
+    OU::ResAddrType m_sourceOffset;
+    uint8_t *m_tx;
+    std::vector<XF::EndPoint *> m_targets;
+    std::vector<OU::ResAddrType> m_targetOffsets;
+    std::vector<volatile uint8_t *> m_rx;
+    std::vector<XF::XferServices *> m_templates;
+    std::vector<XF::XferRequest *> m_requests; // indexed by slot: target * nBuffers + buffer
+    std::vector<uint32_t> m_pending;           // flag value in flight per slot, or 0
+    uint32_t m_sequence;
+  public:
+    XferBench(const Case &c, XF::XferFactory &factory)
+      : m_case(c), m_timeoutNs(options.timeout() * 1000000000ull), m_factory(factory),
+	m_flagOffset(OU::roundUp(c.size, 8)),
+	m_slotSize(OU::roundUp(m_flagOffset + sizeof(uint32_t), XF::BUFFER_ALIGNMENT)),
+	m_nSlots(c.fanout * c.nBuffers), m_source(NULL), m_sourceOffset(0), m_tx(NULL),
+	m_sequence(0) {
+      if (c.size > XF::FlagMeta::maxXferLength)
+	throw OU::Error("message size %zu exceeds the maximum of %" PRIu32, c.size,
+			XF::FlagMeta::maxXferLength);
+      size_t regionSize = m_slotSize * m_nSlots;
+      // Sources have a slot per target buffer so that no source memory is rewritten while
+      // a transfer from it may be in progress
+      m_source = &newEndPoint(regionSize, m_sourceOffset);
+      m_tx = (uint8_t *)m_source->sMemServices().mapTx((XF::Offset)m_sourceOffset, regionSize);
+      m_pending.resize(m_nSlots, 0);
+      for (size_t t = 0; t < c.fanout; t++) {
+	OU::ResAddrType offset;
+	XF::EndPoint &ep = newEndPoint(m_slotSize * c.nBuffers, offset);
+	m_targets.push_back(&ep);
+	m_targetOffsets.push_back(offset);
+	m_rx.push_back((volatile uint8_t *)
+		       ep.sMemServices().mapRx((XF::Offset)offset, m_slotSize * c.nBuffers));
+	memset((void *)m_rx.back(), 0, m_slotSize * c.nBuffers);
+	XF::XferServices &temp = factory.getTemplate(*m_source, ep);
+	m_templates.push_back(&temp);
+	for (size_t b = 0; b < c.nBuffers; b++) {
+	  XF::Offset
+	    src = (XF::Offset)(m_sourceOffset + (t * c.nBuffers + b) * m_slotSize),
+	    dst = (XF::Offset)(offset + b * m_slotSize);
+	  XF::XferRequest *req = temp.createXferRequest();
+	  req->copy(src, dst, c.size, XF::XferRequest::DataTransfer);
+	  req->copy(src + (XF::Offset)m_flagOffset, dst + (XF::Offset)m_flagOffset,
+		    sizeof(uint32_t), XF::XferRequest::FlagTransfer);
+	  m_requests.push_back(req);
+	}
+      }
+    }
+    ~XferBench() {
+      for (size_t n = 0; n < m_requests.size(); n++)
+	delete m_requests[n];
+      for (size_t n = 0; n < m_templates.size(); n++)
+	m_templates[n]->release();
+      for (size_t n = 0; n < m_targets.size(); n++) {
+	m_targets[n]->resourceMgr().free(m_targetOffsets[n], m_slotSize * m_case.nBuffers);
+	m_targets[n]->release();
+      }
+      if (m_source) {
+	m_source->resourceMgr().free(m_sourceOffset, m_slotSize * m_nSlots);
+	m_source->release();
+      }
+    }
+  private:
+    XF::EndPoint &newEndPoint(size_t regionSize, OU::ResAddrType &offset) {
+      size_t size = std::max(m_factory.getSMBSize(), 2 * regionSize + 64 * 1024);
+      XF::EndPoint &ep = m_factory.getEndPoint(m_factory.getProtocol(), true, false, size);
+      ep.finalize();
+      if (ep.resourceMgr().alloc(regionSize, XF::BUFFER_ALIGNMENT, &offset))
+	throw OU::Error("Could not allocate %zu bytes in endpoint %s", regionSize,
+			ep.name().c_str());
+      return ep;
+    }
+    inline volatile uint32_t &rxFlag(size_t t, size_t b) {
+      return *(volatile uint32_t *)(m_rx[t] + b * m_slotSize + m_flagOffset);
+    }
+    void send(size_t t, size_t b) {
+      size_t slot = t * m_case.nBuffers + b;
+      uint8_t *data = m_tx + slot * m_slotSize;
+      // Drivers that carry the flag in-band (e.g. sockets) take the data length from it
+      uint32_t value = XF::FlagMeta::packFlag(m_case.size, (uint8_t)++m_sequence, false);
+      if (m_case.size >= sizeof(m_sequence))
+	memcpy(data, &m_sequence, sizeof(m_sequence));
+      *(uint32_t *)(data + m_flagOffset) = value;
+      m_pending[slot] = value;
+      m_requests[slot]->post();
+    }
+    // Wait for a slot's message to arrive and for its request to be reusable.
+    void receive(size_t t, size_t b) {
+      size_t slot = t * m_case.nBuffers + b;
+      if (!m_pending[slot])
+	return;
+      uint64_t start = now();
+      while (rxFlag(t, b) != m_pending[slot] ||
+	     m_requests[slot]->getStatus() == XF::XferRequest::Pending)
+	if (now() - start > m_timeoutNs)
+	  throw OU::Error("timed out waiting for message to target %zu buffer %zu", t, b);
+      rxFlag(t, b) = 0;
+      m_pending[slot] = 0;
+    }
+  public:
+    void run(Result &r) {
+      const Case &c = m_case;
+      // Latency: one message (or one broadcast) in flight at a time
+      for (unsigned long n = 0; n < options.pings(); n++) {
+	size_t t = c.broadcast ? 0 : n % c.fanout, b = n % c.nBuffers;
+	uint64_t start = now();
+	for (size_t tt = t; tt < (c.broadcast ? c.fanout : t + 1); tt++)
+	  send(tt, b);
+	for (size_t tt = t; tt < (c.broadcast ? c.fanout : t + 1); tt++)
+	  receive(tt, b);
+	r.latency.push_back(now() - start);
+      }
+      // Throughput: keep all buffers of all targets busy
+      uint64_t start = now();
+      for (unsigned long n = 0; n < options.messages(); n++) {
+	size_t t = c.broadcast ? 0 : n % c.fanout;
+	size_t b = (c.broadcast ? n : n / c.fanout) % c.nBuffers;
+	for (size_t tt = t; tt < (c.broadcast ? c.fanout : t + 1); tt++) {
+	  receive(tt, b);
+	  send(tt, b);
+	  r.messages++;
+	  r.bytes += c.size;
+	}
+      }
+      for (size_t t = 0; t < c.fanout; t++)
+	for (size_t b = 0; b < c.nBuffers; b++)
+	  receive(t, b);
+      r.elapsedNs = now() - start;
+    }
+  };
+
+  // Application-level case: one external output port feeding a crew of "fanout" bias
+  // workers, whose output comes back to an external input port.  The crew is fed with the
+  // distribution its input port declares, which for bias is the default, "all", so each
+  // message is broadcast to every member.  Only the first member's output reaches the
+  // single input, so one message comes back for each one sent.
+  class AciBench {
+    const Case &m_case;
+    unsigned long m_timeoutUs;
+    OA::Application *m_app;
+    OA::ExternalPort *m_to, *m_from;
+    size_t m_inFlight;
+    uint32_t m_sequence;
+  public:
+    AciBench(const Case &c, const char *container)
+      : m_case(c), m_timeoutUs(options.timeout() * 1000000ul), m_app(NULL), m_to(NULL),
+	m_from(NULL), m_inFlight(0), m_sequence(0) {
+      std::string xml;
+      OU::format(xml,
+		 "<application package='ocpi.core'>"
+		 "  <instance component='bias' name='b'>"
+		 "    <property name='biasValue' value='0'/>"
+		 "  </instance>"
+		 "  <connection><external name='to'%s/><port instance='b' name='in'/>"
+		 "  </connection>"
+		 "  <connection><external name='from'/><port instance='b' name='out'/>"
+		 "  </connection>"
+		 "</application>", options.share() ? " shareBroadcast='true'" : "");
+      OB::PValueList params;
+      std::string s;
+      const char *err;
+      if ((c.fanout > 1 && (err = params.add("scale", OU::format(s, "b=%zu", c.fanout)))) ||
+	  (container && (err = params.add("container", OU::format(s, "b=%s", container)))) ||
+	  (err = params.add("portBufferCount", OU::format(s, "b=in=%zu", c.nBuffers))) ||
+	  (err = params.add("portBufferCount", OU::format(s, "b=out=%zu", c.nBuffers))) ||
+	  (err = params.add("portBufferSize", OU::format(s, "b=in=%zu", c.size))) ||
+	  (err = params.add("portBufferSize", OU::format(s, "b=out=%zu", c.size))))
+	throw OU::Error("Parameter error: %s", err);
+      m_app = new OA::Application(xml, params);
+      m_app->initialize();
+      m_to = &m_app->getPort("to");
+      m_from = &m_app->getPort("from");
+      m_app->start();
+    }
+    ~AciBench() {
+      if (m_app) {
+	try {
+	  m_app->stop();
+	} catch (...) {}
+	delete m_app;
+      }
+    }
+  private:
+    void send() {
+      uint8_t *data;
+      size_t length;
+      OA::ExternalBuffer *b = m_to->getBuffer(data, length, m_timeoutUs);
+      if (!b)
+	throw OU::Error("timed out waiting for an output buffer for the crew");
+      uint32_t value = ++m_sequence;
+      if (m_case.size >= sizeof(value))
+	memcpy(data, &value, sizeof(value));
+      b->put(m_case.size, 0, false);
+      m_inFlight++;
+    }
+    void receive() {
+      uint8_t *data, opCode;
+      size_t length;
+      bool eof;
+      OA::ExternalBuffer *b = m_from->getBuffer(data, length, opCode, eof, m_timeoutUs);
+      if (!b)
+	throw OU::Error("timed out waiting for a message from the crew");
+      if (length != m_case.size)
+	throw OU::Error("message from the crew has length %zu, expected %zu", length,
+			m_case.size);
+      b->release();
+      m_inFlight--;
+    }
+  public:
+    void run(Result &r) {
+      for (unsigned long n = 0; n < options.pings(); n++) {
+	uint64_t start = now();
+	send();
+	receive();
+	r.latency.push_back(now() - start);
+      }
+      uint64_t start = now();
+      for (unsigned long n = 0; n < options.messages(); n++) {
+	// The pipeline holds a buffer on each side of the workers, and one in them
+	if (m_inFlight >= 2 * m_case.nBuffers + 1)
+	  receive();
+	send();
+	r.messages++;
+	r.bytes += m_case.size;
+      }
+      while (m_inFlight)
+	receive();
+      r.elapsedNs = now() - start;
+    }
+  };
+
+  // An ocpiserve started on the loopback interface for the "local-ocpiserve" scenario.
+  // Its address is taken from the address file it writes once it is listening.
+  class LocalServer {
+    pid_t m_pid;
+    char m_addrFile[32];
+    std::string m_address;
+  public:
+    LocalServer() : m_pid(-1) {
+      strcpy(m_addrFile, "/tmp/transport_bench.XXXXXX");
+      int fd = mkstemp(m_addrFile);
+      if (fd < 0)
+	throw OU::Error("Cannot create a temporary file: %s", strerror(errno));
+      close(fd);
+      if ((m_pid = fork()) < 0) {
+	unlink(m_addrFile);
+	throw OU::Error("Cannot fork to run %s: %s", options.ocpiserve(), strerror(errno));
+      }
+      if (!m_pid) {
+	execlp(options.ocpiserve(), options.ocpiserve(), "-O", "-r", "-a", m_addrFile, NULL);
+	fprintf(stderr, "Cannot execute %s: %s\n", options.ocpiserve(), strerror(errno));
+	_exit(1);
+      }
+      for (uint64_t start = now(); !readAddress(); usleep(10000)) {
+	const char *err = NULL;
+	if (waitpid(m_pid, NULL, WNOHANG) == m_pid) {
+	  m_pid = -1;
+	  err = "exited before it was ready";
+	} else if (now() - start > options.timeout() * 1000000000ull)
+	  err = "timed out starting";
+	if (err) {
+	  stop();
+	  throw OU::Error("%s %s", options.ocpiserve(), err);
+	}
+      }
+    }
+    ~LocalServer() {
+      stop();
+    }
+  private:
+    // The server writes the file once it is listening: wait for a complete first line
+    bool readAddress() {
+      FILE *f = fopen(m_addrFile, "r");
+      char line[256];
+      if (f && fgets(line, sizeof(line), f) && strchr(line, '\n'))
+	m_address.assign(line, strchr(line, '\n'));
+      if (f)
+	fclose(f);
+      return !m_address.empty();
+    }
+    void stop() {
+      if (m_pid > 0) {
+	kill(m_pid, SIGINT);
+	waitpid(m_pid, NULL, 0);
+	m_pid = -1;
+      }
+      unlink(m_addrFile);
+    }
+  public:
+    const char *address() const { return m_address.c_str(); }
+  };
+
+  void
+  sequence(std::vector<size_t> &v, const OA::ULong *values, size_t n,
+	   const size_t *defaults, size_t nDefaults) {
+    for (size_t i = 0; i < n; i++)
+      v.push_back(values[i]);
+    if (v.empty())
+      v.assign(defaults, defaults + nDefaults);
+  }
+
+  struct Matrix {
+    std::vector<size_t> sizes, buffers, fanouts;
+  };
+
+  void
+  runXfer(FILE *out, Case &c, const std::vector<std::string> &transports, const Matrix &m) {
+    XF::XferManager &xm = XF::getManager();
+    c.layer = "xfer";
+    c.broadcast = options.broadcast();
+    for (size_t t = 0; t < transports.size(); t++) {
+      c.transport = transports[t];
+      for (size_t s = 0; s < m.sizes.size(); s++)
+	for (size_t b = 0; b < m.buffers.size(); b++)
+	  for (size_t f = 0; f < m.fanouts.size(); f++) {
+	    c.size = m.sizes[s];
+	    c.nBuffers = m.buffers[b];
+	    c.fanout = m.fanouts[f];
+	    if (options.verbose())
+	      fprintf(stderr, "Measuring %s: size %zu buffers %zu fanout %zu\n",
+		      c.transport.c_str(), c.size, c.nBuffers, c.fanout);
+	    Result r;
+	    try {
+	      XF::XferFactory *factory = xm.find(c.transport);
+	      if (!factory)
+		throw OU::Error("transfer driver not loaded");
+	      XferBench bench(c, *factory);
+	      bench.run(r);
+	    } catch (std::string &e) {
+	      r.error = e;
+	    } catch (...) {
+	      r.error = "unexpected exception";
+	    }
+	    report(out, c, r);
+	  }
+    }
+  }
+
+  // Run the crew in the first container offered by a server, or in this process
+  void
+  runAci(FILE *out, Case &c, const char *server, const Matrix &m) {
+    c.layer = "aci";
+    c.broadcast = true;
+    std::string container;
+    if (server) {
+      OA::useServer(server, options.verbose());
+      OA::Container *ac;
+      for (unsigned i = 0; (ac = OA::ContainerManager::get(i)); i++)
+	if (!ac->name().compare(0, strlen(server), server)) {
+	  container = ac->name();
+	  break;
+	}
+      if (container.empty())
+	throw OU::Error("No containers found at server \"%s\"", server);
+      c.transport = "ocpi-socket-rdma";
+    } else
+      c.transport = "local";
+    for (size_t s = 0; s < m.sizes.size(); s++)
+      for (size_t b = 0; b < m.buffers.size(); b++)
+	for (size_t f = 0; f < m.fanouts.size(); f++) {
+	  c.size = OU::roundUp(m.sizes[s], 4); // bias uses 32 bit samples
+	  c.nBuffers = m.buffers[b];
+	  c.fanout = m.fanouts[f];
+	  if (options.verbose())
+	    fprintf(stderr, "Measuring crew on %s: size %zu buffers %zu fanout %zu\n",
+		    container.empty() ? "this process" : container.c_str(), c.size, c.nBuffers,
+		    c.fanout);
+	  Result r;
+	  try {
+	    AciBench bench(c, container.empty() ? NULL : container.c_str());
+	    bench.run(r);
+	  } catch (std::string &e) {
+	    r.error = e;
+	  } catch (...) {
+	    r.error = "unexpected exception";
+	  }
+	  report(out, c, r);
+	}
+  }
+
+  // Network drivers use the loopback interface unless told otherwise
+  void
+  useLoopback() {
+    setenv("OCPI_TRANSFER_IP_ADDRESS", "127.0.0.1", 0);
+  }
+}
+
+static int mymain(const char **) {
+  FILE *out = stdout;
+  if (options.output() && !(out = fopen(options.output(), "w")))
+    throw OU::Error("Cannot open output file \"%s\": %s", options.output(), strerror(errno));
+  static const size_t
+    defSizes[] = { 16, 1024, 65536 }, defBuffers[] = { 2, 8 }, defFanouts[] = { 1, 4 };
+  Matrix m;
+  size_t n;
+  const OA::ULong *ul = options.size(n);
+  sequence(m.sizes, ul, n, defSizes, sizeof(defSizes)/sizeof(*defSizes));
+  ul = options.buffers(n);
+  sequence(m.buffers, ul, n, defBuffers, sizeof(defBuffers)/sizeof(*defBuffers));
+  ul = options.fanout(n);
+  sequence(m.fanouts, ul, n, defFanouts, sizeof(defFanouts)/sizeof(*defFanouts));
+  std::vector<std::string> transports;
+  const char **tp = options.transport(n);
+  for (size_t i = 0; i < n; i++)
+    transports.push_back(tp[i]);
+  Case c;
+  const char **scenarios = options.scenario(n);
+  if (!n) {
+    c.scenario = "matrix";
+    if (transports.empty())
+      transports = XF::getManager().getListOfSupportedProtocols();
+    runXfer(out, c, transports, m);
+    if (options.aci())
+      runAci(out, c, options.server(), m);
+  }
+  for (size_t i = 0; i < n; i++) {
+    c.scenario = scenarios[i];
+    std::vector<std::string> driver;
+    if (!strcmp(c.scenario, "pio"))
+      driver.push_back("ocpi-smb-pio");
+    else if (!strcmp(c.scenario, "socket")) {
+      useLoopback();
+      driver.push_back("ocpi-socket-rdma");
+    } else if (!strcmp(c.scenario, "datagram-loopback")) {
+      useLoopback();
+      driver.push_back("ocpi-udp-rdma");
+    } else if (!strcmp(c.scenario, "fanout"))
+      runAci(out, c, NULL, m);
+    else if (!strcmp(c.scenario, "local-ocpiserve")) {
+      useLoopback();
+      LocalServer server;
+      runAci(out, c, server.address(), m);
+    } else
+      throw OU::Error("Unknown scenario \"%s\"", c.scenario);
+    if (!driver.empty())
+      runXfer(out, c, driver, m);
+  }
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
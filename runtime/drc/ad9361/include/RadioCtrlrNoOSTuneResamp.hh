@@ -184,6 +184,11 @@ protected : bool m_configurator_tune_resamp_locked;
 
 protected : bool m_readback_gain_mode_as_standard_value;
 
+/// @brief Threads used to try candidate data streams concurrently
+protected : unsigned m_candidate_threads;
+
+private   : struct DataStreamCandidates;
+
 /*! @brief Managing No-OS internally (this class instanced somewhere that
  *         doesn't need to use No-OS).
  ******************************************************************************/
@@ -203,6 +208,16 @@ private: const std::string &RX2_id() const { return m_configurator.RX2_id(); }
 private: const std::string &TX1_id() const { return m_configurator.TX1_id(); }
 private: const std::string &TX2_id() const { return m_configurator.TX2_id(); }
 
+/*! @brief Set how many threads, in addition to the caller's, may try the
+ *         candidate data streams of a config lock request by data stream
+ *         type concurrently, on clones of the configurator. The data stream
+ *         chosen does not depend on this. The first candidate is always
+ *         tried alone. The default is one fewer than the number of online
+ *         processors, at most 3, so a single processor tries them one at a
+ *         time.
+ ******************************************************************************/
+public    : void set_candidate_threads(unsigned threads);
+
 public    : virtual bool request_config_lock(
                 config_lock_ID_t         config_lock_ID,
                 const ConfigLockRequest& config_lock_request);
@@ -413,13 +428,15 @@ protected : bool configurator_check_and_reinit(const ConfigLockRequest &config_l
  *                                   required/pending.
  *  @param[in]  reql_TRXA            A lock of the SMA_TRXA data stream is
  *                                   required/pending.
- *  @param[in]  configurator_copy    Reference to COPY of m_configurator.
+ *  @param[in]  DAC_Clk_divider_ranges Possible ranges of the configurator's
+ *                                   DAC_Clk_divider config with the pending
+ *                                   locks applied.
  *  @return Boolean indication of whether any initialization procedure failed
  *          (which may occur depending on current config locks)
  ******************************************************************************/
 protected : bool reinit_AD9361_if_required(bool reql_RX2B, bool reql_RX2A,
                 bool reql_TRXB, bool reql_TRXA,
-                const Configurator& configurator_copy);
+                const ConfigValueRanges& DAC_Clk_divider_ranges);
 
 protected : bool any_configurator_configs_locked_which_prevent_ad9361_init()
                 const;
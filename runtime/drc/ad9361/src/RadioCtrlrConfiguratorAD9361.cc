@@ -715,32 +715,32 @@ void ConfiguratorAD9361::impose_constraints_single_pass() {
     *s2 = find_data_stream(m_data_stream_TX1),
     *s3 = find_data_stream(m_data_stream_TX2);
 
-  if (s0) constrain_gain_mode_data_stream_0_equals_0_or_1();
-  if (s1) constrain_gain_mode_data_stream_1_equals_0_or_1();
-  if (s2) constrain_gain_mode_data_stream_2_equals_1();
-  if (s3) constrain_gain_mode_data_stream_3_equals_1();
-  if (s2) constrain_gain_dB_data_stream_2_is_in_range_neg_89p75_to_0();
-  if (s3) constrain_gain_dB_data_stream_3_is_in_range_neg_89p75_to_0();
+  if (s0) impose([&]{ constrain_gain_mode_data_stream_0_equals_0_or_1(); });
+  if (s1) impose([&]{ constrain_gain_mode_data_stream_1_equals_0_or_1(); });
+  if (s2) impose([&]{ constrain_gain_mode_data_stream_2_equals_1(); });
+  if (s3) impose([&]{ constrain_gain_mode_data_stream_3_equals_1(); });
+  if (s2) impose([&]{ constrain_gain_dB_data_stream_2_is_in_range_neg_89p75_to_0(); });
+  if (s3) impose([&]{ constrain_gain_dB_data_stream_3_is_in_range_neg_89p75_to_0(); });
 
   // When we are being used in a TuneResamp context, but the constraints are ad9361-specific
   if (s0 && s0->m_configs.find("tuning_freq_complex_mixer_MHz") != s0->m_configs.end())
-    constrain_tuning_freq_equals_Rx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_RX1); // (all/3)
+    impose([&]{ constrain_tuning_freq_equals_Rx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_RX1); }); // (all/3)
   if (s1 && s1->m_configs.find("tuning_freq_complex_mixer_MHz") != s1->m_configs.end())
-    constrain_tuning_freq_equals_Rx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_RX2); // (all/3)
+    impose([&]{ constrain_tuning_freq_equals_Rx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_RX2); }); // (all/3)
   if (s2 && s2->m_configs.find("tuning_freq_complex_mixer_MHz") != s2->m_configs.end())
-    constrain_tuning_freq_equals_Tx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_TX1); // (all/3)
+    impose([&]{ constrain_tuning_freq_equals_Tx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_TX1); }); // (all/3)
   if (s3 && s3->m_configs.find("tuning_freq_complex_mixer_MHz") != s3->m_configs.end())
-    constrain_tuning_freq_equals_Tx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_TX2); // (all/3)
+    impose([&]{ constrain_tuning_freq_equals_Tx_RFPLL_LO_freq_plus_complex_mixer_NCO_freq(m_data_stream_TX2); }); // (all/3)
 
-  if (s0) constrain_gain_dB_data_stream_0_equals_func_of_Rx_RFPLL_LO_freq();
-  if (s1) constrain_gain_dB_data_stream_1_equals_func_of_Rx_RFPLL_LO_freq();
+  if (s0) impose([&]{ constrain_gain_dB_data_stream_0_equals_func_of_Rx_RFPLL_LO_freq(); });
+  if (s1) impose([&]{ constrain_gain_dB_data_stream_1_equals_func_of_Rx_RFPLL_LO_freq(); });
 
-  constrain_RX_SAMPL_FREQ_MHz_equals_TX_SAMPL_FREQ_MHz_times_DAC_Clk_divider();
+  impose([&]{ constrain_RX_SAMPL_FREQ_MHz_equals_TX_SAMPL_FREQ_MHz_times_DAC_Clk_divider(); });
 
-  if (s0) constrain_samples_are_complex_data_stream_0_equals_1();
-  if (s1) constrain_samples_are_complex_data_stream_1_equals_1();
-  if (s2) constrain_samples_are_complex_data_stream_2_equals_1();
-  if (s3) constrain_samples_are_complex_data_stream_3_equals_1();
+  if (s0) impose([&]{ constrain_samples_are_complex_data_stream_0_equals_1(); });
+  if (s1) impose([&]{ constrain_samples_are_complex_data_stream_1_equals_1(); });
+  if (s2) impose([&]{ constrain_samples_are_complex_data_stream_2_equals_1(); });
+  if (s3) impose([&]{ constrain_samples_are_complex_data_stream_3_equals_1(); });
 
 #if 0
   if (s0) constrain_tuning_freq_MHz_data_stream_0_equals_Rx_RFPLL_LO_freq();
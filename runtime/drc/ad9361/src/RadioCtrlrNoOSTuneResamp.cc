@@ -20,10 +20,10 @@
 
 #include <cstdint>  // int32_t, uint8_t, etc
 #include <cassert>
-#include <memory>   // std::unique_ptr
 #include <sstream>  // std::ostringstream
 #include <cmath>    // round()
-#include <unistd.h> // usleep()
+#include <algorithm> // std::min()
+#include <unistd.h> // usleep(), sysconf()
 #include <cinttypes> // PRIu32
 #include "UtilValidRanges.hh" // Util::Range, Util::ValidRanges
 #include "RadioCtrlrNoOSTuneResamp.hh"
@@ -56,11 +56,23 @@ RadioCtrlrNoOSTuneResamp(unsigned which, const char* descriptor, ConfiguratorAD9
     m_ad9361_init_ret(-1),
     m_ad9361_init_called(false),
     m_configurator_tune_resamp_locked(false),
-    m_readback_gain_mode_as_standard_value(false) {
+    m_readback_gain_mode_as_standard_value(false),
+    m_candidate_threads(0) {
 
+  // a small pool, bounded so that wide hosts don't clone the configurator for
+  // every candidate, and none when the threads could only take turns anyway
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if(cpus > 1) {
+    m_candidate_threads = std::min((unsigned)(cpus - 1), 3u);
+  }
   init_AD9361_InitParam();
 }
 
+void RadioCtrlrNoOSTuneResamp::set_candidate_threads(const unsigned threads) {
+
+  m_candidate_threads = threads;
+}
+
 bool RadioCtrlrNoOSTuneResamp::request_config_lock(
     const config_lock_ID_t   config_lock_ID,
     const ConfigLockRequest& config_lock_request) {
@@ -203,11 +215,9 @@ Meas<config_value_t> RadioCtrlrNoOSTuneResamp::get_tuning_freq_MHz(
   // digital radio controller provides to methods which calculate
   // the thereotical value (direct AD9361 register reads) with high precision
 
-  std::unique_ptr<Configurator> copy(m_configurator.clone());
-  Configurator &configurator_copy = *copy;
   if((data_stream_ID == RX2_id()) or (data_stream_ID == RX1_id())) {
 
-    const ConfigValueRanges& x = configurator_copy.get_ranges_possible(data_stream_ID,"tuning_freq_complex_mixer_MHz");
+    const ConfigValueRanges& x = m_configurator.get_ranges_possible(data_stream_ID,"tuning_freq_complex_mixer_MHz");
 
     /// @todo / FIXME - get locked value instead of assuming smallest min is equivalent to locked value
     config_value_t tuning_freq_complex_mixer_MHz = x.get_smallest_min();
@@ -232,7 +242,7 @@ Meas<config_value_t> RadioCtrlrNoOSTuneResamp::get_tuning_freq_MHz(
   }
   else if((data_stream_ID == TX2_id()) or (data_stream_ID == TX1_id())) {
 
-    const ConfigValueRanges& x = configurator_copy.get_ranges_possible(data_stream_ID,"tuning_freq_complex_mixer_MHz");
+    const ConfigValueRanges& x = m_configurator.get_ranges_possible(data_stream_ID,"tuning_freq_complex_mixer_MHz");
 
     /// @todo / FIXME - get locked value instead of assuming smallest min is equivalent to locked value
     config_value_t tuning_freq_complex_mixer_MHz = x.get_smallest_min();
@@ -390,12 +400,10 @@ Meas<config_value_t> RadioCtrlrNoOSTuneResamp::get_sampling_rate_Msps(
   // digital radio controller provides to methods which calculate
   // the thereotical value (direct AD9361 register reads) with high precision
 
-  std::unique_ptr<Configurator> copy(m_configurator.clone());
-  Configurator &configurator_copy = *copy; // const necessitates this...
   if((data_stream_ID == RX2_id()) or (data_stream_ID == RX1_id())) {
 
     /// @todo / FIXME - the best thing to do is probably throw an exception if CIC_dec_decimation_factor is not locked (how can we read the hardware sampling rate if we don't know the decimation factor?)
-    const ConfigValueRanges& x = configurator_copy.get_ranges_possible(data_stream_ID,"CIC_dec_decimation_factor");
+    const ConfigValueRanges& x = m_configurator.get_ranges_possible(data_stream_ID,"CIC_dec_decimation_factor");
     config_value_t CIC_dec_decimation_factor = x.get_smallest_min();
 
     // get_AD9361_RX_SAMPL_FREQ_Hz() is a (highly precise) theoretical
@@ -430,7 +438,7 @@ Meas<config_value_t> RadioCtrlrNoOSTuneResamp::get_sampling_rate_Msps(
   else if((data_stream_ID == TX2_id()) or (data_stream_ID == TX1_id())) {
 
     /// @todo / FIXME - the best thing to do is probably throw an exception if CIC_int_interpolation_factor is not locked (how can we read the hardware sampling rate if we don't know the interpolation factor?)
-    const ConfigValueRanges& x = configurator_copy.get_ranges_possible(data_stream_ID,"CIC_int_interpolation_factor");
+    const ConfigValueRanges& x = m_configurator.get_ranges_possible(data_stream_ID,"CIC_int_interpolation_factor");
     config_value_t CIC_int_interpolation_factor = x.get_smallest_min();
 
     // get_AD9361_RX_SAMPL_FREQ_Hz() is a (highly precise) theoretical
@@ -1630,6 +1638,133 @@ void RadioCtrlrNoOSTuneResamp::update_AD9361_InitParam(const Ad9361InitConfig &c
   init.tx_data_delay       = config.TX_Data_Delay;
 }
 
+/*! @brief The data streams which could satisfy a data stream config lock
+ *         request, as candidates for Configurator::lock_first_candidate().
+ *         Anything read from the device is read beforehand, since the
+ *         candidates may be tried concurrently.
+ ******************************************************************************/
+struct RadioCtrlrNoOSTuneResamp::DataStreamCandidates : public Configurator::Candidates {
+  const RadioCtrlrNoOSTuneResamp&      m_ctrlr;
+  const DataStreamConfigLockRequest&   m_req;
+  const std::vector<data_stream_ID_t>& m_ds_IDs;
+  std::vector<config_value_t>          m_cic_factors; // by candidate
+  DataStreamCandidates(RadioCtrlrNoOSTuneResamp& ctrlr,
+                       const DataStreamConfigLockRequest& req,
+                       const std::vector<data_stream_ID_t>& ds_IDs)
+    : m_ctrlr(ctrlr), m_req(req), m_ds_IDs(ds_IDs), m_cic_factors(ds_IDs.size(), 0.) {
+    for(size_t n = 0; n < ds_IDs.size(); n++) {
+      if((ds_IDs[n] == ctrlr.TX2_id()) or (ds_IDs[n] == ctrlr.TX1_id())) {
+        m_cic_factors[n] = ctrlr.m_callBack.getInterpolation(ctrlr.get_cic_int(req));
+      }
+      else if((ds_IDs[n] == ctrlr.RX2_id()) or (ds_IDs[n] == ctrlr.RX1_id())) {
+        m_cic_factors[n] = ctrlr.m_callBack.getDecimation(ctrlr.get_cic_dec(req));
+      }
+    }
+  }
+  size_t size() const {
+    return m_ds_IDs.size();
+  }
+  bool try_lock(Configurator& configurator, size_t n) const {
+    const data_stream_ID_t& ds_ID = m_ds_IDs[n];
+    bool found_lock = false;
+    config_key_t key;
+    config_value_t val, tol;
+    bool v;
+
+    key = "tuning_freq_complex_mixer_MHz";
+    val = 0;
+    tol = 0;
+    found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"MHz");
+      return false;
+    }
+
+    if((ds_ID == m_ctrlr.TX2_id()) or (ds_ID == m_ctrlr.TX1_id())) {
+      key = "CIC_int_interpolation_factor";
+    }
+    else if((ds_ID == m_ctrlr.RX2_id()) or (ds_ID == m_ctrlr.RX1_id())) {
+      key = "CIC_dec_decimation_factor";
+    }
+    val = m_cic_factors[n];
+    tol = 0;
+    found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"");
+      return false;
+    }
+
+    key = config_key_tuning_freq_MHz;
+    val = m_req.get_tuning_freq_MHz();
+    tol = m_req.get_tolerance_tuning_freq_MHz();
+    found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"MHz");
+      return false;
+    }
+
+    key = config_key_bandwidth_3dB_MHz;
+    val = m_req.get_bandwidth_3dB_MHz();
+    tol = m_req.get_tolerance_bandwidth_3dB_MHz();
+    found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"MHz");
+      return false;
+    }
+
+    key = config_key_sampling_rate_Msps;
+    val = m_req.get_sampling_rate_Msps();
+    tol = m_req.get_tolerance_sampling_rate_Msps();
+    found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"Msps");
+      return false;
+    }
+
+    key = config_key_samples_are_complex;
+    v = m_req.get_samples_are_complex();
+    found_lock |= configurator.lock_config(ds_ID, key, v);
+    if(not found_lock) {
+      m_ctrlr.log_info_config_lock(false, ds_ID,val,key,&v);
+      return false;
+    }
+
+    if(m_req.get_including_gain_mode()) {
+      key = config_key_gain_mode;
+
+      config_value_t _auto = 0;
+      config_value_t manual= 1;
+      if((m_req.get_gain_mode().compare("manual") == 0) or
+         (m_req.get_gain_mode().compare("RF_GAIN_MGC") == 0)) {
+        found_lock |= configurator.lock_config(ds_ID, key, manual);
+      }
+      else if((m_req.get_gain_mode().compare("auto") == 0) or
+              (m_req.get_gain_mode().compare("RF_GAIN_SLOWATTACK_AGC") == 0) or
+              (m_req.get_gain_mode().compare("RF_GAIN_FASTATTACK_AGC") == 0) or
+              (m_req.get_gain_mode().compare("RF_GAIN_HYBRID_AGC") == 0)) {
+        found_lock |= configurator.lock_config(ds_ID, key, _auto);
+      }
+
+      if(not found_lock) {
+        m_ctrlr.log_info_config_lock(false, ds_ID,m_req.get_gain_mode(),key);
+        return false;
+      }
+    }
+
+    if(m_req.get_including_gain_dB()) {
+      key = config_key_gain_dB;
+      val = m_req.get_gain_dB();
+      tol = m_req.get_tolerance_gain_dB();
+      found_lock |= configurator.lock_config(ds_ID, key, val, tol);
+      if(not found_lock) {
+        m_ctrlr.log_info_config_lock_tol(false, false, ds_ID,val,tol,key,"dB");
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
 bool RadioCtrlrNoOSTuneResamp::
 configurator_check_and_reinit(const ConfigLockRequest& config_lock_request) {
 
@@ -1663,9 +1798,9 @@ configurator_check_and_reinit(const ConfigLockRequest& config_lock_request) {
   bool reql_TX2 = false; // config_lock_request requires locking SMA TRXB
   bool reql_TX1 = false; // config_lock_request requires locking SMA TRXA
 
-  // Create a copy of the most-derived object.
-  std::unique_ptr<Configurator> clone(m_configurator.clone());
-  Configurator &configurator_copy = *clone;
+  // The request is tried on m_configurator itself, and everything locked
+  // here is rolled back once we know whether it is acceptable
+  Configurator::Trial trial(m_configurator);
   for(; it != config_lock_request.m_data_streams.end(); it++) {
 
     throw_if_data_stream_lock_request_malformed(*it);
@@ -1680,10 +1815,10 @@ configurator_check_and_reinit(const ConfigLockRequest& config_lock_request) {
       data_streams.push_back(it->get_data_stream_ID());
     }
     else { // assuming request by type only
-      configurator_copy.find_data_streams_of_type(it->get_data_stream_type(), data_streams);
+      m_configurator.find_data_streams_of_type(it->get_data_stream_type(), data_streams);
 
       if(data_streams.empty()) {
-        // configurator_copy did not have any data streams of the requested data
+        // the configurator did not have any data streams of the requested data
         // stream type
         return false;
       }
@@ -1693,159 +1828,35 @@ configurator_check_and_reinit(const ConfigLockRequest& config_lock_request) {
     data_stream_type_t dst_tx = data_stream_type_t::TX;
     data_stream_type_t it_dst = dst_rx; 
   */ 
-    bool found_lock = false;
-    // IDs of data streams what have the potential to meet the
-    // requirements of the current data stream config lock request
-    auto potential_ds_IDs = data_streams.begin();
-
-    for(; potential_ds_IDs != data_streams.end(); potential_ds_IDs++) {
-
-      config_key_t key;
-      config_value_t val, tol;
-      bool v;
-
-/* TODO REMOVE
-      bool is_tx; 
-      this->log_debug("----TEST");    
-      is_tx = (bool) it->get_data_stream_type();
-      
-      this->log_debug("Type: %d, %d ", is_tx, it->get_including_routing_ID());
-  */    
-
-      key = "tuning_freq_complex_mixer_MHz";
-      val = 0;
-      tol = 0;
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-      if(not found_lock) {
-        this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"MHz");
-        goto unrollandcontinue;
-      }
-
-      unsigned which;
-      if((*potential_ds_IDs == TX2_id()) or (*potential_ds_IDs == TX1_id())) {
-        key = "CIC_int_interpolation_factor";
-	which = get_cic_int(*it);
-	val = m_callBack.getInterpolation(which);
-      }
-      else if((*potential_ds_IDs == RX2_id()) or (*potential_ds_IDs == RX1_id())) {
-        key = "CIC_dec_decimation_factor";
-	which = get_cic_dec(*it);
-	val = m_callBack.getDecimation(which);
-      }
-      tol = 0;
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-      if(not found_lock) {
-        this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"");
-        goto unrollandcontinue;
-      }
-
-      key = config_key_tuning_freq_MHz;
-      val = it->get_tuning_freq_MHz();
-      tol = it->get_tolerance_tuning_freq_MHz();
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-      if(not found_lock) {
-        this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"MHz");
-        goto unrollandcontinue;
-      }
-
-      key = config_key_bandwidth_3dB_MHz;
-      val = it->get_bandwidth_3dB_MHz();
-      tol = it->get_tolerance_bandwidth_3dB_MHz();
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-      if(not found_lock) {
-        this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"MHz");
-        goto unrollandcontinue;
-      }
-
-      key = config_key_sampling_rate_Msps;
-      val = it->get_sampling_rate_Msps();
-      tol = it->get_tolerance_sampling_rate_Msps();
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-      if(not found_lock) {
-        this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"Msps");
-        goto unrollandcontinue;
-      }
-
-      key = config_key_samples_are_complex;
-      v = it->get_samples_are_complex();
-      found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, v);
-      if(not found_lock) {
-        this->log_info_config_lock(false, *potential_ds_IDs,val,key,&v);
-        goto unrollandcontinue;
-      }
-
-      if(it->get_including_gain_mode()) {
-        key = config_key_gain_mode;
-
-        config_value_t _auto = 0;
-        config_value_t manual= 1;
-        if((it->get_gain_mode().compare("manual") == 0) or
-           (it->get_gain_mode().compare("RF_GAIN_MGC") == 0)) {
-          found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, manual);
-        }
-        else if((it->get_gain_mode().compare("auto") == 0) or
-                (it->get_gain_mode().compare("RF_GAIN_SLOWATTACK_AGC") == 0) or
-                (it->get_gain_mode().compare("RF_GAIN_FASTATTACK_AGC") == 0) or
-                (it->get_gain_mode().compare("RF_GAIN_HYBRID_AGC") == 0)) {
-          found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, _auto);
-        }
-
-        if(not found_lock) {
-          this->log_info_config_lock(false, *potential_ds_IDs,it->get_gain_mode(),key);
-          goto unrollandcontinue;
-        }
-      }
-
-      if(it->get_including_gain_dB()) {
-        key = config_key_gain_dB;
-        val = it->get_gain_dB();
-        tol = it->get_tolerance_gain_dB();
-        found_lock |= configurator_copy.lock_config(*potential_ds_IDs, key, val, tol);
-        if(not found_lock) {
-          this->log_info_config_lock_tol(false, false, *potential_ds_IDs,val,tol,key,"dB");
-          goto unrollandcontinue;
-        }
-      }
-
-      if(*potential_ds_IDs == RX2_id()) {
-        reql_RX2 = true;
-      }
-      else if(*potential_ds_IDs == RX1_id()) {
-        reql_RX1 = true;
-      }
-      else if(*potential_ds_IDs == TX2_id()) {
-        reql_TX2 = true;
-      }
-      else if(*potential_ds_IDs == TX1_id()) {
-        reql_TX1 = true;
-      }
-
-      break;
-      unrollandcontinue:
-      configurator_copy.unlock_config(*potential_ds_IDs, "tuning_freq_complex_mixer_MHz");
-      if((*potential_ds_IDs == TX2_id()) or (*potential_ds_IDs == TX1_id())) {
-        configurator_copy.unlock_config(*potential_ds_IDs, "CIC_int_interpolation_factor");
-      }
-      else if((*potential_ds_IDs == RX2_id()) or (*potential_ds_IDs == RX1_id())) {
-        configurator_copy.unlock_config(*potential_ds_IDs, "CIC_dec_decimation_factor");
-      }
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_tuning_freq_MHz);
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_bandwidth_3dB_MHz);
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_sampling_rate_Msps);
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_samples_are_complex);
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_gain_mode);
-      configurator_copy.unlock_config(*potential_ds_IDs, config_key_gain_dB);
-    }
-
-    if(not found_lock) {
+    // the first of the data streams which can be locked as requested is used
+    DataStreamCandidates candidates(*this, *it, data_streams);
+    size_t n = m_configurator.lock_first_candidate(candidates, m_candidate_threads);
+    if(n == data_streams.size()) {
       this->log_debug("configurator will not allow lock request\n");
       return false;
     }
+    if(data_streams[n] == RX2_id()) {
+      reql_RX2 = true;
+    }
+    else if(data_streams[n] == RX1_id()) {
+      reql_RX1 = true;
+    }
+    else if(data_streams[n] == TX2_id()) {
+      reql_TX2 = true;
+    }
+    else if(data_streams[n] == TX1_id()) {
+      reql_TX1 = true;
+    }
   }
 
+  // this is all that is needed from the pending locks, which are undone
+  // before any reinitialization
+  ConfigValueRanges DAC_Clk_divider = m_configurator.get_ranges_possible("DAC_Clk_divider");
+  trial.rollback();
+
   bool s; // Boolean indication of whether any initialization procedure failed
           //(which may occur depending on current config locks)
-  s = reinit_AD9361_if_required(reql_RX2,reql_RX1,reql_TX2,reql_TX1,configurator_copy);
+  s = reinit_AD9361_if_required(reql_RX2,reql_RX1,reql_TX2,reql_TX1,DAC_Clk_divider);
   if(s) {
     this->log_debug("configurator will allow lock request\n");
   }
@@ -1855,7 +1866,7 @@ configurator_check_and_reinit(const ConfigLockRequest& config_lock_request) {
 bool RadioCtrlrNoOSTuneResamp::reinit_AD9361_if_required(
   const bool reql_RX2, const bool reql_RX1,
   const bool reql_TX2, const bool reql_TX1,
-  const Configurator& configurator_copy) {
+  const ConfigValueRanges& DAC_Clk_divider_ranges) {
   this->log_debug("reql_RX2=%s,reql_RX1=%s,reql_TX2=%s,reql_TX1=%s",
  (reql_RX2 ? "t" : "f"),
  (reql_RX1 ? "t" : "f"),
@@ -1911,9 +1922,7 @@ bool RadioCtrlrNoOSTuneResamp::reinit_AD9361_if_required(
       }
     }
 
-    std::unique_ptr<Configurator> copy(configurator_copy.clone());
-    Configurator &copycopy = *copy;
-    const ConfigValueRanges& x = copycopy.get_ranges_possible("DAC_Clk_divider");
+    const ConfigValueRanges& x = DAC_Clk_divider_ranges;
     fdd_rx_rate_2tx_enable = (x.get_smallest_min() < 1.5) ? 0 : 1;
 
     if(m_ad9361_init_called) {
@@ -1957,25 +1966,21 @@ bool RadioCtrlrNoOSTuneResamp::any_configurator_configs_locked_which_prevent_ad9
   if (!TX2_id().empty())
     data_streams.push_back(std::string(TX2_id()));
 
-  // unfortunately necessary to make this function const
-  std::unique_ptr<Configurator> copy(m_configurator.clone());
-  Configurator &configurator_copy = *copy;
-
   auto it = data_streams.begin();
   for(; it != data_streams.end(); it++) {
-    if(configurator_copy.get_config_is_locked(*it, config_key_tuning_freq_MHz)) {
+    if(m_configurator.get_config_is_locked(*it, config_key_tuning_freq_MHz)) {
       return true;
     }
-    if(configurator_copy.get_config_is_locked(*it, config_key_bandwidth_3dB_MHz)) {
+    if(m_configurator.get_config_is_locked(*it, config_key_bandwidth_3dB_MHz)) {
       return true;
     }
-    if(configurator_copy.get_config_is_locked(*it, config_key_sampling_rate_Msps)) {
+    if(m_configurator.get_config_is_locked(*it, config_key_sampling_rate_Msps)) {
       return true;
     }
-    if(configurator_copy.get_config_is_locked(*it, config_key_gain_mode)) {
+    if(m_configurator.get_config_is_locked(*it, config_key_gain_mode)) {
       return true;
     }
-    if(configurator_copy.get_config_is_locked(*it, config_key_gain_dB)) {
+    if(m_configurator.get_config_is_locked(*it, config_key_gain_dB)) {
       return true;
     }
   }
@@ -2000,9 +2005,7 @@ RadioCtrlrNoOSTuneResamp::get_ranges_possible_gain_mode(
 
   std::vector<gain_mode_value_t> ret;
   auto key = config_key_gain_mode;
-  std::unique_ptr<Configurator> copy(m_configurator.clone());
-  Configurator &configurator_copy = *copy;
-  auto vr = configurator_copy.get_ranges_possible(data_stream_ID, key);
+  auto vr = m_configurator.get_ranges_possible(data_stream_ID, key);
 
   if(vr.is_valid(0)) {
     // auto is generic value (which corresponds to AD9361-specific
@@ -0,0 +1,288 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * DRC configurator benchmark: the cost of the lock/unlock sequences that config lock
+ * requests cause on an AD9361 configurator with soft tuning and resampling, as used by
+ * the fmcomms and zcu104 DRC workers.  No radio is needed.  It compares incremental
+ * constraint propagation with imposing all constraints in every pass, checking that
+ * they reach the same configs, compares trying requests on a clone of the
+ * configurator with trying them under a checkpoint, and compares finding the first
+ * acceptable one of several candidates for a request one at a time and concurrently.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "OsClock.hh"
+#include "RadioCtrlrConfiguratorTuneResamp.hh"
+#include "RadioCtrlrConfiguratorAD9361.hh"
+
+#define OCPI_OPTIONS_HELP \
+  "Usage syntax is: drcConfigBench [options]\n" \
+  "Measures configurator performance for a sequence of pseudo-random config lock requests.\n"
+#define OCPI_OPTIONS \
+  CMD_OPTION(requests, r, ULong, "200", "config lock requests to try") \
+  CMD_OPTION(seed,     s, ULong, "1", "seed for the requests") \
+  CMD_OPTION(verify,   v, Bool, "true", "check that both propagation methods agree after each request") \
+  CMD_OPTION(threads,  t, ULong, "3", "threads trying candidates concurrently") \
+
+#include "BaseOption.hh"
+
+namespace OD = OCPI::DRC;
+namespace OC = OCPI::OS::Clock;
+
+// Like the configurators of the DRC workers using the ad9361 helper classes
+class BenchConfigurator : public OD::ConfiguratorAD9361, public OD::ConfiguratorTuneResamp {
+public:
+  BenchConfigurator()
+    : OD::ConfiguratorAD9361("rx1", "rx2", "tx1", "tx2"),
+      OD::ConfiguratorTuneResamp(ad9361MaxRxSampleMhz(), ad9361MaxTxSampleMhz()) {
+    static const char *streams[] = { "rx1", "rx2", "tx1", "tx2" };
+    for (unsigned n = 0; n < 4; n++)
+      find_data_stream(streams[n])->setEnable(true);
+  }
+  OD::Configurator *clone() const { return new BenchConfigurator(*this); }
+protected:
+  void impose_constraints_single_pass() {
+    ConfiguratorAD9361::impose_constraints_single_pass();
+    ConfiguratorTuneResamp::impose_constraints_single_pass();
+    Configurator::impose_constraints_single_pass();
+  }
+};
+
+// A config lock request for one data stream, as RadioCtrlrNoOSTuneResamp locks them
+struct Request {
+  const char *stream;
+  bool rx;
+  double tuning, bandwidth, rate, gain;
+  unsigned rateIndex; // of rate in s_rates
+};
+
+static const char *s_streams[] = { "rx1", "rx2", "tx1", "tx2" };
+static const double s_rates[] = { 2.5, 5, 10, 20, 30.72 };
+static const char *s_streamKeys[] = {
+  "tuning_freq_complex_mixer_MHz", "CIC_dec_decimation_factor", "CIC_int_interpolation_factor",
+  OD::config_key_tuning_freq_MHz.c_str(), OD::config_key_bandwidth_3dB_MHz.c_str(),
+  OD::config_key_sampling_rate_Msps.c_str(), OD::config_key_samples_are_complex.c_str(),
+  OD::config_key_gain_mode.c_str(), OD::config_key_gain_dB.c_str()
+};
+static const char *s_keys[] = {
+  "DAC_Clk_divider", "RX_SAMPL_FREQ_MHz", "TX_SAMPL_FREQ_MHz", "rx_rf_bandwidth",
+  "tx_rf_bandwidth", "Rx_RFPLL_LO_freq", "Tx_RFPLL_LO_freq"
+};
+
+static double
+uniform(double min, double max) {
+  return min + (max - min) * (rand() / (RAND_MAX + 1.));
+}
+
+// Requests are drawn from a few channel plans so that some of them are compatible
+static Request
+makeRequest() {
+  static const double tunings[] = { 433.92, 915, 2400, 2450, 5800 };
+  Request r;
+  unsigned s = (unsigned)rand() % 4;
+  r.stream = s_streams[s];
+  r.rx = s < 2;
+  r.tuning = tunings[rand() % 5];
+  r.rateIndex = (unsigned)rand() % 5;
+  r.rate = s_rates[r.rateIndex];
+  r.bandwidth = r.rate * uniform(0.5, 0.8);
+  r.gain = r.rx ? uniform(10, 60) : uniform(-80, 0);
+  return r;
+}
+
+// Lock the configs for a request, returning whether they all locked
+static bool
+lock(OD::Configurator &c, const Request &r) {
+  return
+    c.lock_config(r.stream, "tuning_freq_complex_mixer_MHz", 0, 0) &&
+    c.lock_config(r.stream, r.rx ? "CIC_dec_decimation_factor" : "CIC_int_interpolation_factor",
+		  1, 0) &&
+    c.lock_config(r.stream, OD::config_key_tuning_freq_MHz, r.tuning, 1) &&
+    c.lock_config(r.stream, OD::config_key_bandwidth_3dB_MHz, r.bandwidth, r.bandwidth / 10) &&
+    c.lock_config(r.stream, OD::config_key_sampling_rate_Msps, r.rate, r.rate / 100) &&
+    c.lock_config(r.stream, OD::config_key_samples_are_complex, 1) &&
+    c.lock_config(r.stream, OD::config_key_gain_mode, 1) &&
+    c.lock_config(r.stream, OD::config_key_gain_dB, r.gain, 1);
+}
+
+// Unlock the configs of a request, as when its stream is released
+static void
+unlock(OD::Configurator &c, const Request &r) {
+  for (unsigned n = 0; n < sizeof(s_streamKeys)/sizeof(*s_streamKeys); n++)
+    if (n == 0 || n > 2 || (n == 1) == r.rx)
+      c.unlock_config(r.stream, s_streamKeys[n]);
+}
+
+// A request is accepted, and stays locked, until one is rejected or uses a stream
+// that is in use, when all the streams are released, as when applications come and go.
+static bool
+request(OD::Configurator &c, std::vector<Request> &locked, const Request &r) {
+  for (auto it = locked.begin(); it != locked.end(); ++it)
+    if (it->stream == r.stream) {
+      unlock(c, *it);
+      locked.erase(it);
+      break;
+    }
+  if (lock(c, r)) {
+    locked.push_back(r);
+    return true;
+  }
+  c.unlock_all();
+  locked.clear();
+  return false;
+}
+
+// A request by type, as the candidates RadioCtrlrNoOSTuneResamp tries for it: either
+// stream of the requested direction, each at any of the rates, starting with the
+// requested one.
+struct RequestCandidates : public OD::Configurator::Candidates {
+  Request m_request;
+  RequestCandidates(const Request &r) : m_request(r) {}
+  size_t size() const { return 10; }
+  bool try_lock(OD::Configurator &c, size_t n) const {
+    Request r = m_request;
+    r.stream = s_streams[(r.rx ? 0 : 2) + n / 5];
+    double rate = s_rates[(r.rateIndex + n) % 5];
+    r.bandwidth *= rate / r.rate;
+    r.rate = rate;
+    return lock(c, r);
+  }
+};
+
+static bool
+same(OD::Configurator &a, OD::Configurator &b) {
+  for (unsigned n = 0; n < sizeof(s_keys)/sizeof(*s_keys); n++)
+    if (!(a.get_ranges_possible(s_keys[n]) == b.get_ranges_possible(s_keys[n])) ||
+	a.get_config_is_locked(s_keys[n]) != b.get_config_is_locked(s_keys[n]))
+      return false;
+  for (unsigned s = 0; s < 4; s++)
+    for (unsigned n = 0; n < sizeof(s_streamKeys)/sizeof(*s_streamKeys); n++)
+      if ((n != 1 && n != 2) || (n == 1) == (s < 2)) {
+	const char *ds = s_streams[s], *key = s_streamKeys[n];
+	if (!(a.get_ranges_possible(ds, key) == b.get_ranges_possible(ds, key)) ||
+	    a.get_config_is_locked(ds, key) != b.get_config_is_locked(ds, key))
+	  return false;
+      }
+  return true;
+}
+
+static void
+report(const char *name, uint64_t ns, unsigned long n) {
+  printf("%-36s %10.1f us/request\n", name, n ? (double)ns / 1e3 / (double)n : 0.);
+}
+
+static int mymain(const char **) {
+  unsigned long nRequests = options.requests();
+  std::vector<Request> requests;
+  srand((unsigned)options.seed());
+  for (unsigned long n = 0; n < nRequests; n++)
+    requests.push_back(makeRequest());
+
+  BenchConfigurator incremental, full;
+  full.set_incremental_constraint_propagation(false);
+  uint64_t incrementalNs = 0, fullNs = 0;
+  unsigned long accepted = 0, mismatches = 0;
+  std::vector<Request> incrementalLocked, fullLocked;
+  for (unsigned long n = 0; n < nRequests; n++) {
+    const Request &r = requests[n];
+    uint64_t start = OC::now();
+    bool ok = request(incremental, incrementalLocked, r);
+    uint64_t middle = OC::now();
+    bool fullOk = request(full, fullLocked, r);
+    uint64_t end = OC::now();
+    incrementalNs += middle - start;
+    fullNs += end - middle;
+    accepted += ok;
+    if (options.verify() && (ok != fullOk || !same(incremental, full)))
+      mismatches++;
+  }
+  printf("%lu requests, %lu accepted\n", nRequests, accepted);
+  report("lock/unlock, all constraints", fullNs, nRequests);
+  report("lock/unlock, incremental", incrementalNs, nRequests);
+  if (options.verify())
+    printf("configs differed after %lu requests\n", mismatches);
+
+  // Try each request without keeping it, as RadioCtrlrNoOSTuneResamp does to decide
+  // whether to accept it, on a configurator with one stream already locked.
+  BenchConfigurator base;
+  std::vector<Request> baseLocked;
+  request(base, baseLocked, requests[0]);
+  uint64_t cloneNs = 0, checkpointNs = 0;
+  unsigned long cloneOk = 0, checkpointOk = 0;
+  for (unsigned long n = 1; n < nRequests; n++) {
+    const Request &r = requests[n];
+    uint64_t start = OC::now();
+    {
+      std::unique_ptr<OD::Configurator> copy(base.clone());
+      cloneOk += lock(*copy, r);
+    }
+    uint64_t middle = OC::now();
+    {
+      OD::Configurator::Trial trial(base);
+      checkpointOk += lock(base, r);
+    }
+    uint64_t end = OC::now();
+    cloneNs += middle - start;
+    checkpointNs += end - middle;
+  }
+  report("try request on clone", cloneNs, nRequests - 1);
+  report("try request under checkpoint", checkpointNs, nRequests - 1);
+  if (cloneOk != checkpointOk)
+    printf("clone accepted %lu requests, checkpoint accepted %lu\n", cloneOk, checkpointOk);
+
+  // Find the first acceptable candidate for each request, as the accepted requests
+  // come and go, without keeping it.
+  BenchConfigurator serial, parallel;
+  std::vector<Request> serialLocked, parallelLocked;
+  uint64_t serialNs = 0, parallelNs = 0;
+  unsigned long found = 0, differed = 0;
+  unsigned threads = (unsigned)options.threads();
+  for (unsigned long n = 0; n < nRequests; n++) {
+    const Request &r = requests[n];
+    RequestCandidates candidates(r);
+    {
+      OD::Configurator::Trial serialTrial(serial), parallelTrial(parallel);
+      uint64_t start = OC::now();
+      size_t serialFound = serial.lock_first_candidate(candidates, 0);
+      uint64_t middle = OC::now();
+      size_t parallelFound = parallel.lock_first_candidate(candidates, threads);
+      uint64_t end = OC::now();
+      serialNs += middle - start;
+      parallelNs += end - middle;
+      found += serialFound < candidates.size();
+      if (serialFound != parallelFound || (options.verify() && !same(serial, parallel)))
+	differed++;
+    }
+    if (options.verify() && !same(serial, parallel))
+      differed++;
+    request(serial, serialLocked, r);
+    request(parallel, parallelLocked, r);
+  }
+  printf("%lu requests had an acceptable candidate of %zu\n", found, RequestCandidates(requests[0]).size());
+  report("first candidate, one at a time", serialNs, nRequests);
+  report("first candidate, concurrently", parallelNs, nRequests);
+  if (differed)
+    printf("candidates found differed %lu times\n", differed);
+  return mismatches || cloneOk != checkpointOk || differed ? 1 : 0;
+}
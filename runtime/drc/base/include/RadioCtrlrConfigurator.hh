@@ -23,6 +23,8 @@
 
 #include <map>             // std::map
 #include <vector>          // std::vector
+#include <utility>         // std::pair
+#include <cstdint>         // uint64_t
 #include "UtilLockRConstrConfig.hh"
 #include "UtilLogPrefix.hh"
 
@@ -128,6 +130,52 @@ private   : bool m_impose_constraints_first_run_did_occur;
 private   : size_t m_nRxStreams, m_readIdx; // temporary for getNextStream
 private   : std::vector<data_stream_ID_t> m_readStreams; // could be char*
 
+/*! @brief Constraint propagation state. Each constraint applied via impose()
+ *         during impose_constraints_single_pass() is a node of a dependency
+ *         graph whose edges are the configs it accessed via get_config() the
+ *         last time it ran, along with their versions at that time. A
+ *         constraint is skipped when none of those configs have changed since
+ *         and its last run changed nothing, since it would change nothing
+ *         again. Configs which are changed while a checkpoint is open are
+ *         saved in an undo log so that they can be restored by rollback().
+ ******************************************************************************/
+private   : struct Constraint {
+              const void *m_id; // identifies the impose() call site
+              std::vector<std::pair<unsigned, uint64_t> > m_inputs; // node, version
+              bool m_settled; // last run changed nothing
+              Constraint() : m_id(0), m_settled(false) {}
+            };
+private   : struct Propagation {
+              std::vector<Constraint>          m_constraints;
+              std::vector<LockRConstrConfig *> m_nodes;   // by node - 1
+              std::vector<bool>                m_enabled; // data streams, at last pass
+              uint64_t m_tick;        // source of versions and checkpoint serials
+              bool     m_incremental; // otherwise all constraints are imposed each pass
+              bool     m_in_pass;     // in impose_constraints_single_pass()
+              bool     m_tracking;    // in_pass, and tracking accesses
+              bool     m_untracked;   // config accessed outside of impose() in this pass
+              bool     m_changed;     // a constraint changed something in this pass
+              unsigned m_depth;       // of nested impose() calls
+              size_t   m_next;        // next constraint in the current pass
+              size_t   m_current;     // constraint being imposed
+              std::vector<std::pair<unsigned, LockRConstrConfig> > m_accessed; // by m_current
+              uint64_t m_serial;      // of the innermost checkpoint, 0 if none
+              std::vector<std::pair<LockRConstrConfig *, LockRConstrConfig> > m_undo;
+              Propagation();
+              // copies have the same graph but no open checkpoints
+              Propagation(const Propagation &other);
+              Propagation &operator=(const Propagation &other);
+            };
+private   : mutable Propagation m_propagation;
+
+private   : void index_configs();
+private   : void save_config(LockRConstrConfig &config) const;
+private   : void track_config(const LockRConstrConfig &config) const;
+private   : void changing_config(LockRConstrConfig &config);
+private   : bool begin_constraint(const void *id);
+private   : void end_constraint(bool completed);
+private   : void impose_constraints_full();
+
 public    : Configurator();
 
 public    : virtual Configurator *clone() const = 0; // implemented in most-derived classes
@@ -157,6 +205,73 @@ public    : void unlock_config(config_key_t config_key);
 /// @brief Unlock all configs.
 public    : void unlock_all();
 
+/*! @brief Checkpoints allow configs to be locked and unlocked tentatively
+ *         and then restored, which is much cheaper than trying them on a
+ *         clone(). Checkpoints nest, and must be ended in reverse order, by
+ *         either rollback() or release().
+ ******************************************************************************/
+public    : struct checkpoint_t {
+              size_t   m_undo_size;
+              uint64_t m_serial, m_prev_serial;
+            };
+public    : checkpoint_t checkpoint();
+/// @brief Restore all configs to their state when the checkpoint was taken.
+public    : void rollback(const checkpoint_t &cp);
+/// @brief Keep changes made since the checkpoint was taken.
+public    : void release(const checkpoint_t &cp);
+
+/*! @brief A checkpoint which is rolled back when it goes out of scope unless
+ *         released first.
+ ******************************************************************************/
+public    : class Trial {
+              Configurator &m_configurator;
+              checkpoint_t  m_cp;
+              bool          m_open;
+              Trial(const Trial &);
+              Trial &operator=(const Trial &);
+            public:
+              Trial(Configurator &configurator)
+                : m_configurator(configurator), m_cp(configurator.checkpoint()), m_open(true) {}
+              ~Trial() { if (m_open) m_configurator.rollback(m_cp); }
+              void rollback() { if (m_open) { m_open = false; m_configurator.rollback(m_cp); } }
+              void release() { if (m_open) { m_open = false; m_configurator.release(m_cp); } }
+            };
+
+/*! @brief Whether only the constraints affected by changes are imposed
+ *         (the default), rather than all of them until none has any effect.
+ *         The results are the same.
+ ******************************************************************************/
+public    : void set_incremental_constraint_propagation(bool incremental);
+
+/*! @brief Alternative sets of config locks, e.g. for each data stream which
+ *         could satisfy a data stream config lock request, of which the
+ *         first acceptable one is wanted.
+ ******************************************************************************/
+public    : struct Candidates {
+              virtual ~Candidates() {}
+              virtual size_t size() const = 0;
+              /*! @brief Perform the locks of candidate n on configurator,
+               *         returning whether it is acceptable. Different
+               *         candidates are tried concurrently on different
+               *         configurators, so nothing else may be modified.
+               */
+              virtual bool try_lock(Configurator &configurator, size_t n) const = 0;
+            };
+
+/*! @brief  Try each candidate starting from the current configs, and keep the
+ *          locks of the first acceptable one, as if they were tried in order.
+ *          The first candidate is tried alone. If it is not acceptable, the
+ *          rest are tried concurrently by this thread and up to max_threads
+ *          others, each of those on its own clone(), and the locks of a
+ *          winning clone are then taken over as changes which checkpoints can
+ *          roll back. An exception thrown for a candidate before the winner is
+ *          rethrown.
+ *  @return Index of the candidate that was locked, or candidates.size().
+ ******************************************************************************/
+public    : size_t lock_first_candidate(const Candidates &candidates,
+                                        unsigned max_threads);
+private   : void adopt_configs(const Configurator &other);
+
 /*! @param[in] data_stream_key Key specifier for the desired data stream.
  *  @param[in] config_key      Key specifier for config which exists in the
  *                             data stream specified by data_stream_key
@@ -218,6 +333,25 @@ protected : void constrain_rx_rf_bandwidth_less_than_or_equal_to_RX_SAMPL_FREQ_M
 protected : void constrain_tx_rf_bandwidth_less_than_or_equal_to_TX_SAMPL_FREQ_MHz();
 protected : virtual void impose_constraints_single_pass(); // base class has behavior
 
+/*! @brief Child classes' impose_constraints_single_pass() should apply each
+ *         constraint through this, e.g. impose([&]{ constrain_X(...); }), so
+ *         that it is only applied when configs it depends on have changed.
+ *         Constraints must only access configs via get_config().
+ ******************************************************************************/
+protected : template<typename F> void impose(F constraint) {
+              static const char id = 0; // distinct for each call site
+              if(begin_constraint(&id)) {
+                try {
+                  constraint();
+                }
+                catch(...) {
+                  end_constraint(false);
+                  throw;
+                }
+                end_constraint(true);
+              }
+            }
+
 protected : void ensure_impose_constraints_first_run_did_occur();
 
 protected : void throw_if_any_possible_ranges_are_empty(
@@ -241,6 +375,8 @@ protected : const static int max_constraint_dependency_depth = 32768;
  *         Configurator::max_num_contraint_passes
  *         times) until the ripple effects have resolve, i.e. until the
  *         config allowable ranges are no longer changing in value.
+ *         Only constraints affected by changes are imposed in each pass
+ *         unless incremental propagation is disabled.
  ******************************************************************************/
 protected : void impose_constraints();
 
@@ -21,6 +21,7 @@
 #ifndef _OCPI_PROJECTS_UTIL_LOCK_R_CONSTR_CONFIG_HH
 #define _OCPI_PROJECTS_UTIL_LOCK_R_CONSTR_CONFIG_HH
 
+#include <cstdint>            // uint64_t
 #include "UtilValidRanges.hh" // ValidRanges
 
 namespace OCPI {
@@ -90,6 +91,14 @@ public    : void unlock();
 
 public    : bool operator==(const LockRConstrConfig<T>& rhs) const;
 
+/*! @brief Bookkeeping for the constraint propagation of the configurator
+ *         which owns this config. It is not part of the config's value, i.e.
+ *         it is neither compared nor changed by the methods above.
+ ******************************************************************************/
+public    : unsigned m_node;    ///< index+1 in configurator's graph, 0 if none
+public    : uint64_t m_version; ///< configurator tick when last changed
+public    : uint64_t m_saved;   ///< configurator checkpoint which last saved it
+
 }; // class LockRConstrConfig
 
 } // namespace Util
@@ -26,6 +26,7 @@
 #include <limits>                // std::numeric_limits
 #include <iomanip>               // std::setprecision
 #include "UtilValidRanges.hh"    // Util::ValidRanges
+#include "OsThreadManager.hh"   // OCPI::OS::ThreadManager
 #include "RadioCtrlrConfigurator.hh"
 
 namespace OCPI {
@@ -154,6 +155,33 @@ Configurator::Configurator()
   // constructor
 }
 
+Configurator::Propagation::Propagation()
+    : m_tick(0), m_incremental(true), m_in_pass(false), m_tracking(false),
+      m_untracked(false), m_changed(false), m_depth(0), m_next(0), m_current(0),
+      m_serial(0) {
+}
+
+Configurator::Propagation::Propagation(const Propagation &other)
+    : m_tick(0), m_incremental(true), m_in_pass(false), m_tracking(false),
+      m_untracked(false), m_changed(false), m_depth(0), m_next(0), m_current(0),
+      m_serial(0) {
+  *this = other;
+}
+
+Configurator::Propagation&
+Configurator::Propagation::operator=(const Propagation &other) {
+  // the configs of a copy have the same nodes and versions, so the graph
+  // is valid for it, but the node pointers and undo log are not
+  m_constraints = other.m_constraints;
+  m_nodes.clear();
+  m_enabled     = other.m_enabled;
+  m_tick        = other.m_tick;
+  m_incremental = other.m_incremental;
+  m_serial      = 0;
+  m_undo.clear();
+  return *this;
+}
+
 bool Configurator::
 getNextStream(unsigned &ii, bool enabled, bool &isRx, data_stream_ID_t *&id) {
     if (ii == 0) {
@@ -286,6 +314,7 @@ void Configurator::unlock_config(
 
   LockRConstrConfig& config = get_config(data_stream_key, config_key);
 
+  changing_config(config);
   config.unlock();
   log_debug("configurator: unlocked config (for data stream %s): %s", data_stream_key.c_str(), config_key.c_str());
 
@@ -302,6 +331,7 @@ void Configurator::unlock_config(
 
   LockRConstrConfig& config = get_config(config_key);
 
+  changing_config(config);
   config.unlock();
   log_debug("configurator: unlocked config: %s", config_key.c_str());
 
@@ -318,6 +348,7 @@ void Configurator::unlock_all() {
   for(auto it=m_configs.begin(); it!= m_configs.end(); it++) {
     LockRConstrConfig& config = it->second;
 
+    changing_config(config);
     config.unlock();
 
     log_debug("configurator: unlocked config: %s", it->first.c_str());
@@ -329,6 +360,7 @@ void Configurator::unlock_all() {
     for(; itc != itds->second.m_configs.end(); itc++) {
       LockRConstrConfig& config = itc->second;
 
+      changing_config(config);
       config.unlock();
 
       if (log_debug()) {
@@ -575,7 +607,10 @@ bool Configurator::lock_config(
   // constructor
   ensure_impose_constraints_first_run_did_occur();
 
-  bool was_originally_locked = config.is_locked();
+  // everything done here is undone if the lock turns out to be unacceptable
+  checkpoint_t cp = checkpoint();
+  changing_config(config);
+
   bool lock_was_successful = false;
 
   for(unsigned att = 0; att < 1; att++) { /// @todo / FIXME remove this uneccessary loop
@@ -646,56 +681,19 @@ bool Configurator::lock_config(
         log_debug_str(msg);
       }
 
-      if(do_unroll) { // undo lock and rollback possible ranges
+      if(do_unroll) { // undo lock and restore possible ranges
         log_debug("configurator: unrolling lock");
         lock_was_successful = false;
-        //log_all_possible_config_values(false, true);
-        if(not was_originally_locked) {
-          log_debug("configurator: unlocking config");
-          config.unlock();
-          std::ostringstream ostr;
-          ostr << "configurator: config possible ranges are now: ";
-          ostr << config.get_ranges_possible();
-          log_debug_str(ostr.str());
-          std::ostringstream ostr2;
-          ostr2 << "configurator: config constrained ranges are now: ";
-          ostr2 << config.get_ranges_constrained();
-          log_debug_str(ostr2.str());
-        }
-        for(auto it=m_configs.begin(); it!= m_configs.end(); it++) {
-          ConfigValueRanges vrs = it->second.get_ranges_possible();
-          it->second.set_constrained_to_absolute();
-          if(it->second.is_locked()) {
-            // this is hackish and only necessary because
-            // set_constrained_to_absolute() allows us to do bad things
-            it->second.set_ranges_possible(vrs);
-          }
-        }
-        auto itds = m_data_streams.begin();
-        for(; itds!= m_data_streams.end(); itds++) {
-          auto itc = itds->second.m_configs.begin();
-          for(; itc != itds->second.m_configs.end(); itc++) {
-            ConfigValueRanges vrs = itc->second.get_ranges_possible();
-            itc->second.set_constrained_to_absolute();
-            if(itc->second.is_locked()) {
-              // this is hackish and only necessary because
-              // set_constrained_to_absolute() allows us to do bad things
-              itc->second.set_ranges_possible(vrs);
-            }
-          }
-        }
-        {
-          impose_constraints();
-
-          // impose_constraints should call this function many times, but it's
-          // called again here for robustness / just in case
-          throw_if_any_possible_ranges_are_empty();
-        }
-
-        //log_all_possible_config_values(false, true);
+        rollback(cp);
+        std::ostringstream ostr;
+        ostr << "configurator: config possible ranges are now: ";
+        ostr << config.get_ranges_possible();
+        log_debug_str(ostr.str());
+        return false;
       }
       else {
         // configurator successful, ranges in good state (i.e. none are empty)
+        release(cp);
         return true;
       }
     }
@@ -707,18 +705,462 @@ bool Configurator::lock_config(
       }
     }
   }
+  rollback(cp);
   return false;
 }
 
+void Configurator::index_configs() {
+
+  // configs are only ever added, and copies have the same nodes, so the
+  // existing nodes are almost always still right
+  Propagation& p = m_propagation;
+  bool renumber = false;
+  p.m_nodes.clear();
+  for(auto it=m_configs.begin(); it!= m_configs.end(); it++) {
+    p.m_nodes.push_back(&it->second);
+  }
+  auto itds = m_data_streams.begin();
+  for(; itds!= m_data_streams.end(); itds++) {
+    auto itc = itds->second.m_configs.begin();
+    for(; itc != itds->second.m_configs.end(); itc++) {
+      p.m_nodes.push_back(&itc->second);
+    }
+  }
+  for(unsigned n = 0; n < p.m_nodes.size(); n++) {
+    if(p.m_nodes[n]->m_node != n + 1) {
+      p.m_nodes[n]->m_node = n + 1;
+      renumber = true;
+    }
+  }
+  if(renumber) {
+    p.m_constraints.clear();
+  }
+}
+
+void Configurator::save_config(LockRConstrConfig& config) const {
+
+  Propagation& p = m_propagation;
+  if(p.m_serial and (config.m_saved != p.m_serial)) {
+    p.m_undo.push_back(std::make_pair(&config, config));
+    config.m_saved = p.m_serial;
+  }
+}
+
+void Configurator::track_config(const LockRConstrConfig& config) const {
+
+  Propagation& p = m_propagation;
+  if(not p.m_in_pass) {
+    return;
+  }
+  // constraints have non-const access to whatever they access
+  unsigned node = config.m_node;
+  if((node == 0) or (node > p.m_nodes.size()) or (p.m_nodes[node-1] != &config)) {
+    p.m_untracked = true;
+    return;
+  }
+  save_config(*p.m_nodes[node-1]);
+  if(not p.m_tracking) {
+    return;
+  }
+  if(p.m_depth == 0) {
+    p.m_untracked = true;
+    return;
+  }
+  for(auto it = p.m_accessed.begin(); it != p.m_accessed.end(); it++) {
+    if(it->first == node) {
+      return;
+    }
+  }
+  p.m_accessed.push_back(std::make_pair(node, config));
+}
+
+void Configurator::changing_config(LockRConstrConfig& config) {
+
+  save_config(config);
+  config.m_version = ++m_propagation.m_tick;
+}
+
+bool Configurator::begin_constraint(const void* id) {
+
+  Propagation& p = m_propagation;
+  if(not p.m_tracking) {
+    return true;
+  }
+  if(p.m_depth++) {
+    return true; // nested constraints are part of the outer one
+  }
+  p.m_current = p.m_next++;
+  if(p.m_current < p.m_constraints.size()) {
+    Constraint& c = p.m_constraints[p.m_current];
+    if(c.m_settled and (c.m_id == id)) {
+      bool unchanged = true;
+      for(auto it = c.m_inputs.begin(); it != c.m_inputs.end(); it++) {
+        if(p.m_nodes[it->first-1]->m_version != it->second) {
+          unchanged = false;
+          break;
+        }
+      }
+      if(unchanged) {
+        p.m_depth--;
+        return false;
+      }
+    }
+  }
+  else {
+    p.m_constraints.resize(p.m_current + 1);
+  }
+  p.m_constraints[p.m_current].m_id = id;
+  p.m_accessed.clear();
+  return true;
+}
+
+void Configurator::end_constraint(bool completed) {
+
+  Propagation& p = m_propagation;
+  if((not p.m_tracking) or --p.m_depth) {
+    return;
+  }
+  Constraint& c = p.m_constraints[p.m_current];
+  size_t nchanged = 0;
+  c.m_inputs.clear();
+  for(auto it = p.m_accessed.begin(); it != p.m_accessed.end(); it++) {
+    LockRConstrConfig& config = *p.m_nodes[it->first-1];
+    if(not (config == it->second)) {
+      config.m_version = ++p.m_tick;
+      nchanged++;
+    }
+    c.m_inputs.push_back(std::make_pair(it->first, config.m_version));
+  }
+  p.m_accessed.clear();
+  c.m_settled = completed and (nchanged == 0);
+  if(nchanged) {
+    p.m_changed = true;
+    log_debug("configurator: constraint %zu changed %zu configs", p.m_current, nchanged);
+  }
+}
+
+Configurator::checkpoint_t Configurator::checkpoint() {
+
+  // the first run must not be undone
+  ensure_impose_constraints_first_run_did_occur();
+
+  Propagation& p = m_propagation;
+  checkpoint_t cp;
+  cp.m_undo_size   = p.m_undo.size();
+  cp.m_prev_serial = p.m_serial;
+  cp.m_serial      = p.m_serial = ++p.m_tick;
+  return cp;
+}
+
+void Configurator::rollback(const checkpoint_t& cp) {
+
+  Propagation& p = m_propagation;
+  if(cp.m_serial != p.m_serial) {
+    throw std::string("configurator: checkpoints must be ended in the reverse order of creation");
+  }
+  // a config is restored along with its version, which still identifies
+  // its value for the dependency graph
+  while(p.m_undo.size() > cp.m_undo_size) {
+    LockRConstrConfig& config = *p.m_undo.back().first;
+    unsigned node = config.m_node;
+    config = p.m_undo.back().second;
+    config.m_node = node;
+    p.m_undo.pop_back();
+  }
+  p.m_serial = cp.m_prev_serial;
+}
+
+void Configurator::release(const checkpoint_t& cp) {
+
+  Propagation& p = m_propagation;
+  if(cp.m_serial != p.m_serial) {
+    throw std::string("configurator: checkpoints must be ended in the reverse order of creation");
+  }
+  // the changes become part of the enclosing checkpoint, if any
+  p.m_serial = cp.m_prev_serial;
+  if(p.m_serial == 0) {
+    p.m_undo.clear();
+  }
+}
+
+void Configurator::set_incremental_constraint_propagation(bool incremental) {
+
+  m_propagation.m_incremental = incremental;
+  m_propagation.m_constraints.clear();
+}
+
+namespace {
+
+// State shared by the threads of Configurator::lock_first_candidate()
+struct CandidateSearch {
+  const Configurator::Candidates& m_candidates;
+  // each is written by one thread and read after joining
+  struct Result {
+    bool          m_locked;
+    bool          m_threw;
+    std::string   m_error;
+    Configurator* m_configurator; // which now has the candidate's locks
+    Result() : m_locked(false), m_threw(false), m_configurator(NULL) {}
+  };
+  std::vector<Result>        m_results; // by candidate
+  std::vector<Configurator*> m_clones;  // one for each thread
+  size_t                     m_next;    // next candidate to try
+  size_t                     m_found;   // first acceptable or throwing one so far
+  CandidateSearch(const Configurator::Candidates& candidates)
+    : m_candidates(candidates), m_results(candidates.size()), m_next(1),
+      m_found(candidates.size()) {
+  }
+  ~CandidateSearch() {
+    for(auto it = m_clones.begin(); it != m_clones.end(); it++) {
+      delete *it;
+    }
+  }
+  // candidates after one whose outcome is known are not needed
+  void found(size_t n) {
+    size_t prev = __atomic_load_n(&m_found, __ATOMIC_RELAXED);
+    while((n < prev) and
+          not __atomic_compare_exchange_n(&m_found, &prev, n, false,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+  }
+  // try candidates on the configurator, each from the same configs, until
+  // one is acceptable, and keep its locks
+  void run(Configurator& configurator) {
+    for(;;) {
+      size_t n = __atomic_fetch_add(&m_next, 1, __ATOMIC_RELAXED);
+      if((n >= m_results.size()) or (n > __atomic_load_n(&m_found, __ATOMIC_RELAXED))) {
+        return;
+      }
+      Result& r = m_results[n];
+      try {
+        Configurator::Trial trial(configurator);
+        if(m_candidates.try_lock(configurator, n)) {
+          trial.release();
+          r.m_locked = true;
+          r.m_configurator = &configurator;
+          found(n);
+          return;
+        }
+      }
+      catch(std::string& err) {
+        r.m_error = err;
+        r.m_threw = true;
+        found(n);
+      }
+      catch(...) {
+        r.m_error = "configurator: unexpected exception while trying a candidate";
+        r.m_threw = true;
+        found(n);
+      }
+    }
+  }
+  struct Thread {
+    CandidateSearch*        m_search;
+    Configurator*           m_configurator;
+    OCPI::OS::ThreadManager m_thread;
+    Thread(CandidateSearch& search, Configurator& configurator)
+      : m_search(&search), m_configurator(&configurator) {
+      m_thread.start(run, this);
+    }
+    static void run(void* arg) {
+      Thread& t = *static_cast<Thread*>(arg);
+      t.m_search->run(*t.m_configurator);
+    }
+  };
+};
+
+} // namespace
+
+size_t Configurator::lock_first_candidate(const Candidates& candidates,
+                                          unsigned max_threads) {
+
+  size_t size = candidates.size();
+  // the first candidate is usually acceptable, so it is tried here before
+  // anything is cloned
+  if(size == 0) {
+    return 0;
+  }
+  {
+    Trial trial(*this);
+    if(candidates.try_lock(*this, 0)) {
+      trial.release();
+      return 0;
+    }
+  }
+  // this thread tries the rest too, so one less thread is needed than there
+  // are candidates left
+  size_t nthreads = (size > 2) ? size - 2 : 0;
+  if(max_threads < nthreads) {
+    nthreads = max_threads;
+  }
+  if(nthreads == 0) {
+    for(size_t n = 1; n < size; n++) {
+      Trial trial(*this);
+      if(candidates.try_lock(*this, n)) {
+        trial.release();
+        return n;
+      }
+    }
+    return size;
+  }
+
+  // each thread has a clone, taken before this configurator changes, and
+  // converged, so that all candidates start from the same configs
+  ensure_impose_constraints_first_run_did_occur();
+  CandidateSearch search(candidates);
+  for(size_t n = 0; n < nthreads; n++) {
+    search.m_clones.push_back(clone());
+  }
+  std::vector<CandidateSearch::Thread*> threads;
+  Trial trial(*this);
+  try {
+    for(size_t n = 0; n < nthreads; n++) {
+      threads.push_back(new CandidateSearch::Thread(search, *search.m_clones[n]));
+    }
+  }
+  catch(...) {
+    search.found(0);
+    for(auto it = threads.begin(); it != threads.end(); it++) {
+      (*it)->m_thread.join();
+      delete *it;
+    }
+    throw;
+  }
+  search.run(*this);
+  for(auto it = threads.begin(); it != threads.end(); it++) {
+    (*it)->m_thread.join();
+    delete *it;
+  }
+
+  for(size_t n = 1; n < size; n++) {
+    const CandidateSearch::Result& r = search.m_results[n];
+    if(r.m_threw) {
+      trial.rollback();
+      throw r.m_error;
+    }
+    if(r.m_locked) {
+      if(r.m_configurator != this) {
+        trial.rollback();
+        adopt_configs(*r.m_configurator);
+      }
+      else {
+        trial.release();
+      }
+      log_debug("configurator: candidate %zu of %zu is the first acceptable one", n, size);
+      return n;
+    }
+  }
+  return size;
+}
+
+void Configurator::adopt_configs(const Configurator& other) {
+
+  // each differing config is changed as if locked here, so that checkpoints
+  // can restore it and constraints depending on it are reconsidered
+  auto adopt = [this](LockRConstrConfig& config, const LockRConstrConfig& value) {
+    if(not (config == value)) {
+      changing_config(config);
+      unsigned node    = config.m_node;
+      uint64_t version = config.m_version;
+      uint64_t saved   = config.m_saved;
+      config = value;
+      config.m_node    = node;
+      config.m_version = version;
+      config.m_saved   = saved;
+    }
+  };
+  // a clone has the same configs, in the same order
+  auto it = m_configs.begin();
+  auto ito = other.m_configs.begin();
+  for(; it != m_configs.end(); it++, ito++) {
+    adopt(it->second, ito->second);
+  }
+  auto itds = m_data_streams.begin();
+  auto itdso = other.m_data_streams.begin();
+  for(; itds != m_data_streams.end(); itds++, itdso++) {
+    auto itc = itds->second.m_configs.begin();
+    auto itco = itdso->second.m_configs.begin();
+    for(; itc != itds->second.m_configs.end(); itc++, itco++) {
+      adopt(itc->second, itco->second);
+    }
+  }
+}
+
 void Configurator::impose_constraints() {
 
+  Propagation& p = m_propagation;
+  index_configs();
+
+  // which constraints are imposed depends on which data streams are enabled
+  std::vector<bool> enabled;
+  for(auto it = m_data_streams.begin(); it != m_data_streams.end(); it++) {
+    enabled.push_back(it->second.isEnabled());
+  }
+  if(enabled != p.m_enabled) {
+    p.m_enabled = enabled;
+    p.m_constraints.clear();
+  }
+
+  if(not p.m_incremental) {
+    impose_constraints_full();
+    return;
+  }
+  const int max = max_constraint_dependency_depth;
+  for(int iter_num=0; iter_num < max; iter_num++) {
+    p.m_in_pass = p.m_tracking = true;
+    p.m_untracked = p.m_changed = false;
+    p.m_depth = 0;
+    p.m_next = 0;
+    try {
+      impose_constraints_single_pass();
+    }
+    catch(...) {
+      p.m_in_pass = p.m_tracking = false;
+      p.m_accessed.clear();
+      throw;
+    }
+    p.m_in_pass = p.m_tracking = false;
+
+    log_debug("configurator: %s(): constraint dependency iteration: %i", __func__, iter_num);
+
+    if(p.m_untracked) {
+      // what we can't track, we must compare
+      log_info("configurator: a constraint was imposed without impose(), "
+               "so all constraints will be imposed in each pass");
+      p.m_incremental = false;
+      impose_constraints_full();
+      return;
+    }
+    p.m_constraints.resize(p.m_next);
+    if(not p.m_changed) {
+      return;
+    }
+  }
+  // max_constraint_dependency_depth exceeded
+  throw std::string("max constraint dependency depth exceeded");
+}
+
+void Configurator::impose_constraints_full() {
+
+  Propagation& p = m_propagation;
+  // versions are not maintained here, so the graph will need rebuilding
+  p.m_constraints.clear();
+
   bool en = true; // enable first iteration loop
   const int max = max_constraint_dependency_depth;
   for(int iter_num=0; en & (iter_num < max); iter_num++) {
     auto configs_orig = m_configs;
     data_streams_t data_streams_orig = m_data_streams;
 
-    impose_constraints_single_pass();
+    p.m_in_pass = true; // for checkpoints
+    try {
+      impose_constraints_single_pass();
+    }
+    catch(...) {
+      p.m_in_pass = false;
+      throw;
+    }
+    p.m_in_pass = false;
 
     log_debug("configurator: %s(): constraint dependency iteration: %i", __func__, iter_num);
 
@@ -856,7 +1298,9 @@ LockRConstrConfig& Configurator::get_config(
     throw oss.str();
   }
   try {
-    return data_stream->m_configs.at(cfg_key);
+    LockRConstrConfig& r = data_stream->m_configs.at(cfg_key);
+    track_config(r);
+    return r;
   }
   catch(const std::out_of_range& err) {
     std::ostringstream oss;
@@ -929,12 +1373,15 @@ const LockRConstrConfig& Configurator::get_config(
     }
   }
   const LockRConstrConfig& r = it3->second;
+  track_config(r);
   return r;
 }
 
 LockRConstrConfig& Configurator::get_config(const config_key_t cfg_key){
   try {
-    return m_configs.at(cfg_key); // throws std::out_of_range no match
+    LockRConstrConfig& r = m_configs.at(cfg_key); // throws std::out_of_range no match
+    track_config(r);
+    return r;
   }
   catch(const std::out_of_range& err) {
     std::ostringstream oss;
@@ -970,6 +1417,7 @@ const LockRConstrConfig& Configurator::get_config(
 
   auto it = m_configs.find(cfg_key); // strong guarantee
   if(it != m_configs.end()) {
+    track_config(it->second);
     return it->second;
   }
   else {
@@ -1374,8 +1822,8 @@ constrain_tx_rf_bandwidth_less_than_or_equal_to_TX_SAMPL_FREQ_MHz() {
 
 void Configurator::impose_constraints_single_pass() {
   // Nyquist criterion constraints
-  constrain_rx_rf_bandwidth_less_than_or_equal_to_RX_SAMPL_FREQ_MHz();
-  constrain_tx_rf_bandwidth_less_than_or_equal_to_TX_SAMPL_FREQ_MHz();
+  impose([&]{ constrain_rx_rf_bandwidth_less_than_or_equal_to_RX_SAMPL_FREQ_MHz(); });
+  impose([&]{ constrain_tx_rf_bandwidth_less_than_or_equal_to_TX_SAMPL_FREQ_MHz(); });
 }
 } // namespace RadioCtrlr
 
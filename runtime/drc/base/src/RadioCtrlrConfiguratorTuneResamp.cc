@@ -305,13 +305,13 @@ void ConfiguratorTuneResamp::impose_constraints_single_pass() {
   data_stream_ID_t *id;
   for (unsigned ii = 0; getNextStream(ii, true, rx, id); ++ii)
     if (rx) {
-      constrain_DS_bandwidth_equals_FE_bandwidth_divided_by_CIC_dec(*id, "rx_rf_bandwidth");
-      constrain_sampling_rate_equals_FE_samp_rate_divided_by_CIC_dec(*id, "RX_SAMPL_FREQ_MHz");
-      constrain_FE_samp_rate_equals_func_of_DS_complex_mixer_freq(*id, "RX_SAMPL_FREQ_MHz");
+      impose([&]{ constrain_DS_bandwidth_equals_FE_bandwidth_divided_by_CIC_dec(*id, "rx_rf_bandwidth"); });
+      impose([&]{ constrain_sampling_rate_equals_FE_samp_rate_divided_by_CIC_dec(*id, "RX_SAMPL_FREQ_MHz"); });
+      impose([&]{ constrain_FE_samp_rate_equals_func_of_DS_complex_mixer_freq(*id, "RX_SAMPL_FREQ_MHz"); });
     } else {
-      constrain_DS_bandwidth_equals_FE_bandwidth_divided_by_CIC_int(*id, "tx_rf_bandwidth");
-      constrain_sampling_rate_equals_FE_samp_rate_divided_by_CIC_int(*id, "TX_SAMPL_FREQ_MHz");
-      constrain_FE_samp_rate_equals_func_of_DS_complex_mixer_freq(*id, "TX_SAMPL_FREQ_MHz");
+      impose([&]{ constrain_DS_bandwidth_equals_FE_bandwidth_divided_by_CIC_int(*id, "tx_rf_bandwidth"); });
+      impose([&]{ constrain_sampling_rate_equals_FE_samp_rate_divided_by_CIC_int(*id, "TX_SAMPL_FREQ_MHz"); });
+      impose([&]{ constrain_FE_samp_rate_equals_func_of_DS_complex_mixer_freq(*id, "TX_SAMPL_FREQ_MHz"); });
     }
 }
 
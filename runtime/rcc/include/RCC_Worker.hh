@@ -261,6 +261,17 @@ typedef struct {
 } RCCEntryTable;
 
 #ifdef __cplusplus
+// Generated protocol argument accessors check opcodes, sequence lengths and buffer limits
+// at runtime in debug builds.  Optimized worker builds (NDEBUG) use the argument layout
+// constants emitted by ocpigen so that access is inline pointer arithmetic, still checking
+// that sequence resizes fit in the buffer.
+#ifndef OCPI_RCC_CHECK_ARGS
+#ifdef NDEBUG
+#define OCPI_RCC_CHECK_ARGS 0
+#else
+#define OCPI_RCC_CHECK_ARGS 1
+#endif
+#endif
 // This is a preliminary implementation that avoids reorganizing the classes for
 // maximum commonality between C and C++ workers. FIXME
  class RCCUserWorker;
@@ -270,6 +281,9 @@ typedef struct {
    RCCBuffer *m_rccBuffer;
    RCCBuffer  m_taken;
    bool m_opCodeSet, m_lengthSet, m_resized;
+   RCCUserPort   *m_pool;   // the port that owns this taken buffer, NULL for a port itself
+   RCCUserBuffer *m_next,   // next on the port's free list
+                 *m_allNext; // next of all the port's taken buffers
    friend class RCCUserPort;
    friend class RCCPortOperation;
  protected:
@@ -309,13 +323,53 @@ typedef struct {
    void release();
  };
 
+ // A move-only handle for a taken buffer that releases the buffer when the handle is
+ // destroyed, unless it was sent, released or detached first.
+ class RCCTakenBuffer {
+   RCCUserBuffer *m_buffer;
+   RCCTakenBuffer(const RCCTakenBuffer &) = delete;
+   RCCTakenBuffer &operator=(const RCCTakenBuffer &) = delete;
+ public:
+   explicit RCCTakenBuffer(RCCUserBuffer *b = NULL) : m_buffer(b) {}
+   RCCTakenBuffer(RCCTakenBuffer &&other) : m_buffer(other.m_buffer) { other.m_buffer = NULL; }
+   RCCTakenBuffer &operator=(RCCTakenBuffer &&other) {
+     if (this != &other) {
+       reset();
+       m_buffer = other.m_buffer;
+       other.m_buffer = NULL;
+     }
+     return *this;
+   }
+   ~RCCTakenBuffer() { reset(); }
+   explicit operator bool() const { return m_buffer != NULL; }
+   RCCUserBuffer &operator*() const { return *m_buffer; }
+   RCCUserBuffer *operator->() const { return m_buffer; }
+   RCCUserBuffer *get() const { return m_buffer; }
+   // Give up ownership without releasing
+   RCCUserBuffer *detach() {
+     RCCUserBuffer *b = m_buffer;
+     m_buffer = NULL;
+     return b;
+   }
+   // Release the buffer (if any) back to the framework
+   void reset() {
+     if (m_buffer)
+       detach()->release();
+   }
+ };
+
  // Port inherits the buffer class in order to act as current buffer
  class RCCUserPort : public RCCUserBuffer {
    RCCPort &m_rccPort;
+   RCCUserBuffer *m_freeBuffers, *m_allBuffers; // pool of taken buffer objects
    friend class RCCUserWorker;
    friend class RCCPortOperation;
+   friend class RCCUserBuffer;
+   RCCUserBuffer &allocateTaken();
+   void recycle(RCCUserBuffer &buf);
  protected:
    RCCUserPort();
+   ~RCCUserPort();
    // Note length is capacity for output buffers.
    void *getArgAddress(RCCUserBuffer &buf, unsigned op, unsigned arg, size_t *length,
                        size_t *capacity) const;
@@ -342,6 +396,9 @@ typedef struct {
      setDefaultOpCode(RCCOpCode op),
      send(RCCUserBuffer&);
    RCCUserBuffer &take(RCCUserBuffer *oldBuffer = NULL);
+   // RAII versions of take and send
+   inline RCCTakenBuffer takeBuffer() { return RCCTakenBuffer(&take()); }
+   void send(RCCTakenBuffer &buf);
    bool
     request(size_t minlength = 0),
     advance(size_t minlength = 0),
@@ -366,6 +423,60 @@ typedef struct {
    inline void setArgSize(unsigned arg, size_t a_length) const {
      m_port.setArgSize(*m_buffer, m_op, arg, a_length);
    }
+   // Only the first access to a new buffer, or a different opcode, needs the full check
+   inline void checkOpCode(bool setting) const {
+     RCCBuffer &b = *m_buffer->m_rccBuffer;
+     if (b.isNew_ || !m_buffer->m_opCodeSet || b.opCode_ != m_op)
+       m_port.checkOpCode(*m_buffer, m_op, setting);
+   }
+   // Versions of the above where the argument layout is known at compile time
+   inline void *getArgAddress(unsigned arg, size_t offset, size_t align, size_t elementBytes,
+                              bool isSequence, bool isOnly, size_t *a_length,
+                              size_t *capacity) const {
+#if OCPI_RCC_CHECK_ARGS
+     (void)offset; (void)align; (void)elementBytes; (void)isSequence; (void)isOnly;
+     return getArgAddress(arg, a_length, capacity);
+#else
+     (void)arg;
+     checkOpCode(false);
+     RCCBuffer &b = *m_buffer->m_rccBuffer;
+     uint8_t *p = (uint8_t *)b.data + offset;
+     if (isSequence) {
+       size_t l_maxLength = b.maxLength;
+       if (isOnly)
+         *a_length = b.length_ / elementBytes;
+       else {
+         *a_length = *(uint32_t *)p;
+         l_maxLength -= offset + align;
+         p += align;
+       }
+       if (capacity)
+         *capacity = l_maxLength / elementBytes;
+     }
+     return p;
+#endif
+   }
+   inline void setArgSize(unsigned arg, size_t offset, size_t align, size_t elementBytes,
+                          bool isOnly, size_t a_length) const {
+#if OCPI_RCC_CHECK_ARGS
+     (void)offset; (void)align; (void)elementBytes; (void)isOnly;
+     setArgSize(arg, a_length);
+#else
+     checkOpCode(true);
+     size_t limit = m_buffer->m_rccBuffer->maxLength - (isOnly ? 0 : offset + align);
+     // Bounds are always checked: the full version reports the error
+     if (a_length > limit / elementBytes || m_buffer->m_lengthSet) {
+       setArgSize(arg, a_length);
+       return;
+     }
+     size_t nBytes = a_length * elementBytes;
+     if (!isOnly) {
+       *(uint32_t *)((uint8_t *)m_buffer->m_rccBuffer->data + offset) = (uint32_t)a_length;
+       nBytes += offset + align;
+     }
+     m_buffer->resize(nBytes);
+#endif
+   }
  public:
    inline void * data() const { return m_buffer->data(); }
    inline size_t maxLength() const { return m_buffer->maxLength(); }
@@ -401,6 +512,16 @@ typedef struct {
    inline void setArgSize(size_t length) const {
      return m_op.setArgSize(m_arg, length);
    }
+   inline void *getArgAddress(size_t offset, size_t align, size_t elementBytes,
+                              bool isSequence, bool isOnly, size_t *length,
+                              size_t *capacity) const {
+     return m_op.getArgAddress(m_arg, offset, align, elementBytes, isSequence, isOnly, length,
+                               capacity);
+   }
+   inline void setArgSize(size_t offset, size_t align, size_t elementBytes, bool isOnly,
+                          size_t length) const {
+     m_op.setArgSize(m_arg, offset, align, elementBytes, isOnly, length);
+   }
  };
 
  class Worker;
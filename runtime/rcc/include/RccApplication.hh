@@ -85,6 +85,7 @@ namespace OCPI {
         friend class Controller;
       protected:
 	void run(OCPI::Xfer::EventManager* event_manager, bool &more_to_do);
+	bool needsPolling() const;
       public:
 	OCPI::Container::Worker &
 	createWorker(OCPI::Container::Artifact *art, const char *appInstName, ezxml_t impl,
@@ -39,6 +39,7 @@
 #include "OsSemaphore.hh"
 #include "RccApplication.hh"
 #include "RccDriver.hh"
+#include "UtilTimerWheel.hh"
 
 namespace OCPI {
 
@@ -72,6 +73,10 @@ namespace OCPI {
       static const int LOW_PRI_Q = 0;
       static const int HIGH_PRI_Q = 1;
       static pthread_workqueue_t m_workqueues[WORKQUEUE_COUNT]; 
+      // Run condition timeouts of all our workers
+      OCPI::Util::TimerWheel m_timerWheel;
+      // When the last dispatch found nothing to poll, how long we can sleep, else zero
+      uint64_t m_idleDeadline;
 
     public:
       friend class Port;
@@ -100,6 +105,8 @@ namespace OCPI {
       //      void stop(OCPI::Xfer::EventManager* event_manager);
       OCPI::Xfer::EventManager*  getEventManager();
       bool needThread() { return true; }
+    protected:
+      bool idleWait();
     };
   }
 }
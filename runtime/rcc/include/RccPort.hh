@@ -66,6 +66,8 @@ namespace OCPI {
       RCCPort                              &m_rccPort;    // The RCC port of this port
       OCPI::API::ExternalBuffer            *m_buffer;     // A buffer in use by this port
       bool                                  m_wantsBuffer; // wants a buffer but does not have one
+      RCCPortMask                          &m_readyMask;  // the worker's mask of ports with buffers
+      RCCPortMask                           m_readyBit;   // our bit in it
       //  invalid state: m_wantsBuffer && m_buffer
       //  The initial state is m_wantsBuffer == true, which implies that there is no way for a worker
       //  to start out NOT requesting any buffers... Someday that should be an option:  i.e. like
@@ -88,6 +90,10 @@ namespace OCPI {
       createExternal(const char *extName, bool provider,
 		     const OCPI::Base::PValue *extParams,
 		     const OCPI::Base::PValue *connParams);
+      inline void clearBuffer() {
+	m_buffer = NULL;
+	m_readyMask &= ~m_readyBit;
+      }
     public:
       // These methods are called in one place from the worker from C, hence public and inline
       bool requestRcc(size_t max = 0) {
@@ -119,6 +125,7 @@ namespace OCPI {
 	    m_rccPort.input.eof = m_rccPort.current.eof_;
 	  }
 	  if (m_buffer) {
+	    m_readyMask |= m_readyBit;
 	    if (max && isOutput() && max < m_rccPort.output.length)
 	      throw OCPI::Util::Error("Requested output buffer size is unavailable");
 	    m_rccPort.current.portBuffer = m_buffer;
@@ -136,7 +143,7 @@ namespace OCPI {
       inline void releaseRcc(RCCBuffer &buffer) {
 	ocpiAssert(isProvider() && buffer.portBuffer);
 	if (&m_rccPort.current == &buffer) {
-	  m_buffer = NULL;
+	  clearBuffer();
 	  m_rccPort.current.data = NULL;
 	  m_rccPort.input.eof = false;
 	}
@@ -157,7 +164,7 @@ namespace OCPI {
 	m_rccPort.current.data = NULL;
 	m_rccPort.input.eof = false;
 	m_buffer->take(); // tell lower levels to move on, but not release
-	m_buffer = NULL;
+	clearBuffer();
 	if (oldBuffer) {
 	  ocpiAssert(oldBuffer->portBuffer);
 	  oldBuffer->portBuffer->release();
@@ -183,7 +190,7 @@ namespace OCPI {
 	      // FIXME: share code with take
 	      buffer.containerPort->m_rccPort.current.data = NULL;
 	      buffer.containerPort->m_buffer->take();
-	      buffer.containerPort->m_buffer = NULL;
+	      buffer.containerPort->clearBuffer();
 	      buffer.containerPort->requestRcc();
 	    } // else its a taken buffer
 	    put(*buffer.portBuffer, buffer.length_, buffer.opCode_, buffer.eof_, buffer.direct_);
@@ -38,6 +38,7 @@
 #include "RCC_Worker.hh"
 
 #include "ContainerManager.hh"
+#include "UtilTimerWheel.hh"
 
 namespace OCPI {
   namespace RCC {
@@ -59,6 +60,13 @@ namespace OCPI {
       friend class RCCUserSlave;
       friend class RCCUserWorker;
       void run(bool &anyRun);
+      // Is this worker only waiting for its timeout, or doing nothing at all?
+      // Connected ports must be polled (and their transports given time) regardless.
+      inline bool needsPolling() const {
+	return m_context->connectedPorts ||
+	  (enabled && !(m_runCondition->m_timeout && m_runCondition->m_portMasks &&
+			!m_runCondition->m_portMasks[0] && m_runCondition->m_hasRun));
+      }
       void advanceAll();
       void portError(std::string&error);
       bool doEOF();
@@ -172,12 +180,7 @@ namespace OCPI {
 	m_errorString.clear();
       }
       void checkError() const;
-      inline void setRunCondition(const RunCondition &rc) {
-        if (m_runCondition) // there is no RunCondition::deactivate()
-          m_runCondition->m_inUse = false;
-        m_runCondition = &rc;
-        m_runCondition->activate(m_runTimer, m_nPorts);
-      }
+      void setRunCondition(const RunCondition &rc);
       // Our dispatch table
       RCCEntryTable   *m_entry;    // our entry in the entry table of the artifact
       RCCUserWorker   *m_user;     // for C++, the user's worker object
@@ -192,6 +195,11 @@ namespace OCPI {
       RunCondition     m_defaultRunCondition; // run condition we create
       RunCondition     m_cRunCondition;       // run condition we use when C-language RC changes
       const RunCondition *m_runCondition;        // current active run condition used in dispatching
+      // Port readiness is maintained as ports gain and lose buffers, rather than polled
+      RCCPortMask      m_readyMask;    // ports that have a current buffer
+      volatile uint32_t m_readyChanged; // ports with buffers put or released since we looked
+      RCCPortMask      m_pollMask;     // connected ports that can't tell us, so are polled
+      bool             m_settled;      // we last found nothing to do, and nothing changed since
 
       // Mutable since this is a side effect of clearing the worker-set error when reported
       mutable std::string m_errorString;         // error string set via "setError"
@@ -207,12 +215,16 @@ namespace OCPI {
       uint32_t targetPortCount;
       unsigned m_nPorts;
 
-      // Last time that the worker was run
-      OCPI::OS::Timer m_runTimer;
+      // Timeout of the run condition, in the container's timer wheel
+      OCPI::Util::TimerWheel::Timer m_runTimer;
       OCPI::OS::Time  m_lastRun;
 
       // Debug/stats
       uint64_t worker_run_count;
+      // Always-on statistics, in nanoseconds.  Waiting is the time between runs.
+      static const unsigned c_nRunBuckets = 16; // run time histogram: <1us, <2us, <4us...
+      uint64_t m_runNs, m_runMaxNs, m_waitNs, m_lastRunEnd, m_runBuckets[c_nRunBuckets];
+      uint64_t m_periodsMissed; // periods skipped because a periodic run overran its deadline
 
       // Pointer into actual RCC worker binary for its dispatch struct
       OCPI::Transport::Transport &m_transport;
@@ -222,6 +234,8 @@ namespace OCPI {
 
       // Update a ports information (as a result of a connection)
       void portIsConnected(unsigned ordinal);
+    public:
+      void getStatistics(Statistics &stats);
     };
 
 
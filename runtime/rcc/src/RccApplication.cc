@@ -141,5 +141,13 @@ run(XF::EventManager* event_manager, bool &more_to_do) {
   }
 }
 
+bool Application::
+needsPolling() const {
+  for (Worker *w = OU::Parent<Worker>::firstChild(); w; w = w->nextChild())
+    if (w->needsPolling())
+      return true;
+  return false;
+}
+
   }
 }
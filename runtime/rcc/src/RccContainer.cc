@@ -59,7 +59,7 @@ getEventManager()
 class Driver;
 Container::
 Container(const char *a_name, const OA::PValue* /* params */)
-  : OC::ContainerBase<Driver,Container,Application,Artifact>(*this, a_name)
+  : OC::ContainerBase<Driver,Container,Application,Artifact>(*this, a_name), m_idleDeadline(0)
 {
   const char *system = OU::getSystemId().c_str();
   m_model = "rcc";
@@ -143,6 +143,7 @@ Container::
   // Lock our mutex.  It will be unlocked.
   TRACE( "OCPI::RCC::Container::~Container()");
   this->lock();
+  m_timerWheel.wake();
   OC::Container::shutdown();
   // We need to shut down the apps and workers since they
   // depend on artifacts and transport.
@@ -269,13 +270,34 @@ dispatch(XF::EventManager* event_manager)
     event_manager->consumeEvents();
   }
 #endif
-  // Process the workers
+  // Expire worker timeouts, then process the workers
+  m_timerWheel.advance(OU::TimerWheel::now());
   for (Application *a = OU::Parent<Application>::firstChild(); a; a = a->nextChild())
     a->run(event_manager, more_to_do);
-
+  // If no worker needs polling, we can sleep until the next timeout
+  m_idleDeadline = 0;
+  if (!more_to_do && OU::Parent<Application>::firstChild()) {
+    Application *a;
+    for (a = OU::Parent<Application>::firstChild(); a && !a->needsPolling(); a = a->nextChild())
+      ;
+    if (!a)
+      m_idleDeadline = m_timerWheel.nextDeadline();
+  }
   return more_to_do ? MoreWorkNeeded : Spin;
 }
 
+// Called from the dispatch thread outside our mutex.  Control operations that might need
+// the dispatch thread wake it up, but we still limit the sleep to what the container
+// base class would do with no applications.
+bool Container::
+idleWait() {
+  if (!m_idleDeadline)
+    return false;
+  uint64_t limit = OU::TimerWheel::now() + 100000000ull;
+  m_timerWheel.wait(m_idleDeadline < limit ? m_idleDeadline : limit);
+  return true;
+}
+
 
 /**********************************
  * Creates an application 
@@ -48,7 +48,8 @@ namespace OCPI {
       :  OC::PortBase<Worker, Port, OCPI::RCC::ExternalPort>(w, *this, pmd, params),
 	 m_localOther(NULL), m_rccPort(rp), m_buffer(NULL),
 	 // Internal ports for non-scaled crews don't get buffers
-         m_wantsBuffer(pmd.m_isInternal && w.crewSize() <= 1 ? false : true) {
+         m_wantsBuffer(pmd.m_isInternal && w.crewSize() <= 1 ? false : true),
+	 m_readyMask(w.m_readyMask), m_readyBit(1u << pmd.m_ordinal) {
       // FIXME: deep copy params?
       // Initialize rccPort with aspects based on metadata
       if (pmd.nOperations() <= 1) {
@@ -99,7 +100,7 @@ namespace OCPI {
 	    release(); // m_buffer->release(); must release on port gotten from
 	  }
 	  m_rccPort.current.data = NULL;
-	  m_buffer = NULL;
+	  clearBuffer();
 	}
 	bool ready = requestRcc();
 	if (ready && max && max > m_rccPort.current.maxLength)
@@ -19,6 +19,7 @@
  */
 
 #include <climits>
+#include <cinttypes>
 #include "TimeEmitCategories.hh"
 #include "RccApplication.hh"
 #include "RccPort.hh"
@@ -34,6 +35,10 @@ namespace OA = OCPI::API;
 namespace OCPI {
   namespace RCC {
 
+static inline uint64_t now() {
+  return OU::TimerWheel::now();
+}
+
 Worker::
 Worker(Application & app, Artifact *art, const char *a_name, ezxml_t impl, ezxml_t inst,
        const OC::Workers &a_slaves, bool a_hasMaster, size_t a_member, size_t a_crewSize,
@@ -43,11 +48,14 @@ Worker(Application & app, Artifact *art, const char *a_name, ezxml_t impl, ezxml
     OCPI::Time::Emit(&parent().parent(), "Worker", a_name),
     m_entry(art ? art->getDispatch(ezxml_cattr(impl, "name")) : NULL), m_user(NULL),
     m_dispatch(NULL), m_portInit(0), m_context(NULL), m_firstInput(NULL), m_eofSent(RCC_NO_PORTS),
-    m_mutex(app.container()), m_runCondition(NULL), enabled(false),
+    m_mutex(app.container()), m_runCondition(NULL), m_readyMask(0), m_readyChanged(0),
+    m_pollMask(0), m_settled(false), enabled(false),
     hasRun(false), sourcePortCount(0), targetPortCount(0), m_nPorts(nPorts()), worker_run_count(0),
+    m_runNs(0), m_runMaxNs(0), m_waitNs(0), m_lastRunEnd(0), m_periodsMissed(0),
     m_transport(app.parent().getTransport()), m_taskSem(0)
 {
    memset(&m_info, 0, sizeof(m_info));
+   memset(m_runBuckets, 0, sizeof(m_runBuckets));
    if (art)
      if (!strcasecmp(m_entry->type, "c"))
        m_dispatch = m_entry->dispatch;
@@ -452,7 +460,14 @@ rccTake(RCCPort *rccPort, RCCBuffer *oldBuffer, RCCBuffer *newBuffer)
  void Worker::
  portIsConnected(unsigned ordinal) {
    ocpiDebug("Worker '%s', port %u is connected", name().c_str(), ordinal);
-   m_context->connectedPorts |= (1u << ordinal);
+   RCCPortMask bit = 1u << ordinal;
+   m_context->connectedPorts |= bit;
+   if (m_context->ports[ordinal].containerPort->notifyReadyTo(&m_readyChanged, bit))
+     m_pollMask &= ~bit;
+   else
+     m_pollMask |= bit;
+   __sync_fetch_and_or(&m_readyChanged, bit);
+   m_settled = false;
  }
 
  void Worker::
@@ -538,6 +553,7 @@ doEOF() {
     // all outputs have propagated, and there are no ports that handle EOFs, so we're done
     enabled = false;
     setControlState(OM::Worker::FINISHED);
+    m_runTimer.cancel();
     return true;
   }
   return false;
@@ -546,11 +562,14 @@ doEOF() {
 void Worker::
 run(bool &anyone_run) {
   checkControl();
-  if (!enabled)
+  // Skip the worker entirely if nothing has happened since we found nothing to do
+  if (!enabled ||
+      (m_settled && !m_readyChanged && !m_pollMask && !m_runTimer.expired()))
     return;
   OU::AutoMutex guard (mutex(), true);
   if (!enabled)
     return;
+  m_settled = false;
   // Before run condition processing happens, perform callbacks, and, if we did any,
   // skip runcondition processing
   // FIXME: have a bit mask of these
@@ -579,28 +598,33 @@ run(bool &anyone_run) {
   bool timedOut = false, dont = false;
   do {
     // First do the checks that don't depend on port readiness.
-    if (m_runCondition->shouldRun(m_runTimer, timedOut, dont))
+    if (m_runCondition->shouldRun(m_runTimer.expired(), timedOut, dont))
       break;
-    else if (dont)
+    else if (dont) {
+      m_settled = true;
       return;
-    // Start out assuming optional unconnected ports are "ready"
-    RCCPortMask readyMask = optionalPorts() & ~m_context->connectedPorts;
-    // Only examine connected ports that are in the run condition
+    }
+    // Only examine connected ports that are in the run condition, and of those, only the
+    // ones without buffers that have had buffers move since we last looked, or can't say.
     RCCPortMask relevantMask = m_context->connectedPorts & m_runCondition->m_allMasks;
-    rccPort = m_context->ports;
-    RCCPortMask portBit = 1;
-    for (unsigned n = m_nPorts; n; n--, rccPort++, portBit <<= 1)
-      if ((portBit & relevantMask) && rccPort->containerPort->checkReady())
-	readyMask |= portBit;
-    if (!readyMask)
-      return;
+    RCCPortMask checkMask =
+      (__sync_fetch_and_and(&m_readyChanged, 0) | m_pollMask) & relevantMask & ~m_readyMask;
+    for (unsigned n = 0; checkMask; n++, checkMask >>= 1)
+      if (checkMask & 1)
+	m_context->ports[n].containerPort->checkReady(); // updates m_readyMask
+    // Optional unconnected ports are considered "ready"
+    RCCPortMask readyMask =
+      (optionalPorts() & ~m_context->connectedPorts) | (m_readyMask & relevantMask);
     // See if any of our masks are satisfied
     RCCPortMask *pmp, pm = 0;
-    for (pmp = m_runCondition->m_portMasks; (pm = *pmp); pmp++)
-      if ((pm & readyMask) == (pm & ~(RCC_ALL_PORTS << m_nPorts)))
-	break;
-    if (!pm)
+    if (readyMask)
+      for (pmp = m_runCondition->m_portMasks; (pm = *pmp); pmp++)
+	if ((pm & readyMask) == (pm & ~(RCC_ALL_PORTS << m_nPorts)))
+	  break;
+    if (!pm) {
+      m_settled = true;
       return;
+    }
     if (checkEOF() && doEOF())
       return;
   } while (0);
@@ -610,15 +634,25 @@ run(bool &anyone_run) {
     //      OCPI_EMIT_STATE_CAT_NR_(were, 0, OCPI_EMIT_CAT_TUNING, OCPI_EMIT_CAT_TUNING_WC);
     RCCBoolean newRunCondition = false;
     pthread_setspecific(Driver::s_threadKey, this);
-    if (m_runCondition->m_timeout)
-      m_runTimer.restart();
     OCPI_EMIT_REGISTER_FULL_VAR( "Worker Run", OCPI::Time::Emit::DT_u, 1, OCPI::Time::Emit::State, wre );
     OCPI_EMIT_STATE_CAT_NR_(wre, 1, OCPI_EMIT_CAT_WORKER_DEV, OCPI_EMIT_CAT_WORKER_DEV_RUN_TIME);
     ocpiDebug("Running worker \"%s/%s\"", name().c_str(), OM::Worker::cname());
     RCCResult rc;
+    uint64_t start = now();
+    if (m_lastRunEnd)
+      m_waitNs += start - m_lastRunEnd;
     try {
       rc = m_dispatch ?
 	m_dispatch->run(m_context, timedOut, &newRunCondition) : m_user->run(timedOut);
+      m_lastRunEnd = now();
+      uint64_t ns = m_lastRunEnd - start;
+      m_runNs += ns;
+      if (ns > m_runMaxNs)
+	m_runMaxNs = ns;
+      unsigned bucket = 0;
+      for (uint64_t us = ns / 1000; us && bucket < c_nRunBuckets - 1; us >>= 1)
+	bucket++;
+      m_runBuckets[bucket]++;
     } catch (std::string &e) {
       throw OU::Error("RCC Worker \"%s/%s\" run method failed with exception: %s",
 		      name().c_str(), OM::Worker::cname(), e.c_str());
@@ -632,8 +666,6 @@ run(bool &anyone_run) {
       m_user->m_first = false;
     checkError();
     if (newRunCondition) {
-      if (m_runCondition->m_timeout)
-	m_runTimer.reset();
       if (m_context->runCondition) {
 	m_cRunCondition.setRunCondition(m_context->runCondition->portMasks,
 					m_context->runCondition->timeout,
@@ -641,10 +673,6 @@ run(bool &anyone_run) {
 	setRunCondition(m_cRunCondition);
       } else
 	setRunCondition(m_defaultRunCondition);
-      // FIXME: cache this silly calcation using OS::Time
-      if (m_runCondition->m_timeout)
-	m_runTimer.restart(m_runCondition->m_usecs / 1000000,
-			   (m_runCondition->m_usecs % 1000000) * 1000);
     }
     // The state might have changed behind our back: e.g. in port exceptions
     if (getState() != OM::Worker::UNUSABLE)
@@ -659,13 +687,14 @@ run(bool &anyone_run) {
 	// FIXME:  release all current buffers
 	enabled = false;
 	setControlState(OM::Worker::FINISHED);
+	m_runTimer.cancel(); // an expiration that caused this run must not persist
 	break;
       case RCC_OK:
 	break;
       default:
 	enabled = false;
 	setControlState(OM::Worker::UNUSABLE);
-	m_runTimer.reset();
+	m_runTimer.cancel();
 	{
 	  const char *err = errorString();
 	  if (!err)
@@ -682,9 +711,55 @@ run(bool &anyone_run) {
 	}
       }
     worker_run_count++;
+    // Rearm the timeout.  When this run was due to the timeout, the next deadline is
+    // relative to the one that expired, so periodic execution does not drift.  Otherwise
+    // the timeout is measured from the start of this run.
+    if (enabled && m_runCondition->m_timeout) {
+      uint64_t period = m_runCondition->m_usecs * 1000ull, deadline;
+      if (timedOut && m_runTimer.deadline()) {
+	deadline = m_runTimer.deadline() + period;
+	if (deadline <= m_lastRunEnd && period) { // overran: skip the periods we missed
+	  uint64_t missed = (m_lastRunEnd - deadline) / period + 1;
+	  m_periodsMissed += missed;
+	  deadline += missed * period;
+	}
+      } else
+	deadline = start + period;
+      parent().parent().m_timerWheel.schedule(m_runTimer, deadline);
+    }
   }
 }
 
+void Worker::
+setRunCondition(const RunCondition &rc) {
+  if (m_runCondition) // there is no RunCondition::deactivate()
+    m_runCondition->m_inUse = false;
+  m_runCondition = &rc;
+  m_runCondition->activate(m_nPorts);
+  m_runTimer.cancel();
+  // Ports newly in the run condition may not have been looked at.
+  // The initial run condition is set before the context exists, when none are connected.
+  if (m_context)
+    __sync_fetch_and_or(&m_readyChanged, m_context->connectedPorts);
+  m_settled = false;
+  // The container's thread may be sleeping on the assumption that we didn't need it
+  parent().parent().m_timerWheel.wake();
+}
+
+void Worker::
+getStatistics(Statistics &stats) {
+  addStatistic(stats, "runs", worker_run_count);
+  addStatistic(stats, "runTimeNs", m_runNs);
+  addStatistic(stats, "runTimeMaxNs", m_runMaxNs);
+  addStatistic(stats, "waitTimeNs", m_waitNs);
+  addStatistic(stats, "periodsMissed", m_periodsMissed);
+  std::string hist;
+  for (unsigned n = 0; n < c_nRunBuckets; n++)
+    OU::formatAdd(hist, "%s%" PRIu64, n ? "," : "", m_runBuckets[n]);
+  stats.push_back(std::make_pair("runTimeHistogramUs", hist));
+  OC::Worker::getStatistics(stats);
+}
+
 void Worker::
 advanceAll() {
   OCPI_EMIT_REGISTER_FULL_VAR( "Advance All", OCPI::Time::Emit::DT_u, 1, OCPI::Time::Emit::State, aare );
@@ -731,6 +806,8 @@ OCPI_CONTROL_OPS
     if ((rc = DISPATCH(start)) == RCC_OK) {
       enabled = true;
       hasRun = false; // allow immediate execution after suspension for period execution
+      m_settled = false;
+      parent().parent().m_timerWheel.wake();
     }
     break;
   case OM::Worker::OpStop:
@@ -739,7 +816,7 @@ OCPI_CONTROL_OPS
       break;
     if (enabled) {
       enabled = false;
-      m_runTimer.reset(); // just in case there is overhead with running the timer
+      m_runTimer.cancel();
     }
     setControlState(OM::Worker::SUSPENDED);
     break;
@@ -747,7 +824,7 @@ OCPI_CONTROL_OPS
   case OM::Worker::OpRelease:
     if (enabled) {
       enabled = false;
-      m_runTimer.reset();
+      m_runTimer.cancel();
     }
     rc = DISPATCH(release);
     setControlState(OM::Worker::UNUSABLE);
@@ -1187,10 +1264,46 @@ RCCResult RCCUserWorker::run(bool /*timeout*/) {
    RCCUserPort::
    RCCUserPort()
      : m_rccPort(((Worker *)pthread_getspecific(Driver::s_threadKey))->portInit()),
-       m_isSendMode(false) {
+       m_freeBuffers(NULL), m_allBuffers(NULL), m_isSendMode(false) {
      m_rccBuffer = &m_rccPort.current;
      m_rccPort.userPort = this;
    };
+   RCCUserPort::
+   ~RCCUserPort() {
+     while (m_allBuffers) {
+       RCCUserBuffer *b = m_allBuffers;
+       m_allBuffers = b->m_allNext;
+       delete b;
+     }
+   }
+   // Taken buffer objects are pooled per port.  The pool is filled to the port's buffer
+   // count on first use, so that take/send/release do not allocate in steady state.
+   RCCUserBuffer &RCCUserPort::
+   allocateTaken() {
+     if (!m_freeBuffers) {
+       size_t n = m_allBuffers || !m_rccPort.containerPort ? 1 :
+	 m_rccPort.containerPort->nBuffers();
+       do {
+	 RCCUserBuffer *b = new RCCUserBuffer;
+	 b->m_pool = this;
+	 b->m_allNext = m_allBuffers;
+	 m_allBuffers = b;
+	 b->m_next = m_freeBuffers;
+	 m_freeBuffers = b;
+       } while (--n);
+     }
+     RCCUserBuffer &b = *m_freeBuffers;
+     m_freeBuffers = b.m_next;
+     b.m_rccBuffer = &b.m_taken;
+     b.m_opCodeSet = b.m_lengthSet = b.m_resized = false;
+     return b;
+   }
+   void RCCUserPort::
+   recycle(RCCUserBuffer &buf) {
+     assert(buf.m_pool == this);
+     buf.m_next = m_freeBuffers;
+     m_freeBuffers = &buf;
+   }
    // C++ specific buffer initialization.  When C is better integrated, can be common.
    // Opcode is initialized so we can both detect mismatches (opcode vs opcode-specific
    // accessors) and automatically infer opcodes from the use of opcode-specific accessors
@@ -1301,13 +1414,28 @@ RCCResult RCCUserWorker::run(bool /*timeout*/) {
    send(RCCUserBuffer&buf) {
      m_isSendMode = true;
      rccSend(&m_rccPort, buf.getRccBuffer());
+     if (buf.m_pool) // a taken buffer is no longer usable once sent
+       buf.m_pool->recycle(buf);
+   }
+   void RCCUserPort::
+   send(RCCTakenBuffer &buf) {
+     if (!buf)
+       throw OU::Error("port \"%s\" send of a taken buffer that is empty or was already sent",
+		       m_rccPort.containerPort->name().c_str());
+     send(*buf.detach());
    }
    RCCUserBuffer &RCCUserPort::
    take(RCCUserBuffer *oldBuffer) {
-     RCCUserBuffer *nb = new RCCUserBuffer;
-     rccTake(&m_rccPort, oldBuffer ? &oldBuffer->m_taken : NULL, &nb->m_taken);
-     delete oldBuffer; // FIXME: when C and C++ are more integrated, this will go away
-     return *nb;
+     RCCUserBuffer &nb = allocateTaken();
+     try {
+       rccTake(&m_rccPort, oldBuffer ? &oldBuffer->m_taken : NULL, &nb.m_taken);
+     } catch (...) {
+       recycle(nb);
+       throw;
+     }
+     if (oldBuffer && oldBuffer->m_pool)
+       oldBuffer->m_pool->recycle(*oldBuffer);
+     return nb;
    }
    bool RCCUserPort::
    request(size_t maxlength) {
@@ -1417,7 +1545,8 @@ RCCResult RCCUserWorker::run(bool /*timeout*/) {
    }
 
    RCCUserBuffer::
-   RCCUserBuffer() : m_rccBuffer(&m_taken), m_opCodeSet(false), m_lengthSet(false), m_resized(false) {
+   RCCUserBuffer() : m_rccBuffer(&m_taken), m_opCodeSet(false), m_lengthSet(false), m_resized(false),
+		     m_pool(NULL), m_next(NULL), m_allNext(NULL) {
    }
    RCCUserBuffer::
    ~RCCUserBuffer() {}
@@ -1428,7 +1557,8 @@ RCCResult RCCUserWorker::run(bool /*timeout*/) {
    void RCCUserBuffer::
    release() {
      rccRelease(m_rccBuffer);
-     delete this; // this will go away when we integrate C and C++ better
+     if (m_pool) // taken buffers go back to their port's pool
+       m_pool->recycle(*this);
    }
    void RCCUserBuffer::
    setOpCode(RCCOpCode op) {
@@ -501,8 +501,56 @@ namespace OCPI {
 	return OU::eformat(error, "Control message error: %s", err);
       m_response = "<control>";
       OC::Worker &w = *m_members[inst].m_worker;
+      const char
+	*getRaw = ezxml_cattr(m_rx, "getraw"),
+	*setRaw = ezxml_cattr(m_rx, "setraw");
       try {
-	if (get || set) {
+	if (getRaw || setRaw) {
+	  // Batched raw property access: ordinals in the attribute, hex values in the text
+	  bool uncached;
+	  if ((err = OX::getBoolean(m_rx, "uncached", &uncached)))
+	    return OU::eformat(error, "Raw property control message error: %s", err);
+	  std::vector<const OA::PropertyInfo *> infos;
+	  std::vector<size_t> offsets;
+	  size_t nBytes = 0;
+	  for (const char *cp = getRaw ? getRaw : setRaw; *cp; ) {
+	    char *end;
+	    unsigned long ordinal = strtoul(cp, &end, 10);
+	    if (end == cp || ordinal >= w.nProperties())
+	      return OU::eformat(error, "Raw property control message has bad ordinals: %s",
+				 getRaw ? getRaw : setRaw);
+	    const OA::PropertyInfo &p = w.properties()[ordinal];
+	    infos.push_back(&p);
+	    offsets.push_back(nBytes);
+	    nBytes += p.m_nBytes;
+	    for (cp = end; isspace(*cp); cp++)
+	      ;
+	  }
+	  if (infos.empty())
+	    return OU::eformat(error, "Raw property control message has no ordinals");
+	  std::vector<uint8_t> data(nBytes);
+	  std::vector<uint8_t *> ptrs(infos.size());
+	  for (size_t k = 0; k < infos.size(); ++k)
+	    ptrs[k] = &data[0] + offsets[k];
+	  if (getRaw) {
+	    w.getRawProperties(&infos[0], &ptrs[0], infos.size(), uncached);
+	    for (size_t k = 0; k < infos.size(); ++k) {
+	      if (k)
+		m_response += ' ';
+	      for (size_t i = 0; i < infos[k]->m_nBytes; ++i)
+		OU::formatAdd(m_response, "%02x", ptrs[k][i]);
+	    }
+	  } else {
+	    const char *cp = ezxml_txt(m_rx);
+	    for (size_t k = 0; k < infos.size(); ++k) {
+	      while (isspace(*cp)) cp++;
+	      for (size_t i = 0; i < infos[k]->m_nBytes; ++i, cp += 2)
+		if (sscanf(cp, "%2hhx", (unsigned char *)&ptrs[k][i]) != 1)
+		  return OU::eformat(error, "Raw property control message has short values");
+	    }
+	    w.setRawProperties(&infos[0], (const uint8_t *const *)&ptrs[0], infos.size());
+	  }
+	} else if (get || set) {
 	  OM::Property &p = w.properties()[n];
 	  size_t offset, dimension, idx, nBytes;
 	  bool haveNbytes, string;
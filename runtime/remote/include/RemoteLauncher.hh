@@ -79,6 +79,10 @@ namespace OCPI {
 			 size_t nBytes, unsigned idx),
 	getPropertyBytes(unsigned remoteInstance, size_t propN, size_t offset, const uint8_t *v,
 			 size_t nBytes, unsigned idx, bool string),
+	getRawProperties(unsigned remoteInstance, const OCPI::API::PropertyInfo *const *infos,
+			 uint8_t *const *data, size_t nProps, bool uncached),
+	setRawProperties(unsigned remoteInstance, const OCPI::API::PropertyInfo *const *infos,
+			 const uint8_t *const *data, size_t nProps),
 	getPropertyValue(unsigned remoteInstance, size_t propN, std::string &v,
 			 const std::vector<uint8_t> &path, size_t offset, size_t dimension,
 			 OCPI::API::PropertyOptionList &options,
@@ -161,23 +161,33 @@ class Worker
 				sizeof(data), idx, false);
     return data;
   }
+  // Batched raw access is a single round trip, with caching done on the server side
+  void getRawProperties(const OA::PropertyInfo *const *infos, uint8_t *const *data,
+			size_t nProps, bool uncached) const {
+    m_launcher.getRawProperties(m_remoteInstance, infos, data, nProps, uncached);
+  }
+  void setRawProperties(const OA::PropertyInfo *const *infos, const uint8_t *const *data,
+			size_t nProps) const {
+    m_launcher.setRawProperties(m_remoteInstance, infos, data, nProps);
+  }
   void propertyWritten(unsigned /*ordinal*/) const {};
   void propertyRead(unsigned /*ordinal*/) const {};
   void prepareProperty(OM::Property &,
 		       volatile uint8_t *&/*writeVaddr*/,
 		       const volatile uint8_t *&/*readVaddr*/) const {}
 
-  // These scalar and binary accessors must convert to a string value in the remote
+  // The scalar accessors move the binary value, with no string conversion.
+  // The sequence accessors must convert to a string value in the remote
   // case, since the RPC is string-based anyway.
 #undef OCPI_DATA_TYPE_S
 #define OCPI_DATA_TYPE(sca,corba,letter,bits,run,pretty,store)		\
   void set##pretty##Property(const OCPI::API::PropertyInfo &info, const OB::Member &m, \
 			     size_t offset, const run val, unsigned idx) const { \
-    OB::Unparser up;							\
-    std::string s;							\
-    up.unparse##pretty(s, val, true);					\
-    setProperty(info, s.c_str(), m, offset + idx * m.m_elementBytes,	\
-		m.m_isSequence || m.m_arrayRank ? 1 : 0);		\
+    union { run r; store s; } u;					\
+    u.r = val;								\
+    m_launcher.setPropertyBytes(m_remoteInstance, info.m_ordinal,	\
+				offset + idx * m.m_elementBytes,	\
+				(const uint8_t *)&u.s, sizeof(u.s), 0);	\
   }									\
   void set##pretty##SequenceProperty(const OA::PropertyInfo &info, const run *vals, \
 				     size_t length) const { \
@@ -219,20 +229,17 @@ class Worker
   OCPI_PROPERTY_DATA_TYPES
 #undef OCPI_DATA_TYPE_S
 #undef OCPI_DATA_TYPE
-  // Get Scalar Property by in fact getting the string and parsing it
-  // We get the string because that is the natural remote operation
+  // Get Scalar Property by getting its binary value.
+  // Sequences get the string and parse it, since that is the natural remote operation
 #define OCPI_DATA_TYPE(sca,corba,letter,bits,run,pretty,store)		             \
   run get##pretty##Property(const OCPI::API::PropertyInfo &info, const OB::Member &m, \
 			    size_t offset, unsigned idx) const {	             \
-    std::string uValue; /* unparsed value */                                         \
-    getProperty(info, uValue, m, offset + idx * info.m_elementBytes, \
-		m.m_isSequence || m.m_arrayRank ? 1 : 0, OA::PropertyOptionList({ OA::HEX })); \
-    OB::ValueType vt(m);						\
-    vt.m_isSequence = false;						\
-    vt.m_arrayRank = 0;							\
-    OB::Value v(vt);							\
-    (void)v.parse(uValue.c_str());					\
-    return v.m_##pretty;						\
+    union { run r; store s; } u;					\
+    u.s = 0; /* for warning only */					\
+    m_launcher.getPropertyBytes(m_remoteInstance, info.m_ordinal,	\
+				offset + idx * m.m_elementBytes,	\
+				(uint8_t *)&u.s, sizeof(u.s), 0, false); \
+    return u.r;								\
   }									\
   unsigned get##pretty##SequenceProperty(const OA::PropertyInfo &info, run *vals, \
 					 size_t length) const {		\
@@ -471,6 +471,57 @@ getPropertyBytes(unsigned remoteInstance, size_t propN, size_t offset, const uin
   }
 }
 
+// Batched raw property access: one round trip for all the properties.
+// The ordinals are in the attribute, and the values are hex, one word per property.
+static void
+rawOrdinals(std::string &s, const OA::PropertyInfo *const *infos, size_t nProps) {
+  for (size_t n = 0; n < nProps; ++n)
+    OU::formatAdd(s, "%s%u", n ? " " : "", infos[n]->m_ordinal);
+}
+void Launcher::
+getRawProperties(unsigned remoteInstance, const OA::PropertyInfo *const *infos,
+		 uint8_t *const *data, size_t nProps, bool uncached) {
+  std::string ords;
+  rawOrdinals(ords, infos, nProps);
+  OU::SelfAutoMutex guard(this);
+  OU::format(m_request, "<control id='%u' getraw='%s' uncached='%u'>",
+	     remoteInstance, ords.c_str(), uncached ? 1 : 0);
+  send();
+  receive();
+  assert(!strcasecmp(OX::ezxml_tag(m_rx), "control"));
+  const char *err = ezxml_cattr(m_rx, "error");
+  if (err)
+    throw OU::Error("Error getting raw properties: %s", err);
+  const char *cp = ezxml_txt(m_rx);
+  for (size_t n = 0; n < nProps; ++n) {
+    while (isspace(*cp)) cp++;
+    uint8_t *p = data[n];
+    for (size_t i = 0; i < infos[n]->m_nBytes; ++i, ++p, cp += 2)
+      if (sscanf(cp, "%2hhx", (unsigned char *)p) != 1)
+	throw OU::Error("Error getting raw properties: short response from server");
+  }
+}
+void Launcher::
+setRawProperties(unsigned remoteInstance, const OA::PropertyInfo *const *infos,
+		 const uint8_t *const *data, size_t nProps) {
+  std::string ords;
+  rawOrdinals(ords, infos, nProps);
+  OU::SelfAutoMutex guard(this);
+  OU::format(m_request, "<control id='%u' setraw='%s'>", remoteInstance, ords.c_str());
+  for (size_t n = 0; n < nProps; ++n) {
+    if (n)
+      m_request += ' ';
+    for (size_t i = 0; i < infos[n]->m_nBytes; ++i)
+      OU::formatAdd(m_request, "%02x", data[n][i]);
+  }
+  send();
+  receive();
+  assert(!strcasecmp(OX::ezxml_tag(m_rx), "control"));
+  const char *err = ezxml_cattr(m_rx, "error");
+  if (err)
+    throw OU::Error("Error setting raw properties: %s", err);
+}
+
 void Launcher::
 getPropertyValue(unsigned remoteInstance, size_t propN, std::string &v, const std::vector<uint8_t> &path,
 		 size_t offset, size_t dimension, OA::PropertyOptionList &options,
@@ -45,6 +45,10 @@
 
     // Stop collecting events when Q is Full
     "OCPI_TIME_EMIT_Q_SWF"
+
+    // Number of events in each per-thread lock-free ring (rounded up to a power of 2).
+    // 0 means record into the mutex-protected per-object Qs
+    "OCPI_TIME_EMIT_THREAD_Q_SIZE"
     
     // Emit event on construction/destruction of inherited classes
     "OCPI_TIME_EMIT_TRACE_CD"
@@ -61,6 +65,15 @@
    // File name to dump time data into
    "OCPI_TIME_EMIT_DUMP_FILENAME"
 
+   // File name to continuously stream events recorded in the per-thread Qs into,
+   // rather than keeping them until they are dumped
+   "OCPI_TIME_EMIT_STREAM"
+
+   // Stream format
+      "JSON"   (Chrome/Perfetto trace events, the default)
+      "BINARY" (compact records, see Emit::Streamer in TimeEmit.cc, read by EmitStreamReader)
+   "OCPI_TIME_EMIT_STREAM_FORMAT"
+
     Make options:
 
     // compile in the support for the emit macros
@@ -77,12 +90,14 @@
 
 #include "OsDataTypes.hh"
 #include <sys/time.h>
+#include <cstdio>
 #include <string>
 #include <vector>
 #include <map>
 #include <ostream>
 #include "BasePValue.hh"
 #include "OsMutex.hh"
+#include "OsThreadManager.hh"
 #include "UtilAutoMutex.hh"
 #include "UtilException.hh"
 
@@ -344,8 +359,11 @@ namespace OCPI {
       };
       
       // Forward references
+      class Streamer;
       struct EventQEntry;
       struct EventQ;
+      struct ThreadQEntry;
+      struct ThreadQ;
       struct Header;
       struct HeaderEntry;
       struct EventMap;
@@ -384,21 +402,22 @@ namespace OCPI {
       // This is the base class for the time source that gets used by the emit class for time stamping events.
       class TimeSource {
       public:
-        TimeSource(TickFunc tf = NULL) : ticks(tf) {};
+        TimeSource(TickFunc tf = NULL) : ticks(tf), tsc(false) {};
 	virtual Time getTime();
 	TickFunc ticks;
+	bool tsc; // ticks are the CPU time stamp counter, which can be read inline
 	virtual ~TimeSource(){}
       };
 
-      // This class uses "gettimeofday" to get the time tag
+      // This class uses OCPI::OS::Clock to get the time tag, in nanoseconds since the first one
+      // was constructed
       class SimpleSystemTime : public TimeSource {
       public:
 	SimpleSystemTime();
         static Time getTimeOfDay();
         virtual ~SimpleSystemTime(){};
       private:
-	static struct timespec m_init_tv;
-	static bool m_init;
+	static uint64_t m_initNs;
 	static uint64_t myTicks( TimeSource *);
       };
 
@@ -483,9 +502,17 @@ namespace OCPI {
       // This mutex is used to protect the static header data
       static OCPI::OS::Mutex& getGMutex();
 
-      // Shutdown, deletes all global resources 
+      // Shutdown, deletes all global resources except the per-thread Qs of threads
+      // that are still running, which are deleted when those threads exit.  Nothing
+      // is recorded after this.
       static void shutdown();
 
+      // Move events from the per-thread Qs to where they are formatted
+      static void drain();
+
+      // Events not recorded because the recording thread's Q was full
+      static uint64_t dropped();
+
     private:
       void 
 	init_q ( QConfig* config, TimeSource * ts );
@@ -516,6 +543,12 @@ namespace OCPI {
       // Determines if this id is a child of this class
       bool isChild( Emit::OwnerId id );
 
+      // Per-thread Q support
+      static ThreadQ* getThreadQ();
+      static void drainThread( void* );
+      static void streamExit();
+      inline void put( EventId id, Time t, uint64_t v );
+
       unsigned int   m_level;
       std::string    m_className;
       std::string    m_instanceName;
@@ -525,6 +558,9 @@ namespace OCPI {
       int            m_parentIndex;
       OCPI::OS::Mutex m_mutex;
       TimeSource*    m_ts;
+      bool           m_useThreadQ;
+      static __thread ThreadQ* s_threadQ;
+      static bool    s_shutdown; // after which objects record nothing
       static uint32_t m_categories;
       static uint32_t m_sub_categories;
     };
@@ -567,6 +603,50 @@ namespace OCPI {
       DumpFormat m_dumpFormat;
 
     };
+
+    /*
+     * Reader of the BINARY stream format, for tools that convert or analyze streams.
+     * Events are returned in the order written, i.e. in drain order, not time order.
+     */
+    class EmitStreamReader {
+    public:
+      struct Event {
+	Emit::EventId  eid;
+	Emit::OwnerId  owner;
+	uint32_t       tid;
+	uint64_t       ns;    // since the stream was opened
+	uint64_t       value; // the bits of the value, interpreted according to the dtype
+      };
+      struct EventDef {
+	Emit::EventType type;
+	Emit::DataType  dtype;
+	unsigned        width;
+	std::string     name;
+      };
+      struct OwnerDef {
+	Emit::OwnerId   parent;
+	std::string     name;
+      };
+      EmitStreamReader( const char *file );
+      ~EmitStreamReader();
+
+      // Get the next event, reading any definitions before it.  False at the end.
+      bool next( Event &e );
+      // Definitions are available for any event returned by next()
+      const EventDef &eventDef( Emit::EventId id ) const { return m_events[id]; }
+      const OwnerDef &ownerDef( Emit::OwnerId id ) const { return m_owners[id]; }
+
+    private:
+      template <typename T> void get( T &v );
+      void getName( std::string &name );
+      void bad( const char *what );
+
+      FILE                 *m_file;
+      std::string           m_name;
+      std::vector<EventDef> m_events;
+      std::vector<OwnerDef> m_owners;
+      std::vector<bool>     m_eventsDefined, m_ownersDefined;
+    };
 #else    
 // Define the minimum for compilation
     struct QConfig;
@@ -29,6 +29,8 @@
  */
 
 #include <string>
+#include <deque>
+#include <map>
 #include <fstream>
 #include <iostream>
 #include "OsAssert.hh"
@@ -115,6 +117,54 @@ namespace OCPI {
       }
     };
 
+    // Per-thread Q entries are fixed size so that recording one is just a few stores
+    struct Emit::ThreadQEntry {
+      Time     time_ticks;
+      uint64_t value;
+      EventId  eid;
+      OwnerId  owner;
+    };
+
+    // A single-producer/single-consumer ring written without locking by the one thread
+    // that owns it.  The drain moves entries from the ring to the "events" Q, which is
+    // bounded like an EventQ and is what is formatted.  The owning thread and the header
+    // each hold a reference, and whichever lets go last deletes it, so a thread can keep
+    // recording (and dropping) events into its Q after shutdown() without touching freed
+    // memory.
+    struct Emit::ThreadQ {
+      ThreadQEntry*  ring;
+      uint64_t       mask;
+      uint64_t       head;      // written only by the owning thread
+      uint64_t       dropped;   // written only by the owning thread when the ring is full
+      char           pad0[64];  // keep the owning thread and the drain in separate cache lines
+      uint64_t       tail;      // written only by the drain
+      uint32_t       tid;       // the owning thread's system id, for per-thread tracks
+      unsigned       refs;      // 1 when only the header is left, so delete when drained
+      bool           full;      // the events Q has wrapped or stopped
+      std::deque<ThreadQEntry> events; // protected by the global mutex
+      char           pad1[64];
+      ThreadQ( size_t size )
+	: mask(size-1), head(0), dropped(0), tail(0), tid(0), refs(2), full(false) {
+	ring = new ThreadQEntry[size];
+      }
+      ~ThreadQ() {
+	delete [] ring;
+      }
+      inline void put( EventId id, OwnerId owner, Time t, uint64_t v ) {
+	uint64_t h = head;
+	if ( h - __atomic_load_n( &tail, __ATOMIC_ACQUIRE ) > mask ) {
+	  __atomic_store_n( &dropped, dropped + 1, __ATOMIC_RELAXED );
+	  return;
+	}
+	ThreadQEntry &e = ring[h & mask];
+	e.time_ticks = t;
+	e.value = v;
+	e.eid = id;
+	e.owner = owner;
+	__atomic_store_n( &head, h + 1, __ATOMIC_RELEASE );
+      }
+    };
+
     struct Emit::HeaderEntry {
       std::string     className;
       std::string     instanceName;
@@ -141,7 +191,15 @@ namespace OCPI {
       EventId                              nextEventId;
       std::vector<HeaderEntry>             classDefs;
       std::vector<EventQ*>                 eventQ;
-      std::vector<EventMap>                eventMap;
+      std::vector<EventMap>                eventMap;     // indexed by EventId
+      std::map<std::string, EventId>       eventIds;     // EventId by name
+      std::vector<ThreadQ*>                threadQs;
+      uint64_t                             threadQsDropped; // by Qs no longer in threadQs
+      size_t                               threadQSize;  // power of 2, 0 for none
+      QConfig                              threadQConfig; // bounds the drained events
+      OCPI::OS::ThreadManager             *drainThread;
+      Streamer                            *streamer;     // when streaming drained events
+      volatile bool                        draining;
       bool                                 shuttingDown;
       bool                                 dumpOnExit;
       bool                                 traceCD;      // trace class construction/destruction
@@ -149,7 +207,8 @@ namespace OCPI {
       std::string                          dumpFileName;
       std::fstream                         dumpFileStream;
       Emit::TimeSource                     *ts;  // Default time source
-      Header():init(false),nextEventId(0),shuttingDown(false),dumpOnExit(false)
+      Header():init(false),nextEventId(0),threadQsDropped(0),threadQSize(0),drainThread(NULL),streamer(NULL),draining(false),
+	       shuttingDown(false),dumpOnExit(false)
       {
 	g_mutex = new OCPI::OS::Mutex(true);
 
@@ -171,6 +230,11 @@ namespace OCPI {
 	  delete eventQ[n];
 	}
 	eventQ.clear();
+	for ( unsigned int n=0; n<threadQs.size(); n++ ) {
+	  if ( __atomic_sub_fetch( &threadQs[n]->refs, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+	    delete threadQs[n];
+	  }
+	}
 	delete g_mutex;
 	delete ts;
       }
@@ -186,9 +250,25 @@ inline OCPI::Time::Emit::Time OCPI::Time::Emit::getTime()
 
 inline OCPI::Time::Emit::Time OCPI::Time::Emit::getTicks()
 {
+  // The default time source is gone after shutdown
+  if ( __atomic_load_n( &s_shutdown, __ATOMIC_RELAXED ) )
+    return 0;
+#ifdef __x86_64__
+  // The same counter that fasttime reads, without the call
+  if ( m_ts->tsc )
+    return __builtin_ia32_rdtsc();
+#endif
   return m_ts->ticks(m_ts);
 };
 
+inline void OCPI::Time::Emit::put( EventId id, Time t, uint64_t v )
+{
+  ThreadQ *tq = s_threadQ;
+  if ( !tq )
+    tq = getThreadQ();
+  tq->put( id, m_myId, t, v );
+}
+
 
 inline void OCPI::Time::Emit::processTrigger( EventTriggerRole role ) {
   switch( role ) {
@@ -282,7 +362,14 @@ inline void OCPI::Time::Emit::emitT( OCPI::Time::Emit::EventId id,
 				     Time pticks,
 				    EventTriggerRole role)
 {        
-
+  // The Qs are gone after shutdown
+  if ( __atomic_load_n( &s_shutdown, __ATOMIC_RELAXED ) )
+    return;
+  if ( m_useThreadQ && role == NoTrigger ) {
+    if ( !m_q->done )
+      put( id, pticks, v );
+    return;
+  }
   uint32_t size = sizeof(uint64_t);
   AUTO_MUTEX( m_mutex ); 
   if ( role != NoTrigger ) 
@@ -326,12 +413,11 @@ inline void OCPI::Time::Emit::emit( EventId id, OCPI::API::PValue& p, EventTrigg
   emitT(id,p,getTicks(),role);
 }
 
-inline void OCPI::Time::Emit::emitT( EventId id, OCPI::API::PValue& p, Time t, EventTriggerRole role )
+namespace OCPI {
+  namespace Time {
+// Convert a scalar (not string) PValue to the value recorded for an event
+inline void pvalue2SValue( SValue* dp, OCPI::API::PValue& p )
 {
-  INIT_EVENT(id, role, sizeof(uint64_t), t );
-
-  OCPI::Time::SValue* dp = (OCPI::Time::SValue*)(m_q->current + 1);
-
   switch ( p.type ) {
 
   case OCPI::API::OCPI_Short:
@@ -369,10 +455,6 @@ inline void OCPI::Time::Emit::emitT( EventId id, OCPI::API::PValue& p, Time t, E
     break;    
 
   case OCPI::API::OCPI_String:
-    m_q->current->size = (unsigned)strlen(p.vString) + 1;
-    memcpy( &m_q->current[1], p.vString, m_q->current->size );
-    break;    
-
   case OCPI::API::OCPI_none:
   case OCPI::API::OCPI_Struct:
   case OCPI::API::OCPI_Type:
@@ -380,6 +462,35 @@ inline void OCPI::Time::Emit::emitT( EventId id, OCPI::API::PValue& p, Time t, E
   case OCPI::API::OCPI_scalar_type_limit:
     ocpiAssert(0);
   }
+}
+  }
+}
+
+inline void OCPI::Time::Emit::emitT( EventId id, OCPI::API::PValue& p, Time t, EventTriggerRole role )
+{
+  if ( __atomic_load_n( &s_shutdown, __ATOMIC_RELAXED ) )
+    return;
+  // Strings are variable length so they are always recorded in the per-object Q
+  if ( m_useThreadQ && role == NoTrigger && p.type != OCPI::API::OCPI_String ) {
+    if ( !m_q->done ) {
+      OCPI::Time::SValue sv;
+      sv.uvalue = 0; // not set for the types that are not recorded this way
+      OCPI::Time::pvalue2SValue( &sv, p );
+      put( id, t, sv.uvalue );
+    }
+    return;
+  }
+  INIT_EVENT(id, role, sizeof(uint64_t), t );
+
+  OCPI::Time::SValue* dp = (OCPI::Time::SValue*)(m_q->current + 1);
+
+  if ( p.type == OCPI::API::OCPI_String ) {
+    m_q->current->size = (unsigned)strlen(p.vString) + 1;
+    memcpy( &m_q->current[1], p.vString, m_q->current->size );
+  }
+  else {
+    OCPI::Time::pvalue2SValue( dp, p );
+  }
 
   FINI_EVENT;
 }
@@ -394,6 +505,13 @@ inline void OCPI::Time::Emit::emitT( OCPI::Time::Emit::EventId id,
 				     Time t,
 				     EventTriggerRole role )
 {        
+  if ( __atomic_load_n( &s_shutdown, __ATOMIC_RELAXED ) )
+    return;
+  if ( m_useThreadQ && role == NoTrigger ) {
+    if ( !m_q->done )
+      put( id, t, 0 );
+    return;
+  }
   INIT_EVENT(id, role, sizeof(uint64_t),t );
   FINI_EVENT;
 }
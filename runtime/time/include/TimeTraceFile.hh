@@ -0,0 +1,93 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Read-only memory mapped trace files, read a line at a time, so that the trace tools
+// use constant memory regardless of the size of the traces.
+
+#ifndef OCPI_TIME_TRACE_FILE_HH
+#define OCPI_TIME_TRACE_FILE_HH
+
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace OCPI {
+  namespace Time {
+    class MappedFile {
+      const char *m_base, *m_end;
+      size_t      m_size;
+      MappedFile(const MappedFile &);
+      MappedFile &operator=(const MappedFile &);
+    public:
+      explicit MappedFile(const char *name) : m_base(NULL), m_end(NULL), m_size(0) {
+	int fd = open(name, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st)) {
+	  std::string err("Unable to open input file: ");
+	  err += name;
+	  err += ": ";
+	  err += strerror(errno);
+	  if (fd >= 0)
+	    close(fd);
+	  throw err;
+	}
+	m_size = (size_t)st.st_size;
+	if (m_size) {
+	  void *p = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	  if (p == MAP_FAILED) {
+	    std::string err("Unable to map input file: ");
+	    err += name;
+	    close(fd);
+	    throw err;
+	  }
+	  madvise(p, m_size, MADV_SEQUENTIAL);
+	  m_base = (const char *)p;
+	}
+	close(fd);
+	m_end = m_base + m_size;
+      }
+      ~MappedFile() {
+	if (m_size)
+	  munmap((void *)m_base, m_size);
+      }
+      const char *begin() const { return m_base; }
+      const char *end() const { return m_end; }
+      size_t size() const { return m_size; }
+      // Return the next line at p, without its newline, and advance p past it.
+      // Return false at the end of the file.
+      bool nextLine(const char *&p, const char *&line, size_t &len) const {
+	if (p >= m_end)
+	  return false;
+	line = p;
+	const char *nl = (const char *)memchr(p, '\n', (size_t)(m_end - p));
+	p = nl ? nl + 1 : m_end;
+	len = (size_t)((nl ? nl : m_end) - line);
+	if (len && line[len - 1] == '\r')
+	  len--;
+	return true;
+      }
+    };
+  }
+}
+#endif
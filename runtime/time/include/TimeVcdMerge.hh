@@ -0,0 +1,58 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Merge VCD files from several processes into one, streaming the inputs from memory
+// mapped files with a k-way merge by timestamp, so memory use does not depend on the
+// size of the traces.  Each input's timestamps can be offset to align the clocks of
+// different processes.  Errors are thrown as std::string.
+
+#ifndef OCPI_TIME_VCD_MERGE_HH
+#define OCPI_TIME_VCD_MERGE_HH
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace OCPI {
+  namespace Time {
+    class VcdInput;
+    class VcdMerge {
+      std::vector<VcdInput*> m_inputs;
+      unsigned m_nextSym;
+      bool m_verbose;
+      uint64_t m_bytes;
+      VcdMerge(const VcdMerge &);
+      VcdMerge &operator=(const VcdMerge &);
+    public:
+      // Open the inputs and parse their definitions and initial values.  The offsets,
+      // if any, are signed time offsets, one per input.  With "align", each input is
+      // shifted so its first timestamp is the earliest one of all inputs.
+      VcdMerge(const std::vector<std::string> &inputFiles,
+	       const std::vector<int64_t> &offsets, bool align, bool verbose = false);
+      ~VcdMerge();
+      // The total size of the inputs
+      uint64_t bytes() const { return m_bytes; }
+      // Write the merged file, returning the number of input time blocks merged
+      uint64_t merge(FILE *out);
+    };
+  }
+}
+#endif
@@ -20,13 +20,22 @@
 
 #include <ctime>
 #include <cstdio>
+#include <cstring>
 #include <cstdlib>
+#include <cmath>
 #include <memory>
 #include <algorithm>
+#include <set>
+#include <strings.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #include <fasttime.h>
 #include "TimeEmit.hh"
 #include "OsAssert.hh"
 #include "OsMisc.hh"
+#include "OsClock.hh"
 #include "OsDataTypes.hh"
 #include "BaseDataTypes.hh"
 #include <iostream>
@@ -43,6 +52,8 @@ namespace OCPI {
 
     uint32_t Emit::m_categories = 0;
     uint32_t Emit::m_sub_categories = 0;
+    __thread Emit::ThreadQ* Emit::s_threadQ = NULL;
+    bool Emit::s_shutdown = false;
 
     extern "C" {
       int OcpiTimeARegister( char* signal_name )
@@ -55,11 +66,219 @@ namespace OCPI {
       }
     }
 
+    // Continuous export of the events drained from the per-thread Qs, so that long runs
+    // can be traced with bounded memory.  Ticks are converted to nanoseconds since the
+    // stream was opened.  When the ticks are the cycle counter and OCPI::OS::Clock has a
+    // published calibration for it, that is used; otherwise the ticks are calibrated
+    // against OCPI::OS::Clock at each drain.
+    // Each thread is its own track.
+    // The JSON format is the Chrome/Perfetto trace event format.
+    // The BINARY format is the "OCPITRC1" magic followed by records in host byte order,
+    // each starting with a one byte kind, with definitions preceding their first use:
+    //   'E' event:            u16 eid, u16 owner, u32 tid, u64 nanoseconds, u64 value
+    //   'D' event definition: u16 eid, u8 etype, u8 dtype, u32 width, u16 length, name
+    //   'O' owner definition: u16 owner, u16 parent, u16 length, name
+    class Emit::Streamer {
+      FILE             *m_file;
+      bool              m_json, m_first;
+      uint64_t          m_startNs;
+      Time              m_startTicks;
+      bool              m_cycleClock; // ticks are converted by OCPI::OS::Clock
+      double            m_nsPerTick;
+      std::vector<bool> m_eventsDefined, m_ownersDefined;
+      std::vector<std::string> m_ownerNames;
+      std::set<uint32_t> m_tracks;
+      int               m_pid;
+
+      void writeJSONString( const std::string &str ) {
+	fputc( '"', m_file );
+	for ( std::string::const_iterator ci = str.begin(); ci != str.end(); ci++ ) {
+	  if ( *ci == '"' || *ci == '\\' ) {
+	    fputc( '\\', m_file );
+	  }
+	  if ( (unsigned char)*ci < ' ' ) {
+	    fprintf( m_file, "\\u%04x", (unsigned char)*ci );
+	  }
+	  else {
+	    fputc( *ci, m_file );
+	  }
+	}
+	fputc( '"', m_file );
+      }
+      void startJSON() {
+	fputs( m_first ? "\n" : ",\n", m_file );
+	m_first = false;
+      }
+      template <typename T> void put( T v ) {
+	fwrite( &v, sizeof(v), 1, m_file );
+      }
+      void putName( const std::string &name ) {
+	put( (uint16_t)name.size() );
+	fwrite( name.data(), 1, name.size(), m_file );
+      }
+      const std::string &ownerName( OwnerId owner ) {
+	if ( owner >= m_ownerNames.size() ) {
+	  m_ownerNames.resize( owner + 1u );
+	  m_ownersDefined.resize( owner + 1u );
+	}
+	if ( !m_ownersDefined[owner] ) {
+	  EmitFormatter::formatOwnerString( owner, m_ownerNames[owner], true );
+	  if ( !m_json ) {
+	    HeaderEntry &he = getHeader().classDefs[owner];
+	    put( 'O' );
+	    put( (uint16_t)owner );
+	    put( (uint16_t)he.parentIndex );
+	    putName( m_ownerNames[owner] );
+	  }
+	  m_ownersDefined[owner] = true;
+	}
+	return m_ownerNames[owner];
+      }
+      void track( uint32_t tid ) {
+	if ( m_json && m_tracks.insert( tid ).second ) {
+	  startJSON();
+	  fprintf( m_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+		   "\"args\":{\"name\":\"thread %u\"}}", m_pid, tid, tid );
+	}
+      }
+    public:
+      Streamer( const char *file, const char *format )
+	: m_file( fopen( file, "wb" ) ), m_first( true ), m_nsPerTick( 1.0 ), m_pid( getpid() ) {
+	if ( !m_file ) {
+	  std::string err("Unable to open Time::Emit stream file ");
+	  err += file;
+	  throw OU::EmbeddedException( err.c_str() );
+	}
+	if ( format && strcasecmp( format, "BINARY" ) == 0 ) {
+	  m_json = false;
+	}
+	else if ( !format || strcasecmp( format, "JSON" ) == 0 ) {
+	  m_json = true;
+	}
+	else {
+	  fclose( m_file );
+	  std::string err("Invalid Time::Emit stream format: ");
+	  err += format;
+	  throw OU::EmbeddedException( err.c_str() );
+	}
+	TimeSource &ts = *getDefaultTS();
+	m_startNs = OCPI::OS::Clock::now();
+	m_startTicks = ts.ticks( &ts );
+	uint64_t ns;
+	m_cycleClock = ts.tsc && OCPI::OS::Clock::cyclesToNs( m_startTicks, ns );
+	if ( m_cycleClock ) {
+	  m_startNs = ns;
+	}
+	setvbuf( m_file, NULL, _IOFBF, 256 * 1024 );
+	if ( m_json ) {
+	  fprintf( m_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+	  startJSON();
+	  fprintf( m_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+		   "\"args\":{\"name\":\"OpenCPI %d\"}}", m_pid, m_pid );
+	}
+	else {
+	  fwrite( "OCPITRC1", 1, 8, m_file );
+	}
+      }
+      ~Streamer() {
+	if ( m_json ) {
+	  fputs( "\n]}\n", m_file );
+	}
+	fclose( m_file );
+      }
+      void calibrate() {
+	TimeSource &ts = *getDefaultTS();
+	if ( m_cycleClock ) {
+	  return;
+	}
+	double ns = (double)(int64_t)( OCPI::OS::Clock::now() - m_startNs );
+	Time ticks = ts.ticks( &ts );
+	if ( ticks > m_startTicks && ns > 0 ) {
+	  m_nsPerTick = ns / (double)(ticks - m_startTicks);
+	}
+      }
+      // Called with the global mutex held
+      void write( const ThreadQEntry &e, uint32_t tid ) {
+	if ( e.eid >= getHeader().eventMap.size() ) {
+	  return;
+	}
+	EventMap &em = getHeader().eventMap[e.eid];
+	double ns;
+	uint64_t cns;
+	if ( m_cycleClock && OCPI::OS::Clock::cyclesToNs( e.time_ticks, cns ) ) {
+	  ns = (double)(int64_t)( cns - m_startNs );
+	}
+	else {
+	  ns = (double)(int64_t)( e.time_ticks - m_startTicks ) * m_nsPerTick;
+	}
+	if ( ns < 0 ) {
+	  ns = 0;
+	}
+	const std::string &owner = ownerName( e.owner );
+	if ( !m_json ) {
+	  if ( e.eid >= m_eventsDefined.size() ) {
+	    m_eventsDefined.resize( e.eid + 1u );
+	  }
+	  if ( !m_eventsDefined[e.eid] ) {
+	    put( 'D' );
+	    put( (uint16_t)e.eid );
+	    put( (uint8_t)em.type );
+	    put( (uint8_t)em.dtype );
+	    put( (uint32_t)em.width );
+	    putName( em.eventName );
+	    m_eventsDefined[e.eid] = true;
+	  }
+	  put( 'E' );
+	  put( (uint16_t)e.eid );
+	  put( (uint16_t)e.owner );
+	  put( tid );
+	  put( (uint64_t)ns );
+	  put( e.value );
+	  return;
+	}
+	track( tid );
+	startJSON();
+	fputs( "{\"name\":", m_file );
+	writeJSONString( em.type == Transient ? em.eventName : owner + " " + em.eventName );
+	fputs( ",\"cat\":", m_file );
+	writeJSONString( owner );
+	fprintf( m_file, ",\"ts\":%.3f,\"pid\":%d,\"tid\":%u", ns / 1000., m_pid, tid );
+	if ( em.type == Transient ) {
+	  fputs( ",\"ph\":\"i\",\"s\":\"t\"}", m_file );
+	  return;
+	}
+	// States and values are counters
+	fputs( ",\"ph\":\"C\",\"args\":{\"value\":", m_file );
+	SValue v;
+	v.uvalue = e.value;
+	switch ( em.dtype ) {
+	case DT_i:
+	  fprintf( m_file, "%" PRId64, v.ivalue );
+	  break;
+	case DT_d:
+	  if ( std::isfinite( v.dvalue ) ) {
+	    fprintf( m_file, "%.17g", v.dvalue );
+	  }
+	  else {
+	    fputs( "null", m_file );
+	  }
+	  break;
+	default:
+	  fprintf( m_file, "%" PRIu64, v.uvalue );
+	}
+	fputs( "}}", m_file );
+      }
+      void flush() {
+	fflush( m_file );
+      }
+    };
+
     void
     Emit::
     init() {
       AUTO_MUTEX(Emit::getGMutex());
       if ( getHeader().init == true ) {
+	m_useThreadQ = getHeader().threadQSize != 0;
 	return;
       }
   
@@ -101,6 +320,32 @@ namespace OCPI {
 	m_sub_categories = (unsigned)atoi(tmp);
       }
 
+      // The per-thread Qs are drained into Qs with the default per-object Q configuration
+      size_t tqSize = 4096;
+      if ( ( tmp = getenv("OCPI_TIME_EMIT_THREAD_Q_SIZE") ) != NULL ) {
+	tqSize = (size_t)atol(tmp);
+      }
+      getHeader().threadQSize = 0;
+      if ( tqSize ) {
+	for ( getHeader().threadQSize = 1; getHeader().threadQSize < tqSize; ) {
+	  getHeader().threadQSize <<= 1;
+	}
+      }
+      getHeader().threadQConfig.size = ( tmp = getenv("OCPI_TIME_EMIT_Q_SIZE") ) != NULL ?
+	(unsigned)atoi(tmp) : 50 * 1024;
+      getHeader().threadQConfig.stopWhenFull =
+	( tmp = getenv("OCPI_TIME_EMIT_Q_SWF") ) != NULL && tmp[0] == '1';
+
+      // Streaming is done from the per-thread Qs as they are drained
+      if ( ( tmp = getenv("OCPI_TIME_EMIT_STREAM") ) != NULL && *tmp ) {
+	if ( !getHeader().threadQSize ) {
+	  ocpiBad("OCPI_TIME_EMIT_STREAM requires per-thread Qs; using 4096 entries per thread");
+	  getHeader().threadQSize = 4096;
+	}
+	getHeader().streamer = new Streamer( tmp, getenv("OCPI_TIME_EMIT_STREAM_FORMAT") );
+	atexit( streamExit );
+      }
+
       // Try to open the stream now so that we can report any errors before exit
       if ( getHeader().dumpOnExit ) {
 	getHeader().dumpFileStream.open( getHeader().dumpFileName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary );
@@ -112,6 +357,7 @@ namespace OCPI {
       }
 
       getHeader().init = true;
+      m_useThreadQ = getHeader().threadQSize != 0;
     }
     
     void 
@@ -172,7 +418,7 @@ namespace OCPI {
 
     Emit::
     Emit(TimeSource &ts, const char *class_name, const char *instance_name, QConfig *config)
-      : m_parent(NULL), m_q(NULL), m_ts(NULL) {
+      : m_parent(NULL), m_q(NULL), m_ts(NULL), m_useThreadQ(false) {
       AUTO_MUTEX(Emit::getGMutex() );
       m_ts = &ts;
       pre_init( class_name, instance_name, config );
@@ -184,7 +430,7 @@ namespace OCPI {
 
     Emit::
     Emit(const char *class_name, const char *instance_name, QConfig *config)
-      : m_level(1), m_parent(NULL), m_q(NULL), m_ts(NULL) {
+      : m_level(1), m_parent(NULL), m_q(NULL), m_ts(NULL), m_useThreadQ(false) {
       AUTO_MUTEX(Emit::getGMutex() );
       m_ts = getDefaultTS();
       pre_init( class_name, instance_name, config );
@@ -229,7 +475,7 @@ namespace OCPI {
 
     Emit::
     Emit(Emit *parent, const char *class_name, const char *instance_name, QConfig *config)
-      : m_parent(parent), m_q(NULL), m_ts(NULL) {
+      : m_parent(parent), m_q(NULL), m_ts(NULL), m_useThreadQ(false) {
       AUTO_MUTEX(Emit::getGMutex());
       m_ts = getDefaultTS();
       parent_init(parent,class_name,instance_name,config,config?true:false);
@@ -238,7 +484,7 @@ namespace OCPI {
 
     Emit::
     Emit(Emit *parent, TimeSource &ts, const char *class_name, const char *instance_name, QConfig *config)
-      : m_parent(parent), m_q(NULL), m_ts(NULL) {
+      : m_parent(parent), m_q(NULL), m_ts(NULL), m_useThreadQ(false) {
       AUTO_MUTEX(Emit::getGMutex());
       init_q( config, &ts );
       parent_init(parent,class_name,instance_name,NULL,false);
@@ -268,6 +514,7 @@ namespace OCPI {
     endQue()
     {
       AUTO_MUTEX(Emit::getGMutex());
+      drain();
   
       std::vector<EventQ*>::iterator it;    
       for( it=Emit::getHeader().eventQ.begin();
@@ -367,20 +614,15 @@ namespace OCPI {
 		   EventType type,
 		   DataType dtype)
     {
-      EventId e;
       AUTO_MUTEX(Emit::getGMutex());
       // Make sure this event does not already exist
-      std::vector<EventMap>::iterator it;
-      for( it =Emit::getHeader().eventMap.begin();
-	   it != Emit::getHeader().eventMap.end();
-	   it++ ) {
-	if ( (*it).eventName == event_name ) {
-	  e = (*it).id;
-	  return e;
-	}
+      std::map<std::string, EventId>::iterator it = getHeader().eventIds.find( event_name );
+      if ( it != getHeader().eventIds.end() ) {
+	return it->second;
       }
-      e = getHeader().nextEventId++;
+      EventId e = getHeader().nextEventId++;
       Emit::getHeader().eventMap.push_back( EventMap(e,event_name,width,type,dtype) );
+      Emit::getHeader().eventIds[event_name] = e;
       return e;
     }
 
@@ -397,7 +639,7 @@ namespace OCPI {
     {
       AUTO_MUTEX(Emit::getGMutex());
       m_eid = getHeader().nextEventId++;
-      unsigned width = OU::baseTypeSizes[p.type];
+      unsigned width = OCPI::Base::baseTypeSizes[p.type];
       DataType dtype=Emit::DT_i;
       switch( p.type ){
       case OA::OCPI_Short:
@@ -445,29 +687,17 @@ namespace OCPI {
 
     };
 
+    // Events are registered in order, so the event map is indexed by EventId
     const char* EmitFormatter::getEventDescription( Emit::EventId id ) {
       AUTO_MUTEX(Emit::getGMutex());
-      std::vector<Emit::EventMap>::iterator it;
-      for ( it=m_traceable->getHeader().eventMap.begin(); 
-	    it!=m_traceable->getHeader().eventMap.end(); it++) {
-	if ( (*it).id == id ) {
-	  return (*it).eventName.c_str();
-	}
-      }
-      return NULL;
+      return id < m_traceable->getHeader().eventMap.size() ?
+	m_traceable->getHeader().eventMap[id].eventName.c_str() : NULL;
     }
 
-    static Emit::EventMap* getEventMap( Emit::EventQEntry* e ) 
+    static Emit::EventMap* getEventMap( Emit::EventId id ) 
     {
       AUTO_MUTEX(Emit::getGMutex());
-      std::vector<Emit::EventMap>::iterator it;
-      for ( it=Emit::getHeader().eventMap.begin();
-	    it != Emit::getHeader().eventMap.end(); it++ ) {
-	if ( (*it).id == e->eid ) {
-	  return &(*it);
-	}
-      }  
-      return NULL;
+      return id < Emit::getHeader().eventMap.size() ? &Emit::getHeader().eventMap[id] : NULL;
     }
 
     static inline Emit::EventQEntry* getNextEntry( Emit::EventQEntry * ce, Emit::EventQ * q )
@@ -495,9 +725,271 @@ namespace OCPI {
 
 
 
+    // Create the Q for the calling thread, starting the drain when the first one is made
+    static pthread_once_t s_threadQKeyOnce = PTHREAD_ONCE_INIT;
+    static pthread_key_t s_threadQKey;
+    static void threadQExit( void* arg ) {
+      Emit::ThreadQ *tq = static_cast<Emit::ThreadQ*>(arg);
+      if ( __atomic_sub_fetch( &tq->refs, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+	delete tq;
+      }
+    }
+    static void makeThreadQKey() {
+      pthread_key_create( &s_threadQKey, threadQExit );
+    }
+
+    Emit::ThreadQ*
+    Emit::
+    getThreadQ()
+    {
+      AUTO_MUTEX(Emit::getGMutex());
+      Header &h = getHeader();
+      s_threadQ = new ThreadQ( h.threadQSize );
+#ifdef __linux__
+      s_threadQ->tid = (uint32_t)syscall( SYS_gettid );
+#else
+      s_threadQ->tid = (uint32_t)h.threadQs.size();
+#endif
+      h.threadQs.push_back( s_threadQ );
+      pthread_once( &s_threadQKeyOnce, makeThreadQKey );
+      pthread_setspecific( s_threadQKey, s_threadQ );
+      if ( !h.drainThread ) {
+	h.draining = true;
+	h.drainThread = new OCPI::OS::ThreadManager( drainThread, NULL );
+      }
+      return s_threadQ;
+    }
+
+    // Move what the threads have recorded into the bounded Qs that are formatted,
+    // or to the stream when streaming, freeing the Qs of threads that have exited once
+    // they are empty.
+    void
+    Emit::
+    drain()
+    {
+      AUTO_MUTEX(Emit::getGMutex());
+      Header &h = getHeader();
+      size_t max = h.threadQConfig.size / (sizeof(EventQEntry) + sizeof(uint64_t));
+      if ( h.streamer ) {
+	h.streamer->calibrate();
+      }
+      for ( std::vector<ThreadQ*>::iterator it = h.threadQs.begin(); it != h.threadQs.end(); ) {
+	ThreadQ &tq = **it;
+	uint64_t head = __atomic_load_n( &tq.head, __ATOMIC_ACQUIRE );
+	for ( uint64_t t = tq.tail; t != head; t++ ) {
+	  if ( h.streamer ) {
+	    h.streamer->write( tq.ring[t & tq.mask], tq.tid );
+	    continue;
+	  }
+	  if ( tq.events.size() >= max ) {
+	    tq.full = true;
+	    if ( h.threadQConfig.stopWhenFull || !max ) {
+	      continue;
+	    }
+	    tq.events.pop_front();
+	  }
+	  tq.events.push_back( tq.ring[t & tq.mask] );
+	}
+	__atomic_store_n( &tq.tail, head, __ATOMIC_RELEASE );
+	if ( tq.dropped ) {
+	  ocpiDebug("Time::Emit thread Q %p has dropped %" PRIu64 " events", &tq, tq.dropped);
+	}
+	if ( __atomic_load_n( &tq.refs, __ATOMIC_ACQUIRE ) == 1 && tq.events.empty() ) {
+	  h.threadQsDropped += tq.dropped;
+	  delete &tq;
+	  it = h.threadQs.erase( it );
+	}
+	else {
+	  it++;
+	}
+      }
+      if ( h.streamer ) {
+	h.streamer->flush();
+      }
+    }
+
+    uint64_t
+    Emit::
+    dropped()
+    {
+      AUTO_MUTEX(Emit::getGMutex());
+      Header &h = getHeader();
+      uint64_t n = h.threadQsDropped;
+      for ( std::vector<ThreadQ*>::iterator it = h.threadQs.begin(); it != h.threadQs.end(); it++ ) {
+	n += __atomic_load_n( &(*it)->dropped, __ATOMIC_RELAXED );
+      }
+      return n;
+    }
+
+    void
+    Emit::
+    drainThread( void* )
+    {
+      while ( getHeader().draining ) {
+	drain();
+	OCPI::OS::sleep( 10 );
+      }
+    }
+
+    // Finish the stream when the process exits, whether or not shutdown() is called,
+    // so the last events are written and the JSON is complete.  Objects may still
+    // record events after this, which then stay in the Qs.
+    void
+    Emit::
+    streamExit()
+    {
+      if ( !g_header ) {
+	return;
+      }
+      AUTO_MUTEX(Emit::getGMutex());
+      Header &h = getHeader();
+      if ( h.streamer ) {
+	drain();
+	delete h.streamer;
+	h.streamer = NULL;
+      }
+    }
+
+    EmitStreamReader::
+    EmitStreamReader( const char *file )
+      : m_file( fopen( file, "rb" ) ), m_name( file ) {
+      char magic[8];
+      if ( !m_file ) {
+	bad( "cannot be opened" );
+      }
+      if ( fread( magic, 1, sizeof(magic), m_file ) != sizeof(magic) ||
+	   memcmp( magic, "OCPITRC1", sizeof(magic) ) ) {
+	fclose( m_file );
+	bad( "is not a BINARY stream" );
+      }
+    }
+
+    EmitStreamReader::
+    ~EmitStreamReader() {
+      fclose( m_file );
+    }
+
+    void
+    EmitStreamReader::
+    bad( const char *what ) {
+      std::string err("Time::Emit stream file ");
+      err += m_name;
+      err += " ";
+      err += what;
+      throw OU::EmbeddedException( err.c_str() );
+    }
+
+    template <typename T> void
+    EmitStreamReader::
+    get( T &v ) {
+      if ( fread( &v, sizeof(v), 1, m_file ) != 1 ) {
+	bad( "is truncated" );
+      }
+    }
+
+    void
+    EmitStreamReader::
+    getName( std::string &name ) {
+      uint16_t length;
+      get( length );
+      name.resize( length );
+      if ( length && fread( &name[0], 1, length, m_file ) != length ) {
+	bad( "is truncated" );
+      }
+    }
+
+    bool
+    EmitStreamReader::
+    next( Event &e ) {
+      int c;
+      while ( ( c = getc( m_file ) ) != EOF ) {
+	uint16_t id;
+	switch ( c ) {
+	case 'E':
+	  get( e.eid );
+	  get( e.owner );
+	  get( e.tid );
+	  get( e.ns );
+	  get( e.value );
+	  if ( e.eid >= m_eventsDefined.size() || !m_eventsDefined[e.eid] ||
+	       e.owner >= m_ownersDefined.size() || !m_ownersDefined[e.owner] ) {
+	    bad( "has an event before its definition" );
+	  }
+	  return true;
+	case 'D':
+	  {
+	    uint8_t type, dtype;
+	    uint32_t width;
+	    get( id );
+	    if ( id >= m_events.size() ) {
+	      m_events.resize( id + 1u );
+	      m_eventsDefined.resize( id + 1u );
+	    }
+	    EventDef &ed = m_events[id];
+	    get( type );
+	    get( dtype );
+	    get( width );
+	    getName( ed.name );
+	    if ( type > Emit::Value || dtype > Emit::DT_c ) {
+	      bad( "has an invalid event definition" );
+	    }
+	    ed.type = (Emit::EventType)type;
+	    ed.dtype = (Emit::DataType)dtype;
+	    ed.width = width;
+	    m_eventsDefined[id] = true;
+	  }
+	  break;
+	case 'O':
+	  get( id );
+	  if ( id >= m_owners.size() ) {
+	    m_owners.resize( id + 1u );
+	    m_ownersDefined.resize( id + 1u );
+	  }
+	  get( m_owners[id].parent );
+	  getName( m_owners[id].name );
+	  m_ownersDefined[id] = true;
+	  break;
+	default:
+	  bad( "has an invalid record" );
+	}
+      }
+      return false;
+    }
+
+    // Format one event in the RAW format
+    static void formatEventRAW( std::ostream& out, Emit::EventId eid, Emit::OwnerId owner,
+				Emit::Time ticks, SValue* d )
+    {
+      Emit::EventMap* emap = getEventMap( eid );
+      if ( !emap || !ticks ) {
+	return;  // This can occur on wrap
+      }
+      out << eid << "," << owner << "," << emap->dtype  << "," << ticks;
+      if ( emap->type != Emit::Transient ) {
+	switch ( emap->dtype ) {
+	case Emit::DT_u:
+	  out << "," << d->uvalue << std::endl;
+	  break;
+	case Emit::DT_i:
+	  out << "," << d->ivalue << std::endl;
+	  break;
+	case Emit::DT_c:
+	  out << "," << d->cvalue << std::endl;	  
+	  break;
+	case Emit::DT_d:
+	  out << "," << d->dvalue << std::endl;	  
+	  break;
+	}      
+      }
+      else {
+	out << ",0" << std::endl;	  
+      } 
+    }
+
     std::ostream& EmitFormatter::formatDumpToStreamRAW( std::ostream& out ) 
     {
       AUTO_MUTEX(Emit::getGMutex());
+      Emit::drain();
 
       // Now do the timed events
       for (std::vector<Emit::EventQ*>::iterator it = Emit::getHeader().eventQ.begin();
@@ -513,40 +1005,19 @@ namespace OCPI {
 	  ocpiAssert(qe >= (*it)->start &&
 		     qe < (Emit::EventQEntry *)((*it)->end) &&
 		     (uint8_t*)(qe) + sizeof(Emit::EventQEntry) + qe->size <= (*it)->end);
-
-	  Emit::EventMap* emap = getEventMap( qe );
-	  if ( !emap ) {
-	    qe = getNextEntry( qe, (*it) );
-	    continue;  // This can occur on wrap
-	  }
-	  if ( qe->time_ticks ) {
-	    out << qe->eid << "," << qe->owner << "," << emap->dtype  << "," << qe->time_ticks;
-	    //	    out << qe->eid << "," << qe->owner << "," << emap->dtype  << "," << (*it)->calcGTime( qe->time_ticks );
-	    if ( Emit::getHeader().eventMap[qe->eid].type != Emit::Transient ) {
-	      SValue* d = (SValue*)(qe + 1);
-	      switch ( emap->dtype ) {
-	      case Emit::DT_u:
-		out << "," << d->uvalue << std::endl;
-		break;
-	      case Emit::DT_i:
-		out << "," << d->ivalue << std::endl;
-		break;
-	      case Emit::DT_c:
-		out << "," << d->cvalue << std::endl;	  
-		break;
-	      case Emit::DT_d:
-		out << "," << d->dvalue << std::endl;	  
-		break;
-	      }      
-	    }
-	    else {
-	      out << ",0" << std::endl;	  
-	    } 
-	  }
+	  formatEventRAW( out, qe->eid, qe->owner, qe->time_ticks, (SValue*)(qe + 1) );
 	  qe = getNextEntry( qe, (*it) );
 	}  while( (qe!=begin) && qe->size );
       }
 
+      // Then the events recorded in the per-thread Qs
+      for (std::vector<Emit::ThreadQ*>::iterator it = Emit::getHeader().threadQs.begin();
+	   it != Emit::getHeader().threadQs.end(); it++ ) {
+	for (std::deque<Emit::ThreadQEntry>::iterator ei = (*it)->events.begin();
+	     ei != (*it)->events.end(); ei++ ) {
+	  formatEventRAW( out, ei->eid, ei->owner, ei->time_ticks, (SValue*)&ei->value );
+	}
+      }
 
       // Descriptors
       out << "<EventData>" << std::endl;
@@ -616,45 +1087,25 @@ namespace OCPI {
 
     }
 
-    struct timespec Emit::SimpleSystemTime::m_init_tv;
-    bool  Emit::SimpleSystemTime::m_init=false;
+    uint64_t Emit::SimpleSystemTime::m_initNs;
     Emit::SimpleSystemTime::
     SimpleSystemTime()
     {
-      if ( !m_init ) {
-	ticks = myTicks;
-	m_init_tv.tv_sec =0;
-	m_init_tv.tv_nsec =0;
-	clock_gettime(CLOCK_REALTIME, &m_init_tv );
-	m_init = true;
+      ticks = myTicks;
+#ifdef __x86_64__
+      tsc = true;
+#endif
+      if ( !m_initNs ) {
+	m_initNs = OCPI::OS::Clock::now();
       }
     }
 
+    // The initial time was captured from the same clock, so there is no wrap to handle
     Emit::Time 
     Emit::SimpleSystemTime::
     getTimeOfDay( )
     {
-      struct timespec tv;
-      Time t;
-      clock_gettime(CLOCK_MONOTONIC, &tv );
-#ifdef HANDLE_CLOCK_WRAP
-      static time_t delta=0;
-      if ( m_init_tv.tv_sec > tv.tv_sec ) { // we wrapped, this handles 1 edge consition only
-	time_t d = ~0;
-	delta = d - m_init_tv.tv_sec;
-      }
-      else {
-	t = ((Time) (tv.tv_sec - m_init_tv.tv_sec)) * 1000000000 +
-	  ((unsigned long)tv.tv_nsec - (unsigned long)m_init_tv.tv_nsec);
-	return t;
-      }
-      t = ((Time) (tv.tv_sec + delta)) * 1000000000 +
-	((unsigned long)tv.tv_nsec -(unsigned long) m_init_tv.tv_nsec);
-#else
-      t = ((Time) (tv.tv_sec - m_init_tv.tv_sec)) * 1000000000 +
-	(tv.tv_nsec - m_init_tv.tv_nsec);
-#endif
-      return t;  
+      return OCPI::OS::Clock::now() - m_initNs;
     }
 
 
@@ -675,6 +1126,9 @@ namespace OCPI {
       fasttime_statistics_t stats;
       struct timespec tp_fast, tp_actual;
       ticks = myTicks;
+#ifdef __x86_64__
+      tsc = true;
+#endif
 
       m_method = fasttime_init_context(NULL, 
 				       FASTTIME_METHOD_CLIENT | FASTTIME_METHOD_DAEMON);
@@ -792,37 +1246,43 @@ namespace OCPI {
       return Emit::SimpleSystemTime::getTimeOfDay();
     }
 
-    // A driver manager mostly for shutdown handling
-    class Driver : public OCPI::Base::Plugin::DriverType<Manager,Driver> {
-      Driver(const char *a_name) 
-	: OD::DriverType<Manager,Driver>(a_name, *this) {
+    // Shutdown processing, dumping if requested, after stopping the drain
+    void
+    Emit::
+    shutdown()
+    {
+      if ( !g_header ) {
+	return;
       }
-    }
-    class Manager: public OCPI::Base::Plugin::ManagerBase<Manager, Driver, time_emit> {
-      // Make sure we cleanup last since we want to allow recording of other shutdown events
-      unsigned cleanupPosition() { return 9; }
-
-      // Shutdown processing when the plugin system is shutting down
-      ~Manager() {
-	if (getHeader().dumpOnExit && !getHeader().shuttingDown) {
-	  static bool once=false;
-	  if ( ! once ) {
-	    Emit::endQue();
-	    once = true;
-	    EmitFormatter ef( Emit::getHeader().dumpFormat  );
-	    Emit::getHeader().dumpFileStream << ef;
-	  }
-	}
-	try {
-	  getHeader().shuttingDown = true;
-	  delete g_header;
-	} catch ( ... ) {
-	  // Ignore
+      __atomic_store_n( &s_shutdown, true, __ATOMIC_RELAXED );
+      if ( getHeader().drainThread ) {
+	getHeader().draining = false;
+	getHeader().drainThread->join();
+	delete getHeader().drainThread;
+	getHeader().drainThread = NULL;
+      }
+      if ( getHeader().streamer ) {
+	drain();
+	delete getHeader().streamer;
+	getHeader().streamer = NULL;
+      }
+      if (getHeader().dumpOnExit && !getHeader().shuttingDown) {
+	static bool once=false;
+	if ( ! once ) {
+	  Emit::endQue();
+	  once = true;
+	  EmitFormatter ef( Emit::getHeader().dumpFormat  );
+	  Emit::getHeader().dumpFileStream << ef;
 	}
-	g_header = NULL;
       }
+      try {
+	getHeader().shuttingDown = true;
+	delete g_header;
+      } catch ( ... ) {
+	// Ignore
+      }
+      g_header = NULL;
     }
-    static OCPI::Base::Plugin::Registration<Manager> tm;
   }
 }
 
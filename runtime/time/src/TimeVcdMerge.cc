@@ -0,0 +1,405 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include "TimeTraceFile.hh"
+#include "TimeVcdMerge.hh"
+
+namespace OCPI {
+  namespace Time {
+
+
+// Generate the next merged token, counting with "nextsym"
+static
+void
+getNextSym( char * mysym, unsigned &nextsym )
+{
+#define SYMSTART 33
+  //#define SYMEND   126
+#define SYMEND   47
+#define SYMLEN (SYMEND-SYMSTART)
+  unsigned rem=nextsym/SYMLEN;
+  unsigned mod=nextsym%SYMLEN;
+  int idx=0;
+  mysym[idx++] = (char)(SYMSTART + mod);
+  while ( rem ) {
+    nextsym++;
+    mod=nextsym%SYMLEN;
+    mysym[idx++] = (char)(SYMSTART + mod);
+    rem--;
+  }
+  nextsym++;
+  mysym[idx]=0;
+}
+
+static inline bool
+startsWith( const char *line, size_t len, const char *prefix )
+{
+  size_t n = strlen( prefix );
+  return len >= n && !strncmp( line, prefix, n );
+}
+
+static inline bool
+contains( const char *line, size_t len, const char *what )
+{
+  return std::string( line, len ).find( what ) != std::string::npos;
+}
+
+static void
+trim( const char *&line, size_t &len )
+{
+  while ( len && isspace( *line ) ) {
+    line++;
+    len--;
+  }
+  while ( len && isspace( line[len-1] ) ) {
+    len--;
+  }
+}
+
+// One input file: the definitions are parsed up front and renamed into the merged
+// name space, then the value section is read one time block at a time.
+class VcdInput {
+public:
+  VcdInput( const char *file )
+    : m_filename( file ), m_file( file ), m_offset( 0 ), m_time( 0 ),
+      m_block( NULL ), m_blockEnd( NULL ), m_pos( NULL ), m_done( false ) {}
+
+  // Parse the header, definitions and initial values, leaving m_pos at the values
+  void parse( std::set<std::string> &names, unsigned &nextSym, bool verbose ) {
+    enum { Header, Timescale, Definitions, Initial, InitialValues } state = Header;
+    const char *p = m_file.begin(), *line;
+    size_t len;
+    m_pos = NULL;
+    while ( !m_pos && m_file.nextLine( p, line, len ) ) {
+      trim( line, len );
+      switch ( state ) {
+      case Header:
+	if ( startsWith( line, len, "$timescale" ) ) {
+	  std::string rest( line + 10, len - 10 );
+	  size_t e = rest.find( "$end" );
+	  m_timescale = rest.substr( 0, e );
+	  if ( e == std::string::npos ) {
+	    state = Timescale;
+	  }
+	}
+	else if ( contains( line, len, "$scope" ) ) {
+	  state = Definitions;
+	  m_defs.push_back( std::string( line, len ) );
+	}
+	break;
+      case Timescale:
+	if ( startsWith( line, len, "$end" ) ) {
+	  state = Header;
+	}
+	else {
+	  m_timescale.append( line, len );
+	}
+	break;
+      case Definitions:
+	if ( contains( line, len, "$enddefinitions" ) ) {
+	  state = Initial;
+	}
+	else if ( contains( line, len, "$var" ) ) {
+	  char kind[80], size[80], token[80], name[256];
+	  std::string l( line, len );
+	  if ( sscanf( l.c_str(), "$var %79s %79s %79s %255s", kind, size, token, name ) != 4 ) {
+	    throw std::string( "Invalid variable definition in " ) + m_filename + ": " + l;
+	  }
+	  // If there are name collisions, correct them with a post fix
+	  std::string n( name );
+	  while ( !names.insert( n ).second ) {
+	    n += "_Mrg";
+	  }
+	  char sym[80];
+	  getNextSym( sym, nextSym );
+	  if ( verbose ) {
+	    printf( "Replacing token %s with %s in %s\n", token, sym, m_filename.c_str() );
+	  }
+	  m_tokens[token] = sym;
+	  char tmp[1024];
+	  snprintf( tmp, sizeof(tmp), "$var %s %s %s %s $end", kind, size, sym, n.c_str() );
+	  m_defs.push_back( tmp );
+	}
+	else if ( len ) {
+	  m_defs.push_back( std::string( line, len ) );
+	}
+	break;
+      case Initial:
+	// initial values are optional
+	if ( contains( line, len, "$dumpvars" ) ) {
+	  state = InitialValues;
+	}
+	else if ( len && *line == '#' ) {
+	  m_pos = line;
+	}
+	break;
+      case InitialValues:
+	if ( contains( line, len, "$end" ) ) {
+	  m_pos = p;
+	}
+	else if ( len ) {
+	  m_initValues.push_back( std::string() );
+	  replaceToken( line, len, m_initValues.back() );
+	}
+      }
+    }
+    if ( m_defs.empty() || !m_pos ) {
+      std::string err( "Invalid VCD file format " );
+      err += m_filename;
+      throw err;
+    }
+  }
+
+  // Append a value change line with its token replaced
+  void replaceToken( const char *line, size_t len, std::string &out ) const {
+    size_t vlen;
+    if ( *line == 'b' || *line == 'B' || *line == 'r' || *line == 'R' ) {
+      const char *sp = (const char *)memchr( line, ' ', len );
+      if ( !sp ) {
+	out.append( line, len );
+	return;
+      }
+      vlen = (size_t)(sp - line) + 1;
+    }
+    else {
+      vlen = 1;
+    }
+    std::string token( line + vlen, len - vlen );
+    size_t t = token.find_first_not_of( ' ' );
+    token.erase( 0, t == std::string::npos ? token.size() : t );
+    out.append( line, vlen );
+    std::map<std::string, std::string>::const_iterator it = m_tokens.find( token );
+    out += it == m_tokens.end() ? token : it->second;
+  }
+
+  // Advance to the next time block, returning false at the end of the values
+  bool next() {
+    const char *line;
+    size_t len;
+    m_block = NULL;
+    while ( !m_done && m_file.nextLine( m_pos, line, len ) ) {
+      trim( line, len );
+      if ( !len ) {
+	continue;
+      }
+      if ( contains( line, len, "$dumpoff" ) ) {
+	m_done = true;
+      }
+      else if ( *line == '#' ) {
+	if ( m_block ) {
+	  m_pos = line;  // the start of the next block
+	  break;
+	}
+	int64_t t = (int64_t)strtoull( line + 1, NULL, 10 ) + m_offset;
+	m_time = t < 0 ? 0 : (uint64_t)t;
+	m_block = m_pos;
+      }
+      m_blockEnd = m_pos;
+    }
+    if ( m_block && m_done ) {
+      m_blockEnd = m_pos;
+    }
+    return m_block != NULL;
+  }
+
+  // Write the value changes of the current block
+  void writeBlock( FILE *out, std::string &buf ) const {
+    const char *p = m_block, *line;
+    size_t len;
+    while ( p < m_blockEnd && m_file.nextLine( p, line, len ) ) {
+      trim( line, len );
+      if ( !len || *line == '#' || *line == '$' ) {
+	continue;
+      }
+      buf.clear();
+      replaceToken( line, len, buf );
+      buf += '\n';
+      fwrite( buf.data(), 1, buf.size(), out );
+    }
+  }
+
+  std::string  m_filename;
+  OCPI::Time::MappedFile m_file;
+  std::string  m_timescale;
+  std::vector<std::string> m_defs;
+  std::vector<std::string> m_initValues;
+  std::map<std::string, std::string> m_tokens;  // input token to merged token
+  int64_t      m_offset;
+  uint64_t     m_time;        // of the current block
+  const char  *m_block, *m_blockEnd;
+  const char  *m_pos;
+  bool         m_done;
+};
+
+static
+void
+formatHeader( std::vector<VcdInput*> &inputs, FILE *out )
+{
+  // Date
+  char date[80];
+  const char *fmt="%A, %B %d %Y %X";
+  struct tm* pmt;
+  time_t     raw_time;
+  time ( &raw_time );
+  pmt = gmtime( &raw_time );
+  strftime(date,80,fmt,pmt);
+  fprintf( out, "$date\n         %s\n$end\n", date );
+
+  // Version
+  fprintf( out, "$version\n            OCPI VCD Merged File Event Dumper V1.0\n$end\n" );
+
+  // Timescale, from the inputs
+  std::string ts( inputs[0]->m_timescale.empty() ? "1 us" : inputs[0]->m_timescale );
+  for ( unsigned n = 1; n < inputs.size(); n++ ) {
+    if ( inputs[n]->m_timescale != inputs[0]->m_timescale ) {
+      fprintf( stderr, "Warning: timescale of %s differs from that of %s\n",
+	       inputs[n]->m_filename.c_str(), inputs[0]->m_filename.c_str() );
+    }
+  }
+  fprintf( out, "$timescale\n          %s\n$end\n", ts.c_str() );
+
+  // Now the definitions
+  fprintf( out, "$scope module Merge $end\n" );
+  for ( unsigned n = 0; n < inputs.size(); n++ ) {
+    for ( unsigned m = 0; m < inputs[n]->m_defs.size(); m++ ) {
+      fprintf( out, "%s\n", inputs[n]->m_defs[m].c_str() );
+    }
+  }
+  fprintf( out, "$upscope $end\n$enddefinitions $end\n" );
+
+  // Initial values
+  fprintf( out, "$dumpvars\n" );
+  for ( unsigned n = 0; n < inputs.size(); n++ ) {
+    for ( unsigned m = 0; m < inputs[n]->m_initValues.size(); m++ ) {
+      fprintf( out, "%s\n", inputs[n]->m_initValues[m].c_str() );
+    }
+  }
+  fprintf( out, "$end\n\n$dumpoff\n" );
+}
+
+// Merge the time blocks of all inputs in time order.  Blocks at the same time are
+// combined, and a block earlier than what has already been written (which can happen
+// within one input) is written at the current time.
+static uint64_t
+mergeValues( std::vector<VcdInput*> &inputs, FILE *out )
+{
+  typedef std::pair<uint64_t, size_t> Entry;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+  for ( size_t n = 0; n < inputs.size(); n++ ) {
+    if ( inputs[n]->m_block ) {
+      heap.push( Entry( inputs[n]->m_time, n ) );
+    }
+  }
+  uint64_t blocks = 0, last = 0;
+  bool first = true;
+  std::string buf;
+  while ( !heap.empty() ) {
+    size_t n = heap.top().second;
+    VcdInput &in = *inputs[n];
+    heap.pop();
+    if ( first || in.m_time > last ) {
+      fprintf( out, "#%llu\n", (unsigned long long)in.m_time );
+      last = in.m_time;
+      first = false;
+    }
+    in.writeBlock( out, buf );
+    blocks++;
+    if ( in.next() ) {
+      heap.push( Entry( in.m_time, n ) );
+    }
+  }
+  fprintf( out, "$end\n" );
+  return blocks;
+}
+
+VcdMerge::
+VcdMerge( const std::vector<std::string> &inputFiles, const std::vector<int64_t> &offsets,
+	  bool align, bool verbose )
+  : m_nextSym( 0 ), m_verbose( verbose ), m_bytes( 0 )
+{
+  if ( offsets.size() && offsets.size() != inputFiles.size() ) {
+    throw std::string( "When offsets are specified there must be one for each input file" );
+  }
+  try {
+    // Open the input files, positioned at their first time block
+    std::set<std::string> names;
+    uint64_t earliest = UINT64_MAX;
+    for ( unsigned n = 0; n < inputFiles.size(); n++ ) {
+      VcdInput* p = new VcdInput( inputFiles[n].c_str() );
+      m_inputs.push_back( p );
+      p->parse( names, m_nextSym, verbose );
+      if ( offsets.size() ) {
+	p->m_offset = offsets[n];
+      }
+      if ( p->next() && p->m_time < earliest ) {
+	earliest = p->m_time;
+      }
+      m_bytes += p->m_file.size();
+    }
+    // Clock offset alignment: make each input start at the earliest time
+    if ( align ) {
+      for ( unsigned n = 0; n < m_inputs.size(); n++ ) {
+	if ( m_inputs[n]->m_block ) {
+	  int64_t delta = (int64_t)(m_inputs[n]->m_time - earliest);
+	  m_inputs[n]->m_offset -= delta;
+	  m_inputs[n]->m_time = earliest;
+	  if ( verbose ) {
+	    printf( "Aligning %s by %lld\n", m_inputs[n]->m_filename.c_str(), -(long long)delta );
+	  }
+	}
+      }
+    }
+  }
+  catch ( ... ) {
+    for ( unsigned n = 0; n < m_inputs.size(); n++ ) {
+      delete m_inputs[n];
+    }
+    throw;
+  }
+}
+
+VcdMerge::
+~VcdMerge()
+{
+  for ( unsigned n = 0; n < m_inputs.size(); n++ ) {
+    delete m_inputs[n];
+  }
+}
+
+uint64_t
+VcdMerge::
+merge( FILE *out )
+{
+  formatHeader( m_inputs, out );
+  return mergeValues( m_inputs, out );
+}
+
+  }
+}
@@ -0,0 +1,121 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Clock benchmark: the cost of reading OCPI::OS::Clock compared to the other clocks used
+ * in the runtime, and the drift of OCPI::OS::Clock relative to CLOCK_MONOTONIC_RAW.
+ * The results are meaningful for the cycle counter only when fasttimed is running.
+ */
+
+#include <inttypes.h>
+#include <cstdio>
+#include <sys/time.h>
+#include "OsClock.hh"
+#include "OsTimer.hh"
+
+#define OCPI_OPTIONS_HELP \
+  "Usage syntax is: clockBench [options]\n" \
+  "Measures the cost of reading clocks, and the drift of OCPI::OS::Clock from the system clock.\n"
+#define OCPI_OPTIONS \
+  CMD_OPTION(reads,   r, ULong, "10000000", "reads of each clock used to measure cost") \
+  CMD_OPTION(seconds, s, ULong, "10", "seconds over which drift is measured, 0 for none") \
+  CMD_OPTION(samples, n, ULong, "100", "comparisons made during the drift measurement") \
+
+#include "BaseOption.hh"
+
+namespace OC = OCPI::OS::Clock;
+
+static volatile uint64_t sink; // keep the reads from being optimized away
+
+// Report the average cost of a read, timing with the system clock
+template <typename F> static void
+cost(const char *name, F read) {
+  unsigned long n = options.reads();
+  uint64_t sum = 0, start = OC::system();
+  for (unsigned long i = 0; i < n; i++)
+    sum += read();
+  uint64_t elapsed = OC::system() - start;
+  sink = sum;
+  printf("%-32s %8.2f ns/read\n", name, n ? (double)elapsed / (double)n : 0.);
+}
+
+static uint64_t readClock() { return OC::now(); }
+static uint64_t readCycles() { return OC::cycles(); }
+static uint64_t readSystem() { return OC::system(); }
+static uint64_t readMonotonic() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_nsec;
+}
+static uint64_t readTimeOfDay() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_usec;
+}
+static uint64_t readOsTime() { return OCPI::OS::Time::now().bits(); }
+
+// Compare the clocks, attributing the system time to the middle of the two clock
+// reads around it, and keeping the tightest of a few tries.
+static int64_t
+offset() {
+  uint64_t best = UINT64_MAX;
+  int64_t result = 0;
+  for (unsigned n = 0; n < 8; n++) {
+    uint64_t before = OC::now(), sys = OC::system(), after = OC::now();
+    if (after - before < best) {
+      best = after - before;
+      result = (int64_t)(before + (after - before) / 2 - sys);
+    }
+  }
+  return result;
+}
+
+static int mymain(const char **) {
+  printf("OCPI::OS::Clock source: %s\n", OC::source());
+  cost("OCPI::OS::Clock::now", readClock);
+  cost("OCPI::OS::Clock::cycles", readCycles);
+  cost("clock_gettime(MONOTONIC_RAW)", readSystem);
+  cost("clock_gettime(MONOTONIC)", readMonotonic);
+  cost("gettimeofday", readTimeOfDay);
+  cost("OCPI::OS::Time::now", readOsTime);
+  unsigned long samples = options.samples() ? options.samples() : 1;
+  if (!options.seconds())
+    return 0;
+  uint64_t interval = options.seconds() * 1000000000ull / samples;
+  int64_t first = offset(), min = first, max = first, last = first;
+  double sum = 0;
+  uint64_t start = OC::system();
+  for (unsigned long n = 0; n < samples; n++) {
+    struct timespec ts = { (time_t)(interval / 1000000000), (long)(interval % 1000000000) };
+    nanosleep(&ts, NULL);
+    last = offset();
+    if (last < min)
+      min = last;
+    if (last > max)
+      max = last;
+    sum += (double)last;
+  }
+  uint64_t elapsed = OC::system() - start;
+  printf("offset from MONOTONIC_RAW over %.3f s: first %" PRId64 " ns, last %" PRId64
+	 " ns, min %" PRId64 " ns, max %" PRId64 " ns, mean %.1f ns\n",
+	 (double)elapsed / 1e9, first, last, min, max, sum / (double)samples);
+  printf("drift: %.3f ppm\n", (double)(last - first) * 1e6 / (double)elapsed);
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Time::Emit benchmark: the cost of recording an event, with and without a value,
+ * from one or more threads.  Events are recorded in lock-free per-thread queues unless
+ * OCPI_TIME_EMIT_THREAD_Q_SIZE is 0, when they go directly into the per-object queue
+ * under its mutex.  The time includes reading the clock.  Unless that variable is set,
+ * each thread's queue holds all the events of a pass, so no event is dropped while
+ * being timed.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "OsClock.hh"
+#include "OsThreadManager.hh"
+#include "TimeEmit.hh"
+
+#define OCPI_OPTIONS_HELP \
+  "Usage syntax is: emitBench [options]\n" \
+  "Measures the cost of recording Time::Emit events.\n"
+#define OCPI_OPTIONS \
+  CMD_OPTION(events,  e, ULong, "100000", "events recorded by each thread for each kind") \
+  CMD_OPTION(threads, t, ULong, "1", "threads recording events concurrently") \
+
+#include "BaseOption.hh"
+
+namespace OC = OCPI::OS::Clock;
+namespace OT = OCPI::Time;
+
+#ifdef OCPI_TIME_EMIT_SUPPORT
+struct BenchObject : public OT::Emit {
+  BenchObject(unsigned n) : OT::Emit("BenchObject", n ? "other" : "first") {}
+};
+
+struct Run {
+  BenchObject *object;
+  unsigned long events;
+  uint64_t plainNs, valueNs;
+};
+
+static void
+runThread(void *arg) {
+  Run &r = *static_cast<Run *>(arg);
+  static OT::Emit::RegisterEvent
+    plain("benchPlain"),
+    value("benchValue", 64, OT::Emit::Value, OT::Emit::DT_u);
+  // The first pass creates this thread's queue and warms up, and only the second is kept
+  for (unsigned pass = 0; pass < 2; pass++) {
+    uint64_t start = OC::now();
+    for (unsigned long n = 0; n < r.events; n++)
+      r.object->emit(plain);
+    uint64_t middle = OC::now();
+    for (unsigned long n = 0; n < r.events; n++)
+      r.object->emit(value, (uint64_t)n);
+    uint64_t end = OC::now();
+    r.plainNs = middle - start;
+    r.valueNs = end - middle;
+    OT::Emit::drain(); // empty the queue outside the timing
+  }
+}
+
+static int mymain(const char **) {
+  unsigned long nThreads = options.threads() ? options.threads() : 1;
+  unsigned long nEvents = options.events();
+  const char *env = getenv("OCPI_TIME_EMIT_THREAD_Q_SIZE");
+  char size[32];
+  if (!env) {
+    snprintf(size, sizeof(size), "%lu", 2 * nEvents);
+    setenv("OCPI_TIME_EMIT_THREAD_Q_SIZE", size, 1);
+  }
+  std::vector<BenchObject *> objects;
+  std::vector<Run> runs(nThreads);
+  for (unsigned n = 0; n < nThreads; n++) {
+    objects.push_back(new BenchObject(n));
+    runs[n].object = objects.back();
+    runs[n].events = nEvents;
+  }
+  printf("recording into %s, clock source %s\n",
+	 env && !atol(env) ? "per-object queues (mutex)" : "per-thread queues", OC::source());
+  std::vector<OCPI::OS::ThreadManager *> threads;
+  for (unsigned n = 0; n < nThreads; n++)
+    threads.push_back(new OCPI::OS::ThreadManager(runThread, &runs[n]));
+  for (unsigned n = 0; n < nThreads; n++) {
+    threads[n]->join();
+    delete threads[n];
+  }
+  uint64_t plainNs = 0, valueNs = 0;
+  for (unsigned n = 0; n < nThreads; n++) {
+    plainNs += runs[n].plainNs;
+    valueNs += runs[n].valueNs;
+  }
+  double events = (double)nEvents * (double)nThreads;
+  printf("%lu threads, %lu events each\n", nThreads, nEvents);
+  printf("%-24s %8.2f ns/event\n", "emit(event)", nEvents ? (double)plainNs / events : 0.);
+  printf("%-24s %8.2f ns/event\n", "emit(event, value)", nEvents ? (double)valueNs / events : 0.);
+  printf("%-24s %8" PRIu64 "\n", "events dropped", OT::Emit::dropped());
+  uint64_t start = OC::now();
+  OT::Emit::shutdown();
+  printf("%-24s %8.2f ms\n", "shutdown", (double)(OC::now() - start) / 1e6);
+  for (unsigned n = 0; n < nThreads; n++)
+    delete objects[n];
+  return 0;
+}
+#else
+static int mymain(const char **) {
+  fprintf(stderr, "Time::Emit support (OCPI_TIME_EMIT_SUPPORT) is not enabled in this build\n");
+  return 1;
+}
+#endif
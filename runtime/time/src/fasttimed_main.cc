@@ -40,10 +40,14 @@
 #include <sys/ipc.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <string>
 
 #include "fasttime_private.h"
 #include "calibration.h"
 #include "OsAssert.hh"
+#include "OsClock.hh"
+
+namespace OC = OCPI::OS::Clock;
 
 static fasttime_buffers_t *ft_storage;
 static volatile int shutdown_flag;
@@ -199,6 +203,14 @@ int main(int argc, char **argv)
     ft_storage->ready_time = calibrate_get_ready_time();
     calibrate_init();
 
+    /* Also publish the calibration used by OCPI::OS::Clock, if the counter allows */
+    OC::Publisher *publisher = NULL;
+    try {
+        publisher = new OC::Publisher();
+    } catch (std::string &err) {
+        fprintf(stderr, "Not publishing the clock calibration: %s\n", err.c_str());
+    }
+
     /* Calibration loop */
     for (;;)
     {
@@ -216,7 +228,20 @@ int main(int argc, char **argv)
 
         /* Switch to the new buffer */
         atomic_inc(&ft_storage->buffer_idx);
+
+        if (publisher)
+        {
+            publisher->update();
+            if (debug_calibrate)
+            {
+                const OC::Calibration &c = publisher->calibration();
+                printf("clock: %llu Hz, error %lld ns over %llu ns\n",
+                       (unsigned long long)c.hz, (long long)c.errorNs,
+                       (unsigned long long)c.intervalNs);
+            }
+        }
     }
+    delete publisher;
 
     /* Shutdown; free shared segment */
     for (i = 0; i < FASTTIME_BUFFERS; i++)
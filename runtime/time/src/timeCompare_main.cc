@@ -30,9 +30,10 @@
 
 
 #include <iostream>
-#include <fstream>
+#include <cstdio>
 #include <math.h>
 #include "UtilCommandLineConfiguration.hh"
+#include "TimeTraceFile.hh"
 
 class OcpiConfigurator
   : public OCPI::Util::CommandLineConfiguration
@@ -97,6 +98,40 @@ printUsage (OcpiConfigurator & a_config,
   a_config.printOptions (std::cout);
 }
 
+// Average the "Worker Run" values in a RAW time file, which is memory mapped and
+// scanned a line at a time so that large files use constant memory
+static double
+averageRunTime( const char *file )
+{
+  OCPI::Time::MappedFile in( file );
+  const char *p = in.begin(), *l;
+  size_t len;
+  char line[1024];
+  double d = 0;
+  int c = 0;
+  while ( in.nextLine( p, l, len ) ) {
+    if ( len >= sizeof(line) ) {
+      len = sizeof(line) - 1;
+    }
+    memcpy( line, l, len );
+    line[len] = 0;
+    if ( config.verbose ) {
+      std::cout << line << std::endl;
+    }
+    //3,237631318,1,0,Worker:fr_test_data:1,"Worker Run",142773
+    long long v;
+    if ( sscanf( line, "%*d,%*d,%*d,%*d,Worker:unit_test:%*d,\"Worker Run\",%lld", &v ) != 1 ) {
+      break;
+    }
+    if ( config.verbose ) {
+      std::cout << "v = " << v << std::endl;
+    }
+    d += (double)v;
+    c++;
+  }
+  return d/c;
+}
+
 int main( int argc, char** argv )
 {
 
@@ -124,66 +159,15 @@ int main( int argc, char** argv )
     return 1;
   }
 
-  std::ifstream * tfin = new std::ifstream;
-  try {
-    tfin->open( config.tf.c_str() );
-  }
-  catch( std::string & oops ) {
-    std::cerr << "Unable to open file " << config.tf << " Error = " << oops << std::endl;
-  }
-  catch( ...) {
-    std::cerr << "Unable to open file " << config.tf << " Unknown error" << std::endl;
-  }
-  if ( tfin->fail() ) {
-    throw std::string("Could not open input file");
-  }
-
-  std::ifstream * efin = new std::ifstream;
+  double Ravg, Eavg;
   try {
-    efin->open( config.ef.c_str() );
+    Ravg = averageRunTime( config.tf.c_str() );
+    Eavg = averageRunTime( config.ef.c_str() );
   }
   catch( std::string & oops ) {
-    std::cerr << "Unable to open file " << config.ef << " Error = " << oops << std::endl;
-  }
-  catch( ...) {
-    std::cerr << "Unable to open file " << config.ef << " Unknown error" << std::endl;
-  }
-  if ( efin->fail() ) {
-    throw std::string("Could not open input file");
-  }
-
-  char line[1024];
-  double d=0;
-  int c = 0;
-  while ( ! tfin->eof() ) {
-    tfin->getline( line, 1024 );
-    std::cout << line << std::endl;
-    
-    //3,237631318,1,0,Worker:fr_test_data:1,"Worker Run",142773
-    long long v;
-    if ( sscanf( line, "%*d,%*d,%*d,%*d,Worker:unit_test:%*d,\"Worker Run\",%lld", &v ) != 1 ) {
-      break;
-    }
-    std::cout << "v = " << v << std::endl;
-    d += (double)v;
-    c++;
-  }
-  double Ravg = d/c;
-
-  d = 0;
-  c = 0;
-  while ( ! efin->eof() ) {
-    efin->getline( line, 1024 );
-    std::cout << line << std::endl;
-    long long v;
-    if ( sscanf( line, "%*d,%*d,%*d,%*d,Worker:unit_test:%*d,\"Worker Run\",%lld", &v ) != 1 ) {
-      break;
-    }
-    std::cout << "v = " << v << std::endl;
-    d += (double)v;
-    c++;
+    std::cerr << oops << std::endl;
+    return 1;
   }
-  double Eavg = d/c;
 
   double delta = fabs( Ravg - Eavg );
   std::cout << "Expected Average Runtime = " << Eavg << " Calculated Average runtime = " << Ravg << " Delta = " << delta << std::endl;
@@ -201,9 +185,5 @@ int main( int argc, char** argv )
   }
   std::cout << std::endl;
 
-  tfin->close();
-  delete tfin;
-  efin->close();
-  delete efin;
   return ret;
 }
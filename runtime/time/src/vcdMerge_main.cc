@@ -18,18 +18,22 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <ctime>
+// Merge VCD files from several processes into one: see TimeVcdMerge.hh
+
 #include <cstdio>
-#include <sstream>
 #include <cstdlib>
+#include <cerrno>
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <cstring>
 #include <vector>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
 #include "UtilCommandLineConfiguration.hh"
 #include "OsAssert.hh"
+#include "TimeVcdMerge.hh"
 
 class OcpiRccBinderConfigurator
   : public OCPI::Util::CommandLineConfiguration
@@ -40,7 +44,10 @@ public:
 public:
   bool          help;
   bool          verbose;
+  bool          align;
+  unsigned long synthetic;
   MultiString   inputFiles;
+  MultiString   offsets;
   std::string   outputFile;
 
 private:
@@ -54,7 +61,9 @@ OcpiRccBinderConfigurator::
 OcpiRccBinderConfigurator ()
   : OCPI::Util::CommandLineConfiguration (g_options),
     help (false),
-    verbose (false)
+    verbose (false),
+    align (false),
+    synthetic (0)
 {
 }
 
@@ -69,6 +78,18 @@ OcpiRccBinderConfigurator::g_options[] = {
     "outputFile", "Output File",
     OCPI_CLC_OPT(&OcpiRccBinderConfigurator::outputFile), 0 },
 
+  { OCPI::Util::CommandLineConfiguration::OptionType::MULTISTRING,
+    "offsets", "Signed time offset added to each input file, in input order",
+    OCPI_CLC_OPT(&OcpiRccBinderConfigurator::offsets), 0 },
+
+  { OCPI::Util::CommandLineConfiguration::OptionType::BOOLEAN,
+    "align", "Align the first timestamp of each input to the earliest",
+    OCPI_CLC_OPT(&OcpiRccBinderConfigurator::align), 0 },
+
+  { OCPI::Util::CommandLineConfiguration::OptionType::UNSIGNEDLONG,
+    "synthetic", "Benchmark: first create each input file, with this many time steps",
+    OCPI_CLC_OPT(&OcpiRccBinderConfigurator::synthetic), 0 },
+
   { OCPI::Util::CommandLineConfiguration::OptionType::BOOLEAN,
     "verbose", "Be verbose",
     OCPI_CLC_OPT(&OcpiRccBinderConfigurator::verbose), 0 },
@@ -90,423 +111,66 @@ printUsage (OcpiRccBinderConfigurator & a_config,
   a_config.printOptions (std::cout);
 }
 
-
-static
-void
-getNextSym( char * mysym )
+// Write a synthetic trace for benchmarking, in the form written by Time::Emit.
+// The file must not already exist, so that real traces are never overwritten.
+static void
+writeSynthetic( const char *file, unsigned long steps, unsigned seed )
 {
-#define SYMSTART 33
-  //#define SYMEND   126
-#define SYMEND   47
-#define SYMLEN (SYMEND-SYMSTART)
-  static int init=false;
-  static char syms[SYMLEN];
-  static int nextsym=0;
-  if ( ! init ) {
-    init = true;
-    for ( int n=0; n<SYMLEN; n++ ) {
-      syms[n] = (char)(SYMSTART + n);
+  int fd = open( file, O_WRONLY | O_CREAT | O_EXCL, 0666 );
+  FILE *f = fd < 0 ? NULL : fdopen( fd, "w" );
+  if ( !f ) {
+    std::string err( "Unable to create synthetic input file " );
+    err += file;
+    err += ": ";
+    err += strerror( errno );
+    if ( errno == EEXIST ) {
+      err += " (--synthetic will not overwrite existing files)";
     }
-  }
-
-  int rem=nextsym/SYMLEN;
-  int mod=nextsym%SYMLEN;
-  int idx=0;
-  mysym[idx++] = syms[mod];
-  while ( rem ) {
-    nextsym++;
-    mod=nextsym%SYMLEN;
-    mysym[idx++] = syms[mod];
-    rem--;
-  }
-  nextsym++;
-  mysym[idx]=0;
-}
-
-void
-testSyms()
-{
-  for ( int n=0; n<1024; n++ ) {
-    char syms[80];
-    getNextSym(syms);
-    printf("Next sym = %s\n", syms );
-  }
-}
-
-struct VCDBase {
-  VCDBase( std::string& value ):m_value(value){}
-  virtual std::string& toString(){return m_value;};
-  std::string m_value;
-  virtual ~VCDBase(){}
-};
-
-
-enum VCDType { VariableT, TagT, TimeT, Opaque2PartT, JunkT };
-struct VCDValue :  public VCDBase {
-  VCDValue ( std::string& v )
-    :VCDBase(v),type(JunkT){parse();}
-  void parse() {
-    int c;
-    for (size_t n = 0; n < m_value.size(); n++) {
-      if ( isspace( m_value[n] ) ) {
-        continue;
-      }
-      else if ( m_value[n] == '#' ) {
-        type = TimeT;
-        //        printf("MV = %s\n", m_value.c_str() );
-        if ( (c=sscanf( m_value.c_str(),"#%llu", (long long unsigned*)&time)) != 1 ) {
-          printf("c = %d\n",c);
-          throw std::string("Could not parse value (%s)\n", m_value.c_str() );
-        }
-        break;
-      }
-      else if ( m_value[n] == '$' ) {
-        type = TagT;
-        break;
-      }
-      else if ( (m_value[n]>=48) && (m_value[n]<=57) ) {
-        type = VariableT;
-        // Format 01010token
-        std::string t;
-        size_t nn;
-        for (nn = m_value.length(); nn;) {
-	  --nn;
-          if ( (m_value[nn]>=48) && (m_value[nn]<=57) ) {
-            memcpy(token,t.c_str(),t.length());
-            token[t.length()]=0;
-            break;
-          }
-          if ( ! isspace( m_value[nn] )) {
-            t += m_value[nn];
-          }
-        }
-        memcpy(value, m_value.c_str(), nn+1);
-
-        // can fail on $end, ok
-        //        sscanf( m_value.c_str(),"%s %s",value, token);
-        break;
-      }
-      else if ( m_value[n] == 'b' ) {
-        type = Opaque2PartT;
-        sscanf( m_value.c_str(),"%s %s",value, token);
-        break;
-      }
+    if ( fd >= 0 ) {
+      close( fd );
     }
+    throw err;
   }
-
-  virtual std::string& toString()
-  {
-    if ( type == VariableT) {
-      char tmp[1024];
-      sprintf(tmp,"%s%s\n",value, token );
-      m_value = tmp;
-    }
-    else if ( type == Opaque2PartT ) {
-      char tmp[1024];
-      sprintf(tmp,"%s %s\n",value, token );
-      m_value = tmp;
-    }
-    return m_value;
+  const unsigned nVars = 8;
+  fprintf( f, "$date\n         synthetic\n$end\n$version\n            OCPI VCD Software Event Dumper V1.0\n"
+	   "$end\n$timescale\n          1 ns\n$end\n$scope module Software $end\n" );
+  for ( unsigned v = 0; v < nVars; v++ ) {
+    fprintf( f, "$var %s %u v%u signal_%u $end\n", v & 1 ? "reg" : "wire", v & 1 ? 64 : 1, v, v );
   }
-
-  virtual ~VCDValue(){};
-
-  VCDType type;
-  char token[80];
-  char value[128];
-  uint64_t time;
-};
-
-
-struct VCDValDef : public VCDBase {
-  VCDValDef( std::string& v )
-    :VCDBase(v),type(TagT){parse();}
-
-  void parse() {
-
-    if ( m_value.find("$var") != std::string::npos ) {
-      type = VariableT;
-      char n[256];
-      sscanf( m_value.c_str(),"$var %s %s %s %s", kind,size,token,n);
-      name = n;
-      getNextSym( n );
-      printf("Replacing token %s with %s\n", token, n );
-      old_token = token;
-      strcpy( token, n );
-    }
+  fprintf( f, "$upscope $end\n$enddefinitions $end\n$dumpvars\n" );
+  for ( unsigned v = 0; v < nVars; v++ ) {
+    fprintf( f, v & 1 ? "b0 v%u\n" : "0v%u\n", v );
   }
-
-  virtual std::string& toString()
-  {
-    if ( type == VariableT ) {
-      char tmp[1024];
-      sprintf(tmp,"$var %s %s %s %s $end\n", kind, size, token, name.c_str() );
-      m_value = tmp;
-    }
-    return m_value;
-  }
-
-  virtual ~VCDValDef(){};
-
-  VCDType type;
-  char  kind[80];
-  char  size[80];
-  char  token[80];
-  std::string  old_token;
-  std::string  name;
-
-};
-
-
-void replaceTokens( std::vector<VCDValue> & values, std::vector<VCDValDef> & defs )
-{
-  std::vector<VCDValue>::iterator vit;
-  std::vector<VCDValDef>::iterator dit;
-  for ( vit=values.begin(); vit!=values.end(); vit++) {
-    for ( dit=defs.begin(); dit!=defs.end(); dit++) {
-      if ( (*vit).token == (*dit).old_token ) {
-        strcpy( (*vit).token, (*dit).token );
-        break;
+  fprintf( f, "$end\n" );
+  uint64_t t = seed;
+  srand( seed );
+  for ( unsigned long s = 0; s < steps; s++ ) {
+    t += 1 + (uint64_t)(rand() % 1000);
+    unsigned v = (unsigned)rand() % nVars;
+    if ( v & 1 ) {
+      fprintf( f, "\n#%llu\nb", (unsigned long long)t );
+      for ( unsigned b = 0; b < 64; b++ ) {
+	fputc( (rand() & 1) + '0', f );
       }
+      fprintf( f, " v%u\n", v );
     }
-  }
-}
-
-
-class VcdParser {
-public:
-
-  VcdParser( const char* file )
-    :m_filename(file)
-  {
-    m_file.open( file, std::ios::in );
-    if ( ! m_file.is_open() ) {
-      std::string err("Unable to open input file: ");
-      err += file;
-      throw err;
+    else {
+      fprintf( f, "\n#%llu\n1v%u\n#%llu\n0v%u\n", (unsigned long long)t, v,
+	       (unsigned long long)t + 1, v );
     }
-    parse();
   }
+  fprintf( f, "\n$dumpoff\n$end\n" );
+  fclose( f );
+}
 
-  void parse() {
-    bool done;
-    std::string line;
-
-    // Header
-    done = false;
-    while ( ! done &&  ! m_file.eof() ) {
-      getline(  m_file, line );
-      printf("%s\n", line.c_str() );
-      if ( line.find("$timescale") != std::string::npos ) {
-        printf("Found the timescale !!");
-      }
-      if ( line.find("$scope") != std::string::npos ) {
-        done = true;
-      }
-      else {
-        header += line + "\n";
-      }
-    }
-    printf("Header = %s\n", header.c_str() );
-
-    // Definitions
-    val_defs.push_back(VCDValDef(line));
-    done = false;
-    while ( ! done &&  ! m_file.eof() ) {
-      getline( m_file, line );
-      printf("%s\n", line.c_str() );
-      if ( ( line.find("$enddefinitions" ) != std::string::npos ) ) {
-        done = true;
-      }
-      else {
-        val_defs.push_back(VCDValDef(line));
-      }
-    }
-
-
-    // initial values (optional)
-    done = false;
-    bool ivfound=false;
-    while ( ! done &&  ! m_file.eof() ) {
-      getline( m_file, line );
-      printf("%s\n", line.c_str() );
-      if ( ( line.find("$dumpvars" ) != std::string::npos ) ) {
-        ivfound = true;
-        done = true;
-      }
-    }
-    if ( ivfound ) {
-      done = false;
-      while ( ! done &&  ! m_file.eof() ) {
-        getline( m_file, line );
-        printf("%s\n", line.c_str() );
-        if ( ( line.find("$end" ) != std::string::npos ) ) {
-          done = true;
-        }
-        else {
-          init_values.push_back(VCDValue(line) );
-        }
-      }
-    }
-    replaceTokens( init_values, val_defs );
-
-
-    // values
-    done = false;
-    while ( ! done &&  ! m_file.eof() ) {
-      getline( m_file, line );
-      printf("%s\n", line.c_str() );
-      if ( ( line.find("$dumpoff" ) != std::string::npos ) ) {
-        done = true;
-      }
-      else {
-        VCDValue v(line);
-        if ( v.type == TimeT ) {
-          std::vector<VCDValue> vv;
-          vv.push_back(v);
-          time.push_back( vv );
-        }
-        else if ( v.type != JunkT ) {
-          time.back().push_back( v );
-        }
-      }
-    }
-    for (unsigned n = 0; n < time.size(); n++)
-      replaceTokens(time[n], val_defs);
-
-    if ( header.empty() ||
-         val_defs.empty() ||
-         time.empty() ) {
-      std::string err("Invalid VCD file format ");
-      err += m_filename;
-      throw err;
-    }
-  }
-
-
-
-  void merge( VcdParser* p )
-  {
-    unsigned int n,m;
-    // If there are name collisions, correct them with a post fix
-    for( n=0; n<val_defs.size(); n++ ) {
-      for(  m=0; m<p->val_defs.size(); m++ ) {
-        if ( val_defs[n].type == VariableT ) {
-          if ( val_defs[n].name == p->val_defs[m].name ) {
-            p->val_defs[m].name += "_Mrg";
-          }
-        }
-      }
-    }
-    for(  m=0; m<p->val_defs.size(); m++ ) {
-      val_defs.push_back( p->val_defs[m] );
-    }
-
-    //DEBUG, REMOVE
-    for(  m=0; m<val_defs.size(); m++ ) {
-      printf( "Var name = %s\n", val_defs[m].name.c_str() );
-    }
-
-
-
-    for(  m=0; m<p->init_values.size(); m++ ) {
-      init_values.push_back( p->init_values[m] );
-    }
-    std::vector< std::vector<VCDValue> >::iterator t;
-    std::vector< std::vector<VCDValue> >::iterator ts;
-    for( t=p->time.begin(); t!=p->time.end(); t++ ) {
-      bool inserted=false;
-      for( ts=time.begin(); ts!=time.end(); ts++ ) {
-        if ( (*t).begin()[0].time < (*ts).begin()[0].time ) {
-          time.insert( ts, (*t) );
-          inserted = true;
-          break;
-        }
-        else if ( (*t).begin()[0].time == (*ts).begin()[0].time ) {
-          for (unsigned int u=1; u<(*t).size(); u++ ) {
-            (*ts).push_back( (*t)[u] );
-          }
-          inserted = true;
-          break;
-        }
-      }
-      if ( ! inserted ) {
-        time.push_back( (*t) );
-      }
-    }
-
-  }
-
-  std::string  m_filename;
-  int          time_scale;
-  std::string  header;
-  std::vector<VCDValDef>  val_defs;
-  std::vector<VCDValue>   init_values;
-  std::vector< std::vector<VCDValue> > time;
-  std::fstream m_file;
-};
-
-
-
-
-static
-void
-formatOutput(  VcdParser * parser, std::fstream & out )
+static double
+now()
 {
-  unsigned int n;
-
-  // Date
-  char date[80];
-  const char *fmt="%A, %B %d %Y %X";
-  struct tm* pmt;
-  time_t     raw_time;
-  time ( &raw_time );
-  pmt = gmtime( &raw_time );
-  strftime(date,80,fmt,pmt);
-  out << "$date" << std::endl;
-  out << "         " << date << std::endl;
-  out << "$end" << std::endl;
-
-  // Version
-  out << "$version" << std::endl;
-  out << "            OCPI VCD Merged File Event Dumper V1.0" << std::endl;
-  out << "$end" << std::endl;
-
-  // Timescale
-  out << "$timescale" << std::endl;
-  out << "          1 us" << std::endl;
-  out << "$end" << std::endl;
-
-  // Now the definitions
-  out << "$scope module Merge $end" << std::endl;
-  for ( n=0; n<parser->val_defs.size(); n++ ) {
-    out << parser->val_defs[n].toString() << std::endl;
-  }
-  out << "$upscope $end" << std::endl;
-  out << "$enddefinitions $end" << std::endl;
-
-  // Initial values
-  out << "$dumpvars" << std::endl;
-  for ( n=0; n<parser->init_values.size(); n++ ) {
-    out << parser->init_values[n].toString() << std::endl;
-  }
-  out << "$end" << std::endl;
-
-  // Time values
-  out << std::endl << "$dumpoff" << std::endl;
-
-  std::vector< std::vector<VCDValue> >::iterator t;
-  for( t=parser->time.begin(); t!=parser->time.end(); t++ ) {
-    for ( unsigned int m=0; m<(*t).size(); m++ ) {
-      out << (*t)[m].toString() << std::endl;
-    }
-  }
-  out << "$end" << std::endl;
-
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
 }
 
-
-
 int main( int argc, char ** argv )
 {
 
@@ -531,6 +195,11 @@ int main( int argc, char ** argv )
     printUsage (config, argv[0]);
     return -1;
   }
+  if ( config.offsets.size() && config.offsets.size() != config.inputFiles.size() ) {
+    printf("When offsets are specified there must be one for each input file\n");
+    printUsage (config, argv[0]);
+    return -1;
+  }
   if ( config.verbose ) {
     printf("Processing Input files:\n");
     std::vector<std::string>::iterator it;
@@ -540,36 +209,51 @@ int main( int argc, char ** argv )
     printf("Output file = %s\n", config.outputFile.c_str() );
   }
 
-  // Open the output file
-  std::fstream outfile;
-  outfile.open( config.outputFile.c_str(), std::ios::out | std::ios::trunc );
-  if ( ! outfile.is_open() ) {
-    std::string err("Unable to open Time::Emit dump file ");
-    err += config.outputFile.c_str();
-    fprintf( stderr, "%s\n", err.c_str());
-    return -1;
-  }
-
-  // Now the input files
-  std::vector<VcdParser*> parsers;
-  std::vector<std::string>::iterator it;
   try {
-    for ( it=config.inputFiles.begin(); it != config.inputFiles.end(); it++ ) {
-      VcdParser* p = new VcdParser( (*it).c_str() );
-      parsers.push_back( p );
+    if ( config.synthetic ) {
+      for ( unsigned n = 0; n < config.inputFiles.size(); n++ ) {
+	writeSynthetic( config.inputFiles[n].c_str(), config.synthetic, n + 1 );
+      }
+    }
+    double start = now();
+
+    // Open the output file
+    FILE *out = fopen( config.outputFile.c_str(), "w" );
+    if ( !out ) {
+      std::string err("Unable to open VCD output file ");
+      err += config.outputFile.c_str();
+      throw err;
+    }
+    setvbuf( out, NULL, _IOFBF, 1024 * 1024 );
+
+    // Now the input files, then the actual merge
+    std::vector<int64_t> offsets;
+    for ( unsigned n = 0; n < config.offsets.size(); n++ ) {
+      offsets.push_back( strtoll( config.offsets[n].c_str(), NULL, 0 ) );
+    }
+    uint64_t bytes, blocks;
+    try {
+      OCPI::Time::VcdMerge merge( config.inputFiles, offsets, config.align, config.verbose );
+      bytes = merge.bytes();
+      blocks = merge.merge( out );
+    }
+    catch ( ... ) {
+      fclose( out );
+      throw;
+    }
+    if ( fclose( out ) ) {
+      throw std::string( "Error writing VCD output file " ) + config.outputFile;
+    }
+    double elapsed = now() - start;
+    if ( config.verbose || config.synthetic ) {
+      printf( "Merged %zu files, %llu bytes, %llu time steps in %.3f s (%.1f MB/s)\n",
+	      config.inputFiles.size(), (unsigned long long)bytes, (unsigned long long)blocks,
+	      elapsed, elapsed > 0 ? (double)bytes / elapsed / 1e6 : 0. );
     }
   }
   catch( std::string & err ) {
     fprintf( stderr, "%s\n", err.c_str());
     return -1;
   }
-
-  // Do the actual merge
-  std::vector<VcdParser*>::iterator mpit=parsers.begin();
-  std::vector<VcdParser*>::iterator pit = mpit + 1;
-  for ( ; pit!=parsers.end(); pit++ ) {
-    (*mpit)->merge(*pit);
-  }
-  formatOutput( (*mpit), outfile );
-
+  return 0;
 }
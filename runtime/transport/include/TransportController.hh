@@ -60,6 +60,7 @@ protected:
   unsigned  m_nextTid;  // Next input temporal id
   bool      m_zcopyEnabled;
   bool      m_isWholeOutputSet;
+  bool      m_eagerTemplates; // create all output templates at init rather than on first use
 
 public:
   Controller(PortSet &output, PortSet &input);
@@ -68,33 +69,52 @@ public:
   //================================================================================
   // Setup methods
   void init(); // must be called after constructor returns
-  std::vector<Transfer *> &getTransfers(unsigned outPort, unsigned outBuffer, unsigned inPort, unsigned inBuffer,
-					bool broadcast, TransferType inout) {
+  // The template slot for the given port and buffer combination.
+  // The vectors of slots are sized when first used.
+  Transfer *&getTransfer(unsigned outPort, unsigned outBuffer, unsigned inPort, unsigned inBuffer,
+			 bool broadcast, TransferType inout) {
     (void)outBuffer;(void)inBuffer;
     assert(outPort < m_output.getPortCount() && inPort < m_input.getPortCount() &&
 	   outBuffer < m_output.getBufferCount() && inBuffer < m_input.getBufferCount());
     auto &out2in = m_inPort2outPort[outPort * m_input.getPortCount() + inPort];
-    return broadcast ?
+    std::vector<Transfer *> &transfers = broadcast ?
       (inout == OUTPUT ? out2in.m_outputBroadcastTransfers : out2in.m_inputBroadcastTransfers) :
       (inout == OUTPUT ? out2in.m_outputTransfers : out2in.m_inputTransfers);
+    if (transfers.empty())
+      transfers.resize(m_output.getBufferCount() * m_input.getBufferCount(), NULL);
+    return transfers[outBuffer * m_input.getBufferCount() + inBuffer];
   }
+  // Report the number of templates, their transfer requests and zero-copies, and the
+  // bytes used by templates, not including the transfer requests themselves.
+  void templateStats(size_t &nTemplates, size_t &nRequests, size_t &nZeroCopies,
+		     size_t &nBytes) const;
 protected:
+  // Templates are created when first used, unless created by createOutputTransfers
   inline Transfer &
   getTemplate(unsigned outPort, unsigned outBuffer, unsigned inPort, unsigned inBuffer,
 	      bool broadcast, TransferType inout) {
-    return
-      *getTransfers(outPort, outBuffer, inPort, inBuffer, broadcast, inout)
-      [outBuffer * m_input.getBufferCount() + inBuffer];
+    Transfer *&temp = getTransfer(outPort, outBuffer, inPort, inBuffer, broadcast, inout);
+    if (!temp)
+      createTemplate(outPort, outBuffer, inPort, inBuffer, broadcast, inout);
+    assert(temp);
+    return *temp;
   }
   inline void
   setTemplate(Transfer &temp, unsigned outPort, unsigned outBuffer, unsigned inPort,
 	      unsigned inBuffer, bool broadcast = false, TransferType inout = OUTPUT) {
-    getTransfers(outPort, outBuffer, inPort, inBuffer, broadcast, inout)
-      [outBuffer * m_input.getBufferCount() + inBuffer] = &temp;
+    getTransfer(outPort, outBuffer, inPort, inBuffer, broadcast, inout) = &temp;
   }
+  void createTemplate(unsigned outPort, unsigned outBuffer, unsigned inPort, unsigned inBuffer,
+		      bool broadcast, TransferType inout);
   virtual void createInputTransfers(Port &input);
-  virtual void createOutputTransfers(Port &output) = 0; // no default
+  // The default creates the output templates for all buffers when eager, using
+  // createOutputTemplate, for patterns where the input port of the template is always 0.
+  virtual void createOutputTransfers(Port &output);
+  // Create the template from this output buffer to this input buffer, on first use.
+  // The default is for patterns that create all their templates in createOutputTransfers.
+  virtual void createOutputTemplate(Port &output, unsigned s_tid, unsigned t_tid);
   virtual void createOutputBroadcastTemplates(Port &output);
+  void createOutputBroadcastTemplate(Port &output, unsigned s_tid, unsigned t_tid);
   virtual void createInputBroadcastTemplates(Port &input);
 
   //================================================================================
@@ -134,6 +154,8 @@ public:
   virtual bool hasFullInputBuffer(Port *, InputBuffer **) const;
   // determine if there is an available buffer, but does not affect the
   virtual bool hasEmptyOutputBuffer(Port *port) const;
+  // how many output buffers are available in sequence, without affecting the state
+  virtual unsigned emptyOutputBufferCount(Port *port) const;
   // get the next available buffer from the specified output port
   virtual Buffer* getNextEmptyOutputBuffer(Port *src_port);
   // get the next available buffer from the specified input port
@@ -147,6 +169,8 @@ public:
 };
 
 Controller &controllerNotSupported(PortSet &output, PortSet &input);
+// Sequential (e.g. least_busy) input distributions are not implemented by pattern 2
+Controller &controllerSequentialNotSupported(PortSet &output, PortSet &input);
 
 template<class TheController>
 Controller &
@@ -163,7 +187,7 @@ public:
   virtual ~Controller1(){};
   Controller1(PortSet &output, PortSet &input)
     : Controller(output, input){}
-  void createOutputTransfers(Port &s_port);
+  void createOutputTemplate(Port &s_port, unsigned s_tid, unsigned t_tid);
   // determine if we can produce from the indicated buffer
   bool canProduce(Buffer *buffer);
   // initiate a data transfer from the output buffer.
@@ -202,6 +226,7 @@ public:
     : Controller1AFCShadow(output, input){}
   void createInputTransfers(Port &s_port);
   void createOutputTransfers(Port &s_port);
+  void createOutputTemplate(Port &s_port, unsigned s_tid, unsigned t_tid);
 
 };
 #if 0
@@ -108,6 +108,8 @@ namespace OCPI {
        * state of the object.
        *********************************/
       bool hasEmptyOutputBuffer();
+      // How many empty output buffers are ready to be used, in order, without state change
+      unsigned emptyOutputBufferCount();
 
 
 
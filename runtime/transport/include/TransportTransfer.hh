@@ -59,8 +59,10 @@ namespace Transport {
     // For some templates, there are mutiple transfers that have to take place from
     // a single output buffer, such is the case for whole to parts when the number of
     // parts exceed the number of buffers+input ports.
-    //                       transfer sequence          input port    input buffer
-    Transfer *m_nextTransfer[MAX_TRANSFERS_PER_BUFFER][MAX_PCONTRIBS][MAX_BUFFERS];
+    // This is large and rarely used, so it is allocated when the first one is added.
+    //                   transfer sequence         input port    input buffer
+    typedef Transfer *GatedTransfers[MAX_TRANSFERS_PER_BUFFER][MAX_PCONTRIBS][MAX_BUFFERS];
+    GatedTransfers *m_nextTransfer;
     List m_gatedTransfersPending;
     unsigned m_sequence;
     unsigned m_maxSequence;
@@ -104,6 +106,8 @@ namespace Transport {
     }
     // Add a zero copy transfer request
     void addZeroCopyTransfer(OutputBuffer *output, InputBuffer *input);
+    // Footprint of this template: transfer requests, zero copies and bytes
+    void footprint(size_t &nRequests, size_t &nZeroCopies, size_t &nBytes) const;
     // Add a gated transfer, gated transfers are additional transfers that
     void addGatedTransfer(unsigned sequence,
 			  Transfer *gated_transfer,
@@ -114,11 +118,13 @@ namespace Transport {
       }
       ocpiDebug("*** Adding a gated transfer to this[%d][%d][%d] \n",
 		m_maxSequence,input_port_id, buffer_tid);
-      m_nextTransfer[sequence][input_port_id][buffer_tid] = gated_transfer;
+      if (!m_nextTransfer)
+	m_nextTransfer = new GatedTransfers[1]();
+      (*m_nextTransfer)[sequence][input_port_id][buffer_tid] = gated_transfer;
     }
     // Get a gated transfer
     Transfer *getNextGatedTransfer(PortOrdinal input_port_id, unsigned buffer_tid) {
-      return m_nextTransfer[m_sequence++][input_port_id][buffer_tid];
+      return m_nextTransfer ? (*m_nextTransfer)[m_sequence++][input_port_id][buffer_tid] : NULL;
     }
     // Get the maximum post produce sequence this class should transfer
     unsigned getMaxGatedSequence() {
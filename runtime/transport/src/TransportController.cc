@@ -18,6 +18,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include "UtilList.hh"
 #include "OsAssert.hh"
 #include "TimeEmitCategories.hh"
@@ -39,27 +41,32 @@ controllerNotSupported(PortSet &/*output*/, PortSet &/*input*/) {
   throw OCPI::Util::EmbeddedException("Unsupported data transfer request rejected !!\n");
 }
 
+// This is a configuration error rather than a programming error, so it does not assert.
+// Balanced crews get their "least busy" distribution from the container's bridge ports.
+Controller &
+controllerSequentialNotSupported(PortSet &/*output*/, PortSet &input) {
+  static const char *subTypes[] = {
+    "round_robin", "random_even", "random_statistical", "first_available", "least_busy"
+  };
+  unsigned subType = input.getDataDistribution()->getMetaData()->distSubType;
+  throw OCPI::Util::Error("The \"%s\" data distribution to a set of input ports is not "
+			  "supported by the transport: use a Balanced crew instead",
+			  subType < sizeof(subTypes)/sizeof(*subTypes) ?
+			  subTypes[subType] : "unknown");
+}
+
 Controller::
 Controller(PortSet &output, PortSet &input)
   :  m_EmptyQPtr(0), m_output(output), m_input(input), m_nextTid(0), m_zcopyEnabled(true) {
   // For convenience
   m_isWholeOutputSet =
     output.getDataDistribution()->getMetaData()->distType == DataDistributionMetaData::parallel;
-
-  unsigned
-    inSize = input.getPortCount(),
-    outSize = output.getPortCount(),
-    in2outSize = inSize * outSize,
-    inBuffers = input.getBufferCount(),
-    outBuffers = output.getBufferCount(),
-    in2outBuffers = inBuffers * outBuffers;
-  m_inPort2outPort.resize(in2outSize);
-  for (unsigned n = 0; n < in2outSize; ++n) {
-    m_inPort2outPort[n].m_outputTransfers.resize(in2outBuffers);
-    m_inPort2outPort[n].m_outputBroadcastTransfers.resize(in2outBuffers); // can this be conditional?
-    m_inPort2outPort[n].m_inputTransfers.resize(in2outBuffers);
-    m_inPort2outPort[n].m_inputBroadcastTransfers.resize(in2outBuffers); // can this be conditional?
-  }
+  // Output templates are normally created on first use, which avoids creating the
+  // templates for all buffer combinations of wide fan-outs at connection time.
+  const char *eager = getenv("OCPI_EAGER_TRANSFER_TEMPLATES");
+  m_eagerTemplates = eager && *eager && strcmp(eager, "0");
+  // The vectors of templates in each of these are sized when first used.
+  m_inPort2outPort.resize(input.getPortCount() * output.getPortCount());
 }
 
 /**********************************
@@ -67,17 +74,91 @@ Controller(PortSet &output, PortSet &input)
  *********************************/
 Controller::~Controller()
 {
+  size_t nTemplates = 0, nRequests = 0, nZeroCopies = 0, nBytes = 0;
+  templateStats(nTemplates, nRequests, nZeroCopies, nBytes);
+  ocpiInfo("Transfer controller %p had %zu templates with %zu transfer requests and "
+	   "%zu zero-copies using %zu bytes", this, nTemplates, nRequests, nZeroCopies, nBytes);
+  for (unsigned p = 0; p < m_inPort2outPort.size(); ++p) {
+    auto &io = m_inPort2outPort[p];
+    std::vector<Transfer *> *vecs[] = {
+      &io.m_outputTransfers, &io.m_outputBroadcastTransfers,
+      &io.m_inputTransfers, &io.m_inputBroadcastTransfers
+    };
+    for (unsigned v = 0; v < sizeof(vecs)/sizeof(*vecs); ++v)
+      for (unsigned b = 0; b < vecs[v]->size(); ++b)
+	delete (*vecs[v])[b];
+  }
+}
+
+void Controller::
+templateStats(size_t &nTemplates, size_t &nRequests, size_t &nZeroCopies,
+	      size_t &nBytes) const {
+  nBytes += m_inPort2outPort.size() * sizeof(OutPort2InPort);
   for (unsigned p = 0; p < m_inPort2outPort.size(); ++p) {
     auto &io = m_inPort2outPort[p];
-    for (unsigned b = 0; b < io.m_outputTransfers.size(); ++b) {
-      delete  io.m_outputTransfers[b];
-      delete  io.m_outputBroadcastTransfers[b];
-      delete  io.m_inputTransfers[b];
-      delete  io.m_inputBroadcastTransfers[b];
+    const std::vector<Transfer *> *vecs[] = {
+      &io.m_outputTransfers, &io.m_outputBroadcastTransfers,
+      &io.m_inputTransfers, &io.m_inputBroadcastTransfers
+    };
+    for (unsigned v = 0; v < sizeof(vecs)/sizeof(*vecs); ++v) {
+      nBytes += vecs[v]->size() * sizeof(Transfer *);
+      for (unsigned b = 0; b < vecs[v]->size(); ++b)
+	if ((*vecs[v])[b]) {
+	  nTemplates++;
+	  (*vecs[v])[b]->footprint(nRequests, nZeroCopies, nBytes);
+	}
     }
   }
 }
 
+// Create a template when it is first used.
+// Only output templates are created this way, with input port 0 since all inputs are
+// in the same template.
+void Controller::
+createTemplate(unsigned outPort, unsigned outBuffer, unsigned inPort, unsigned inBuffer,
+	       bool broadcast, TransferType inout) {
+  ocpiAssert(inout == OUTPUT && inPort == 0);
+  (void)inPort; (void)inout;
+  Port *s_port = NULL;
+  for (PortOrdinal n = 0; n < m_output.getPortCount(); n++)
+    if (m_output.getPort(n)->getPortId() == outPort) {
+      s_port = m_output.getPort(n);
+      break;
+    }
+  ocpiAssert(s_port && !s_port->isShadow());
+  ocpiDebug("Creating %stemplate on first use: output port %u buffer %u input buffer %u",
+	    broadcast ? "broadcast " : "", outPort, outBuffer, inBuffer);
+  if (broadcast)
+    createOutputBroadcastTemplate(*s_port, outBuffer, inBuffer);
+  else
+    createOutputTemplate(*s_port, outBuffer, inBuffer);
+}
+
+// Create all the output templates now when requested, rather than on first use.
+void Controller::
+createOutputTransfers(Port &s_port) {
+  // Since this is a whole output distribution, only port 0 of the output
+  // set gets to do anything.
+  if (!m_eagerTemplates ||
+      (s_port.getPortSet()->getDataDistribution()->getMetaData()->distType ==
+       DataDistributionMetaData::parallel && s_port.getRank() != 0))
+    return;
+  for (unsigned s_buffers = 0; s_buffers < m_output.getBufferCount(); s_buffers++) {
+    unsigned s_tid = s_port.getOutputBuffer(s_buffers)->getTid();
+    for (unsigned t_buffers = 0; t_buffers < m_input.getBufferCount(); t_buffers++) {
+      unsigned t_tid = m_input.getPort(0)->getInputBuffer(t_buffers)->getTid();
+      if (!getTransfer(s_port.getPortId(), s_tid, 0, t_tid, false, OUTPUT))
+	createOutputTemplate(s_port, s_tid, t_tid);
+    }
+  }
+}
+
+void Controller::
+createOutputTemplate(Port &/*s_port*/, unsigned /*s_tid*/, unsigned /*t_tid*/) {
+  ocpiAssert("This transfer pattern does not create templates on first use"==0);
+  throw OCPI::Util::EmbeddedException("Transfer template was not created");
+}
+
 // After construction (of derived classes) this finishes the initialization
 void Controller::
 init() {
@@ -184,121 +265,115 @@ createInputBroadcastTemplates(Port &input) {
 
 void Controller::
 createOutputBroadcastTemplates(Port &s_port) {
-  unsigned n,
-    n_s_buffers = m_output.getBufferCount(),
-    n_t_buffers = m_input.getBufferCount(),
-    n_t_ports = m_input.getPortCount();
-
   // We need a transfer template to allow a transfer from each output buffer to every
   // input buffer for this pattern.
-  for (unsigned s_buffers = 0; s_buffers < n_s_buffers; s_buffers++) {
+  for (unsigned s_buffers = 0; s_buffers < m_output.getBufferCount(); s_buffers++)
+    for (unsigned t_buffers = 0; t_buffers < m_input.getBufferCount(); t_buffers++)
+      createOutputBroadcastTemplate(s_port, s_port.getOutputBuffer(s_buffers)->getTid(),
+				    m_input.getPort(0)->getInputBuffer(t_buffers)->getTid());
+}
 
-    // output buffer
-    OutputBuffer* s_buf = static_cast<OutputBuffer*>(s_port.getOutputBuffer(s_buffers));
-    unsigned s_tid = s_buf->getTid();
-    unsigned t_tid;
+// Create the broadcast template from one output buffer to one input buffer in all inputs
+void Controller::
+createOutputBroadcastTemplate(Port &s_port, unsigned s_tid, unsigned t_tid) {
+  unsigned n, n_t_ports = m_input.getPortCount();
+  // output buffer
+  OutputBuffer* s_buf = static_cast<OutputBuffer*>(s_port.getOutputBuffer(s_tid));
+  // input buffer
+  InputBuffer* t_buf;
 
-    // We need a transfer template to allow a transfer to each input buffer
-    for (unsigned t_buffers = 0; t_buffers < n_t_buffers; t_buffers++) {
+  // Create a template
+  Transfer &temp = *new Transfer(0);
 
-      // input buffer
-      InputBuffer* t_buf = static_cast<InputBuffer*>(m_input.getPort(0)->getInputBuffer(t_buffers));
-      t_tid = t_buf->getTid();
+  // Add the template to the controller, for this pattern the output port
+  // and the input ports remains constant
 
-      // Create a template
-      Transfer &temp = *new Transfer(0);
+  ocpiDebug("output port id = %d, buffer id = %d, input id = %d",
+	    s_port.getPortId(), s_tid, t_tid );
+  ocpiDebug("Template address = %p", &temp);
 
-      // Add the template to the controller, for this pattern the output port
-      // and the input ports remains constant
+  setTemplate(temp, s_port.getPortId(), s_tid, 0, t_tid, true, OUTPUT);
 
-      ocpiDebug("output port id = %d, buffer id = %d, input id = %d",
-		s_port.getPortId(), s_tid, t_tid );
-      ocpiDebug("Template address = %p", &temp);
+  // This transfer is used to mark the local input shadow buffer as full
 
-      setTemplate(temp, s_port.getPortId(), s_tid, 0, t_tid, true, OUTPUT);
+  struct PortMetaData::OutputPortBufferControlMap *output_offsets =
+    &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
 
-      // This transfer is used to mark the local input shadow buffer as full
+  // We need to setup a transfer for each input port.
+  ocpiDebug("Number of input ports = %d", n_t_ports);
+  for ( n=0; n < n_t_ports; n++) {
 
-      struct PortMetaData::OutputPortBufferControlMap *output_offsets =
-        &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
+    // Get the input port
+    Port  &t_port = *m_input.getPort(n);
+    t_buf = static_cast<InputBuffer*>(t_port.getBuffer(t_tid));
 
-      // We need to setup a transfer for each input port. 
-      ocpiDebug("Number of input ports = %d", n_t_ports);
-      for ( n=0; n < n_t_ports; n++) {
+    struct PortMetaData::InputPortBufferControlMap *input_offsets =
+      &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
 
-        // Get the input port
-        Port  &t_port = *m_input.getPort(n);
-        t_buf = static_cast<InputBuffer*>(t_port.getBuffer(t_buffers));
+    // We need to determine if this can be a Zero copy transfer.  If so,
+    // we dont need to create a transfer template
+    if (m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
 
-        struct PortMetaData::InputPortBufferControlMap *input_offsets = 
-          &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
+      ocpiDebug("** ZERO COPY TransferTemplateGenerator::createOutputBroadcastTemplates from %p, to %p",
+		s_buf, t_buf);
+      temp.addZeroCopyTransfer(s_buf, t_buf);
+      continue;
+    }
+    XF::XferRequest* ptransfer =
+      s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
+    try {
+      ptransfer->copy(output_offsets->bufferOffset,
+		      input_offsets->bufferOffset,
+		      output_offsets->bufferSize,
+		      XF::XferRequest::DataTransfer);
+      // Create the transfer that copys the output meta-data to the input meta-data
+      ptransfer->copy(output_offsets->metaDataOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
+		      input_offsets->metaDataOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
+		      sizeof(int64_t),
+		      XF::XferRequest::MetaDataTransfer );
+
+      // Create the transfer that copys the output state to the remote input state
+      ptransfer->copy(output_offsets->localStateOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      input_offsets->localStateOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      sizeof(BufferState),
+		      XF::XferRequest::FlagTransfer);
+    } catch ( ... ) {
+      FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
+    }
+    // Add the transfer
+    temp.addTransfer(ptransfer);
 
-        // We need to determine if this can be a Zero copy transfer.  If so, 
-        // we dont need to create a transfer template
-        if (m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
+  } // end for each input port
 
-          ocpiDebug("** ZERO COPY TransferTemplateGenerator::createOutputBroadcastTemplates from %p, to %p",
-		    s_buf, t_buf);
-          temp.addZeroCopyTransfer(s_buf, t_buf);
-          continue;
-        }
-	XF::XferRequest* ptransfer =
-	  s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
-        try {
-	  ptransfer->copy(output_offsets->bufferOffset,
-			  input_offsets->bufferOffset,
-			  output_offsets->bufferSize,
-			  XF::XferRequest::DataTransfer);
-          // Create the transfer that copys the output meta-data to the input meta-data
-	  ptransfer->copy(output_offsets->metaDataOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
-			   input_offsets->metaDataOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
-			   sizeof(int64_t),
-			  XF::XferRequest::MetaDataTransfer );
-
-          // Create the transfer that copys the output state to the remote input state
-          ptransfer->copy(output_offsets->localStateOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  input_offsets->localStateOffset + s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  sizeof(BufferState),
-			  XF::XferRequest::FlagTransfer);
-        } catch ( ... ) {
-          FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
-        }
-        // Add the transfer
-        temp.addTransfer(ptransfer);
-
-      } // end for each input buffer
-
-      // And now to all other outputs
-
-      // A output braodcast must also send to all other outputs to update them as well
-      // Now we need to pass the output control baton onto the next output port
-      XF::XferRequest* ptransfer2 = NULL;
-      for (PortOrdinal ns = 0; ns < s_port.getPortSet()->getPortCount(); ns++) {
-        Port &next_sp =
-          *static_cast<Port*>(s_port.getPortSet()->getPortFromIndex(ns));
-        if (&next_sp == &s_port)
-          continue;
-
-        struct PortMetaData::OutputPortBufferControlMap *next_output_offsets =
-          &next_sp.getMetaData()->m_bufferData[s_tid].outputOffsets;
-	ptransfer2 =
-	  s_port.getTemplate(s_port.getEndPoint(), next_sp.getEndPoint()).createXferRequest();
-        // Create the transfer from out output contol state to the next
-        try {
-          ptransfer2->copy (output_offsets->portSetControlOffset,
-			    next_output_offsets->portSetControlOffset,
-			    sizeof(OutputPortSetControl),
-			    XF::XferRequest::FlagTransfer);
-	} catch( ... ) {
-	  FORMAT_TRANSFER_EC_RETHROW(&s_port, &next_sp);
-	}
-      }
+  // And now to all other outputs
+
+  // A output braodcast must also send to all other outputs to update them as well
+  // Now we need to pass the output control baton onto the next output port
+  XF::XferRequest* ptransfer2 = NULL;
+  for (PortOrdinal ns = 0; ns < s_port.getPortSet()->getPortCount(); ns++) {
+    Port &next_sp =
+      *static_cast<Port*>(s_port.getPortSet()->getPortFromIndex(ns));
+    if (&next_sp == &s_port)
+      continue;
 
-      // Add the transfer 
-      if (ptransfer2)
-	temp.addTransfer(ptransfer2);
-    } // end for each output buffer
-  }  // end for each input port
+    struct PortMetaData::OutputPortBufferControlMap *next_output_offsets =
+      &next_sp.getMetaData()->m_bufferData[s_tid].outputOffsets;
+    ptransfer2 =
+      s_port.getTemplate(s_port.getEndPoint(), next_sp.getEndPoint()).createXferRequest();
+    // Create the transfer from out output contol state to the next
+    try {
+      ptransfer2->copy (output_offsets->portSetControlOffset,
+			next_output_offsets->portSetControlOffset,
+			sizeof(OutputPortSetControl),
+			XF::XferRequest::FlagTransfer);
+    } catch( ... ) {
+      FORMAT_TRANSFER_EC_RETHROW(&s_port, &next_sp);
+    }
+  }
+
+  // Add the transfer
+  if (ptransfer2)
+    temp.addTransfer(ptransfer2);
 }
 
 // This base class method provides a default pattern for the input buffers which is to
@@ -387,6 +462,18 @@ hasEmptyOutputBuffer(Port *src_port) const {
   return buffer->isEmpty() && !buffer->inUse();
 }
 
+unsigned Controller::
+emptyOutputBufferCount(Port *src_port) const {
+  BufferOrdinal nBuffers = src_port->getBufferCount(), count = 0;
+  for (BufferOrdinal n = src_port->getLastBufferTidProcessed(); count < nBuffers;
+       n = (n + 1) % nBuffers, count++) {
+    OutputBuffer* buffer = src_port->getOutputBuffer(n);
+    if (!buffer->isEmpty() || buffer->inUse())
+      break;
+  }
+  return OCPI_UTRUNCATE(unsigned, count);
+}
+
 bool Controller::
 hasFullInputBuffer(Port *input_port, InputBuffer** retb) const {
   InputBuffer* buffer;
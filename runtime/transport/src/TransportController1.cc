@@ -35,110 +35,92 @@ namespace XF = OCPI::Xfer;
 namespace OCPI {
 namespace Transport {
 
-// Create transfers for output port for the pattern w[p] -> w[p]
+// Create the transfer template for the pattern w[p] -> w[p], from one output buffer
+// to the same input buffer in all input ports.  This happens on first use.
 void Controller1::
-createOutputTransfers(Port &s_port) {
-  // Since this is a whole output distribution, only port 0 of the output
-  // set gets to do anything.
-  if (s_port.getPortSet()->getDataDistribution()->getMetaData()->distType ==
-      DataDistributionMetaData::parallel && s_port.getRank() != 0)
-    return;
-  unsigned n,
-    n_s_buffers = m_output.getBufferCount(),
-    n_t_buffers = m_input.getBufferCount(),
-    n_t_ports = m_input.getPortCount();
-
-  // We need a transfer template to allow a transfer from each output buffer to every
-  // input buffer for this pattern.
-  for (unsigned s_buffers = 0; s_buffers < n_s_buffers; s_buffers++) {
-    // output buffer
-    OutputBuffer* s_buf = s_port.getOutputBuffer(s_buffers);
-    unsigned s_tid = s_buf->getTid();
-
-    // We need a transfer template to allow a transfer to each input buffer
-    for (unsigned t_buffers = 0; t_buffers < n_t_buffers; t_buffers++) {
-      // input buffer
-      InputBuffer* t_buf = m_input.getPort(0)->getInputBuffer(t_buffers);
-      unsigned t_tid = t_buf->getTid();
-
-      // Create a template
-      Transfer &temp = *new Transfer(1);
-
-      // Add the template to the controller, for this pattern the output port
-      // and the input ports remains constant
-      ocpiDebug("output port id = %d, buffer id = %d, input id = %d, temp=%p\n",
-		s_port.getPortId(), s_tid, t_tid, &temp);
-
-      setTemplate(temp, s_port.getPortId(), s_tid, 0 ,t_tid, false, OUTPUT);
-      /*
-       *  This transfer is used to mark the local input shadow buffer as full
-       */
-      // We need to setup a transfer for each input port.
-      ocpiDebug("Number of input ports = %d\n", n_t_ports);
-
-      for (n = 0; n < n_t_ports; n++) {
-        // Get the input port
-        Port &t_port = *m_input.getPort(n);
-        t_buf = t_port.getInputBuffer(t_buffers);
-
-        struct PortMetaData::OutputPortBufferControlMap *output_offsets =
-          &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
-
-        struct PortMetaData::InputPortBufferControlMap *input_offsets =
-          &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
-
-        // We need to determine if this can be a Zero copy transfer.  If so,
-        // we dont need to create a transfer template
-        if (m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
-          ocpiDebug("** ZERO COPY TransferTemplateGeneratorPattern1::createOutputTransfers from %p, to %p",
-		    s_buf, t_buf);
-          temp.addZeroCopyTransfer(s_buf, t_buf);
-          continue;
-        }
-
-        // Create the transfer that copys the output data to the input data
-	XF::XferRequest* ptransfer =
-	  s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
-        try {
-          ptransfer->copy(output_offsets->bufferOffset,
-			  input_offsets->bufferOffset,
-			  output_offsets->bufferSize,
-			  XF::XferRequest::DataTransfer);
-
-	  XF::Offset	metaOffset =
-	    output_offsets->metaDataOffset +
-	    s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData);
-	  uint32_t options = t_port.getMetaData()->m_descriptor.options;
-
-	  if (!(options & (1 << FlagIsMeta)))
-	    // Create the transfer that copys the output meta-data to the input meta-data
-	    ptransfer->copy(metaOffset,
-			    input_offsets->metaDataOffset +
-			    s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
-			    sizeof(OCPI::OS::int64_t),
-			    XF::XferRequest::MetaDataTransfer);
-	  // The flag transfer which could be three things
-	  ptransfer->copy(// source offset, depends on mode
-			  options & (1 << FlagIsCounting) ?
-			  metaOffset + OCPI_OFFSETOF(XF::Offset, RplMetaData, timestamp) :
-			  options & (1 << FlagIsMeta) ?
-			  metaOffset + OCPI_OFFSETOF(XF::Offset, RplMetaData, xferMetaData) :
-			  output_offsets->localStateOffset +
-			  OCPI_SIZEOF(XF::Offset, BufferState) * MAX_PCONTRIBS +
-			  s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  // destination offset
-			  input_offsets->localStateOffset +
-			  s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  sizeof(BufferState),
-			  XF::XferRequest::FlagTransfer);
-        } catch( ... ) {
-          FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
-        }
-        // Add the transfer 
-        temp.addTransfer(ptransfer);
-      } // end for each input buffer
-    } // end for each output buffer
-  }  // end for each input port
+createOutputTemplate(Port &s_port, unsigned s_tid, unsigned t_tid) {
+  unsigned n, n_t_ports = m_input.getPortCount();
+  // output buffer
+  OutputBuffer* s_buf = s_port.getOutputBuffer(s_tid);
+  // input buffer
+  InputBuffer* t_buf;
+
+  // Create a template
+  Transfer &temp = *new Transfer(1);
+
+  // Add the template to the controller, for this pattern the output port
+  // and the input ports remains constant
+  ocpiDebug("output port id = %d, buffer id = %d, input id = %d, temp=%p\n",
+	    s_port.getPortId(), s_tid, t_tid, &temp);
+
+  setTemplate(temp, s_port.getPortId(), s_tid, 0 ,t_tid, false, OUTPUT);
+  /*
+   *  This transfer is used to mark the local input shadow buffer as full
+   */
+  // We need to setup a transfer for each input port.
+  ocpiDebug("Number of input ports = %d\n", n_t_ports);
+
+  for (n = 0; n < n_t_ports; n++) {
+    // Get the input port
+    Port &t_port = *m_input.getPort(n);
+    t_buf = t_port.getInputBuffer(t_tid);
+
+    struct PortMetaData::OutputPortBufferControlMap *output_offsets =
+      &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
+
+    struct PortMetaData::InputPortBufferControlMap *input_offsets =
+      &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
+
+    // We need to determine if this can be a Zero copy transfer.  If so,
+    // we dont need to create a transfer template
+    if (m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
+      ocpiDebug("** ZERO COPY TransferTemplateGeneratorPattern1::createOutputTemplate from %p, to %p",
+		s_buf, t_buf);
+      temp.addZeroCopyTransfer(s_buf, t_buf);
+      continue;
+    }
+
+    // Create the transfer that copys the output data to the input data
+    XF::XferRequest* ptransfer =
+      s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
+    try {
+      ptransfer->copy(output_offsets->bufferOffset,
+		      input_offsets->bufferOffset,
+		      output_offsets->bufferSize,
+		      XF::XferRequest::DataTransfer);
+
+      XF::Offset	metaOffset =
+	output_offsets->metaDataOffset +
+	s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData);
+      uint32_t options = t_port.getMetaData()->m_descriptor.options;
+
+      if (!(options & (1 << FlagIsMeta)))
+	// Create the transfer that copys the output meta-data to the input meta-data
+	ptransfer->copy(metaOffset,
+			input_offsets->metaDataOffset +
+			s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData),
+			sizeof(OCPI::OS::int64_t),
+			XF::XferRequest::MetaDataTransfer);
+      // The flag transfer which could be three things
+      ptransfer->copy(// source offset, depends on mode
+		      options & (1 << FlagIsCounting) ?
+		      metaOffset + OCPI_OFFSETOF(XF::Offset, RplMetaData, timestamp) :
+		      options & (1 << FlagIsMeta) ?
+		      metaOffset + OCPI_OFFSETOF(XF::Offset, RplMetaData, xferMetaData) :
+		      output_offsets->localStateOffset +
+		      OCPI_SIZEOF(XF::Offset, BufferState) * MAX_PCONTRIBS +
+		      s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      // destination offset
+		      input_offsets->localStateOffset +
+		      s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      sizeof(BufferState),
+		      XF::XferRequest::FlagTransfer);
+    } catch( ... ) {
+      FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
+    }
+    // Add the transfer 
+    temp.addTransfer(ptransfer);
+  } // end for each input port
 }
 
 bool Controller1::
@@ -39,6 +39,7 @@ namespace Transport {
 // Create transfers for a output port that has a ActiveFlowControl role.  This means that the 
 // the only transfer that takes place is the "flag" transfer.  It is the responibility of the 
 // remote "pull" port to tell us when our output buffer becomes free.
+// The templates themselves are created on first use unless eager.
 void Controller1AFC::
 createOutputTransfers(Port &s_port) {
   // Since this is a whole output distribution, only port 0 of the output
@@ -47,84 +48,77 @@ createOutputTransfers(Port &s_port) {
       DataDistributionMetaData::parallel &&
        s_port.getRank() != 0)
     return;
-  unsigned n_s_buffers = m_output.getBufferCount();
-  unsigned n_t_buffers = m_input.getBufferCount();
-  PortOrdinal n_t_ports = m_input.getPortCount();
-
-  // We need a transfer template to allow a transfer from each output buffer to every
-  // input buffer for this pattern.
-  for (unsigned s_buffers = 0; s_buffers < n_s_buffers; s_buffers++) {
-    // output buffer
-    OutputBuffer* s_buf = s_port.getOutputBuffer(s_buffers);
-    s_buf->setSlave();
-    unsigned s_tid = s_buf->getTid();
-
-    // We need a transfer template to allow a transfer to each input buffer
-    for (unsigned t_buffers = 0; t_buffers < n_t_buffers; t_buffers++) {
-      // input buffer
-      InputBuffer* t_buf = m_input.getPort(0)->getInputBuffer(t_buffers);
-      unsigned t_tid = t_buf->getTid();
-
-      // Create a template
-      // Transfer *temp = new TransferAFC(1);
-      Transfer &temp = *new Transfer(1);
-
-
-      // Add the template to the controller, for this pattern the output port
-      // and the input ports remains constant
-      ocpiDebug("output port id = %d, buffer id = %d, input id = %d", 
-		s_port.getPortId(), s_tid, t_tid);
-      ocpiDebug("Template address = %p", &temp);
-
-      setTemplate(temp, s_port.getPortId(), s_tid, 0 ,t_tid, false, OUTPUT);
-
-      // We need to setup a transfer for each input port. 
-      ocpiDebug("Number of input ports = %d", n_t_ports);
-
-      for (PortOrdinal n = 0; n < n_t_ports; n++) {
-        // Get the input port
-        Port &t_port = *m_input.getPort(n);
-        t_buf = t_port.getInputBuffer(t_buffers);
-
-        struct PortMetaData::OutputPortBufferControlMap *output_offsets =
-          &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
-
-        struct PortMetaData::InputPortBufferControlMap *input_offsets =
-          &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
-
-        // We need to determine if this can be a Zero copy transfer.  If so,
-        // we dont need to create a transfer template
-        if ( m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
-          ocpiDebug("** ZERO COPY TransferTemplateGeneratorPattern1AFC::createOutputTransfers from %p, to %p",
-		    s_buf, t_buf);
-          temp.addZeroCopyTransfer(s_buf, t_buf);
-          continue;
-        }
+  for (unsigned s_buffers = 0; s_buffers < m_output.getBufferCount(); s_buffers++)
+    s_port.getOutputBuffer(s_buffers)->setSlave();
+  Controller::createOutputTransfers(s_port);
+}
 
-        // Create the transfer that copys the output data to the input data
-	XF::XferRequest* ptransfer =
-	  s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
-        // Note that in the ActiveFlowControl mode we only send the state to indicate that our
-        // buffer is ready for the remote actor to pull data.
-        try {
-	  ptransfer->copy(t_port.getMetaData()->m_descriptor.options & (1 << FlagIsMeta) ?
-			  output_offsets->metaDataOffset +
-			  s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData) +
-			  OCPI_OFFSETOF(XF::Offset, RplMetaData, xferMetaData) :
-			  output_offsets->localStateOffset +
-			  s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  input_offsets->localStateOffset +
-			  s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
-			  sizeof(BufferState),
-			  XF::XferRequest::FlagTransfer);
-        } catch( ... ) {
-          FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
-        }
-        // Add the transfer 
-        temp.addTransfer(ptransfer);
-      } // end for each input buffer
-    } // end for each output buffer
-  }  // end for each input port
+// Create the template from one output buffer to the same input buffer in all input ports
+void Controller1AFC::
+createOutputTemplate(Port &s_port, unsigned s_tid, unsigned t_tid) {
+  PortOrdinal n_t_ports = m_input.getPortCount();
+  // output buffer
+  OutputBuffer* s_buf = s_port.getOutputBuffer(s_tid);
+  // input buffer
+  InputBuffer* t_buf;
+
+  // Create a template
+  // Transfer *temp = new TransferAFC(1);
+  Transfer &temp = *new Transfer(1);
+
+  // Add the template to the controller, for this pattern the output port
+  // and the input ports remains constant
+  ocpiDebug("output port id = %d, buffer id = %d, input id = %d", 
+	    s_port.getPortId(), s_tid, t_tid);
+  ocpiDebug("Template address = %p", &temp);
+
+  setTemplate(temp, s_port.getPortId(), s_tid, 0 ,t_tid, false, OUTPUT);
+
+  // We need to setup a transfer for each input port. 
+  ocpiDebug("Number of input ports = %d", n_t_ports);
+
+  for (PortOrdinal n = 0; n < n_t_ports; n++) {
+    // Get the input port
+    Port &t_port = *m_input.getPort(n);
+    t_buf = t_port.getInputBuffer(t_tid);
+
+    struct PortMetaData::OutputPortBufferControlMap *output_offsets =
+      &s_port.getMetaData()->m_bufferData[s_tid].outputOffsets;
+
+    struct PortMetaData::InputPortBufferControlMap *input_offsets =
+      &t_port.getMetaData()->m_bufferData[t_tid].inputOffsets;
+
+    // We need to determine if this can be a Zero copy transfer.  If so,
+    // we dont need to create a transfer template
+    if ( m_zcopyEnabled && s_port.supportsZeroCopy(&t_port)) {
+      ocpiDebug("** ZERO COPY TransferTemplateGeneratorPattern1AFC::createOutputTemplate from %p, to %p",
+		s_buf, t_buf);
+      temp.addZeroCopyTransfer(s_buf, t_buf);
+      continue;
+    }
+
+    // Create the transfer that copys the output data to the input data
+    XF::XferRequest* ptransfer =
+      s_port.getTemplate(s_port.getEndPoint(), t_port.getEndPoint()).createXferRequest();
+    // Note that in the ActiveFlowControl mode we only send the state to indicate that our
+    // buffer is ready for the remote actor to pull data.
+    try {
+      ptransfer->copy(t_port.getMetaData()->m_descriptor.options & (1 << FlagIsMeta) ?
+		      output_offsets->metaDataOffset +
+		      s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferMetaData) +
+		      OCPI_OFFSETOF(XF::Offset, RplMetaData, xferMetaData) :
+		      output_offsets->localStateOffset +
+		      s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      input_offsets->localStateOffset +
+		      s_port.getPortId() * OCPI_SIZEOF(XF::Offset, BufferState),
+		      sizeof(BufferState),
+		      XF::XferRequest::FlagTransfer);
+    } catch( ... ) {
+      FORMAT_TRANSFER_EC_RETHROW(&s_port, &t_port);
+    }
+    // Add the transfer 
+    temp.addTransfer(ptransfer);
+  } // end for each input port
 }
 
 // This base class provides a default pattern for the input buffers which is to
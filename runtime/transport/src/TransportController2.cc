@@ -39,8 +39,6 @@ namespace Transport {
 Controller2::
 Controller2(PortSet &output, PortSet &input)
   : Controller(output, input) {
-  ocpiAssert(input.getDataDistribution()->getMetaData()->distSubType ==
-	     DataDistributionMetaData::least_busy);
 }
 
 void Controller2::
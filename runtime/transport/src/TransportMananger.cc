@@ -95,7 +95,7 @@ TransportManager(unsigned event_ordinal, bool async)
   m_controllerFactories[DataDistributionMetaData::parallel][DataDistributionMetaData::sequential]
     [DataPartitionMetaData::INDIVISIBLE][DataPartitionMetaData::INDIVISIBLE] 
     [false] [ActiveMessage] [ActiveMessage] 
-    = createController<Controller2>;
+    = controllerSequentialNotSupported; // Controller2 is not finished
 
   m_controllerFactories[DataDistributionMetaData::sequential][DataDistributionMetaData::sequential]
     [DataPartitionMetaData::INDIVISIBLE][DataPartitionMetaData::INDIVISIBLE] 
@@ -1458,6 +1458,17 @@ hasEmptyOutputBuffer()
   return getPortSet()->getTxController()->hasEmptyOutputBuffer(this);
 }
 
+unsigned
+Port::
+emptyOutputBufferCount()
+{
+  Circuit *c = getCircuit();
+  OU::SelfAutoMutex guard(c);
+  if (c->isCircuitOpen() || !getPortSet() || !getPortSet()->getTxController())
+    return 0;
+  return getPortSet()->getTxController()->emptyOutputBufferCount(this);
+}
+
 
 BufferUserFacet* 
 Port::
@@ -28,12 +28,14 @@ namespace Transport {
 
 Transfer::
 Transfer(unsigned id)
-  : m_id(id), n_transfers(0), m_maxSequence(0), m_zCopy(NULL) {
+  : m_id(id), n_transfers(0), m_nextTransfer(NULL), m_sequence(0), m_maxSequence(0),
+    m_zCopy(NULL) {
 }
 
 Transfer::
 ~Transfer() {
   delete m_zCopy;
+  delete [] m_nextTransfer;
   // DO NOT DELETE from m_xferReq array since they are owned by the controller
 }
 
@@ -60,6 +62,16 @@ addZeroCopyTransfer(OutputBuffer* output, InputBuffer* input) {
     m_zCopy->add(zc);
 }
 
+void Transfer::
+footprint(size_t &nRequests, size_t &nZeroCopies, size_t &nBytes) const {
+  nRequests += n_transfers;
+  nBytes += sizeof(*this);
+  if (m_nextTransfer)
+    nBytes += sizeof(*m_nextTransfer);
+  for (ZCopy *z = m_zCopy; z; z = z->next, nZeroCopies++)
+    nBytes += sizeof(*z);
+}
+
 // Is this transfer complete
 bool Transfer::
 isComplete() {
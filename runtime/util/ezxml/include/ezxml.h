@@ -39,6 +39,8 @@ extern "C" {
 #define EZXML_NAMEM   0x80 // name is malloced
 #define EZXML_TXTM    0x40 // txt is malloced
 #define EZXML_DUP     0x20 // attribute name and value are strduped
+#define EZXML_ARENAN  0x10 // tag structure is in the document's arena
+#define EZXML_ARENAA  0x08 // attribute list is in the document's arena
 
 typedef struct ezxml *ezxml_t;
 struct ezxml {
@@ -67,6 +69,14 @@ ezxml_t ezxml_parse_fd(int fd);
 
 // a wrapper for ezxml_parse_fd() that accepts a file name
 ezxml_t ezxml_parse_file(const char *file);
+
+// Variants of the above that allocate all tags and attribute lists of the document
+// from a few large blocks that are freed together by ezxml_free() on the root tag.
+// The resulting structure has the same semantics, except that tags cut from the
+// document must not be used after the document is freed.
+ezxml_t ezxml_parse_str_arena(char *s, size_t len);
+ezxml_t ezxml_parse_fd_arena(int fd);
+ezxml_t ezxml_parse_file_arena(const char *file);
     
 // Wrapper for ezxml_parse_str() that accepts a file stream. Reads the entire
 // stream into memory and then parses it. For xml files, use ezxml_parse_file()
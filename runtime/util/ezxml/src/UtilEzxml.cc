@@ -739,7 +739,7 @@ namespace OCPI {
       }
       const char *
       ezxml_parse_file(const char *file, ezxml_t &xml) {
-	if (!(xml = ::ezxml_parse_file(file)))
+	if (!(xml = ::ezxml_parse_file_arena(file)))
 	  return OU::esprintf("could not parse xml file: '%s'", file);
 	else if (ezxml_error(xml)[0])
 	  return OU::esprintf("error parsing xml file '%s': %s", file, ezxml_error(xml));
@@ -749,7 +749,7 @@ namespace OCPI {
       ezxml_parse_str(char *string, size_t len, ezxml_t &xml) {
 	if (!len)
 	  len = strlen(string);
-	if (!(xml = ::ezxml_parse_str(string, len)))
+	if (!(xml = ::ezxml_parse_str_arena(string, len)))
 	  return "Could not parse xml string";
 	else if (ezxml_error(xml)[0]) {
 	  const char *err = OU::esprintf("error parsing xml string': %s", ezxml_error(xml));
@@ -58,10 +58,25 @@
 #define EZXML_WS   "\t\r\n "  // whitespace
 #define EZXML_ERRL 128        // maximum error string length
 
+// block of memory in the arena of a document parsed with the _arena functions
+typedef struct ezxml_block *ezxml_block_t;
+struct ezxml_block {
+    ezxml_block_t next;   // previously filled block
+    size_t size;          // bytes available after the header
+    size_t used;          // bytes used after the header
+};
+#define EZXML_ALIGN(n) (((n) + 2 * sizeof(void *) - 1) & ~(2 * sizeof(void *) - 1))
+
 typedef struct ezxml_root *ezxml_root_t;
 struct ezxml_root {       // additional data for the root tag
     struct ezxml xml;     // is a super-struct built on top of ezxml struct
     ezxml_t cur;          // current xml tree insertion point
+    ezxml_t last;         // last subtag of cur while parsing, or NULL
+    size_t *txtl;         // txt length and space of cur and its parents
+    int depth;            // index in txtl of cur while parsing
+    int ntxtl;            // number of entries allocated in txtl
+    ezxml_t *link;        // first and last subtag of each name when linking
+    size_t nlink;         // number of names allocated in link
     char *m;              // original xml string
     size_t len;           // length of allocated memory for mmap, -1 for malloc
     char *u;              // UTF-8 conversion of string if original was UTF-16
@@ -71,6 +86,11 @@ struct ezxml_root {       // additional data for the root tag
     char ***attr;         // default attributes
     char ***pi;           // processing instructions
     short standalone;     // non-zero if <?xml standalone="yes"?>
+    short use_arena;      // non-zero while parsing tags into the arena
+    ezxml_block_t arena;  // blocks holding tags and attribute lists, or NULL
+    char **scratch;       // attribute list being built when parsing into the arena
+    char *mscratch;       // list of malloced names/vals for scratch
+    size_t nscratch;      // number of pointers allocated in scratch
     char err[EZXML_ERRL]; // error string
 };
 
@@ -237,16 +257,120 @@ char *ezxml_decode(char *s, char **ent, char t)
     return r;
 }
 
-// called when parser finds start of new tag
-void ezxml_open_tag(ezxml_root_t root, char *name, char **attr)
+// allocates memory from the document's arena, adding a larger block when full
+static void *ezxml_arena_alloc(ezxml_root_t root, size_t size)
 {
-    ezxml_t xml = root->cur;
+    ezxml_block_t b = root->arena;
+    char *p;
+
+    size = EZXML_ALIGN(size);
+    if (! b || b->used + size > b->size) {
+        size_t n = (b) ? b->size * 2 : (size_t)(root->e - root->s) / 2;
+        if (n < EZXML_BUFSIZE * 4) n = EZXML_BUFSIZE * 4;
+        if (n < size) n = size;
+        if (! (b = malloc(EZXML_ALIGN(sizeof(struct ezxml_block)) + n))) return NULL;
+        b->next = root->arena;
+        b->size = n;
+        b->used = 0;
+        root->arena = b;
+    }
+    p = (char *)b + EZXML_ALIGN(sizeof(struct ezxml_block)) + b->used;
+    b->used += size;
+    return p;
+}
+
+// makes room for the attribute at l in the attribute list being parsed, along with
+// its entry in the list of which names and values are malloced. When parsing into
+// the arena, the list is built in scratch space and copied when the tag is opened.
+static char **ezxml_attr_grow(ezxml_root_t root, char **attr, int l)
+{
+    if (! root->use_arena) {
+        attr = (l) ? realloc(attr, (l + 4) * sizeof(char *))
+                   : malloc(4 * sizeof(char *)); // allocate space
+        attr[l + 3] = (l) ? realloc(attr[l + 1], (l / 2) + 2)
+                          : malloc(2); // mem for list of maloced vals
+        return attr;
+    }
+    if ((size_t)l + 4 > root->nscratch) {
+        root->nscratch = (l + 4) * 2;
+        root->scratch = realloc(root->scratch, root->nscratch * sizeof(char *));
+        root->mscratch = realloc(root->mscratch, root->nscratch / 2 + 2);
+    }
+    root->scratch[l + 3] = root->mscratch;
+    return root->scratch;
+}
 
-    if (xml->name) xml = ezxml_add_child(xml, name, strlen(xml->txt));
-    else xml->name = name; // first open tag
+// Adds a subtag after all existing subtags of dest while parsing. Only the
+// ordered list is maintained here: the sibling and next lists are built by
+// ezxml_link() when dest is complete, so no list needs to be searched.
+static ezxml_t ezxml_append(ezxml_root_t root, ezxml_t xml, ezxml_t dest,
+                            size_t off)
+{
+    xml->next = xml->sibling = xml->ordered = NULL;
+    xml->off = off;
+    xml->parent = dest;
+    if (root->last) root->last->ordered = xml;
+    else dest->child = xml; // first sub tag
+    return xml;
+}
 
+// Builds the sibling and next lists of the subtags of xml from its ordered
+// list, with the same result as adding each of them with ezxml_insert()
+static void ezxml_link(ezxml_root_t root, ezxml_t xml)
+{
+    ezxml_t cur;
+    size_t i, n = 0;
+
+    for (cur = xml->child; cur; cur = cur->ordered) {
+        for (i = 0; i < n && strcmp(root->link[i * 2]->name, cur->name); i++);
+        if (i == n) { // first tag of this type
+            if (n == root->nlink)
+                root->link = realloc(root->link,
+                                     (root->nlink = n * 2 + 16) * 2 * sizeof(ezxml_t));
+            if (n) root->link[(n - 1) * 2]->sibling = cur;
+            root->link[n++ * 2] = cur;
+        }
+        else root->link[i * 2 + 1]->next = cur;
+        root->link[i * 2 + 1] = cur;
+    }
+}
+
+// called when parser finds start of new tag
+void ezxml_open_tag(ezxml_root_t root, char *name, char **attr)
+{
+    ezxml_t xml = root->cur, child;
+    char **a;
+    int l;
+
+    if (! xml->name) xml->name = name; // first open tag
+    else { // same as ezxml_add_child(), but possibly in the arena
+        child = (ezxml_t)memset(root->use_arena
+                                ? ezxml_arena_alloc(root, sizeof(struct ezxml))
+                                : malloc(sizeof(struct ezxml)),
+                                '\0', sizeof(struct ezxml));
+        child->name = name;
+        child->attr = EZXML_NIL;
+        child->txt = "";
+        if (root->use_arena) child->flags = EZXML_ARENAN;
+        xml = ezxml_append(root, child, xml, root->txtl[root->depth * 2]);
+        root->depth++;
+    }
+    if (root->depth >= root->ntxtl)
+        root->txtl = realloc(root->txtl,
+                             (root->ntxtl = root->depth * 2 + 16) * 2 * sizeof(size_t));
+    root->txtl[root->depth * 2] = root->txtl[root->depth * 2 + 1] = 0;
+
+    if (root->use_arena && attr != EZXML_NIL) { // copy scratch list to the arena
+        for (l = 0; attr[l]; l += 2);
+        a = ezxml_arena_alloc(root, (l + 2) * sizeof(char *) + l / 2 + 1);
+        memcpy(a, attr, (l + 1) * sizeof(char *));
+        a[l + 1] = memcpy((char *)(a + l + 2), attr[l + 1], l / 2 + 1);
+        attr = a;
+        xml->flags |= EZXML_ARENAA;
+    }
     xml->attr = attr;
     root->cur = xml; // update tag insertion point
+    root->last = NULL; // which has no subtags yet
 }
 
 // called when parser finds character content between open and closing tag
@@ -254,19 +378,27 @@ void ezxml_char_content(ezxml_root_t root, char *s, size_t len, char t)
 {
     ezxml_t xml = root->cur;
     char *m = s;
-    size_t l;
+    size_t *l = root->txtl + root->depth * 2; // current length and space of txt
 
     if (! xml || ! xml->name || ! len) return; // sanity check
 
     s[len] = '\0'; // null terminate text (calling functions anticipate this)
     len = strlen(s = ezxml_decode(s, root->ent, t)) + 1;
 
-    if (! *(xml->txt)) xml->txt = s; // initial character content
-    else { // allocate our own memory and make a copy
-        xml->txt = (xml->flags & EZXML_TXTM) // allocate some space
-                   ? realloc(xml->txt, (l = strlen(xml->txt)) + len)
-                   : strcpy(malloc((l = strlen(xml->txt)) + len), xml->txt);
-        strcpy(xml->txt + l, s); // add new char content
+    if (! *(xml->txt)) { // initial character content
+        xml->txt = s;
+        l[0] = len - 1;
+        l[1] = 0; // space unknown, so the next append will allocate
+    }
+    else { // allocate our own memory and make a copy, growing it geometrically
+        if (l[0] + len > l[1]) {
+            l[1] = (l[0] + len) * 2;
+            xml->txt = (xml->flags & EZXML_TXTM) // allocate some space
+                       ? realloc(xml->txt, l[1])
+                       : memcpy(malloc(l[1]), xml->txt, l[0] + 1);
+        }
+        memcpy(xml->txt + l[0], s, len); // add new char content
+        l[0] += len - 1;
         if (s != m) free(s); // free s if it was malloced by ezxml_decode()
     }
 
@@ -279,7 +411,10 @@ ezxml_t ezxml_close_tag(ezxml_root_t root, char *name, char *s)
     if (! root->cur || ! root->cur->name || strcmp(name, root->cur->name))
         return ezxml_err(root, s, "unexpected closing tag </%s>", name);
 
+    ezxml_link(root, root->cur);
+    root->last = root->cur; // closed tag is now the last subtag of its parent
     root->cur = root->cur->parent;
+    root->depth--;
     return NULL;
 }
 
@@ -472,8 +607,9 @@ char *ezxml_str2utf8(char **s, size_t *len)
     return *s = realloc(u, *len = l);
 }
 
-// frees a tag attribute list
-void ezxml_free_attr(char **attr) {
+// frees the malloced names and values of a tag attribute list, and the list
+// itself unless it is in scratch space or the arena
+static void ezxml_free_attr_list(char **attr, short list) {
     int i = 0;
     char *m;
 
@@ -484,14 +620,20 @@ void ezxml_free_attr(char **attr) {
         if (m[i] & EZXML_NAMEM) free(attr[i * 2]);
         if (m[i] & EZXML_TXTM) free(attr[(i * 2) + 1]);
     }
-    free(m);
-    free(attr);
+    if (list) {
+        free(m);
+        free(attr);
+    }
 }
 
-// parse the given xml string and return an ezxml structure
-ezxml_t ezxml_parse_str(char *s, size_t len)
+// frees a tag attribute list
+void ezxml_free_attr(char **attr) {
+    ezxml_free_attr_list(attr, 1);
+}
+
+// parse the given xml string into the given root
+static ezxml_t ezxml_parse_root(ezxml_root_t root, char *s, size_t len)
 {
-    ezxml_root_t root = (ezxml_root_t)ezxml_new(NULL);
     char q, e, *d, **attr, **a = NULL; // initialize a to avoid compile warning
     int l, i, j;
 
@@ -525,10 +667,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                 for (i = 0; (a = root->attr[i]) && strcmp(a[0], d); i++);
 
             for (l = 0; *s && *s != '/' && *s != '>'; l += 2) { // new attrib
-                attr = (l) ? realloc(attr, (l + 4) * sizeof(char *))
-                           : malloc(4 * sizeof(char *)); // allocate space
-                attr[l + 3] = (l) ? realloc(attr[l + 1], (l / 2) + 2)
-                                  : malloc(2); // mem for list of maloced vals
+                attr = ezxml_attr_grow(root, attr, l); // allocate space
                 strcpy(attr[l + 3] + (l / 2), " "); // value is not malloced
                 attr[l + 2] = NULL; // null terminate list
                 attr[l + 1] = ""; // temporary attribute value
@@ -543,7 +682,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                         while (*s && *s != q) s++;
                         if (*s) *(s++) = '\0'; // null terminate attribute val
                         else {
-                            ezxml_free_attr(attr);
+                            ezxml_free_attr_list(attr, ! root->use_arena);
                             return ezxml_err(root, d, "missing %c", q);
                         }
 
@@ -560,7 +699,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
             if (*s == '/') { // self closing tag
                 *(s++) = '\0';
                 if ((*s && *s != '>') || (! *s && e != '>')) {
-                    if (l) ezxml_free_attr(attr);
+                    if (l) ezxml_free_attr_list(attr, ! root->use_arena);
                     return ezxml_err(root, d, "missing >");
                 }
                 ezxml_open_tag(root, d, attr);
@@ -572,7 +711,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                 *s = q;
             }
             else {
-                if (l) ezxml_free_attr(attr);
+                if (l) ezxml_free_attr_list(attr, ! root->use_arena);
                 return ezxml_err(root, d, "missing >");
             }
         }
@@ -625,6 +764,43 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
     else return ezxml_err(root, d, "unclosed tag <%s>", root->cur->name);
 }
 
+// parse the given xml string, optionally into an arena
+static ezxml_t ezxml_parse_mode(char *s, size_t len, short arena)
+{
+    ezxml_root_t root = (ezxml_root_t)ezxml_new(NULL);
+    ezxml_t xml, cur;
+
+    root->use_arena = arena;
+    xml = ezxml_parse_root(root, s, len);
+    for (cur = root->cur; cur; cur = cur->parent)
+        ezxml_link(root, cur); // tags left open by errors
+    root->use_arena = 0; // tags added later are malloced as usual
+    free(root->scratch);
+    free(root->mscratch);
+    free(root->txtl);
+    free(root->link);
+    root->scratch = NULL;
+    root->mscratch = NULL;
+    root->txtl = NULL;
+    root->link = NULL;
+    root->nscratch = 0;
+    root->ntxtl = 0;
+    root->nlink = 0;
+    return xml;
+}
+
+// parse the given xml string and return an ezxml structure
+ezxml_t ezxml_parse_str(char *s, size_t len)
+{
+    return ezxml_parse_mode(s, len, 0);
+}
+
+// parse the given xml string into an arena and return an ezxml structure
+ezxml_t ezxml_parse_str_arena(char *s, size_t len)
+{
+    return ezxml_parse_mode(s, len, 1);
+}
+
 // Wrapper for ezxml_parse_str() that accepts a file stream. Reads the entire
 // stream into memory and then parses it. For xml files, use ezxml_parse_file()
 // or ezxml_parse_fd()
@@ -646,10 +822,10 @@ ezxml_t ezxml_parse_fp(FILE *fp)
     return &root->xml;
 }
 
-// A wrapper for ezxml_parse_str() that accepts a file descriptor. First
-// attempts to mem map the file. Failing that, reads the file into memory.
-// Returns NULL on failure.
-ezxml_t ezxml_parse_fd(int fd)
+// Parses from a file descriptor, optionally into an arena. First attempts to
+// mem map the file and parse it in place. Failing that, reads the file into
+// memory. Returns NULL on failure.
+static ezxml_t ezxml_parse_fd_mode(int fd, short arena)
 {
     ezxml_root_t root;
     struct stat st;
@@ -664,7 +840,7 @@ ezxml_t ezxml_parse_fd(int fd)
     if ((m = mmap(NULL, l, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)) !=
         MAP_FAILED) {
         madvise(m, l, MADV_SEQUENTIAL); // optimize for sequential access
-        root = (ezxml_root_t)ezxml_parse_str(m, st.st_size);
+        root = (ezxml_root_t)ezxml_parse_mode(m, st.st_size, arena);
         madvise(m, root->len = l, MADV_NORMAL); // put it back to normal
     }
     else { // mmap failed, read file into memory
@@ -691,7 +867,7 @@ ezxml_t ezxml_parse_fd(int fd)
 #else
         l = read(fd, m = malloc(st.st_size), st.st_size);
 #endif
-        root = (ezxml_root_t)ezxml_parse_str(m, l);
+        root = (ezxml_root_t)ezxml_parse_mode(m, l, arena);
         root->len = -1; // so we know to free s in ezxml_free()
 #ifndef EZXML_NOMMAP
     }
@@ -699,6 +875,20 @@ ezxml_t ezxml_parse_fd(int fd)
     return &root->xml;
 }
 
+// A wrapper for ezxml_parse_str() that accepts a file descriptor. First
+// attempts to mem map the file. Failing that, reads the file into memory.
+// Returns NULL on failure.
+ezxml_t ezxml_parse_fd(int fd)
+{
+    return ezxml_parse_fd_mode(fd, 0);
+}
+
+// A wrapper for ezxml_parse_str_arena() that accepts a file descriptor
+ezxml_t ezxml_parse_fd_arena(int fd)
+{
+    return ezxml_parse_fd_mode(fd, 1);
+}
+
 // a wrapper for ezxml_parse_fd that accepts a file name
 ezxml_t ezxml_parse_file(const char *file)
 {
@@ -709,6 +899,16 @@ ezxml_t ezxml_parse_file(const char *file)
     return xml;
 }
 
+// a wrapper for ezxml_parse_fd_arena that accepts a file name
+ezxml_t ezxml_parse_file_arena(const char *file)
+{
+    int fd = open(file, O_RDONLY, 0);
+    ezxml_t xml = ezxml_parse_fd_arena(fd);
+
+    if (fd >= 0) close(fd);
+    return xml;
+}
+
 // Encodes ampersand sequences appending the results to *dst, reallocating *dst
 // if length excedes max. a is non-zero for attribute encoding. Returns *dst
 char *ezxml_ampencode(const char *s, ssize_t len, char **dst, size_t *dlen,
@@ -845,6 +1045,7 @@ char *ezxml_toxml(ezxml_t xml)
 void ezxml_free(ezxml_t xml)
 {
     ezxml_root_t root = (ezxml_root_t)xml;
+    ezxml_block_t b;
     int i, j;
     char **a, *s;
 
@@ -878,10 +1079,15 @@ void ezxml_free(ezxml_t xml)
         if (root->u) free(root->u); // utf8 conversion
     }
 
-    ezxml_free_attr(xml->attr); // tag attributes
+    ezxml_free_attr_list(xml->attr, ! (xml->flags & EZXML_ARENAA)); // attributes
     if ((xml->flags & EZXML_TXTM)) free(xml->txt); // character content
     if ((xml->flags & EZXML_NAMEM)) free(xml->name); // tag name
-    free(xml);
+    if (! xml->parent)
+        while ((b = root->arena)) { // free arena last: root attributes may be in it
+            root->arena = b->next;
+            free(b);
+        }
+    if (! (xml->flags & EZXML_ARENAN)) free(xml);
 }
 
 // return parser error message or empty string if none
@@ -979,8 +1185,17 @@ ezxml_t ezxml_set_txt(ezxml_t xml, const char *txt)
 ezxml_t ezxml_set_attr(ezxml_t xml, const char *name, const char *value)
 {
     int l = 0, c;
+    char **a;
 
     if (! xml) return NULL;
+    if (xml->flags & EZXML_ARENAA) { // attribute list in the arena: malloc a copy
+        for (c = 0; xml->attr[c]; c += 2);
+        a = memcpy(malloc((c + 2) * sizeof(char *)), xml->attr,
+                   (c + 1) * sizeof(char *));
+        a[c + 1] = strdup(xml->attr[c + 1]);
+        xml->attr = a;
+        xml->flags &= ~EZXML_ARENAA;
+    }
     while (xml->attr[l] && strcmp(xml->attr[l], name)) l += 2;
     if (! xml->attr[l]) { // not found, add as new attribute
         if (! value) return xml; // nothing to do
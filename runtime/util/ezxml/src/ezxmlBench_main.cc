@@ -0,0 +1,108 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark for parsing XML files with and without the ezxml arena.
+// Each file is parsed from a fresh in-memory copy for each iteration, and the
+// two resulting structures must convert back to identical XML.
+// Usage: ezxmlBench [-n iterations] file.xml ...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include "ezxml.h"
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static bool readFile(const char *file, std::string &data) {
+  FILE *f = fopen(file, "r");
+  if (!f)
+    return true;
+  char buf[8192];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  fclose(f);
+  return false;
+}
+
+// Parse the data nIter times in the given mode, returning seconds per parse
+static double bench(const std::string &data, unsigned nIter, bool arena, std::string &xml,
+		    std::string &err) {
+  std::vector<char> copy(data.size());
+  double total = 0;
+  for (unsigned n = 0; n < nIter; n++) {
+    memcpy(&copy[0], data.data(), data.size());
+    double t0 = now();
+    ezxml_t x = arena ? ezxml_parse_str_arena(&copy[0], copy.size()) :
+      ezxml_parse_str(&copy[0], copy.size());
+    ezxml_free(x);
+    total += now() - t0;
+  }
+  // Convert the last parse back to XML for comparison
+  memcpy(&copy[0], data.data(), data.size());
+  ezxml_t x = arena ? ezxml_parse_str_arena(&copy[0], copy.size()) :
+    ezxml_parse_str(&copy[0], copy.size());
+  err = ezxml_error(x);
+  char *s = ezxml_toxml(x);
+  xml = s;
+  free(s);
+  ezxml_free(x);
+  return total / nIter;
+}
+
+int main(int argc, char **argv) {
+  unsigned nIter = 100;
+  if (argc > 2 && !strcmp(argv[1], "-n")) {
+    nIter = (unsigned)strtoul(argv[2], NULL, 0);
+    argc -= 2, argv += 2;
+  }
+  if (argc < 2 || !nIter) {
+    fprintf(stderr, "Usage is: ezxmlBench [-n iterations] file.xml ...\n");
+    return 1;
+  }
+  bool bad = false;
+  for (int a = 1; a < argc; a++) {
+    std::string data, oldXml, newXml, oldErr, newErr;
+    if (readFile(argv[a], data) || data.empty()) {
+      fprintf(stderr, "Could not read file \"%s\"\n", argv[a]);
+      bad = true;
+      continue;
+    }
+    double
+      tOld = bench(data, nIter, false, oldXml, oldErr),
+      tNew = bench(data, nIter, true, newXml, newErr);
+    if (oldXml != newXml || oldErr != newErr) {
+      fprintf(stderr, "Arena parsing of \"%s\" produced different results\n", argv[a]);
+      bad = true;
+      continue;
+    }
+    printf("%-40s %9zu bytes  malloc %9.3f ms  arena %9.3f ms (%4.1fx)%s%s\n", argv[a],
+	   data.size(), tOld * 1e3, tNew * 1e3, tOld / tNew, oldErr.empty() ? "" : "  error: ",
+	   oldErr.c_str());
+  }
+  return bad ? 1 : 0;
+}
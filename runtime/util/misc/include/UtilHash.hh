@@ -36,6 +36,9 @@
 #ifndef OCPI_COMMON_HASH
 #define OCPI_COMMON_HASH
 
+#include <cstddef>
+#include <stdint.h>
+
 
 namespace OCPI {
         namespace Util {
@@ -48,6 +51,14 @@ namespace OCPI {
 
                         unsigned int hashCode( const char* string );
 
+                        /**
+                         * \brief Map a 64 bit hash to one of nBuckets buckets,
+                         * using the "jump consistent hash" of Lamping and Veach.
+                         * When nBuckets grows by one, only 1/nBuckets of the keys move.
+                         */
+
+                        size_t jumpHash( uint64_t key, size_t nBuckets );
+
                 }
 
         }
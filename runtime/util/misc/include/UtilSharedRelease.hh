@@ -0,0 +1,80 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Release of buffers that are shared by several readers instead of copied to each,
+ * used by local ports for zero-copy broadcast.  The sender counts a share for each
+ * reader before the reader can see the buffer, and each reader, on whatever thread,
+ * removes its share when done.  The sender hands its buffers back here in the order
+ * they were sent, and they are released in that order, each when it has no shares
+ * left, since the sender's buffers must be released in order.  The sender may limit
+ * how many are waiting, so that it stops sending when the slowest reader falls too
+ * far behind.  All but the ShareCount methods are used only by the sending thread.
+ */
+#ifndef UTIL_SHARED_RELEASE_H_
+#define UTIL_SHARED_RELEASE_H_
+
+#include <cstddef>
+#include <deque>
+
+namespace OCPI {
+  namespace Util {
+
+    // Embedded in what is shared
+    class ShareCount {
+      volatile unsigned m_count;
+    public:
+      ShareCount() : m_count(0) {}
+      inline void add() { __atomic_add_fetch(&m_count, 1, __ATOMIC_RELAXED); }
+      // The reader must not touch what it shared after this
+      inline void remove() { __atomic_sub_fetch(&m_count, 1, __ATOMIC_RELEASE); }
+      inline bool shared() const { return __atomic_load_n(&m_count, __ATOMIC_ACQUIRE) != 0; }
+    };
+
+    // T has a "ShareCount &shares()" method and a "void release()" method
+    template <class T> class SharedRelease {
+      std::deque<T*> m_waiting; // handed back, in order, not yet released
+      size_t         m_limit;   // the most that may wait, zero for no limit
+    public:
+      SharedRelease() : m_limit(0) {}
+      inline void setLimit(size_t limit) { m_limit = limit; }
+      inline size_t waiting() const { return m_waiting.size(); }
+      // Should the sender wait before sharing another buffer?
+      inline bool full() const { return m_limit && m_waiting.size() >= m_limit; }
+      // The sender is done with a buffer, whether or not it was shared
+      void release(T &t) {
+	if (m_waiting.empty() && !t.shares().shared())
+	  t.release();
+	else {
+	  m_waiting.push_back(&t);
+	  poll();
+	}
+      }
+      // Release those whose readers are done, in order
+      void poll() {
+	while (!m_waiting.empty() && !m_waiting.front()->shares().shared()) {
+	  m_waiting.front()->release();
+	  m_waiting.pop_front();
+	}
+      }
+    };
+  }
+}
+#endif
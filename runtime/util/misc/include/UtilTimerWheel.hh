@@ -0,0 +1,98 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A hierarchical timer wheel, used by the RCC container to schedule run condition
+ * timeouts of its workers.  Rather than each worker polling its own timer on every
+ * dispatch pass, the container advances the wheel once per pass, which marks the
+ * timers that have expired, and asks the wheel for the next deadline when it has
+ * nothing else to do, so that it can sleep until then.
+ *
+ * Deadlines are absolute, in nanoseconds of the steady (monotonic) clock, so that
+ * periodic workers can be rescheduled relative to their previous deadline and not
+ * drift.  All scheduling operations are performed under the container's mutex;
+ * only wait() and wake() are called without it.
+ */
+#ifndef UTIL_TIMER_WHEEL_H_
+#define UTIL_TIMER_WHEEL_H_
+
+#include <cstdint>
+#include <pthread.h>
+
+namespace OCPI {
+  namespace Util {
+
+    class TimerWheel {
+    public:
+      // A timer embedded in whatever is being timed
+      class Timer {
+	friend class TimerWheel;
+	TimerWheel *m_wheel;       // the wheel we are in, when armed
+	Timer      *m_next, **m_prev;
+	uint64_t    m_deadline;    // absolute, zero when not scheduled
+	unsigned    m_level;       // which level of the wheel we are in, when armed
+	bool        m_expired;
+      public:
+	Timer()
+	  : m_wheel(NULL), m_next(NULL), m_prev(NULL), m_deadline(0), m_level(0), m_expired(false) {}
+	~Timer() { cancel(); }
+	inline bool armed() const { return m_prev != NULL; }
+	// Has the timer fired since it was last scheduled?
+	inline bool expired() const { return m_expired; }
+	// The last deadline scheduled, which persists after expiration, zero if cancelled.
+	inline uint64_t deadline() const { return m_deadline; }
+	void cancel();
+      };
+    private:
+      // The tick is ~65us, and four levels of 256 slots cover ~78 hours.
+      static const unsigned c_tickShift = 16, c_levelBits = 8, c_nLevels = 4;
+      static const unsigned c_nSlots = 1u << c_levelBits, c_slotMask = c_nSlots - 1;
+      Timer   *m_slots[c_nLevels][c_nSlots];
+      unsigned m_nArmed[c_nLevels];
+      uint64_t m_current;          // all ticks before this one have been processed
+      // For wait() and wake()
+      pthread_mutex_t m_waitMutex;
+      pthread_cond_t  m_waitCond;
+      bool            m_woken;
+
+      void place(Timer &t);
+      void unlink(Timer &t);
+      void cascade(unsigned level);
+      TimerWheel(const TimerWheel &);
+      TimerWheel &operator=(const TimerWheel &);
+    public:
+      TimerWheel();
+      ~TimerWheel();
+      // The clock that deadlines are based on
+      static uint64_t now();
+      // (Re)arm the timer at an absolute deadline, clearing any previous expiration
+      void schedule(Timer &t, uint64_t deadline);
+      // Mark all timers whose deadline is not after "now" as expired, returning how many
+      unsigned advance(uint64_t now);
+      // The earliest deadline of any armed timer, or UINT64_MAX if there are none
+      uint64_t nextDeadline() const;
+      // Sleep until the deadline or until wake() is called, whichever comes first
+      void wait(uint64_t deadline);
+      // Cause a current or the next wait() to return immediately
+      void wake();
+    };
+  }
+}
+#endif
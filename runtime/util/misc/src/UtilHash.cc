@@ -66,3 +66,15 @@ OCPI::Util::Misc::hashCode( const char* string )
   return (hash_value & mask);
 
 }
+
+size_t
+OCPI::Util::Misc::jumpHash( uint64_t key, size_t nBuckets )
+{
+  int64_t b = -1, j = 0;
+  while (j < (int64_t)nBuckets) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = (int64_t)((double)(b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+  }
+  return (size_t)b;
+}
@@ -0,0 +1,209 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include "OsAssert.hh"
+#include "UtilTimerWheel.hh"
+
+namespace OCPI {
+  namespace Util {
+
+void TimerWheel::Timer::
+cancel() {
+  if (armed())
+    m_wheel->unlink(*this);
+  m_deadline = 0;
+  m_expired = false;
+}
+
+TimerWheel::
+TimerWheel()
+  : m_current(now() >> c_tickShift), m_woken(false) {
+  memset(m_slots, 0, sizeof(m_slots));
+  memset(m_nArmed, 0, sizeof(m_nArmed));
+  pthread_condattr_t ca;
+  ocpiCheck(pthread_condattr_init(&ca) == 0);
+  ocpiCheck(pthread_condattr_setclock(&ca, CLOCK_MONOTONIC) == 0);
+  ocpiCheck(pthread_cond_init(&m_waitCond, &ca) == 0);
+  pthread_condattr_destroy(&ca);
+  ocpiCheck(pthread_mutex_init(&m_waitMutex, NULL) == 0);
+}
+
+TimerWheel::
+~TimerWheel() {
+  for (unsigned l = 0; l < c_nLevels; l++)
+    for (unsigned s = 0; s < c_nSlots; s++)
+      while (m_slots[l][s])
+	unlink(*m_slots[l][s]);
+  pthread_cond_destroy(&m_waitCond);
+  pthread_mutex_destroy(&m_waitMutex);
+}
+
+uint64_t TimerWheel::
+now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Put the timer in the level and slot that its deadline falls in, relative to the current
+// tick.  Past deadlines go in the current slot, and deadlines beyond the last level go in
+// the furthest slot, to be placed again when that slot cascades.
+void TimerWheel::
+place(Timer &t) {
+  uint64_t tick = t.m_deadline >> c_tickShift;
+  if (tick < m_current)
+    tick = m_current;
+  uint64_t delta = tick - m_current;
+  unsigned level = 0;
+  while (level < c_nLevels - 1 && delta >= 1ull << ((level + 1) * c_levelBits))
+    level++;
+  if (delta >= 1ull << (c_nLevels * c_levelBits))
+    tick = m_current + (1ull << (c_nLevels * c_levelBits)) - 1;
+  Timer **head = &m_slots[level][(tick >> (level * c_levelBits)) & c_slotMask];
+  if ((t.m_next = *head))
+    t.m_next->m_prev = &t.m_next;
+  t.m_prev = head;
+  *head = &t;
+  t.m_level = level;
+  m_nArmed[level]++;
+}
+
+void TimerWheel::
+unlink(Timer &t) {
+  ocpiAssert(t.m_prev && m_nArmed[t.m_level]);
+  if ((*t.m_prev = t.m_next))
+    t.m_next->m_prev = t.m_prev;
+  t.m_next = NULL;
+  t.m_prev = NULL;
+  m_nArmed[t.m_level]--;
+}
+
+// Move the timers in the current slot of a level down to lower levels
+void TimerWheel::
+cascade(unsigned level) {
+  Timer **head = &m_slots[level][(m_current >> (level * c_levelBits)) & c_slotMask];
+  Timer *t = *head;
+  if (!t)
+    return;
+  *head = NULL;
+  for (Timer *next; t; t = next) {
+    next = t->m_next;
+    m_nArmed[level]--;
+    place(*t);
+  }
+}
+
+void TimerWheel::
+schedule(Timer &t, uint64_t a_deadline) {
+  if (t.armed())
+    t.m_wheel->unlink(t);
+  t.m_wheel = this;
+  t.m_deadline = a_deadline;
+  t.m_expired = false;
+  place(t);
+}
+
+unsigned TimerWheel::
+advance(uint64_t a_now) {
+  uint64_t target = a_now >> c_tickShift;
+  unsigned nExpired = 0;
+  for (;;) {
+    if (!m_nArmed[0]) {
+      // Nothing to expire in the first level: skip to the next cascade or the target
+      unsigned l;
+      for (l = 1; l < c_nLevels && !m_nArmed[l]; l++)
+	;
+      uint64_t skip = l == c_nLevels ? target : (m_current | c_slotMask);
+      if (skip > target)
+	skip = target;
+      if (skip > m_current)
+	m_current = skip;
+    } else {
+      // Timers in slots before the target have all expired; in the target slot only some.
+      for (Timer *t = m_slots[0][m_current & c_slotMask], *next; t; t = next) {
+	next = t->m_next;
+	if (m_current < target || t->m_deadline <= a_now) {
+	  unlink(*t);
+	  t->m_expired = true;
+	  nExpired++;
+	}
+      }
+    }
+    if (m_current >= target)
+      break;
+    if (!(++m_current & c_slotMask))
+      for (unsigned l = 1; l < c_nLevels; l++) {
+	cascade(l);
+	if ((m_current >> (l * c_levelBits)) & c_slotMask)
+	  break;
+      }
+  }
+  return nExpired;
+}
+
+// In each level, slots after the current one are in deadline order, so the first occupied
+// one has the earliest deadline of that level.  Higher levels' current slots can only hold
+// timers a full revolution away, so they are looked at last.  The last level may also hold
+// timers beyond its range, so all of its slots are looked at.
+uint64_t TimerWheel::
+nextDeadline() const {
+  uint64_t earliest = UINT64_MAX;
+  for (unsigned l = 0; l < c_nLevels; l++) {
+    if (!m_nArmed[l])
+      continue;
+    unsigned current = (unsigned)(m_current >> (l * c_levelBits)) & c_slotMask;
+    for (unsigned n = l ? 1 : 0; n <= c_nSlots; n++) {
+      const Timer *t = m_slots[l][(current + n) & c_slotMask];
+      if (t) {
+	for (; t; t = t->m_next)
+	  if (t->m_deadline < earliest)
+	    earliest = t->m_deadline;
+	if (l < c_nLevels - 1)
+	  break;
+      }
+    }
+  }
+  return earliest;
+}
+
+void TimerWheel::
+wait(uint64_t a_deadline) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)(a_deadline / 1000000000ull);
+  ts.tv_nsec = (long)(a_deadline % 1000000000ull);
+  ocpiCheck(pthread_mutex_lock(&m_waitMutex) == 0);
+  while (!m_woken && pthread_cond_timedwait(&m_waitCond, &m_waitMutex, &ts) != ETIMEDOUT)
+    ;
+  m_woken = false;
+  ocpiCheck(pthread_mutex_unlock(&m_waitMutex) == 0);
+}
+
+void TimerWheel::
+wake() {
+  ocpiCheck(pthread_mutex_lock(&m_waitMutex) == 0);
+  m_woken = true;
+  ocpiCheck(pthread_cond_signal(&m_waitCond) == 0);
+  ocpiCheck(pthread_mutex_unlock(&m_waitMutex) == 0);
+}
+  }
+}
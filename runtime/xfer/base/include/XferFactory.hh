@@ -47,6 +47,10 @@ namespace Xfer {
     size_t getSMBSize() const { return m_SMBSize; }
     size_t m_SMBSize;
     size_t m_retryCount;
+    // Placement of local endpoint memory: page size ("none", "transparent", "2M", "1G",
+    // optionally followed by ":<hugetlbfs-dir>") and NUMA node ("none", "local", or <n>).
+    // "local" is the node of the process's CPU affinity, e.g. as set by numactl or taskset.
+    std::string m_hugePages, m_numaNode;
     ezxml_t  m_xml; // the element that these attributes were parsed from
   };
 
@@ -154,10 +154,16 @@ parse(FactoryConfig *parent, ezxml_t x) {
     const char *err;
     // Note we are not writing defaults here because they are set
     // in the constructor, and they need to be set even when there is no xml
-    if ((err = OX::checkAttrs(x, "load", "SMBSize", "TxRetryCount", NULL)) ||
+    if ((err = OX::checkAttrs(x, "load", "SMBSize", "TxRetryCount", "HugePages", "NumaNode",
+			      NULL)) ||
 	(err = OX::getNumber(x, "SMBSize", &m_SMBSize, NULL, 0, false)) ||
 	(err = OX::getNumber(x, "TxRetryCount", &m_retryCount, NULL, 0, false)))
       throw std::string(err); // FIXME configuration api error exception class
+    const char *cp;
+    if ((cp = ezxml_cattr(x, "HugePages")))
+      m_hugePages = cp;
+    if ((cp = ezxml_cattr(x, "NumaNode")))
+      m_numaNode = cp;
   }
 }
 
@@ -58,6 +58,10 @@ configure(ezxml_t x) {
   if (env && OX::getUNum(env, &m_SMBSize))
     throw OU::Error("Invalid OCPI_SMB_SIZE value: %s", env);
   ocpiDebug("After environment, SMB size is %zu", m_SMBSize);
+  if ((env = getenv("OCPI_SMB_HUGE_PAGES")))
+    m_hugePages = env;
+  if ((env = getenv("OCPI_SMB_NUMA_NODE")))
+    m_numaNode = env;
   // Now configure the drivers
   OP::Manager::configure(x);
   for (XferFactory* d = firstDriver(); d; d = d->nextDriver())
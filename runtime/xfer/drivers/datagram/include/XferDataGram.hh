@@ -25,7 +25,7 @@
 #include <deque>
 #include <vector>
 #include "OsIovec.hh"
-#include "OsTimer.hh"
+#include "OsClock.hh"
 #include "UtilThread.hh"
 #include "UtilSelfMutex.hh"
 #include "XferDriver.hh"
@@ -99,7 +99,7 @@ protected:
 
 static const int MAX_MSGS = 10;  // FIXME can be calulated
 struct Frame {
-  OCPI::OS::Time       send_time;
+  uint64_t             send_time; // OCPI::OS::Clock nanoseconds, zero if not sent
   uint16_t             msg_start, msg_count;
   bool                 is_free;
   unsigned             resends;
@@ -244,8 +244,9 @@ public:
   void setAcks(Frame &f);
   void post(Frame &f);
   void processFrame(FrameHeader *frame);
-  void checkAcks(OCPI::OS::Time time, OCPI::OS::Time timeout);
-  void sendAcks(OCPI::OS::Time time_now, OCPI::OS::Time timeout);
+  // Times are OCPI::OS::Clock nanoseconds
+  void checkAcks(uint64_t time, uint64_t timeout);
+  void sendAcks(uint64_t time_now, uint64_t timeout);
   virtual uint16_t maxPayloadSize() = 0;
 
 private:
@@ -269,7 +270,7 @@ private:
   uint16_t                 m_frameSeq;
   std::vector<FrameRecord> m_frameSeqRecord;
   std::vector<MsgTransactionRecord> m_msgTransactionRecord;
-  OCPI::OS::Time m_last_ack_send;
+  uint64_t m_last_ack_send;
   unsigned m_transactions_in_play;
 };
 }
@@ -52,7 +52,7 @@ XferServices(XferFactory &driver, EndPoint &source, EndPoint &target) :
   m_lep(*static_cast<DGEndPoint *>(source.local() ? &source : &target)),
   m_rep(*static_cast<DGEndPoint *>(source.local() ? &target : &source)),
   m_freeFrames(MAX_FRAME_HISTORY), m_frameSeq(1), m_frameSeqRecord(MAX_FRAME_HISTORY),
-  m_msgTransactionRecord(MAX_TRANSACTION_HISTORY), m_last_ack_send(OS::Time::now()),
+  m_msgTransactionRecord(MAX_TRANSACTION_HISTORY), m_last_ack_send(OS::Clock::now()),
   m_transactions_in_play(0)
 {
   assert((source.local() && !target.local()) || (!source.local() && target.local()));
@@ -175,7 +175,7 @@ post(Frame & frame) {
   ocpiLog(9, "%s", msghdr(s, hdr, "OUT"));
   static_cast<SmemServices *>(&m_from.sMemServices())->send(frame, *static_cast<DGEndPoint*>(&m_to));
   // This must be *after* it is sent so that we do not retransmit it
-  frame.send_time = OS::Time::now();
+  frame.send_time = OS::Clock::now();
   // If there is nothing to ack (no messages) in this frame, free it as soon as it is sent.
   // The "send" is required to take it and not queue it (or at least copy it).
   if (!frame.msg_count)
@@ -183,11 +183,11 @@ post(Frame & frame) {
 }
 
 void XferServices::
-sendAcks(OS::Time time_now, OS::Time timeout) {
+sendAcks(uint64_t time_now, uint64_t timeout) {
   OU::SelfAutoMutex guard(this);
   if (m_acks.size() && (time_now - m_last_ack_send ) > timeout) {
     ocpiDebug("acks %zu now %" PRIu64 " timeout %" PRIu64 " m_last_ack_send %" PRIu64,
-	      m_acks.size(), time_now.bits(), timeout.bits(), m_last_ack_send.bits());
+	      m_acks.size(), time_now, timeout, m_last_ack_send);
     post(getFrame());
   }
 }
@@ -197,7 +197,7 @@ setAcks(Frame &f) {
   // We will piggyback any pending acks here
   f.frameHdr.ACKCount = 0;
   if (m_acks.size()) {
-    m_last_ack_send = OS::Time::now();
+    m_last_ack_send = OS::Clock::now();
     uint16_t seq = f.frameHdr.ACKStart = m_acks.front();
     do
       m_acks.pop_front();
@@ -370,19 +370,19 @@ SmemServices::
 // send acknowledgements occasionally
 void SmemServices::
 run() {
-  const OS::Time
-    checkTimeout(0, 200 * 1000 * 1000),
-    ackTimeout(0, 80 * 1000 * 1000);  // timeout in nSec
+  const uint64_t
+    checkTimeout = 200 * 1000 * 1000,
+    ackTimeout = 80 * 1000 * 1000;  // timeout in nSec
 
   do {
     for (size_t n = 0, max = m_ep.xferServicesSize(); n < max; ++n) {
       OU::SelfAutoMutex epGuard(&m_ep);
       XferServices *xfs = m_ep.xferServices(n);
       if (xfs) {
-	OS::Time time_now = OS::Time::now();
+	uint64_t time_now = OS::Clock::now();
 	xfs->checkAcks(time_now, checkTimeout);
 	OCPI::OS::sleep(2);
-	time_now = OS::Time::now();
+	time_now = OS::Clock::now();
 	xfs->sendAcks(time_now, ackTimeout);
 	OCPI::OS::sleep(2);
       }
@@ -392,11 +392,11 @@ run() {
 }
 
 void XferServices::
-checkAcks(OS::Time time, OS::Time time_out) {
+checkAcks(uint64_t time, uint64_t time_out) {
   OCPI::Util::SelfAutoMutex guard(this);
   for (unsigned n = 0; n < m_freeFrames.size(); n++) {
     Frame &f = m_freeFrames[n];
-    if (!f.is_free && (time - f.send_time) > time_out && f.send_time.bits()) {
+    if (!f.is_free && f.send_time && (time - f.send_time) > time_out) {
       ocpiLog(9, "Resending datagram frame %u try %u", f.frameHdr.frameSeq, f.resends);
       if (++f.resends > MAX_RESENDS)
 	ocpiBad("Datagram retransmissions exceeds %u for seq %u", MAX_RESENDS, f.frameHdr.frameSeq);
@@ -31,6 +31,7 @@
 #ifndef OcpiNT_FILE_MAPPING_SERVICES_H_
 #define OcpiNT_FILE_MAPPING_SERVICES_H_
 
+#include <string>
 #include "OsDataTypes.hh"
 
 namespace OCPI {
@@ -98,6 +99,19 @@ namespace PIO {
     //                DataTransferEx for all other exception conditions
     virtual int GetLastError () = 0;
 
+    // Request page size and NUMA placement for subsequent mappings.
+    //        Arguments:
+    //                hugePages        - "", "none", "transparent", "2M" or "1G",
+    //                                   optionally followed by ":<hugetlbfs directory>"
+    //                numaNode        - "", "none", "local" or a node number.  "local" is
+    //                                  the node of all the CPUs the process may run on,
+    //                                  which its containers' threads inherit, and means no
+    //                                  placement when those CPUs are on several nodes
+    //        Throws:
+    //                OCPI::Util::Error for invalid values
+    virtual void setPlacement(const std::string &/*hugePages*/,
+			      const std::string &/*numaNode*/) {}
+
     // Destructor
     virtual ~FileMapping () {};
   };
@@ -40,10 +40,21 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#endif
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "ocpi-config.h"
 #include "OsAssert.hh"
 #include "XferPioFileMapping.hh"
 #include "UtilMisc.hh"
+#include "UtilException.hh"
 
 #ifndef OCPI_OS_VERSION_zynq
 // This fails on zynq and we have not dug into it yet.
@@ -54,10 +65,52 @@ namespace Xfer {
 namespace PIO {
   namespace OU = OCPI::Util;
   // PosixFileMapping implements basic file mapping support on Posix compliant platforms.
+  // Local endpoint memory may be placed on explicit huge pages (a file in a hugetlbfs mount,
+  // whose pages are reserved at mmap time), on transparent huge pages (madvise), and/or on
+  // a preferred NUMA node (mbind before the creator first touches the memory).  The "local"
+  // node is that of the CPUs the process may run on, not of the thread creating the endpoint.
   class PosixFileMapping : public FileMapping
   {
     size_t m_size;
+    static const int NoNode = -1, LocalNode = -2;
   public:
+    void setPlacement(const std::string &hugePages, const std::string &numaNode) {
+      m_hugePageSize = 0;
+      m_transparent = false;
+      m_hugeDir.clear();
+      m_numaNode = NoNode;
+      std::string hp(hugePages);
+      size_t colon = hp.find(':');
+      if (colon != std::string::npos) {
+	m_hugeDir = hp.substr(colon + 1);
+	hp.resize(colon);
+      }
+      if (hp == "2M" || hp == "2m")
+	m_hugePageSize = 2 * 1024 * 1024;
+      else if (hp == "1G" || hp == "1g")
+	m_hugePageSize = 1024 * 1024 * 1024;
+      else if (!m_hugeDir.empty())
+	throw OU::Error("Invalid HugePages value \"%s\": a hugetlbfs directory requires 2M or 1G",
+			hugePages.c_str());
+      else if (hp == "transparent")
+	m_transparent = true;
+      else if (!hp.empty() && hp != "none")
+	throw OU::Error("Invalid HugePages value \"%s\": expected none, transparent, 2M or 1G",
+			hugePages.c_str());
+      if (m_hugePageSize && m_hugeDir.empty())
+	m_hugeDir = defaultHugeDir(m_hugePageSize);
+      if (numaNode == "local")
+	m_numaNode = LocalNode;
+      else if (!numaNode.empty() && numaNode != "none") {
+	char *end;
+	unsigned long n = strtoul(numaNode.c_str(), &end, 0);
+	if (*end || end == numaNode.c_str() || n > 1023)
+	  throw OU::Error("Invalid NumaNode value \"%s\": expected none, local or a node number",
+			  numaNode.c_str());
+	m_numaNode = (int)n;
+      }
+    }
+
     // Create a mapping to a named file.
     //	strFilePath - Path to a file. If null, no backing store.
     //	strMapName	- Name of the mapping. Can be null.
@@ -73,6 +126,9 @@ namespace PIO {
 #ifdef REAL_SHM
 	  // Set the size of the shared area if not already large enough
 	  // Note Darwin/MacOS doesn't allow truncating it more than once, so it can't expand either
+	  // Files on hugetlbfs can only be sized in units of its page size
+	  if (m_pageSize)
+	    iMaxSize = OU::roundUp(iMaxSize, m_pageSize);
 	  struct stat statbuf;
 	  rc = fstat (m_fd, &statbuf);
 	  if (rc == 0 && statbuf.st_size < (off_t)iMaxSize)
@@ -143,8 +199,12 @@ namespace PIO {
 #endif
 	  ocpiDebug("mmap on %d at offset %u length %zu returns %p errno %d",
 		    m_fd, iOffset, lLength, iRet, errno);
-	  if (iRet != MAP_FAILED)
+	  if (iRet != MAP_FAILED) {
+	    // Placement must be applied before anything touches the pages
+	    if (m_created)
+	      applyPlacement(iRet, lLength);
 	    ocpiDebug("mmap value at %p is %" PRIx32, iRet, *(uint32_t*)iRet);
+	  }
 	}
       m_length = lLength;
       return iRet;
@@ -167,7 +227,8 @@ namespace PIO {
 
     // Constructor
     PosixFileMapping ()
-      : m_fd(-1), m_errno(0), m_length(0), m_created(false)
+      : m_size(0), m_hugePageSize(0), m_transparent(false), m_numaNode(NoNode), m_pageSize(0),
+	m_fd(-1), m_errno(0), m_length(0), m_created(false)
     {}
 
     // Destructor
@@ -176,6 +237,12 @@ namespace PIO {
     };
 
   private:
+    size_t m_hugePageSize;      // explicit huge page size requested, or 0
+    bool m_transparent;         // advise transparent huge pages
+    std::string m_hugeDir;      // hugetlbfs mount for explicit huge pages
+    int m_numaNode;             // preferred NUMA node, NoNode or LocalNode
+    std::string m_path;         // when not empty, the hugetlbfs file rather than a shm object
+    size_t m_pageSize;          // page size of the hugetlbfs file, or 0
     std::string m_name;
     int	m_fd;			// File descriptor
     int	m_errno;		// Last error.
@@ -202,7 +269,23 @@ namespace PIO {
       m_name = strMapName[0] == '/' ? strMapName : "/" + strMapName;
       // Open a shared memory object
 #ifdef REAL_SHM
-      m_fd = shm_open (m_name.c_str (), iOpenFlags | iFlags, 0666);
+      m_path.clear();
+      m_pageSize = 0;
+      m_fd = -1;
+      if (m_hugePageSize && iFlags == O_CREAT &&
+	  (m_fd = openHuge(m_hugeDir, iOpenFlags | iFlags)) == -1)
+	ocpiInfo("Could not create %s in hugetlbfs directory \"%s\" (%s): "
+		 "using normal pages", m_name.c_str(), m_hugeDir.c_str(), strerror(errno));
+      if (m_fd == -1 && (m_fd = shm_open (m_name.c_str (), iOpenFlags | iFlags, 0666)) == -1 &&
+	  errno == ENOENT && iFlags == 0) {
+	// The creator may have put it in a hugetlbfs directory
+	if ((!m_hugeDir.empty() && (m_fd = openHuge(m_hugeDir, iOpenFlags)) != -1) ||
+	    (m_fd = openHuge(defaultHugeDir(2 * 1024 * 1024), iOpenFlags)) != -1 ||
+	    (m_fd = openHuge(defaultHugeDir(1024 * 1024 * 1024), iOpenFlags)) != -1)
+	  ocpiDebug("Attached to %s in hugetlbfs", m_path.c_str());
+	else
+	  errno = ENOENT;
+      }
 #else
       // Use anonymous mappings
       static int fakefd = 1000;
@@ -226,14 +309,112 @@ namespace PIO {
     {
       if ( m_fd != -1 ) {
       ocpiDebug("shm closing %s fd %d created %d", m_name.c_str(), m_fd, m_created);
-	if (m_created)
-	  shm_unlink(m_name.c_str());
+	if (m_created) {
+	  if (m_path.empty())
+	    shm_unlink(m_name.c_str());
+	  else
+	    unlink(m_path.c_str());
+	}
 	close (m_fd);
       }
       m_fd =  -1;
       return 0;
     }
 
+    static const char *defaultHugeDir(size_t pageSize) {
+      return pageSize > 2 * 1024 * 1024 ? "/dev/hugepages1G" : "/dev/hugepages";
+    }
+
+    // Open (or create) our named file in a hugetlbfs directory, recording its path and page size
+    int openHuge(const std::string &dir, int iOpenFlags) {
+      std::string path = dir + m_name;
+      int fd = open(path.c_str(), iOpenFlags, 0666);
+      if (fd == -1)
+	return -1;
+      m_path = path;
+#ifdef __linux__
+      struct statfs sfs;
+      if (fstatfs(fd, &sfs) == 0) {
+	m_pageSize = (size_t)sfs.f_bsize;
+	if ((iOpenFlags & O_CREAT) && m_pageSize != m_hugePageSize)
+	  ocpiInfo("Hugetlbfs directory \"%s\" has page size %zu, not the requested %zu",
+		   dir.c_str(), m_pageSize, m_hugePageSize);
+      }
+#endif
+      return fd;
+    }
+
+    // Apply transparent huge page advice and NUMA policy to a new mapping we created.
+    // Failures are not fatal: the memory is still usable with default placement.
+    void applyPlacement(void *addr, size_t length) {
+#ifdef __linux__
+#ifdef MADV_HUGEPAGE
+      if (m_transparent && madvise(addr, length, MADV_HUGEPAGE))
+	ocpiInfo("Transparent huge pages not available for %s: %s",
+		 m_name.c_str(), strerror(errno));
+#endif
+      if (m_numaNode == NoNode)
+	return;
+      unsigned node = (unsigned)m_numaNode;
+      if (m_numaNode == LocalNode && !affinityNode(node)) {
+	ocpiInfo("No single local NUMA node for %s: the process may run on CPUs of several nodes",
+		 m_name.c_str());
+	return;
+      }
+      const unsigned bits = sizeof(unsigned long) * 8;
+      std::vector<unsigned long> mask(node / bits + 1, 0);
+      mask[node / bits] = 1ul << (node % bits);
+      // MPOL_PREFERRED rather than MPOL_BIND so an exhausted node degrades rather than fails
+      const int mpolPreferred = 1;
+      if (syscall(SYS_mbind, addr, length, mpolPreferred, &mask[0],
+		  (unsigned long)(mask.size() * bits + 1), 0))
+	ocpiInfo("Could not place %s on NUMA node %u: %s", m_name.c_str(), node, strerror(errno));
+      else
+	ocpiDebug("Placed %s (%zu bytes) on NUMA node %u", m_name.c_str(), length, node);
+#else
+      (void)addr; (void)length;
+#endif
+    }
+
+#ifdef __linux__
+    // The NUMA node of a CPU, from its "nodeN" entry in sysfs
+    static bool cpuNode(unsigned cpu, unsigned &node) {
+      char dir[64];
+      snprintf(dir, sizeof(dir), "/sys/devices/system/cpu/cpu%u", cpu);
+      DIR *d = opendir(dir);
+      if (!d)
+	return false;
+      bool found = false;
+      for (struct dirent *e; !found && (e = readdir(d)); )
+	if (!strncmp(e->d_name, "node", 4) && isdigit(e->d_name[4])) {
+	  node = (unsigned)atoi(e->d_name + 4);
+	  found = true;
+	}
+      closedir(d);
+      return found;
+    }
+
+    // The "local" node is where the containers consuming from this endpoint run.
+    // Endpoints are shared by all the containers of the process, and container threads
+    // inherit the CPU affinity of the process, so this is the node holding all the CPUs
+    // the process may run on.  False when those CPUs span several nodes.
+    static bool affinityNode(unsigned &node) {
+      cpu_set_t cpus;
+      if (sched_getaffinity(getpid(), sizeof(cpus), &cpus))
+	return false;
+      bool found = false;
+      for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	if (CPU_ISSET(cpu, &cpus)) {
+	  unsigned n;
+	  if (!cpuNode(cpu, n) || (found && n != node))
+	    return false;
+	  node = n;
+	  found = true;
+	}
+      return found;
+    }
+#endif
+
     // Map an AccessType to a POSIX open flags
     int MapAccessTypeToOpen (AccessType eAccess)
     {
@@ -37,6 +37,7 @@
 #include <map>
 #include "XferException.hh"
 #include "XferEndPoint.hh"
+#include "XferFactory.hh"
 #include "XferPioSmemServices.hh"
 #include "XferPioFileMapping.hh"
 
@@ -122,6 +123,7 @@ namespace PIO {
 #if 1
 	  m_pSmem = new HostSmem(loc, handle, pMapper);
 	  BaseSmemServices::add(m_pSmem);
+	  pMapper->setPlacement(loc->factory().m_hugePages, loc->factory().m_numaNode);
           ocpiDebug("Creating mapping of size %zu name %s", loc->size(), m_pSmem->m_name.c_str());
           if ((rc = pMapper->CreateMapping ("", m_pSmem->m_name.c_str(),
 					    FileMapping::ReadWriteAccess, loc->size())))
@@ -209,6 +211,7 @@ namespace PIO {
 #if 1
 	      pSmem = new HostSmem(m_location, handle, pMapper);
 	      BaseSmemServices::add(pSmem);
+	      pMapper->setPlacement(loc->factory().m_hugePages, loc->factory().m_numaNode);
               if (pMapper->OpenMapping(pSmem->m_name.c_str(),
 				       FileMapping::AllAccess))
                 throw DataTransferEx(RESOURCE_EXCEPTION,
@@ -20,7 +20,15 @@
 
 #include <inttypes.h>
 #include <unistd.h>  // FIXME for gethostname - use OS::
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
 #include <deque>
+#include <set>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
 #include "OsSocket.hh"
 #include "OsMisc.hh"
 #include "OsAssert.hh"
@@ -54,6 +62,7 @@ class EndPoint: public XF::EndPoint {
   friend class XferServices;
   friend class SmemServices;
   friend class ServerSocketHandler;
+  friend class Stream;
 protected:
   std::string m_ipAddress;
   uint16_t    m_portNum;
@@ -137,6 +146,77 @@ protected:
   }
 };
 
+// Receiving state for the stream of messages (header, data, then flag) from one peer
+class Stream {
+  EndPoint     &m_sep;
+  SmemServices &m_smem;
+  FlagHeader    m_header;
+  uint8_t      *m_current;  // where the next bytes go, or NULL when given to the receiver
+  size_t        m_left;     // bytes left in the current header or data
+  bool          m_inHeader;
+public:
+  Stream(EndPoint &sep, SmemServices &smem)
+    : m_sep(sep), m_smem(smem), m_current((uint8_t*)&m_header), m_left(sizeof(m_header)),
+      m_inHeader(true) {
+  }
+  bool inHeader() const { return m_inHeader; }
+  size_t left() const { return m_left; }
+  // Where the next "length" bytes may be received directly, or NULL if they must be
+  // received elsewhere and passed to consume().
+  uint8_t *next(size_t &length) const { length = m_left; return m_current; }
+  // Process n received bytes at data, or, when data is NULL, n bytes already received
+  // at the place returned by next().
+  void consume(uint8_t *data, size_t n) {
+    size_t copy_len;
+    for (; n; n -= copy_len) {
+      copy_len = std::min(n, m_left);
+      ocpiDebug("Copying socket data to %p, size = %zu, in header %d, left %zu",
+		m_current, copy_len, m_inHeader, m_left);
+      if (m_current) {
+	if (data)
+	  memcpy(m_current, data, copy_len);
+	m_current += copy_len;
+      } else {
+	assert(data);
+	m_sep.receiver()->receive(m_header.dataOffset, data, copy_len);
+	m_header.dataOffset += OCPI_UTRUNCATE(Offset, copy_len);
+      }
+      if (data)
+	data += copy_len;
+      if (!(m_left -= copy_len)) // finishing header or data
+	finish();
+    }
+  }
+private:
+  void finish() {
+    if (m_inHeader) {
+      size_t dataLength = XF::FlagMeta::getLengthInFlag(m_header.flagValue);
+      ocpiDebug("Received Header: len %zu dataOff 0x%" PRIx32 " flagOff 0x%" PRIx32
+		"flag 0x%" PRIx32,
+		dataLength, m_header.dataOffset, m_header.flagOffset, m_header.flagValue);
+      if (dataLength) {
+	m_left = dataLength;
+	m_inHeader = false;
+	m_current =
+	  m_sep.receiver() ? NULL : (uint8_t *)m_smem.map(m_header.dataOffset, dataLength);
+	return;
+      }
+    }
+    // end of data or a zlm header
+    if (m_header.flagOffset) {
+      assert(!(m_header.flagOffset & (sizeof(uint32_t)-1)));
+      if (m_sep.receiver())
+	m_sep.receiver()->receive(m_header.flagOffset, (uint8_t*)&m_header.flagValue,
+				  sizeof(uint32_t));
+      else
+	*(uint32_t *)m_smem.map(m_header.flagOffset, sizeof(uint32_t)) = m_header.flagValue;
+    }
+    m_current = (uint8_t*)&m_header;
+    m_left = sizeof(m_header); // packed
+    m_inHeader = true;
+  }
+};
+
 // Thread per peer writing to this endpoint
 class ServerSocketHandler : public OU::Thread {
   EndPoint     &m_sep;
@@ -167,63 +247,18 @@ public:
     m_run = false;
   }
 
-  void doFlag() {
-  }
-
   void run() {
     try {
       size_t     n = 0;
       std::vector<uint8_t> buf(m_receiveSize);
-      FlagHeader header;
-      uint8_t   *current_ptr = (uint8_t*)&header;
-      size_t     bytes_left = sizeof(header);
-      bool       in_header = true;;
+      Stream     stream(m_sep, m_smem);
 
       while (m_run && (n = m_socket.recv((char*)&buf[0], m_receiveSize, 500))) {
 	if (n == SIZE_MAX)
 	  continue; // allow timeout so m_run can go away and shut us down
-	size_t copy_len;
-	for (uint8_t *bp = &buf[0]; n; n -= copy_len, bp += copy_len) {
-	  copy_len = std::min(n, bytes_left);
-	  ocpiDebug("Copying socket data to %p, size = %zu, in header %d, left %zu, first %x",
-		    current_ptr, copy_len, in_header, bytes_left, *(uint32_t *)bp);
-	  if (current_ptr) {
-	    memcpy(current_ptr, bp, copy_len );
-	    current_ptr += copy_len;
-	  } else {
-	    m_sep.receiver()->receive(header.dataOffset, bp, copy_len);
-	    header.dataOffset += OCPI_UTRUNCATE(Offset, copy_len);
-	  }
-	  if (!(bytes_left -= copy_len)) { // finishing header or data
-	    if (in_header) {
-	      size_t dataLength = XF::FlagMeta::getLengthInFlag(header.flagValue);
-	      ocpiDebug("Received Header: len %zu dataOff 0x%" PRIx32 " flagOff 0x%" PRIx32
-			"flag 0x%" PRIx32,
-			dataLength, header.dataOffset, header.flagOffset, header.flagValue);
-	      if (dataLength) {
-		bytes_left = dataLength;
-		in_header = false;
-		current_ptr =
-		  m_sep.receiver() ? NULL : (uint8_t *)m_smem.map(header.dataOffset, dataLength);
-		if (dataLength + sizeof(header) > m_receiveSize)
-		  buf.resize((m_receiveSize = dataLength + sizeof(header)));
-		continue;
-	      }
-	    }
-	    // end of data or a zlm header
-	    if (header.flagOffset) {
-	      assert(!(header.flagOffset & (sizeof(uint32_t)-1)));
-	      if (m_sep.receiver())
-		m_sep.receiver()->receive(header.flagOffset, (uint8_t*)&header.flagValue,
-					  sizeof(uint32_t));
-	      else
-		*(uint32_t *)m_smem.map(header.flagOffset, sizeof(uint32_t)) = header.flagValue;
-	    }
-	    current_ptr = (uint8_t*)&header;
-	    bytes_left = sizeof(header); // packed
-	    in_header = true;
-	  }
-	}
+	stream.consume(&buf[0], n);
+	if (!stream.inHeader() && stream.left() + sizeof(FlagHeader) > m_receiveSize)
+	  buf.resize((m_receiveSize = stream.left() + sizeof(FlagHeader)));
       }
       if (n == 0)
 	ocpiInfo("Got a socket EOF for endpoint, terminating connection");
@@ -237,18 +272,27 @@ public:
   }
 };
 
-// Master listener thread per endpoint to receive connection requests from peers
+// Master listener thread per endpoint to receive connection requests from peers.
+// By default each peer gets its own receiving thread.  When the OCPI_SOCKET_EVENT_LOOP
+// environment variable is set (Linux only), this thread instead receives from all peers
+// using a single epoll event loop, receiving message data directly into the endpoint.
 class ServerT : public OU::Thread {
   EndPoint                         &m_sep;
   SmemServices                     &m_smem;
   bool                              m_stop;
   bool                              m_started;
   bool                              m_error;
+  bool                              m_eventLoop;
   OS::ServerSocket                  m_server;
   std::deque<ServerSocketHandler *> m_sockets;
 public:  
   ServerT(EndPoint &sep, SmemServices &smem)
-    : m_sep(sep), m_smem(smem), m_stop(false), m_started(false), m_error(false) {
+    : m_sep(sep), m_smem(smem), m_stop(false), m_started(false), m_error(false),
+      m_eventLoop(false) {
+#ifdef __linux__
+    const char *env = getenv("OCPI_SOCKET_EVENT_LOOP");
+    m_eventLoop = env && env[0] && strcmp(env, "0");
+#endif
     // This server socket setup must happen in the constructor because the port
     // must be determined before this returns.
     try {
@@ -284,6 +328,13 @@ public:
 
   void run() {
     m_started = true;
+#ifdef __linux__
+    if (m_eventLoop) {
+      runEventLoop();
+      m_server.close();
+      return;
+    }
+#endif
     while (!m_stop) {
       if (m_server.wait(500)) // give a chance to stop every 1/2 second
 	m_sockets.push_back(new ServerSocketHandler(m_server, m_sep, m_smem));
@@ -297,6 +348,104 @@ public:
     }
     m_server.close();
   }
+#ifdef __linux__
+private:
+  // A peer whose messages are received by the event loop
+  struct Peer {
+    OS::Socket socket;
+    Stream     stream;
+    Peer(EndPoint &sep, SmemServices &smem) : stream(sep, smem) {}
+  };
+  // Receive what is available from a peer, returning false when it should be dropped.
+  // The number of reads is bounded so that one busy peer cannot starve the others: being
+  // level-triggered, epoll will report it again.
+  bool receive(Peer &p, std::vector<uint8_t> &buf) {
+    for (unsigned reads = 0; reads < 16; reads++) {
+      size_t length;
+      uint8_t *direct = p.stream.next(length);
+      // Headers are read in bulk with whatever follows them, since messages are often small.
+      // Data goes straight to its place in the endpoint's memory
+      bool intoPlace = direct && !p.stream.inHeader();
+      ssize_t n = intoPlace ?
+	::recv(p.socket.fd(), direct, length, 0) : ::recv(p.socket.fd(), &buf[0], buf.size(), 0);
+      if (n > 0)
+	p.stream.consume(intoPlace ? NULL : &buf[0], (size_t)n);
+      else if (n == 0) {
+	ocpiInfo("Got a socket EOF for endpoint, terminating connection");
+	return false;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK)
+	break;
+      else if (errno != EINTR) {
+	ocpiBad("Error receiving on endpoint socket: %s", strerror(errno));
+	return false;
+      }
+    }
+    return true;
+  }
+  void runEventLoop() {
+    int efd = epoll_create1(EPOLL_CLOEXEC);
+    if (efd < 0) {
+      ocpiBad("Cannot create socket event loop: %s", strerror(errno));
+      return;
+    }
+    ocpiInfo("Socket endpoint %s receiving using an event loop", m_sep.name().c_str());
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; // the listening socket
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, m_server.fd(), &ev))
+      ocpiBad("Cannot add listener to socket event loop: %s", strerror(errno));
+    std::set<Peer *> peers;
+    std::vector<uint8_t> buf(256*1024);
+    struct epoll_event events[64];
+    while (!m_stop) {
+      int nEvents = epoll_wait(efd, events, 64, 500); // give a chance to stop every 1/2 second
+      if (nEvents < 0 && errno != EINTR) {
+	ocpiBad("Socket event loop wait failed: %s", strerror(errno));
+	break;
+      }
+      for (int n = 0; n < nEvents; n++) {
+	Peer *p = (Peer *)events[n].data.ptr;
+	bool ok = true;
+	try {
+	  if (!p) {
+	    p = new Peer(m_sep, m_smem);
+	    peers.insert(p);
+	    m_server.accept(p->socket);
+	    p->socket.linger(true); // give some time for data to the client
+	    int fd = p->socket.fd(), flags = fcntl(fd, F_GETFL);
+	    ev.events = EPOLLIN | EPOLLRDHUP;
+	    ev.data.ptr = p;
+	    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) ||
+		epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev)) {
+	      ocpiBad("Cannot add peer to socket event loop: %s", strerror(errno));
+	      ok = false;
+	    }
+	  } else
+	    ok = receive(*p, buf);
+	} catch (std::string &s) {
+	  ocpiBad("Exception in endpoint socket event loop: %s", s.c_str());
+	  ok = false;
+	}
+	if (!ok && p) {
+	  epoll_ctl(efd, EPOLL_CTL_DEL, p->socket.fd(), NULL);
+	  try {
+	    p->socket.close();
+	  } catch (...) {}
+	  peers.erase(p);
+	  delete p;
+	}
+      }
+    }
+    for (auto pi = peers.begin(); pi != peers.end(); ++pi) {
+      try {
+	(*pi)->socket.close();
+      } catch (...) {}
+      delete *pi;
+    }
+    ::close(efd);
+  }
+public:
+#endif
   void stop() { m_stop=true; }
   void btr() {
     while (!m_started)
@@ -0,0 +1,183 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <cstring>
+#include "gtest/gtest.h"
+#include "BaseExpression.hh"
+
+namespace {
+  namespace OB = OCPI::Base;
+
+  // The identifiers a, b and s, with a count of how often they are looked up
+  struct Resolver : public OB::IdentResolver {
+    int64_t a, b;
+    const char *s;
+    mutable unsigned lookups;
+    Resolver(int64_t aa, int64_t bb, const char *ss) : a(aa), b(bb), s(ss), lookups(0) {}
+    const char *getValue(const char *sym, OB::ExprValue &val) const {
+      lookups++;
+      if (!strcmp(sym, "a"))
+	val.setNumber(a);
+      else if (!strcmp(sym, "b"))
+	val.setNumber(b);
+      else if (!strcmp(sym, "s"))
+	val.setString(s);
+      else
+	return "identifier not defined";
+      return NULL;
+    }
+    // Set values for the slots of a compiled expression, false if there is no value
+    bool bind(const OB::ExprCompiled &expr, OB::ExprValue *values) const {
+      for (size_t n = 0; n < expr.nSymbols(); n++)
+	if (getValue(expr.symbol(n), values[n]))
+	  return false;
+      return true;
+    }
+  };
+
+  // What an evaluation produced, for comparison
+  std::string result(const char *err, const OB::ExprValue &v) {
+    std::string s, value;
+    if (err)
+      return s = std::string("error: ") + err;
+    v.getString(value);
+    return s = (v.isNumber() ? "number: " : "string: ") + value;
+  }
+
+  const char *exprs[] = {
+    "a + b * 2",
+    "(a - b) / (b + 1)",
+    "a % 7 == 3 ? \"odd\" : s",
+    "a < b && b != 0",
+    "~a ^ b | 5",
+    "a << 3 >> 1",
+    "s ? a : -b",
+    "!s",
+    "a >= 10 ? \"big\" : \"small\"",
+    "true ? a : b",
+    "FALSE || a == b",
+    "s == \"x\"",
+    "a + c",
+    "(a + b",
+    "a ? b :",
+  };
+  const int64_t as[] = { -7, 0, 1, 12, 1000 }, bs[] = { 0, 3, 17 };
+  const char *ss[] = { "", "x" };
+
+  // Compiled once and evaluated with many bindings, by resolver or by slot, an expression
+  // gives what evaluating its source afresh gives for each
+  TEST( TestExprCompiled, matchesInterpreted )
+  {
+    for (unsigned e = 0; e < sizeof(exprs)/sizeof(*exprs); e++) {
+      OB::ExprCompiled expr;
+      const char *cerr = expr.compile(exprs[e]);
+      for (unsigned ia = 0; ia < sizeof(as)/sizeof(*as); ia++)
+	for (unsigned ib = 0; ib < sizeof(bs)/sizeof(*bs); ib++)
+	  for (unsigned is = 0; is < sizeof(ss)/sizeof(*ss); is++) {
+	    Resolver r(as[ia], bs[ib], ss[is]);
+	    OB::ExprValue interpreted;
+	    std::string expected = result(OB::evalExpression(exprs[e], interpreted, &r),
+					  interpreted);
+	    SCOPED_TRACE(std::string(exprs[e]) + " with " + expected);
+	    if (cerr) {
+	      // Compile errors are those of the interpreter, which never gets to evaluate
+	      EXPECT_EQ( result(cerr, interpreted), expected );
+	      continue;
+	    }
+	    OB::ExprValue resolved;
+	    EXPECT_EQ( result(expr.evaluate(resolved, &r), resolved), expected );
+	    // Unknown identifiers can't be bound, so slots only apply to the others
+	    OB::ExprValue values[3], bound;
+	    ASSERT_LE( expr.nSymbols(), 3u );
+	    if (r.bind(expr, values)) {
+	      EXPECT_EQ( result(expr.evaluate(bound, values, expr.nSymbols()), bound), expected );
+	    }
+	  }
+    }
+  }
+
+  // Numeric results agree with the same expression computed in C++
+  TEST( TestExprCompiled, matchesCpp )
+  {
+    OB::ExprCompiled expr;
+    ASSERT_EQ( expr.compile("a * 3 + (b << 2) - a % 5 + (a > b ? a - b : b - a)"),
+	       (const char *)NULL );
+    for (int64_t a = -20; a <= 20; a += 3)
+      for (int64_t b = 0; b <= 9; b++) {
+	Resolver r(a, b, "");
+	OB::ExprValue v;
+	ASSERT_EQ( expr.evaluate(v, &r), (const char *)NULL );
+	ASSERT_TRUE( v.isNumber() );
+	EXPECT_EQ( v.getNumber(), a * 3 + (b << 2) - a % 5 + (a > b ? a - b : b - a) );
+      }
+  }
+
+  // Identifiers get one slot each, in order of appearance, and true/false are constants
+  TEST( TestExprCompiled, symbols )
+  {
+    OB::ExprCompiled expr;
+    EXPECT_FALSE( expr.isCompiled() );
+    ASSERT_EQ( expr.compile("b + a * b - true + (False ? a : 1)"), (const char *)NULL );
+    EXPECT_TRUE( expr.isCompiled() );
+    EXPECT_EQ( expr.source(), "b + a * b - true + (False ? a : 1)" );
+    ASSERT_EQ( expr.nSymbols(), 2u );
+    EXPECT_STREQ( expr.symbol(0), "b" );
+    EXPECT_STREQ( expr.symbol(1), "a" );
+    // Each evaluation looks up every occurrence, even in the branch not taken, as the
+    // interpreter does
+    Resolver r(2, 5, "");
+    OB::ExprValue v;
+    ASSERT_EQ( expr.evaluate(v, &r), (const char *)NULL );
+    EXPECT_EQ( v.getNumber(), 5 + 2 * 5 - 1 + 1 );
+    EXPECT_EQ( r.lookups, 4u );
+  }
+
+  TEST( TestExprCompiled, errors )
+  {
+    OB::ExprCompiled expr;
+    EXPECT_NE( expr.compile("a + \"b"), (const char *)NULL );
+    EXPECT_FALSE( expr.isCompiled() );
+    ASSERT_EQ( expr.compile("a + b"), (const char *)NULL );
+    OB::ExprValue noResolver;
+    EXPECT_NE( expr.evaluate(noResolver), (const char *)NULL );
+    OB::ExprValue values[1], tooFew;
+    values[0].setNumber(1);
+    EXPECT_NE( expr.evaluate(tooFew, values, 1), (const char *)NULL );
+  }
+
+  // Copies are independent of the original
+  TEST( TestExprCompiled, copy )
+  {
+    OB::ExprCompiled *expr = new OB::ExprCompiled;
+    ASSERT_EQ( expr->compile("a - b"), (const char *)NULL );
+    OB::ExprCompiled copy(*expr), assigned;
+    assigned = *expr;
+    ASSERT_EQ( expr->compile("a + b"), (const char *)NULL );
+    delete expr;
+    Resolver r(10, 4, "");
+    OB::ExprValue v1, v2;
+    ASSERT_EQ( copy.evaluate(v1, &r), (const char *)NULL );
+    ASSERT_EQ( assigned.evaluate(v2, &r), (const char *)NULL );
+    EXPECT_EQ( v1.getNumber(), 6 );
+    EXPECT_EQ( v2.getNumber(), 6 );
+  }
+
+} // anon namespace
@@ -0,0 +1,171 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gtest/gtest.h"
+#include "ContainerManager.hh"
+#include "ContainerBasicPort.hh"
+
+namespace {
+  namespace OA = OCPI::API;
+  namespace OC = OCPI::Container;
+  namespace OM = OCPI::Metadata;
+
+  const size_t bufferSize = 256;
+
+  // Port metadata as it would come from a worker
+  struct MetaPort : public OM::Port {
+    MetaPort(const char *name, bool provider) {
+      m_name = name;
+      m_provider = provider;
+      m_bufferSize = bufferSize;
+    }
+  };
+
+  // An in-process connection as made between an external port and a worker port:
+  // the input holds the buffers and the output is forwarded to it
+  struct Port : public OC::BasicPort {
+    Port(const OM::Port &mp) : OC::BasicPort(container(), mp, mp.m_provider, NULL) {}
+    static OC::Container &container() {
+      OA::Container *c = OA::ContainerManager::find("rcc");
+      assert(c);
+      return *static_cast<OC::Container *>(c);
+    }
+    void shim(Port &output) {
+      output.setBufferSize(m_bufferSize);
+      becomeShim(&output);
+      output.forward2shim(*this);
+    }
+    size_t nBuffers() const { return m_nBuffers; }
+  };
+
+  struct Connection {
+    MetaPort m_inMeta, m_outMeta;
+    Port m_in, m_out;
+    Connection() : m_inMeta("in", true), m_outMeta("out", false), m_in(m_inMeta),
+		   m_out(m_outMeta) {
+      m_in.shim(m_out);
+    }
+    // Put a message from the output side, true if there was room
+    bool put(uint8_t opCode) {
+      uint8_t *data;
+      size_t length;
+      OA::ExternalBuffer *b = m_out.getBuffer(data, length);
+      if (!b)
+	return false;
+      memset(data, opCode, 8);
+      b->put(8, opCode);
+      return true;
+    }
+  };
+
+  bool readable(int fd) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) == 1;
+  }
+
+  uint64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+  }
+
+  // The fd becomes readable when a buffer is put or released, and getBuffer clears it
+  TEST( TestExternalReady, signalAndClear )
+  {
+    Connection c;
+    int fd = c.m_in.readyFd();
+    ASSERT_GE( fd, 0 );
+    // Both sides wait on the port that holds the buffers
+    EXPECT_EQ( c.m_out.readyFd(), fd );
+    EXPECT_FALSE( readable(fd) );
+    ASSERT_TRUE( c.put(1) );
+    EXPECT_TRUE( readable(fd) );
+    // A second put while still signaled leaves it readable
+    ASSERT_TRUE( c.put(2) );
+    EXPECT_TRUE( readable(fd) );
+    uint8_t *data, opCode;
+    size_t length;
+    bool end;
+    OA::ExternalBuffer *b = c.m_in.getBuffer(data, length, opCode, end);
+    ASSERT_TRUE( b != NULL );
+    EXPECT_EQ( opCode, 1 );
+    EXPECT_EQ( length, 8u );
+    EXPECT_FALSE( readable(fd) );
+    b->release();
+    EXPECT_TRUE( readable(fd) );
+    b = c.m_in.getBuffer(data, length, opCode, end);
+    ASSERT_TRUE( b != NULL );
+    EXPECT_EQ( opCode, 2 );
+    EXPECT_FALSE( readable(fd) );
+    b->release();
+    // Nothing left to read: getBuffer clears it and finds nothing
+    EXPECT_TRUE( c.m_in.getBuffer(data, length, opCode, end) == NULL );
+    EXPECT_FALSE( readable(fd) );
+  }
+
+  // Timed getBuffer returns NULL when nothing arrives, on either side
+  TEST( TestExternalReady, timeout )
+  {
+    Connection c;
+    uint8_t *data, opCode;
+    size_t length;
+    bool end;
+    uint64_t start = now();
+    EXPECT_TRUE( c.m_in.getBuffer(data, length, opCode, end, 20000) == NULL );
+    EXPECT_GE( now() - start, 20000u );
+    // Fill all the buffers so the output has nowhere to put
+    for (size_t n = 0; n < c.m_in.nBuffers(); n++)
+      ASSERT_TRUE( c.put((uint8_t)n) );
+    start = now();
+    EXPECT_TRUE( c.m_out.getBuffer(data, length, 20000) == NULL );
+    EXPECT_GE( now() - start, 20000u );
+  }
+
+  // A waiting getBuffer wakes when another thread puts a buffer
+  void *putter(void *arg) {
+    usleep(10000);
+    static_cast<Connection *>(arg)->put(7);
+    return NULL;
+  }
+
+  TEST( TestExternalReady, wake )
+  {
+    Connection c;
+    pthread_t thread;
+    ASSERT_EQ( pthread_create(&thread, NULL, putter, &c), 0 );
+    uint8_t *data, opCode;
+    size_t length;
+    bool end;
+    uint64_t start = now();
+    OA::ExternalBuffer *b = c.m_in.getBuffer(data, length, opCode, end, 5000000);
+    pthread_join(thread, NULL);
+    ASSERT_TRUE( b != NULL );
+    EXPECT_EQ( opCode, 7 );
+    EXPECT_LT( now() - start, 5000000u );
+    b->release();
+  }
+
+} // anon namespace
@@ -0,0 +1,128 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "gtest/gtest.h"
+#include "OsDebug.hh"
+
+namespace {
+  // OCPI_LOG_ASYNC is read once per process, so the logging is done by this program
+  // run again with it set, running only the DISABLED_child test below.
+  const unsigned nThreads = 4, nMessages = 200; // all fit in one ring, which may be reused
+
+  void *logThread(void *arg) {
+    for (unsigned n = 0; n < nMessages; n++)
+      OCPI::OS::logPrint(8, "thread %u message %u", (unsigned)(size_t)arg, n);
+    return NULL;
+  }
+
+  size_t count(const std::string &s, const char *what) {
+    size_t n = 0;
+    for (size_t pos = 0; (pos = s.find(what, pos)) != std::string::npos; pos++)
+      n++;
+    return n;
+  }
+
+  TEST( TestOcpiOsAsyncLog, DISABLED_child )
+  {
+    if (!getenv("OCPI_LOG_ASYNC"))
+      return;
+    // The format is copied: this one is changed before it could be drained
+    {
+      std::string fmt("transient format %d");
+      OCPI::OS::logPrint(8, fmt.c_str(), 1);
+      fmt.assign(fmt.size(), 'X');
+    }
+    // Strings with a precision need not be terminated: this one is just before a page
+    // that can't be read
+    long page = sysconf(_SC_PAGESIZE);
+    char *mem = (char *)mmap(NULL, (size_t)page * 2, PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE( mem, MAP_FAILED );
+    ASSERT_EQ( mprotect(mem + page, (size_t)page, PROT_NONE), 0 );
+    char *abcd = mem + page - 4;
+    memcpy(abcd, "abcd", 4);
+    OCPI::OS::logPrint(8, "unterminated %.4s|%.*s|%.2s", abcd, 4, abcd, abcd);
+    pthread_t threads[nThreads];
+    for (unsigned n = 0; n < nThreads; n++)
+      ASSERT_EQ( pthread_create(&threads[n], NULL, logThread, (void *)(size_t)n), 0 );
+    for (unsigned n = 0; n < nThreads; n++)
+      pthread_join(threads[n], NULL);
+    // A forked child has no drain thread, so it must log synchronously
+    pid_t pid = fork();
+    ASSERT_GE( pid, 0 );
+    if (pid == 0) {
+      OCPI::OS::logPrint(8, "forked child %s", "message");
+      _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    // Written when the process exits
+    OCPI::OS::logPrint(8, "last %s", "message");
+  }
+
+  TEST( TestOcpiOsAsyncLog, output )
+  {
+    char name[] = "/tmp/test-debug-async-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    pid_t pid = fork();
+    ASSERT_GE( pid, 0 );
+    if (pid == 0) {
+      int null = open("/dev/null", O_WRONLY);
+      dup2(null, 1);
+      dup2(fd, 2);
+      setenv("OCPI_LOG_ASYNC", "1", 1);
+      setenv("OCPI_LOG_LEVEL", "8", 1);
+      execl("/proc/self/exe", "ocpitests", "--gtest_filter=TestOcpiOsAsyncLog.DISABLED_child",
+	    "--gtest_also_run_disabled_tests", (char *)NULL);
+      _exit(1);
+    }
+    int status;
+    ASSERT_EQ( waitpid(pid, &status, 0), pid );
+    EXPECT_TRUE( WIFEXITED(status) && WEXITSTATUS(status) == 0 );
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET);
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+      out.append(buf, (size_t)n);
+    close(fd);
+    unlink(name);
+    EXPECT_EQ( count(out, "transient format 1\n"), 1u );
+    EXPECT_EQ( count(out, "unterminated abcd|abcd|ab\n"), 1u );
+    EXPECT_EQ( count(out, " message "), nThreads * nMessages );
+    for (unsigned t = 0; t < nThreads; t++) {
+      snprintf(buf, sizeof(buf), "thread %u message %u\n", t, nMessages - 1);
+      EXPECT_EQ( count(out, buf), 1u ) << buf;
+    }
+    EXPECT_EQ( count(out, "forked child message\n"), 1u );
+    EXPECT_EQ( count(out, "last message\n"), 1u );
+    EXPECT_EQ( count(out, "dropped"), 0u );
+  }
+
+} // anon namespace
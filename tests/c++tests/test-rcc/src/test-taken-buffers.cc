@@ -0,0 +1,189 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <set>
+#include <utility>
+#include "gtest/gtest.h"
+#include "OcpiContainerApi.hh"
+#include "ContainerWorker.hh"
+#include "ContainerPort.hh"
+#include "RccDriver.hh"
+#include "RccWorker.hh"
+
+namespace {
+  namespace OA = OCPI::API;
+  namespace OC = OCPI::Container;
+  namespace OR = OCPI::RCC;
+
+  const unsigned nBuffers = 3;
+  const size_t bufferSize = 64;
+
+  OR::RCCResult run(OR::RCCWorker *, OR::RCCBoolean, OR::RCCBoolean *) { return OR::RCC_OK; }
+
+  // A worker with one input and one output, which is never started: the test drives its
+  // ports as the worker's run method would
+  OR::RCCDispatch dispatch = {
+    RCC_VERSION, 1, 1, 0, NULL, 0,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, run,
+    NULL, NULL, 0, 0
+  };
+
+  // The ports as a C++ worker has them
+  struct UserPort : public OR::RCCUserPort {
+  };
+
+  // The worker's output connected to its own input
+  struct Loopback {
+    OA::ContainerApplication *m_app;
+    OR::Worker *m_worker;
+    UserPort *m_in, *m_out;
+    Loopback() {
+      OA::Container *c = OA::ContainerManager::find("rcc");
+      assert(c);
+      m_app = c->createApplication();
+      OC::Worker &w = static_cast<OC::Worker &>
+	(m_app->createWorker(NULL, NULL, (const char *)&dispatch, NULL, NULL, NULL));
+      m_worker = dynamic_cast<OR::Worker *>(&w);
+      assert(m_worker);
+      OC::Port &in = w.createInputPort(0, nBuffers, bufferSize);
+      w.createOutputPort(1, nBuffers, bufferSize).connect(in);
+      // User ports are constructed in ordinal order on the worker's thread
+      pthread_setspecific(OR::Driver::s_threadKey, m_worker);
+      m_in = new UserPort;
+      m_out = new UserPort;
+      pthread_setspecific(OR::Driver::s_threadKey, NULL);
+    }
+    ~Loopback() {
+      delete m_in;
+      delete m_out;
+      delete m_app;
+    }
+    // Send a message on the output, true if there was room
+    bool send(OR::RCCOpCode opCode) {
+      if (!m_out->hasBuffer())
+	return false;
+      m_out->setInfo(opCode, 8);
+      m_out->advance();
+      return true;
+    }
+  };
+
+  // Taken buffer objects come from a pool per port, and are reused rather than allocated
+  TEST( TestTakenBuffers, pool )
+  {
+    Loopback l;
+    std::set<OR::RCCUserBuffer *> objects;
+    for (unsigned round = 0; round < 4; round++) {
+      OR::RCCUserBuffer *taken[nBuffers];
+      for (unsigned n = 0; n < nBuffers; n++) {
+	ASSERT_TRUE( l.send((OR::RCCOpCode)n) );
+	ASSERT_TRUE( l.m_in->hasBuffer() );
+	taken[n] = &l.m_in->take();
+	EXPECT_EQ( taken[n]->opCode(), n );
+	objects.insert(taken[n]);
+      }
+      // All input buffers are taken, so the output can't send
+      EXPECT_FALSE( l.send(0) );
+      for (unsigned n = 0; n < nBuffers; n++)
+	taken[n]->release();
+      // The pool was filled to the buffer count on first use, and never grew
+      EXPECT_EQ( objects.size(), nBuffers );
+    }
+  }
+
+  // Taking with an old buffer releases it and gives its object back to the pool
+  TEST( TestTakenBuffers, takeWithOld )
+  {
+    Loopback l;
+    ASSERT_TRUE( l.send(1) );
+    ASSERT_TRUE( l.m_in->hasBuffer() );
+    OR::RCCUserBuffer *old = &l.m_in->take();
+    ASSERT_TRUE( l.send(2) );
+    ASSERT_TRUE( l.m_in->hasBuffer() );
+    OR::RCCUserBuffer &b = l.m_in->take(old);
+    EXPECT_EQ( b.opCode(), 2 );
+    b.release();
+    // The object of the old buffer is reused first
+    ASSERT_TRUE( l.send(3) );
+    ASSERT_TRUE( l.m_in->hasBuffer() );
+    EXPECT_EQ( &l.m_in->take(), &b );
+  }
+
+  // A taken buffer handle releases its buffer when destroyed, and moves transfer that duty
+  TEST( TestTakenBuffers, handle )
+  {
+    Loopback l;
+    for (unsigned n = 0; n < nBuffers; n++)
+      ASSERT_TRUE( l.send((OR::RCCOpCode)n) );
+    EXPECT_FALSE( l.send(0) );
+    {
+      ASSERT_TRUE( l.m_in->hasBuffer() );
+      OR::RCCTakenBuffer h = l.m_in->takeBuffer();
+      ASSERT_TRUE( (bool)h );
+      EXPECT_EQ( h->opCode(), 0 );
+      OR::RCCTakenBuffer moved(std::move(h));
+      EXPECT_FALSE( (bool)h );
+      ASSERT_TRUE( (bool)moved );
+      EXPECT_EQ( moved->opCode(), 0 );
+      // Assigning over a handle releases what it held
+      ASSERT_TRUE( l.m_in->hasBuffer() );
+      OR::RCCTakenBuffer other = l.m_in->takeBuffer();
+      EXPECT_EQ( other->opCode(), 1 );
+      moved = std::move(other);
+      EXPECT_FALSE( (bool)other );
+      EXPECT_EQ( moved->opCode(), 1 );
+      EXPECT_TRUE( l.send(3) );
+      EXPECT_FALSE( l.send(0) );
+      // Detaching gives up the buffer without releasing it
+      OR::RCCUserBuffer *b = moved.detach();
+      EXPECT_FALSE( (bool)moved );
+      EXPECT_FALSE( l.send(0) );
+      b->release();
+    }
+    EXPECT_TRUE( l.send(4) );
+    // Destroying a handle releases its buffer
+    {
+      ASSERT_TRUE( l.m_in->hasBuffer() );
+      OR::RCCTakenBuffer h = l.m_in->takeBuffer();
+      EXPECT_EQ( h->opCode(), 2 );
+      EXPECT_FALSE( l.send(0) );
+    }
+    EXPECT_TRUE( l.send(5) );
+  }
+
+  // Sending through a handle empties it, and sending an empty handle is an error
+  TEST( TestTakenBuffers, send )
+  {
+    Loopback from, to;
+    ASSERT_TRUE( from.send(1) );
+    ASSERT_TRUE( from.m_in->hasBuffer() );
+    OR::RCCTakenBuffer h = from.m_in->takeBuffer();
+    // Send the input buffer on another worker's output
+    to.m_out->send(h);
+    EXPECT_FALSE( (bool)h );
+    ASSERT_TRUE( to.m_in->hasBuffer() );
+    EXPECT_EQ( to.m_in->opCode(), 1 );
+    EXPECT_THROW( to.m_out->send(h), OCPI::Util::Error );
+    OR::RCCTakenBuffer empty;
+    EXPECT_THROW( to.m_out->send(empty), OCPI::Util::Error );
+  }
+
+} // anon namespace
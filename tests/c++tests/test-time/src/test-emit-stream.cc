@@ -0,0 +1,210 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "gtest/gtest.h"
+#include "TimeEmit.hh"
+
+#ifdef OCPI_TIME_EMIT_SUPPORT
+namespace {
+  namespace OT = OCPI::Time;
+
+  // Time::Emit state is global to the process and is not reusable after shutdown,
+  // so each stream is recorded by a child process.
+  struct Recorder : public OT::Emit {
+    Recorder() : OT::Emit("Recorder", "rec") {}
+  };
+  const unsigned nEvents = 10000; // more than a thread Q holds
+
+  // Record a stream into "file" in a child, which either shuts down or just exits
+  void record(const char *file, const char *format, bool shutdown) {
+    pid_t pid = fork();
+    ASSERT_GE( pid, 0 );
+    if (pid == 0) {
+      setenv("OCPI_TIME_EMIT_STREAM", file, 1);
+      setenv("OCPI_TIME_EMIT_STREAM_FORMAT", format, 1);
+      unsetenv("OCPI_TIME_EMIT_THREAD_Q_SIZE");
+      static OT::Emit::RegisterEvent
+	plain("plain"), value("value", 32, OT::Emit::Value, OT::Emit::DT_u);
+      Recorder r;
+      for (unsigned n = 0; n < nEvents; n++) {
+	r.emit(plain);
+	r.emit(value, (uint64_t)n);
+	if (n % 1000 == 999 && n + 1 < nEvents)
+	  usleep(50000); // let the drain empty the thread Q, but not after the last events
+      }
+      if (shutdown) {
+	OT::Emit::shutdown();
+	_exit(0);
+      }
+      exit(0);
+    }
+    int status;
+    ASSERT_EQ( waitpid(pid, &status, 0), pid );
+    ASSERT_TRUE( WIFEXITED(status) && WEXITSTATUS(status) == 0 );
+  }
+
+  std::string readFile(const char *file) {
+    std::string s;
+    FILE *f = fopen(file, "rb");
+    if (f) {
+      char buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), f)))
+	s.append(buf, n);
+      fclose(f);
+    }
+    return s;
+  }
+
+  size_t count(const std::string &s, const char *what) {
+    size_t n = 0;
+    for (size_t pos = 0; (pos = s.find(what, pos)) != std::string::npos; pos++)
+      n++;
+    return n;
+  }
+
+  void checkBinary(const char *file) {
+    OT::EmitStreamReader reader(file);
+    OT::EmitStreamReader::Event e;
+    unsigned nPlain = 0, nValue = 0;
+    uint64_t lastNs = 0;
+    while (reader.next(e)) {
+      const OT::EmitStreamReader::EventDef &ed = reader.eventDef(e.eid);
+      EXPECT_NE( reader.ownerDef(e.owner).name.find("Recorder"), std::string::npos );
+      EXPECT_GE( e.ns, lastNs );
+      lastNs = e.ns;
+      if (ed.name == "plain") {
+	EXPECT_EQ( ed.type, OT::Emit::Transient );
+	nPlain++;
+      } else if (ed.name == "value") {
+	EXPECT_EQ( ed.type, OT::Emit::Value );
+	EXPECT_EQ( ed.dtype, OT::Emit::DT_u );
+	EXPECT_EQ( ed.width, 32u );
+	EXPECT_EQ( e.value, nValue );
+	nValue++;
+      }
+    }
+    EXPECT_EQ( nPlain, nEvents );
+    EXPECT_EQ( nValue, nEvents );
+  }
+
+  TEST( TestEmitStream, binaryShutdown )
+  {
+    char name[] = "/tmp/test-emit-stream-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    close(fd);
+    record(name, "BINARY", true);
+    checkBinary(name);
+    unlink(name);
+  }
+
+  // Without shutdown, the stream is finished at exit
+  TEST( TestEmitStream, binaryExit )
+  {
+    char name[] = "/tmp/test-emit-stream-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    close(fd);
+    record(name, "BINARY", false);
+    checkBinary(name);
+    unlink(name);
+  }
+
+  TEST( TestEmitStream, jsonExit )
+  {
+    char name[] = "/tmp/test-emit-stream-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    close(fd);
+    record(name, "JSON", false);
+    std::string s = readFile(name);
+    unlink(name);
+    ASSERT_GT( s.size(), 4u );
+    EXPECT_EQ( s.compare(0, 37, "{\"displayTimeUnit\":\"ns\",\"traceEvents\""), 0 );
+    EXPECT_EQ( s.substr(s.size() - 4), "\n]}\n" );
+    EXPECT_EQ( count(s, "\"ph\":\"i\""), nEvents );
+    EXPECT_EQ( count(s, "\"ph\":\"C\""), nEvents );
+  }
+
+  // A thread that outlives shutdown() keeps its Q and records nothing more
+  pthread_barrier_t s_barrier;
+  void *lateRecorder(void *arg) {
+    Recorder &r = *static_cast<Recorder *>(arg);
+    static OT::Emit::RegisterEvent late("late");
+    r.emit(late, 1);
+    pthread_barrier_wait(&s_barrier); // this thread's Q exists
+    pthread_barrier_wait(&s_barrier); // shut down
+    for (unsigned n = 0; n < nEvents; n++)
+      r.emit(late, n);
+    return NULL;
+  }
+
+  TEST( TestEmitStream, recordAfterShutdown )
+  {
+    pid_t pid = fork();
+    ASSERT_GE( pid, 0 );
+    if (pid == 0) {
+      unsetenv("OCPI_TIME_EMIT_STREAM");
+      unsetenv("OCPI_TIME_EMIT_THREAD_Q_SIZE");
+      Recorder r;
+      pthread_t thread;
+      pthread_barrier_init(&s_barrier, NULL, 2);
+      if (pthread_create(&thread, NULL, lateRecorder, &r))
+	_exit(1);
+      pthread_barrier_wait(&s_barrier);
+      OT::Emit::shutdown();
+      pthread_barrier_wait(&s_barrier);
+      pthread_join(thread, NULL);
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ( waitpid(pid, &status, 0), pid );
+    EXPECT_TRUE( WIFEXITED(status) && WEXITSTATUS(status) == 0 );
+  }
+
+  TEST( TestEmitStream, badFiles )
+  {
+    EXPECT_THROW( OT::EmitStreamReader("/nonexistent/stream"), OCPI::Util::EmbeddedException );
+    char name[] = "/tmp/test-emit-stream-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    ASSERT_EQ( write(fd, "{\"displayTimeUnit\"", 18), 18 );
+    close(fd);
+    EXPECT_THROW( OT::EmitStreamReader reader(name), OCPI::Util::EmbeddedException );
+    // A truncated event
+    FILE *f = fopen(name, "wb");
+    fwrite("OCPITRC1E\001", 1, 10, f);
+    fclose(f);
+    OT::EmitStreamReader reader(name);
+    OT::EmitStreamReader::Event e;
+    EXPECT_THROW( reader.next(e), OCPI::Util::EmbeddedException );
+    unlink(name);
+  }
+
+} // anon namespace
+#endif
@@ -0,0 +1,153 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "TimeVcdMerge.hh"
+
+namespace {
+  namespace OT = OCPI::Time;
+
+  // Temporary input files, removed at the end of each test
+  struct Inputs {
+    std::vector<std::string> names;
+    ~Inputs() {
+      for (unsigned n = 0; n < names.size(); n++)
+	unlink(names[n].c_str());
+    }
+    // Write a trace with one variable, "token", changing at each of the times
+    void add(const char *var, const char *token, const std::vector<unsigned> &times) {
+      char name[] = "/tmp/test-vcd-merge-XXXXXX";
+      int fd = mkstemp(name);
+      ASSERT_GE( fd, 0 );
+      names.push_back(name);
+      FILE *f = fdopen(fd, "w");
+      fprintf(f, "$date\n  today\n$end\n$timescale\n  1 ns\n$end\n$scope module Software $end\n"
+	      "$var wire 1 %s %s $end\n$upscope $end\n$enddefinitions $end\n"
+	      "$dumpvars\n0%s\n$end\n", token, var, token);
+      for (unsigned n = 0; n < times.size(); n++)
+	fprintf(f, "\n#%u\n%c%s\n", times[n], n & 1 ? '0' : '1', token);
+      fprintf(f, "\n$dumpoff\n$end\n");
+      fclose(f);
+    }
+  };
+
+  // Merge into a string
+  std::string merge(const Inputs &in, const std::vector<int64_t> &offsets, bool align,
+		    uint64_t &blocks) {
+    FILE *f = tmpfile();
+    OT::VcdMerge m(in.names, offsets, align);
+    blocks = m.merge(f);
+    std::string s;
+    rewind(f);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)))
+      s.append(buf, n);
+    fclose(f);
+    return s;
+  }
+
+  // The merged values: one "time:value" per value change, from the $dumpoff on
+  std::string values(const std::string &s) {
+    size_t pos = s.find("$dumpoff");
+    EXPECT_NE( pos, std::string::npos );
+    std::string out, time;
+    const char *p = s.c_str() + pos;
+    for (const char *nl; (nl = strchr(p, '\n')); p = nl + 1) {
+      std::string line(p, (size_t)(nl - p));
+      if (line.empty() || line[0] == '$')
+	continue;
+      if (line[0] == '#')
+	time = line.substr(1);
+      else
+	out += time + ":" + line + " ";
+    }
+    return out;
+  }
+
+  std::vector<unsigned> times(unsigned a, unsigned b, unsigned c) {
+    std::vector<unsigned> v;
+    v.push_back(a);
+    v.push_back(b);
+    v.push_back(c);
+    return v;
+  }
+
+  // Three inputs with interleaved times, some equal across inputs and with the same
+  // variable name in two of them
+  TEST( TestVcdMerge, kWay )
+  {
+    Inputs in;
+    in.add("a", "!", times(10, 40, 70));
+    in.add("b", "!", times(20, 40, 80));
+    in.add("a", "\"", times(5, 50, 60));
+    ASSERT_EQ( in.names.size(), 3u );
+    uint64_t blocks;
+    std::string s = merge(in, std::vector<int64_t>(), false, blocks);
+    EXPECT_EQ( blocks, 9u );
+    // Each input's token and name are replaced with merged ones, without collisions
+    EXPECT_NE( s.find("$var wire 1 ! a $end"), std::string::npos );
+    EXPECT_NE( s.find("$var wire 1 \" b $end"), std::string::npos );
+    EXPECT_NE( s.find("$var wire 1 # a_Mrg $end"), std::string::npos );
+    EXPECT_NE( s.find("$timescale\n          1 ns"), std::string::npos );
+    EXPECT_NE( s.find("$dumpvars\n0!\n0\"\n0#\n$end"), std::string::npos );
+    EXPECT_EQ( values(s),
+	       "5:1# 10:1! 20:1\" 40:0! 40:0\" 50:0# 60:1# 70:1! 80:1\" " );
+  }
+
+  TEST( TestVcdMerge, offsets )
+  {
+    Inputs in;
+    in.add("a", "!", times(10, 40, 70));
+    in.add("b", "!", times(20, 40, 80));
+    ASSERT_EQ( in.names.size(), 2u );
+    std::vector<int64_t> offsets;
+    offsets.push_back(100);
+    offsets.push_back(-15);
+    uint64_t blocks;
+    EXPECT_EQ( values(merge(in, offsets, false, blocks)),
+	       "5:1\" 25:0\" 65:1\" 110:1! 140:0! 170:1! " );
+    // Aligned, both start at the earliest time
+    EXPECT_EQ( values(merge(in, std::vector<int64_t>(), true, blocks)),
+	       "10:1! 10:1\" 30:0\" 40:0! 70:1! 70:1\" " );
+    EXPECT_THROW( OT::VcdMerge(in.names, std::vector<int64_t>(1), false), std::string );
+  }
+
+  TEST( TestVcdMerge, badFiles )
+  {
+    std::vector<std::string> names(1, "/nonexistent/trace.vcd");
+    EXPECT_THROW( OT::VcdMerge(names, std::vector<int64_t>(), false), std::string );
+    char name[] = "/tmp/test-vcd-merge-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    ASSERT_EQ( write(fd, "not a trace\n", 12), 12 );
+    close(fd);
+    names[0] = name;
+    EXPECT_THROW( OT::VcdMerge(names, std::vector<int64_t>(), false), std::string );
+    unlink(name);
+  }
+
+} // anon namespace
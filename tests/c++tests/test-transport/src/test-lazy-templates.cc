@@ -0,0 +1,126 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "gtest/gtest.h"
+#include "Transport.hh"
+#include "TransportPort.hh"
+#include "TransportPortSet.hh"
+#include "TransportController.hh"
+
+namespace {
+  namespace OT = OCPI::Transport;
+
+  const unsigned nBuffers = 2;
+  const size_t bufferSize = 1024;
+
+  void initDesc(OT::Descriptors &d, bool input) {
+    d.type = input ? OT::ConsumerDescT : OT::ProducerDescT;
+    d.role = OT::NoRole;
+    d.options = 0;
+    bzero((void *)&d.desc, sizeof(d.desc));
+    d.desc.nBuffers = nBuffers;
+    d.desc.dataBufferSize = bufferSize;
+    strcpy(d.desc.oob.oep, "ocpi-smb-pio");
+  }
+
+  // An output port connected to an input port in another transport in this process,
+  // the way ports of different containers connect locally
+  struct Connection {
+    OT::TransportManager m_manager;
+    OT::Transport m_inTransport, m_outTransport;
+    OT::Descriptors m_inDesc, m_outDesc;
+    OT::Port *m_in, *m_out;
+    Connection()
+      : m_manager(0, false), m_inTransport(&m_manager, false), m_outTransport(&m_manager, false) {
+      initDesc(m_inDesc, true);
+      initDesc(m_outDesc, false);
+      OT::Descriptors inFeedback, outFeedback;
+      bool inDone = false, outDone = false;
+      m_in = m_inTransport.createInputPort(m_inDesc);
+      m_out = m_outTransport.createOutputPort(m_outDesc, m_inDesc);
+      const OT::Descriptors *result = m_out->finalize(&m_inDesc, m_outDesc, &outFeedback, outDone);
+      if (result) {
+	result = m_in->finalize(result, m_inDesc, &inFeedback, inDone);
+	if (result)
+	  result = m_out->finalize(result, m_outDesc, &outFeedback, outDone);
+      }
+      EXPECT_TRUE( inDone && outDone && !result );
+    }
+    size_t templates() {
+      size_t nTemplates = 0, nRequests = 0, nZeroCopies = 0, nBytes = 0;
+      m_out->getPortSet()->getTxController()->
+	templateStats(nTemplates, nRequests, nZeroCopies, nBytes);
+      return nTemplates;
+    }
+    // Send a message and receive it
+    void send(uint8_t opcode) {
+      uint8_t *data;
+      size_t length;
+      OT::BufferUserFacet *ob = m_out->getNextEmptyOutputBuffer(data, length);
+      ASSERT_TRUE( ob != NULL );
+      ASSERT_EQ( length, bufferSize );
+      memset(data, opcode, 16);
+      m_out->sendOutputBuffer(ob, 16, opcode);
+      bool end;
+      uint8_t op;
+      OT::BufferUserFacet *ib;
+      for (unsigned n = 0; !(ib = m_in->getNextFullInputBuffer(data, length, op, end)); n++) {
+	ASSERT_LT( n, 1000000u );
+	m_outTransport.dispatch();
+	m_inTransport.dispatch();
+      }
+      EXPECT_EQ( op, opcode );
+      EXPECT_EQ( length, 16u );
+      EXPECT_EQ( data[15], opcode );
+      m_in->releaseInputBuffer(ib);
+    }
+  };
+
+  // Output templates are created for each buffer combination as it is first used
+  TEST( TestLazyTemplates, firstUse )
+  {
+    unsetenv("OCPI_EAGER_TRANSFER_TEMPLATES");
+    Connection c;
+    EXPECT_EQ( c.templates(), 0u );
+    c.send(1);
+    EXPECT_EQ( c.templates(), 1u );
+    c.send(2);
+    EXPECT_EQ( c.templates(), 2u );
+    // Output and input buffers are used in step, so the other combinations never are
+    for (uint8_t op = 3; op < 3 + 2 * nBuffers; op++)
+      c.send(op);
+    EXPECT_EQ( c.templates(), nBuffers );
+  }
+
+  // Unless they are all created when connecting
+  TEST( TestLazyTemplates, eager )
+  {
+    setenv("OCPI_EAGER_TRANSFER_TEMPLATES", "1", 1);
+    Connection c;
+    unsetenv("OCPI_EAGER_TRANSFER_TEMPLATES");
+    EXPECT_EQ( c.templates(), nBuffers * nBuffers );
+    for (uint8_t op = 1; op <= 2 * nBuffers; op++)
+      c.send(op);
+    EXPECT_EQ( c.templates(), nBuffers * nBuffers );
+  }
+
+} // anon namespace
@@ -0,0 +1,187 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "ezxml.h"
+
+namespace {
+  using namespace std;
+
+  // A parsed document with the buffer that it may point into
+  struct Doc {
+    vector<char> m_buf;
+    ezxml_t m_xml;
+    Doc(const string &s, bool arena) : m_buf(s.begin(), s.end()) {
+      m_buf.push_back('\0');
+      m_xml = arena ? ezxml_parse_str_arena(&m_buf[0], s.size()) :
+	ezxml_parse_str(&m_buf[0], s.size());
+    }
+    ~Doc() { ezxml_free(m_xml); }
+    string xml() const {
+      char *cp = ezxml_toxml(m_xml);
+      string s(cp);
+      free(cp);
+      return s;
+    }
+    string error() const { return ezxml_error(m_xml); }
+  };
+
+  const char *const documents[] = {
+    "<a/>",
+    "<a x='1' y=\"two\" z='&lt;&amp;&gt;'>text<b/>more<c q='1'>inner</c>tail</a>",
+    "<?xml version='1.0'?><!-- comment --><a><?pi stuff?><b><![CDATA[<raw>]]></b></a>",
+    "<a><b n='1'/><c/><b n='2'/><d><b/></d><c/><b n='3'/></a>",
+    "<!DOCTYPE a [<!ENTITY e 'expanded'><!ATTLIST a d CDATA 'default'>]><a x='&e;'>&e;</a>",
+    "<a x='1' x2='2' x3='3' x4='4' x5='5' x6='6' x7='7' x8='8' x9='9' x10='10'/>",
+  };
+
+  // Arena mode must produce the same document as the malloc mode
+  TEST( TestEzxmlArena, sameDocument )
+  {
+    for (size_t n = 0; n < sizeof(documents)/sizeof(*documents); n++) {
+      Doc normal(documents[n], false), arena(documents[n], true);
+      ASSERT_TRUE( normal.m_xml != NULL );
+      ASSERT_TRUE( arena.m_xml != NULL );
+      EXPECT_EQ( normal.error(), "" ) << documents[n];
+      EXPECT_EQ( arena.error(), "" ) << documents[n];
+      EXPECT_EQ( normal.xml(), arena.xml() ) << documents[n];
+    }
+  }
+
+  // The next, sibling and ordered lists are built as when each tag was inserted
+  TEST( TestEzxmlArena, tagLists )
+  {
+    for (unsigned mode = 0; mode < 2; mode++) {
+      Doc d(documents[3], mode != 0);
+      ezxml_t b = ezxml_child(d.m_xml, "b");
+      ASSERT_TRUE( b != NULL );
+      EXPECT_STREQ( ezxml_attr(b, "n"), "1" );
+      EXPECT_STREQ( ezxml_attr(b->next, "n"), "2" );
+      EXPECT_STREQ( ezxml_attr(b->next->next, "n"), "3" );
+      EXPECT_TRUE( b->next->next->next == NULL );
+      EXPECT_STREQ( b->sibling->name, "c" );
+      EXPECT_STREQ( b->sibling->sibling->name, "d" );
+      EXPECT_TRUE( b->sibling->sibling->sibling == NULL );
+      const char *order[] = { "b", "c", "b", "d", "c", "b" };
+      size_t i = 0;
+      for (ezxml_t x = d.m_xml->child; x; x = x->ordered, i++) {
+	ASSERT_LT( i, sizeof(order)/sizeof(*order) );
+	EXPECT_STREQ( x->name, order[i] );
+      }
+      EXPECT_EQ( i, sizeof(order)/sizeof(*order) );
+      EXPECT_STREQ( ezxml_attr(ezxml_child(d.m_xml, "d")->child, "n"), NULL );
+    }
+  }
+
+  // Many siblings, which used to be quadratic
+  TEST( TestEzxmlArena, wide )
+  {
+    const unsigned nTags = 20000;
+    string s("<a>");
+    for (unsigned n = 0; n < nTags; n++) {
+      char buf[40];
+      snprintf(buf, sizeof(buf), "<%c i='%u'>t</%c>", n % 3 ? 'b' : 'c', n, n % 3 ? 'b' : 'c');
+      s += buf;
+    }
+    s += "</a>";
+    Doc normal(s, false), arena(s, true);
+    EXPECT_EQ( normal.xml(), arena.xml() );
+    unsigned nb = 0, nc = 0, last = 0;
+    for (ezxml_t x = ezxml_child(arena.m_xml, "b"); x; x = x->next, nb++) {
+      unsigned i = (unsigned)atoi(ezxml_attr(x, "i"));
+      EXPECT_TRUE( nb == 0 || i > last );
+      last = i;
+    }
+    for (ezxml_t x = ezxml_child(arena.m_xml, "c"); x; x = x->next)
+      nc++;
+    EXPECT_EQ( nb + nc, nTags );
+    EXPECT_EQ( nc, (nTags + 2) / 3 );
+  }
+
+  // The mutation API works on arena tags and attribute lists
+  TEST( TestEzxmlArena, mutate )
+  {
+    Doc d(documents[1], true);
+    ezxml_t c = ezxml_child(d.m_xml, "c");
+    ASSERT_TRUE( c != NULL );
+    ezxml_set_attr(d.m_xml, "y", "changed");
+    ezxml_set_attr(d.m_xml, "x", NULL);
+    ezxml_set_attr(d.m_xml, "new", "added");
+    ezxml_set_attr(c, "q", NULL);
+    ezxml_set_txt(c, "replaced");
+    ezxml_add_child(c, "added", strlen("replaced"));
+    EXPECT_STREQ( ezxml_attr(d.m_xml, "y"), "changed" );
+    EXPECT_STREQ( ezxml_attr(d.m_xml, "x"), NULL );
+    EXPECT_STREQ( ezxml_attr(d.m_xml, "new"), "added" );
+    EXPECT_STREQ( ezxml_attr(d.m_xml, "z"), "<&>" );
+    EXPECT_STREQ( ezxml_attr(c, "q"), NULL );
+    EXPECT_EQ( d.xml(),
+	       "<a y=\"changed\" z=\"&lt;&amp;&gt;\" new=\"added\">text<b/>more"
+	       "<c>replaced<added/></c>tail</a>" );
+    // a tag cut from an arena document is still usable while the document exists
+    ezxml_t b = ezxml_cut(ezxml_child(d.m_xml, "b"));
+    EXPECT_STREQ( b->name, "b" );
+    ezxml_insert(b, c, 0);
+    EXPECT_TRUE( ezxml_child(d.m_xml, "b") == NULL );
+    EXPECT_TRUE( ezxml_child(c, "b") != NULL );
+  }
+
+  // Bad input gets the same error and partial document in both modes
+  TEST( TestEzxmlArena, errors )
+  {
+    const char *const bad[] = {
+      "<a><b></a>", "<a x='1></a>", "<a>", "<a></b>", "<a><b x='1' y='2'><c/>", "",
+    };
+    for (size_t n = 0; n < sizeof(bad)/sizeof(*bad); n++) {
+      Doc normal(bad[n], false), arena(bad[n], true);
+      EXPECT_NE( normal.error(), "" ) << bad[n];
+      EXPECT_EQ( normal.error(), arena.error() ) << bad[n];
+      EXPECT_EQ( normal.xml(), arena.xml() ) << bad[n];
+    }
+  }
+
+  TEST( TestEzxmlArena, file )
+  {
+    char name[] = "/tmp/test-ezxml-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE( fd, 0 );
+    const char *doc = documents[4];
+    ASSERT_EQ( write(fd, doc, strlen(doc)), (ssize_t)strlen(doc) );
+    close(fd);
+    Doc normal(doc, false);
+    ezxml_t x = ezxml_parse_file_arena(name);
+    unlink(name);
+    ASSERT_TRUE( x != NULL );
+    EXPECT_STREQ( ezxml_error(x), "" );
+    char *cp = ezxml_toxml(x);
+    EXPECT_EQ( normal.xml(), cp );
+    free(cp);
+    EXPECT_STREQ( ezxml_attr(x, "d"), "default" );
+    EXPECT_STREQ( ezxml_txt(x), "expanded" );
+    ezxml_free(x);
+  }
+
+} // anon namespace
@@ -0,0 +1,91 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include "gtest/gtest.h"
+#include "UtilHash.hh"
+
+namespace {
+  namespace OM = OCPI::Util::Misc;
+
+  // a simple source of well mixed keys
+  uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  // Hashed distribution must send a key to the same member wherever it is computed,
+  // so the mapping must never change
+  TEST( TestJumpHash, stable )
+  {
+    EXPECT_EQ( OM::jumpHash(0, 1000), 0u );
+    EXPECT_EQ( OM::jumpHash(1, 10), 6u );
+    EXPECT_EQ( OM::jumpHash(1, 1000), 549u );
+    EXPECT_EQ( OM::jumpHash(0xdeadbeefULL, 2), 1u );
+    EXPECT_EQ( OM::jumpHash(0xdeadbeefULL, 10), 5u );
+    EXPECT_EQ( OM::jumpHash(0xdeadbeefULL, 1000), 285u );
+    EXPECT_EQ( OM::jumpHash(0x0123456789abcdefULL, 1000), 194u );
+    EXPECT_EQ( OM::jumpHash(~0ULL, 10), 9u );
+    EXPECT_EQ( OM::jumpHash(~0ULL, 1000), 313u );
+  }
+
+  TEST( TestJumpHash, range )
+  {
+    for (uint64_t k = 0; k < 1000; k++) {
+      EXPECT_EQ( OM::jumpHash(mix(k), 1), 0u );
+      for (size_t n = 2; n < 40; n += 7)
+        EXPECT_LT( OM::jumpHash(mix(k), n), n );
+    }
+  }
+
+  // Each bucket gets close to its share of the keys
+  TEST( TestJumpHash, distribution )
+  {
+    const size_t nBuckets = 16, nKeys = 160000;
+    std::vector<size_t> counts(nBuckets);
+    for (uint64_t k = 0; k < nKeys; k++)
+      counts[OM::jumpHash(mix(k), nBuckets)]++;
+    for (size_t b = 0; b < nBuckets; b++) {
+      EXPECT_GT( counts[b], nKeys / nBuckets * 95 / 100 );
+      EXPECT_LT( counts[b], nKeys / nBuckets * 105 / 100 );
+    }
+  }
+
+  // Adding a bucket only moves keys to the new bucket, and moves about 1/n of them
+  TEST( TestJumpHash, consistent )
+  {
+    const size_t nKeys = 100000;
+    for (size_t n = 1; n < 20; n++) {
+      size_t moved = 0;
+      for (uint64_t k = 0; k < nKeys; k++) {
+        size_t before = OM::jumpHash(mix(k), n), after = OM::jumpHash(mix(k), n + 1);
+        if (before != after) {
+          EXPECT_EQ( after, n );
+          moved++;
+        }
+      }
+      EXPECT_GT( moved, nKeys / (n + 1) * 9 / 10 );
+      EXPECT_LT( moved, nKeys / (n + 1) * 11 / 10 );
+    }
+  }
+
+} // anon namespace
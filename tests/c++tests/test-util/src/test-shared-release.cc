@@ -0,0 +1,155 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <pthread.h>
+#include "gtest/gtest.h"
+#include "UtilSharedRelease.hh"
+
+namespace {
+  namespace OU = OCPI::Util;
+
+  // A buffer that records the order in which buffers are released
+  struct Buffer {
+    OU::ShareCount m_shares;
+    std::vector<unsigned> &m_released;
+    unsigned m_n;
+    Buffer(std::vector<unsigned> &released, unsigned n) : m_released(released), m_n(n) {}
+    OU::ShareCount &shares() { return m_shares; }
+    void release() { m_released.push_back(m_n); }
+  };
+
+  // A buffer shared by several readers is released when the last is done
+  TEST( TestSharedRelease, sharing )
+  {
+    std::vector<unsigned> released;
+    OU::SharedRelease<Buffer> sr;
+    Buffer b(released, 0);
+    b.shares().add();
+    b.shares().add();
+    sr.release(b);
+    EXPECT_TRUE( released.empty() );
+    EXPECT_EQ( sr.waiting(), 1u );
+    b.shares().remove();
+    sr.poll();
+    EXPECT_TRUE( released.empty() );
+    b.shares().remove();
+    sr.poll();
+    ASSERT_EQ( released.size(), 1u );
+    EXPECT_EQ( sr.waiting(), 0u );
+    // With nothing waiting, an unshared buffer is released at once
+    Buffer c(released, 1);
+    sr.release(c);
+    EXPECT_EQ( released.size(), 2u );
+  }
+
+  // Buffers are released in the order they were sent, even when later readers finish first
+  TEST( TestSharedRelease, order )
+  {
+    std::vector<unsigned> released;
+    OU::SharedRelease<Buffer> sr;
+    Buffer b0(released, 0), b1(released, 1), b2(released, 2), b3(released, 3);
+    b0.shares().add();
+    b1.shares().add();
+    sr.release(b0);
+    sr.release(b1);
+    sr.release(b2); // not shared, but sent after ones that are
+    b1.shares().remove();
+    sr.poll();
+    EXPECT_TRUE( released.empty() );
+    b0.shares().remove();
+    sr.release(b3);
+    std::vector<unsigned> expected;
+    for (unsigned n = 0; n < 4; n++)
+      expected.push_back(n);
+    EXPECT_EQ( released, expected );
+    EXPECT_EQ( sr.waiting(), 0u );
+  }
+
+  // The sender is told to wait while "limit" buffers are waiting for the slowest reader
+  TEST( TestSharedRelease, lag )
+  {
+    std::vector<unsigned> released;
+    OU::SharedRelease<Buffer> sr;
+    std::vector<Buffer*> buffers;
+    for (unsigned n = 0; n < 3; n++)
+      buffers.push_back(new Buffer(released, n));
+    EXPECT_FALSE( sr.full() );
+    buffers[0]->shares().add();
+    sr.release(*buffers[0]);
+    EXPECT_FALSE( sr.full() ); // no limit by default
+    sr.setLimit(2);
+    EXPECT_FALSE( sr.full() );
+    buffers[1]->shares().add();
+    sr.release(*buffers[1]);
+    EXPECT_TRUE( sr.full() );
+    buffers[0]->shares().remove();
+    sr.poll();
+    EXPECT_FALSE( sr.full() );
+    EXPECT_EQ( sr.waiting(), 1u );
+    buffers[1]->shares().remove();
+    sr.release(*buffers[2]);
+    EXPECT_EQ( sr.waiting(), 0u );
+    EXPECT_EQ( released.size(), 3u );
+    for (unsigned n = 0; n < 3; n++)
+      delete buffers[n];
+  }
+
+  // Readers on other threads remove their shares while the sender polls
+  const unsigned nBuffers = 1000, nReaders = 4;
+  struct Reader {
+    std::vector<Buffer*> *buffers;
+    pthread_t thread;
+  };
+  void *readerThread(void *arg) {
+    std::vector<Buffer*> &buffers = *static_cast<Reader*>(arg)->buffers;
+    for (unsigned n = 0; n < buffers.size(); n++)
+      buffers[n]->shares().remove();
+    return NULL;
+  }
+
+  TEST( TestSharedRelease, threads )
+  {
+    std::vector<unsigned> released;
+    OU::SharedRelease<Buffer> sr;
+    std::vector<Buffer*> buffers;
+    for (unsigned n = 0; n < nBuffers; n++) {
+      buffers.push_back(new Buffer(released, n));
+      for (unsigned r = 0; r < nReaders; r++)
+	buffers.back()->shares().add();
+    }
+    Reader readers[nReaders];
+    for (unsigned r = 0; r < nReaders; r++) {
+      readers[r].buffers = &buffers;
+      ASSERT_EQ( pthread_create(&readers[r].thread, NULL, readerThread, &readers[r]), 0 );
+    }
+    for (unsigned n = 0; n < nBuffers; n++)
+      sr.release(*buffers[n]);
+    for (unsigned r = 0; r < nReaders; r++)
+      pthread_join(readers[r].thread, NULL);
+    sr.poll();
+    ASSERT_EQ( released.size(), nBuffers );
+    for (unsigned n = 0; n < nBuffers; n++)
+      EXPECT_EQ( released[n], n );
+    for (unsigned n = 0; n < nBuffers; n++)
+      delete buffers[n];
+  }
+
+} // anon namespace
@@ -0,0 +1,136 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file
+ * distributed with this source distribution.
+ *
+ * This file is part of OpenCPI <http://www.opencpi.org>
+ *
+ * OpenCPI is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include "gtest/gtest.h"
+#include "UtilTimerWheel.hh"
+
+namespace {
+  typedef OCPI::Util::TimerWheel TW;
+  // The wheel's tick is 2^16 ns, with 256 slots per level
+  const uint64_t tick = 1ull << 16, revolution = tick << 8;
+
+  TEST( TestTimerWheel, scheduleExpire )
+  {
+    TW w;
+    TW::Timer t1, t2;
+    uint64_t start = TW::now();
+    EXPECT_EQ( w.nextDeadline(), UINT64_MAX );
+    w.schedule(t1, start + 10 * tick);
+    w.schedule(t2, start + 20 * tick);
+    EXPECT_TRUE( t1.armed() );
+    EXPECT_EQ( t1.deadline(), start + 10 * tick );
+    EXPECT_EQ( w.nextDeadline(), start + 10 * tick );
+    EXPECT_EQ( w.advance(start + 5 * tick), 0u );
+    EXPECT_FALSE( t1.expired() );
+    // Within the tick of the deadline, only timers whose deadline has passed expire
+    EXPECT_EQ( w.advance(start + 10 * tick - 1), 0u );
+    EXPECT_EQ( w.advance(start + 10 * tick), 1u );
+    EXPECT_TRUE( t1.expired() );
+    EXPECT_FALSE( t1.armed() );
+    EXPECT_EQ( t1.deadline(), start + 10 * tick );
+    EXPECT_FALSE( t2.expired() );
+    EXPECT_EQ( w.nextDeadline(), start + 20 * tick );
+    EXPECT_EQ( w.advance(start + 100 * tick), 1u );
+    EXPECT_TRUE( t2.expired() );
+    EXPECT_EQ( w.nextDeadline(), UINT64_MAX );
+    // Rescheduling clears the expiration
+    w.schedule(t1, start + 200 * tick);
+    EXPECT_FALSE( t1.expired() );
+    EXPECT_TRUE( t1.armed() );
+    // A deadline in the past expires on the next advance
+    w.schedule(t2, start);
+    EXPECT_EQ( w.advance(start + 101 * tick), 1u );
+    EXPECT_TRUE( t2.expired() );
+  }
+
+  TEST( TestTimerWheel, cancel )
+  {
+    TW w;
+    TW::Timer t1, t2;
+    uint64_t start = TW::now();
+    w.schedule(t1, start + 10 * tick);
+    w.schedule(t2, start + 10 * tick);
+    t1.cancel();
+    EXPECT_FALSE( t1.armed() );
+    EXPECT_EQ( t1.deadline(), 0u );
+    EXPECT_EQ( w.advance(start + 20 * tick), 1u );
+    EXPECT_FALSE( t1.expired() );
+    EXPECT_TRUE( t2.expired() );
+    // Cancelling clears an expiration
+    t2.cancel();
+    EXPECT_FALSE( t2.expired() );
+    // A timer that is destroyed while armed leaves the wheel
+    {
+      TW::Timer t3;
+      w.schedule(t3, start + 30 * tick);
+    }
+    EXPECT_EQ( w.nextDeadline(), UINT64_MAX );
+    EXPECT_EQ( w.advance(start + 40 * tick), 0u );
+  }
+
+  // Deadlines in higher levels, past the end of the first level's slots, and beyond the
+  // range of all levels, cascade down and expire in order
+  TEST( TestTimerWheel, wrapAround )
+  {
+    TW w;
+    uint64_t start = TW::now();
+    const uint64_t offsets[] = {
+      1, tick * 255, tick * 256, tick * 300, revolution * 3 + 7, revolution * 256 + tick,
+      revolution * 256 * 256 * 2, revolution * 256 * 256 * 256 * 3,
+    };
+    const size_t n = sizeof(offsets)/sizeof(*offsets);
+    std::vector<TW::Timer> timers(n);
+    // Schedule in reverse so that insertion order does not match deadline order
+    for (size_t i = n; i--; )
+      w.schedule(timers[i], start + offsets[i]);
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_EQ( w.nextDeadline(), start + offsets[i] ) << i;
+      EXPECT_EQ( w.advance(start + offsets[i] - 1), 0u ) << i;
+      EXPECT_EQ( w.advance(start + offsets[i]), 1u ) << i;
+      for (size_t j = 0; j < n; j++)
+	EXPECT_EQ( timers[j].expired(), j <= i ) << i << " " << j;
+    }
+    EXPECT_EQ( w.nextDeadline(), UINT64_MAX );
+  }
+
+  // Many timers in the same slot, and periodic rescheduling across slot wrap
+  TEST( TestTimerWheel, periodic )
+  {
+    TW w;
+    uint64_t start = TW::now(), period = 7 * tick + 3;
+    std::vector<TW::Timer> timers(100);
+    for (size_t i = 0; i < timers.size(); i++)
+      w.schedule(timers[i], start + period);
+    unsigned fired = 0;
+    uint64_t now = start;
+    for (unsigned p = 1; p <= 100; p++) {
+      now = start + p * period;
+      fired += w.advance(now);
+      for (size_t i = 0; i < timers.size(); i++) {
+	ASSERT_TRUE( timers[i].expired() ) << p;
+	w.schedule(timers[i], timers[i].deadline() + period);
+      }
+    }
+    EXPECT_EQ( fired, 100u * 100u );
+    EXPECT_EQ( w.nextDeadline(), now + period );
+  }
+
+} // anon namespace
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+# This file is protected by Copyright. Please refer to the COPYRIGHT file
+# distributed with this source distribution.
+#
+# This file is part of OpenCPI <http://www.opencpi.org>
+#
+# OpenCPI is free software: you can redistribute it and/or modify it under the
+# terms of the GNU Lesser General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or (at your option) any
+# later version.
+#
+# OpenCPI is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+# A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+# details.
+#
+# You should have received a copy of the GNU Lesser General Public License along
+# with this program. If not, see <http://www.gnu.org/licenses/>.
+import unittest
+import sys
+import os
+import array
+sys.path.append(os.getenv('OCPI_CDK_DIR') + '/' + os.getenv('OCPI_TOOL_PLATFORM') + '/lib/')
+import opencpi.aci as aci
+
+"""
+This file contains the unit tests for the batched external port I/O of the Python ACI:
+ExternalPort.writeMessages and ExternalPort.readMessages
+"""
+APP_XML = ("<application package='ocpi.core'>"
+           "  <instance component='bias' name='b'>"
+           "    <property name='biasValue' value='0'/>"
+           "  </instance>"
+           "  <connection><external name='to'/><port instance='b' name='in'/></connection>"
+           "  <connection><external name='from'/><port instance='b' name='out'/></connection>"
+           "</application>")
+TIMEOUT_US = 5000000
+
+class AciMessagesTest(unittest.TestCase):
+    def setUp(self):
+        self.app = aci.Application(APP_XML)
+        self.app.initialize()
+        self.to_port = self.app.getPort("to")
+        self.from_port = self.app.getPort("from")
+        self.app.start()
+
+    def tearDown(self):
+        self.app.stop()
+        del self.app
+
+    def read(self, n_messages):
+        """
+        read n_messages messages, returning them as a list of bytes objects
+        """
+        size = self.from_port.bufferSize()
+        messages = []
+        while len(messages) < n_messages:
+            data = bytearray(size * (n_messages - len(messages)))
+            offsets = array.array('Q', [0] * (n_messages - len(messages) + 1))
+            n, eof = self.from_port.readMessages(data, offsets, None, TIMEOUT_US)
+            self.assertGreater(n, 0)
+            self.assertFalse(eof)
+            messages += [bytes(data[offsets[i]:offsets[i + 1]]) for i in range(n)]
+        return messages
+
+    def test_write_read(self):
+        """
+        write several messages in one call and read them back through the bias worker
+        """
+        messages = [bytes(range(4 * n, 8 * n)) for n in range(1, 6)]
+        offsets = array.array('Q', [0])
+        for message in messages:
+            offsets.append(offsets[-1] + len(message))
+        n = self.to_port.writeMessages(b"".join(messages), offsets, None, TIMEOUT_US)
+        assert n == len(messages)
+        assert self.read(len(messages)) == messages
+
+    def test_write_too_large(self):
+        """
+        messages from the first one larger than the buffer size on are not written,
+        and the port is still usable afterward
+        """
+        size = self.to_port.bufferSize()
+        data = bytes(4) + bytes(size + 4) + bytes(8)
+        offsets = array.array('Q', [0, 4, size + 8, size + 16])
+        assert self.to_port.writeMessages(data, offsets, None, TIMEOUT_US) == 1
+        assert self.to_port.writeMessages(b"\x01\x02\x03\x04", array.array('Q', [0, 4]),
+                                          None, TIMEOUT_US) == 1
+        assert self.read(2) == [bytes(4), b"\x01\x02\x03\x04"]
+
+    def test_bad_offsets(self):
+        """
+        offsets that are not ascending within the data raise ValueError
+        """
+        self.assertRaises(ValueError, self.to_port.writeMessages,
+                          bytes(8), array.array('Q', [0, 8, 4]))
+        self.assertRaises(ValueError, self.to_port.writeMessages,
+                          bytes(8), array.array('Q', [0, 12]))
+
+if __name__ == '__main__':
+    unittest.main()
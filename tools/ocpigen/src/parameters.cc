@@ -348,7 +348,7 @@ doDefaults(bool missingOk) {
 	  if (p.m_defaultExpr.length()) {
 	    // If the default is an expression, reevaluate it with the current parameter values.
 	    params[n].m_value.setType(p);    // blank default value
-	    params[n].m_value.parse(p.m_defaultExpr.c_str(), NULL, false, this, NULL);
+	    p.parseDefaultExpr(params[n].m_value, *this);
 	    params[n].m_isDefault = false;
 	  } else
 	    params[n].m_value = *p.m_default; // assignment operator to copy the value
@@ -1718,14 +1718,22 @@ emitRccCppImpl(FILE *f) {
           bool isLast;
           //      m_worker->rccType(type, *m, 1, offset, pad, on.c_str(), false, isLast,
           worker().rccBaseType(type, *m, 1, offset, pad, on.c_str(), false, isLast, 0);
+          // The layout constants let optimized builds access the argument inline
           fprintf(f,
                   "       class %sArg : public OCPI::RCC::RCCPortOperationArg { \n"
+                  "       public:\n"
+                  "          static constexpr size_t c_offset = %zu, c_align = %zu, c_elementBytes = %zu;\n"
+                  "          static constexpr bool c_isSequence = %s, c_isOnly = %s;\n"
                   "       private:\n"
                   "          mutable %s *m_myptr;\n",
-                  a.c_str(), type.c_str());
+                  a.c_str(), m->m_offset, m->m_align, m->m_elementBytes,
+                  m->m_isSequence ? "true" : "false", o->nArgs() == 1 ? "true" : "false",
+                  type.c_str());
           std::string get;
           // FIXME: CACHE THIS UNTIL BUFFER CHANGES...
-          OU::format(get, "m_myptr = (%s *)getArgAddress(%s, %s);\n",
+          OU::format(get,
+                     "m_myptr = (%s *)getArgAddress(c_offset, c_align, c_elementBytes, "
+                     "c_isSequence, c_isOnly, %s, %s);\n",
                      type.c_str(), m->m_isSequence ? "&m_size" : "NULL",
                      m->m_isSequence ? "&m_capacity" : "NULL");
           if (m->m_isSequence)
@@ -1760,7 +1768,7 @@ emitRccCppImpl(FILE *f) {
                                     m->cname());
               fprintf(f,
                       "         inline void resize(size_t size) {\n"
-                      "           setArgSize(size);\n"
+                      "           setArgSize(c_offset, c_align, c_elementBytes, c_isOnly, size);\n"
                       "         }\n");
             }
           }